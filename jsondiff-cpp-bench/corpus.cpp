@@ -0,0 +1,261 @@
+#include "corpus.h"
+
+#include <cstdio>
+#include <random>
+
+namespace jsondiff
+{
+	namespace bench
+	{
+		static const char* shape_names[CS_SHAPE_COUNT] = { "wide_object", "deep_nesting", "scalar_array", "record_array", "big_strings" };
+		static const size_t default_sizes[CS_SHAPE_COUNT] = { 10000, 256, 20000, 5000, 1024 };
+		static const size_t big_string_size = 64 * 1024;
+
+		const char* corpus_shape_name(CorpusShape shape)
+		{
+			return shape < CS_SHAPE_COUNT ? shape_names[shape] : "unknown";
+		}
+
+		CorpusShape corpus_shape_by_name(const std::string& name)
+		{
+			for (int i = 0; i < CS_SHAPE_COUNT; i++)
+			{
+				if (name == shape_names[i])
+					return (CorpusShape)i;
+			}
+			return CS_SHAPE_COUNT;
+		}
+
+		size_t corpus_default_size(CorpusShape shape)
+		{
+			return shape < CS_SHAPE_COUNT ? default_sizes[shape] : 0;
+		}
+
+		// only mt19937 itself is used, the std distributions differ between standard libraries
+		class CorpusRandom
+		{
+		private:
+			std::mt19937 _rng;
+		public:
+			explicit CorpusRandom(uint32_t seed) : _rng(seed) {}
+
+			uint32_t next() { return _rng(); }
+			uint32_t below(uint32_t n) { return _rng() % n; }
+			bool chance(double p) { return _rng() / 4294967296.0 < p; }
+		};
+
+		static std::string make_name(const char* prefix, size_t i)
+		{
+			char name[48];
+			snprintf(name, sizeof(name), "%s-%08u", prefix, (unsigned)i);
+			return name;
+		}
+
+		static JsonValue make_scalar(CorpusRandom& rng, size_t i)
+		{
+			switch (i % 5)
+			{
+			case 0: return JsonValue((int64_t)rng.below(1000000000));
+			case 1: return JsonValue(rng.below(1000000) * 0.25);
+			case 2: return JsonValue(make_name("s", rng.below(100000000)));
+			case 3: return JsonValue(rng.below(2) == 1);
+			default: return JsonValue();
+			}
+		}
+
+		static JsonValue make_record(CorpusRandom& rng, size_t i)
+		{
+			fc::variants tags;
+			tags.push_back(make_name("tag", rng.below(16)));
+			tags.push_back(make_name("tag", rng.below(16)));
+			fc::mutable_variant_object record;
+			record.reserve(5);
+			record.set("id", (int64_t)i);
+			record.set("name", make_name("record", i));
+			record.set("balance", (int64_t)rng.below(100000000));
+			record.set("active", rng.below(2) == 1);
+			record.set("tags", std::move(tags));
+			return record;
+		}
+
+		static JsonValue make_document(CorpusShape shape, size_t size, CorpusRandom& rng)
+		{
+			switch (shape)
+			{
+			case CS_WIDE_OBJECT:
+			{
+				fc::mutable_variant_object obj;
+				obj.reserve(size);
+				for (size_t i = 0; i < size; i++)
+					obj.set(make_name("key", i), make_scalar(rng, i));
+				return obj;
+			}
+			case CS_DEEP_NESTING:
+			{
+				// built from the innermost level out
+				JsonValue doc = fc::mutable_variant_object("leaf", (int64_t)rng.below(1000));
+				for (size_t level = size; level > 0; level--)
+				{
+					fc::mutable_variant_object obj;
+					obj.reserve(4);
+					obj.set("level", (int64_t)level);
+					obj.set("name", make_name("node", rng.below(100000000)));
+					obj.set("value", rng.below(1000000) * 0.5);
+					obj.set("child", std::move(doc));
+					doc = std::move(obj);
+				}
+				return doc;
+			}
+			case CS_SCALAR_ARRAY:
+			{
+				fc::variants items;
+				items.reserve(size);
+				for (size_t i = 0; i < size; i++)
+					items.push_back(make_scalar(rng, i % 4));
+				return items;
+			}
+			case CS_RECORD_ARRAY:
+			{
+				fc::variants items;
+				items.reserve(size);
+				for (size_t i = 0; i < size; i++)
+					items.push_back(make_record(rng, i));
+				return items;
+			}
+			case CS_BIG_STRINGS:
+			{
+				size_t count = size / 64 > 0 ? size / 64 : 1;
+				fc::mutable_variant_object obj;
+				obj.reserve(count);
+				for (size_t i = 0; i < count; i++)
+				{
+					std::string text(big_string_size, ' ');
+					for (auto& c : text)
+						c = (char)('a' + rng.below(26));
+					obj.set(make_name("text", i), std::move(text));
+				}
+				return obj;
+			}
+			default:
+				return JsonValue();
+			}
+		}
+
+		// copies a document, changing the leaves, members and items picked by the change ratio
+		class CorpusMutator
+		{
+		private:
+			CorpusRandom& _rng;
+			double _ratio;
+			// change the first leaf reached whatever the ratio, so that no version equals its base
+			bool _force;
+			size_t _added;
+		public:
+			size_t changes;
+
+			CorpusMutator(CorpusRandom& rng, double ratio, bool force)
+				: _rng(rng), _ratio(ratio), _force(force), _added(0), changes(0) {}
+
+			JsonValue change_scalar(const JsonValue& value)
+			{
+				changes++;
+				switch (value.get_type())
+				{
+				case fc::variant::int64_type:
+					return JsonValue(value.as_int64() + 1 + _rng.below(1000));
+				case fc::variant::uint64_type:
+					return JsonValue(value.as_uint64() + 1 + _rng.below(1000));
+				case fc::variant::double_type:
+					return JsonValue(value.as_double() + 0.5);
+				case fc::variant::bool_type:
+					return JsonValue(!value.as_bool());
+				case fc::variant::string_type:
+				{
+					auto text = value.as_string();
+					if (text.size() < 64)
+						return JsonValue(text + "-changed");
+					// one character of a big string
+					auto& c = text[_rng.below((uint32_t)text.size())];
+					c = c == 'z' ? 'a' : (char)(c + 1);
+					return JsonValue(std::move(text));
+				}
+				default:
+					return JsonValue((int64_t)_rng.below(1000));
+				}
+			}
+
+			JsonValue added_like(const JsonValue& value)
+			{
+				changes++;
+				if (value.is_object() || value.is_array())
+				{
+					// a copy with every leaf changed
+					CorpusMutator all(_rng, 1, false);
+					return all.mutate(value);
+				}
+				return make_scalar(_rng, _rng.below(4));
+			}
+
+			JsonValue mutate(const JsonValue& value)
+			{
+				if (value.is_object())
+				{
+					const auto& obj = value.get_object();
+					fc::mutable_variant_object result;
+					result.reserve(obj.size());
+					for (auto it = obj.begin(); it != obj.end(); ++it)
+					{
+						if (_rng.chance(_ratio / 4))
+						{
+							changes++;
+							continue;
+						}
+						result.set(it->key(), mutate(it->value()));
+						if (_rng.chance(_ratio / 4))
+							result.set(make_name("added", _added++), added_like(it->value()));
+					}
+					return result;
+				}
+				if (value.is_array())
+				{
+					const auto& items = value.get_array();
+					fc::variants result;
+					result.reserve(items.size());
+					for (const auto& item : items)
+					{
+						if (_rng.chance(_ratio / 4))
+						{
+							changes++;
+							continue;
+						}
+						result.push_back(mutate(item));
+						if (_rng.chance(_ratio / 4))
+							result.push_back(added_like(item));
+					}
+					return result;
+				}
+				if (_force || _rng.chance(_ratio))
+				{
+					_force = false;
+					return change_scalar(value);
+				}
+				return value;
+			}
+		};
+
+		CorpusPair make_corpus(CorpusShape shape, size_t size, double change_ratio, uint32_t seed)
+		{
+			CorpusRandom rng(seed);
+			CorpusPair pair;
+			pair.old_json = make_document(shape, size, rng);
+			CorpusMutator mutator(rng, change_ratio, false);
+			pair.new_json = mutator.mutate(pair.old_json);
+			if (mutator.changes == 0)
+			{
+				CorpusMutator forced(rng, change_ratio, true);
+				pair.new_json = forced.mutate(pair.old_json);
+			}
+			return pair;
+		}
+	}
+}
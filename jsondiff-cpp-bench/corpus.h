@@ -0,0 +1,44 @@
+#ifndef JSONDIFF_BENCH_CORPUS_H
+#define JSONDIFF_BENCH_CORPUS_H
+
+#include <jsondiff/json_value_types.h>
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace jsondiff
+{
+	namespace bench
+	{
+		// the shapes of synthetic documents the benchmark suite runs on
+		enum CorpusShape
+		{
+			CS_WIDE_OBJECT = 0, // one flat object of `size` members
+			CS_DEEP_NESTING = 1, // `size` levels of objects nested in each other, a few scalars per level
+			CS_SCALAR_ARRAY = 2, // one array of `size` numbers, strings and bools
+			CS_RECORD_ARRAY = 3, // one array of `size` small records with an "id" member
+			CS_BIG_STRINGS = 4, // an object of `size` / 64 strings of 64kb
+			CS_SHAPE_COUNT = 5
+		};
+
+		const char* corpus_shape_name(CorpusShape shape);
+		// CS_SHAPE_COUNT if name is not a shape
+		CorpusShape corpus_shape_by_name(const std::string& name);
+		// the size the suite uses for a shape when no scale is given
+		size_t corpus_default_size(CorpusShape shape);
+
+		struct CorpusPair
+		{
+			JsonValue old_json;
+			JsonValue new_json;
+		};
+
+		// a document of the given shape and a new version of it where about change_ratio of the leaves are changed,
+		// and about change_ratio / 4 of the object members and array items are deleted and as many added.
+		// the same shape, size, ratio and seed give the same documents on every platform
+		CorpusPair make_corpus(CorpusShape shape, size_t size, double change_ratio, uint32_t seed);
+	}
+}
+
+#endif
@@ -0,0 +1,1625 @@
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <cstdio>
+#include <thread>
+#include <jsondiff/exceptions.h>
+#include <jsondiff/jsondiff.h>
+#include <jsondiff/json_patch.h>
+#include <jsondiff/mapped_file.h>
+#include <jsondiff/tracked_document.h>
+#include <jsondiff/version_store.h>
+#include "corpus.h"
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+using namespace jsondiff;
+
+// global allocation counters, every heap allocation of the process goes through here.
+// atomic for the parallel benches, the high-water mark is only approximate there
+static std::atomic<size_t> g_alloc_count(0);
+static std::atomic<size_t> g_alloc_bytes(0);
+// bytes currently allocated and their high-water mark, each block keeps its size in a header
+static std::atomic<size_t> g_live_bytes(0);
+static std::atomic<size_t> g_peak_bytes(0);
+static const size_t alloc_header_size = 16;
+
+void* operator new(size_t size)
+{
+	g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+	g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+	size_t live = g_live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+	if (live > g_peak_bytes.load(std::memory_order_relaxed))
+		g_peak_bytes.store(live, std::memory_order_relaxed);
+	char* p = (char*)std::malloc(size + alloc_header_size);
+	if (!p)
+		throw std::bad_alloc();
+	*(size_t*)p = size;
+	return p + alloc_header_size;
+}
+
+void* operator new[](size_t size)
+{
+	return ::operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	if (!p)
+		return;
+	char* block = (char*)p - alloc_header_size;
+	g_live_bytes.fetch_sub(*(size_t*)block, std::memory_order_relaxed);
+	std::free(block);
+}
+
+void operator delete[](void* p) noexcept
+{
+	::operator delete(p);
+}
+
+namespace legacy
+{
+	// the diff algorithm before the const reference traversal, copies both subtrees at every level.
+	// kept here as the baseline of the allocation comparison
+	DiffResultP diff(const JsonValue& old_json, const JsonValue& new_json)
+	{
+		auto old_json_type = guess_json_value_type(old_json);
+		auto new_json_type = guess_json_value_type(new_json);
+		if (is_scalar_json_value_type(old_json_type) || old_json_type != new_json_type)
+		{
+			bool changed = old_json_type != new_json_type
+				|| (old_json_type == JVT_STRING ? old_json.as_string() != new_json.as_string() : json_dumps(old_json) != json_dumps(new_json));
+			if (!changed)
+				return DiffResult::make_undefined_diff_result();
+			fc::mutable_variant_object result_json;
+			result_json[JSONDIFF_KEY_OLD_VALUE] = old_json;
+			result_json[JSONDIFF_KEY_NEW_VALUE] = new_json;
+			return std::make_shared<DiffResult>(result_json);
+		}
+		else if (old_json_type == JVT_OBJECT)
+		{
+			auto a_obj = old_json.as<fc::mutable_variant_object>();
+			auto b_obj = new_json.as<fc::mutable_variant_object>();
+			fc::mutable_variant_object diff_json;
+			for (auto i = a_obj.begin(); i != a_obj.end(); i++)
+			{
+				auto a_i_value = i->value();
+				auto a_i_key = i->key();
+				if (b_obj.find(a_i_key) == b_obj.end())
+					diff_json[a_i_key + JSONDIFF_KEY_DELETED_POSTFIX] = a_i_value;
+				else
+				{
+					auto sub_diff_value = diff(a_i_value, b_obj[a_i_key]);
+					if (sub_diff_value->is_undefined())
+						continue;
+					diff_json[a_i_key] = sub_diff_value->value();
+				}
+			}
+			for (auto j = b_obj.begin(); j != b_obj.end(); j++)
+			{
+				if (a_obj.find(j->key()) == a_obj.end())
+					diff_json[j->key() + JSONDIFF_KEY_ADDED_POSTFIX] = j->value();
+			}
+			if (diff_json.size() < 1)
+				return DiffResult::make_undefined_diff_result();
+			return std::make_shared<DiffResult>(diff_json);
+		}
+		else
+		{
+			auto a_array = old_json.as<fc::variants>();
+			auto b_array = new_json.as<fc::variants>();
+			fc::variants diff_json;
+			for (size_t i = 0; i < a_array.size(); i++)
+			{
+				if (i >= b_array.size())
+				{
+					diff_json.push_back(make_array_diff_item("-", i, a_array[i]));
+					continue;
+				}
+				auto item_value_diff = diff(a_array[i], b_array[i]);
+				if (item_value_diff->is_undefined())
+					continue;
+				diff_json.push_back(make_array_diff_item("~", i, item_value_diff->value()));
+			}
+			for (size_t i = a_array.size(); i < b_array.size(); i++)
+				diff_json.push_back(make_array_diff_item("+", i, b_array[i]));
+			if (diff_json.size() < 1)
+				return DiffResult::make_undefined_diff_result();
+			return std::make_shared<DiffResult>(diff_json);
+		}
+	}
+}
+
+// a document of `depth` nested levels, every level has `width` scalar members, one array and one child object
+static JsonValue make_nested_document(size_t depth, size_t width, int64_t leaf_value)
+{
+	fc::mutable_variant_object obj;
+	for (size_t i = 0; i < width; i++)
+		obj["k" + std::to_string(i)] = std::string("value-") + std::to_string(i);
+	fc::variants items;
+	for (size_t i = 0; i < width; i++)
+		items.push_back((int64_t)i);
+	obj["items"] = items;
+	if (depth > 0)
+		obj["child"] = make_nested_document(depth - 1, width, leaf_value);
+	else
+		obj["leaf"] = leaf_value;
+	return obj;
+}
+
+struct BenchRecord
+{
+	size_t allocs;
+	size_t bytes;
+	double ns;
+	std::string output;
+};
+
+template <typename F>
+static BenchRecord measure(F f, size_t iterations)
+{
+	BenchRecord record;
+	auto allocs_before = g_alloc_count.load();
+	auto bytes_before = g_alloc_bytes.load();
+	auto start = std::chrono::steady_clock::now();
+	DiffResultP result;
+	for (size_t i = 0; i < iterations; i++)
+		result = f();
+	auto end = std::chrono::steady_clock::now();
+	record.allocs = (g_alloc_count - allocs_before) / iterations;
+	record.bytes = (g_alloc_bytes - bytes_before) / iterations;
+	record.ns = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+	record.output = result->str();
+	return record;
+}
+
+static void bench_nested_diff(size_t depth, size_t width, size_t iterations)
+{
+	auto old_json = make_nested_document(depth, width, 1);
+	auto new_json = make_nested_document(depth, width, 2);
+	JsonDiff json_diff;
+	auto before = measure([&]() { return legacy::diff(old_json, new_json); }, iterations);
+	auto after = measure([&]() { return json_diff.diff(old_json, new_json); }, iterations);
+	if (before.output != after.output)
+	{
+		std::cerr << "diff output mismatch at depth " << depth << std::endl;
+		std::exit(1);
+	}
+	std::cout << "diff_nested depth=" << std::setw(3) << depth << " width=" << std::setw(3) << width
+		<< " | before: " << std::setw(9) << before.allocs << " allocs " << std::setw(11) << before.bytes << " bytes " << std::setw(12) << (size_t)before.ns << " ns"
+		<< " | after: " << std::setw(9) << after.allocs << " allocs " << std::setw(11) << after.bytes << " bytes " << std::setw(12) << (size_t)after.ns << " ns"
+		<< std::endl;
+}
+
+// a flat object of `key_count` members, every 100th value changed, every 1000th key removed and replaced by a new one
+// every renamed_every-th key is renamed (deleted and added), every 100th value changes
+static void make_wide_objects(size_t key_count, JsonValue& old_json, JsonValue& new_json, size_t renamed_every = 1000)
+{
+	fc::mutable_variant_object old_obj;
+	fc::mutable_variant_object new_obj;
+	old_obj.reserve(key_count);
+	new_obj.reserve(key_count);
+	for (size_t i = 0; i < key_count; i++)
+	{
+		auto key = "account-" + std::to_string(i);
+		old_obj.set(key, (int64_t)i);
+		if (i % renamed_every == renamed_every - 1)
+			new_obj.set("new-account-" + std::to_string(i), (int64_t)i);
+		else
+			new_obj.set(key, (int64_t)(i % 100 == 0 ? i + 1 : i));
+	}
+	old_json = old_obj;
+	new_json = new_obj;
+}
+
+static void bench_wide_object(size_t key_count, size_t iterations, bool with_legacy, size_t renamed_every = 1000)
+{
+	JsonValue old_json;
+	JsonValue new_json;
+	make_wide_objects(key_count, old_json, new_json, renamed_every);
+	JsonDiff json_diff;
+	auto diff_record = measure([&]() { return json_diff.diff(old_json, new_json); }, iterations);
+	auto diff_result = json_diff.diff(old_json, new_json);
+	auto patch_record = measure([&]() { json_diff.patch(old_json, diff_result); return diff_result; }, iterations);
+	auto rollback_record = measure([&]() { json_diff.rollback(new_json, diff_result); return diff_result; }, iterations);
+	std::cout << "wide_object keys=" << std::setw(7) << key_count << " renamed=1/" << std::setw(4) << std::left << renamed_every << std::right
+		<< " | diff: " << std::setw(12) << (size_t)diff_record.ns << " ns"
+		<< " | patch: " << std::setw(12) << (size_t)patch_record.ns << " ns"
+		<< " | rollback: " << std::setw(12) << (size_t)rollback_record.ns << " ns";
+	if (with_legacy)
+	{
+		auto legacy_record = measure([&]() { return legacy::diff(old_json, new_json); }, iterations);
+		std::cout << " | linear find diff: " << std::setw(12) << (size_t)legacy_record.ns << " ns";
+	}
+	std::cout << std::endl;
+}
+
+// a state document of `section_count` nested sections, of which a single leaf changes between versions.
+// the versions are built separately so they share no fc storage with the base
+static void bench_repeated_diff_against_base(size_t section_count, size_t iterations)
+{
+	fc::mutable_variant_object base_obj;
+	for (size_t i = 0; i < section_count; i++)
+		base_obj["section-" + std::to_string(i)] = make_nested_document(3, 8, 1);
+	JsonValue base_json = base_obj;
+	fc::mutable_variant_object version_obj;
+	for (size_t i = 0; i < section_count; i++)
+		version_obj["section-" + std::to_string(i)] = make_nested_document(3, 8, i == section_count / 2 ? 2 : 1);
+	JsonValue version_json = version_obj;
+
+	JsonDiff plain_diff;
+	DiffOptions fingerprint_options;
+	fingerprint_options.use_fingerprints = true;
+	JsonDiff fingerprint_diff(fingerprint_options);
+	JsonFingerprintCache base_fingerprints;
+	JsonFingerprintCache version_fingerprints;
+	plain_diff.diff(base_json, version_json, base_fingerprints, version_fingerprints);
+
+	auto plain = measure([&]() { return plain_diff.diff(base_json, version_json); }, iterations);
+	auto fresh = measure([&]() { return fingerprint_diff.diff(base_json, version_json); }, iterations);
+	auto cached = measure([&]() { return plain_diff.diff(base_json, version_json, base_fingerprints); }, iterations);
+	auto both_cached = measure([&]() { return plain_diff.diff(base_json, version_json, base_fingerprints, version_fingerprints); }, iterations);
+	if (plain.output != fresh.output || plain.output != cached.output || plain.output != both_cached.output)
+	{
+		std::cerr << "fingerprint diff output mismatch" << std::endl;
+		std::exit(1);
+	}
+	std::cout << "repeated_diff sections=" << std::setw(5) << section_count
+		<< " | plain: " << std::setw(12) << (size_t)plain.ns << " ns " << std::setw(8) << plain.allocs << " allocs"
+		<< " | fingerprints: " << std::setw(12) << (size_t)fresh.ns << " ns " << std::setw(8) << fresh.allocs << " allocs"
+		<< " | cached base: " << std::setw(12) << (size_t)cached.ns << " ns " << std::setw(8) << cached.allocs << " allocs"
+		<< " | both cached: " << std::setw(12) << (size_t)both_cached.ns << " ns " << std::setw(8) << both_cached.allocs << " allocs"
+		<< std::endl;
+}
+
+// an array of `item_count` objects, the new version has `front_count` items inserted at the front
+// and, if edit_stride is set, every edit_stride-th old item replaced
+static void bench_array_diff(size_t item_count, size_t front_count, size_t edit_stride, size_t iterations)
+{
+	fc::variants old_items;
+	fc::variants new_items;
+	old_items.reserve(item_count);
+	new_items.reserve(item_count + front_count);
+	for (size_t i = 0; i < front_count; i++)
+		new_items.push_back(fc::mutable_variant_object("id", "front-" + std::to_string(i)));
+	for (size_t i = 0; i < item_count; i++)
+	{
+		old_items.push_back(fc::mutable_variant_object("id", "item-" + std::to_string(i)));
+		if (edit_stride > 0 && i % edit_stride == 0)
+			new_items.push_back(fc::mutable_variant_object("id", "edited-" + std::to_string(i)));
+		else
+			new_items.push_back(old_items.back());
+	}
+	JsonValue old_json = old_items;
+	JsonValue new_json = new_items;
+	JsonDiff json_diff;
+	auto positional = measure([&]() { return legacy::diff(old_json, new_json); }, iterations);
+	auto sequence = measure([&]() { return json_diff.diff(old_json, new_json); }, iterations);
+	auto diff_result = json_diff.diff(old_json, new_json);
+	if (json_dumps(json_diff.patch(old_json, diff_result)) != json_dumps(new_json))
+	{
+		std::cerr << "array diff patch mismatch" << std::endl;
+		std::exit(1);
+	}
+	std::cout << "array_diff items=" << std::setw(7) << item_count << " front inserts=" << std::setw(3) << front_count << " edit stride=" << std::setw(4) << edit_stride
+		<< " | positional: " << std::setw(12) << (size_t)positional.ns << " ns " << std::setw(10) << positional.output.size() << " bytes of diff"
+		<< " | sequence: " << std::setw(12) << (size_t)sequence.ns << " ns " << std::setw(10) << sequence.output.size() << " bytes of diff"
+		<< std::endl;
+}
+
+// a list of `item_count` records with an "id" member, the new version has every swap_stride-th pair of records swapped
+// and one record moved from the back to the front
+static void bench_keyed_array_diff(size_t item_count, size_t swap_stride, size_t iterations)
+{
+	fc::variants old_items;
+	old_items.reserve(item_count);
+	for (size_t i = 0; i < item_count; i++)
+		old_items.push_back(fc::mutable_variant_object("id", "record-" + std::to_string(i))("balance", (int64_t)i));
+	fc::variants new_items = old_items;
+	for (size_t i = 0; i + 1 < item_count; i += swap_stride)
+		std::swap(new_items[i], new_items[i + 1]);
+	std::rotate(new_items.begin(), new_items.end() - 1, new_items.end());
+	fc::mutable_variant_object old_obj;
+	old_obj["records"] = old_items;
+	fc::mutable_variant_object new_obj;
+	new_obj["records"] = new_items;
+	JsonValue old_json = old_obj;
+	JsonValue new_json = new_obj;
+
+	JsonDiff sequence_diff;
+	DiffOptions keyed_options;
+	keyed_options.array_keys.push_back(ArrayKey("/records", "id"));
+	JsonDiff keyed_diff(keyed_options);
+	auto sequence = measure([&]() { return sequence_diff.diff(old_json, new_json); }, iterations);
+	auto keyed = measure([&]() { return keyed_diff.diff(old_json, new_json); }, iterations);
+	auto sequence_result = sequence_diff.diff(old_json, new_json);
+	auto keyed_result = keyed_diff.diff(old_json, new_json);
+	auto sequence_patch = measure([&]() { sequence_diff.patch(old_json, sequence_result); return sequence_result; }, iterations);
+	auto keyed_patch = measure([&]() { keyed_diff.patch(old_json, keyed_result); return keyed_result; }, iterations);
+	if (json_dumps(keyed_diff.patch(old_json, keyed_result)) != json_dumps(new_json)
+		|| json_dumps(keyed_diff.rollback(new_json, keyed_result)) != json_dumps(old_json))
+	{
+		std::cerr << "keyed array diff patch mismatch" << std::endl;
+		std::exit(1);
+	}
+	std::cout << "keyed_array_diff items=" << std::setw(7) << item_count << " swap stride=" << std::setw(5) << swap_stride
+		<< " | sequence: diff " << std::setw(12) << (size_t)sequence.ns << " ns patch " << std::setw(12) << (size_t)sequence_patch.ns << " ns " << std::setw(10) << sequence.output.size() << " bytes of diff"
+		<< " | keyed: diff " << std::setw(12) << (size_t)keyed.ns << " ns patch " << std::setw(12) << (size_t)keyed_patch.ns << " ns " << std::setw(10) << keyed.output.size() << " bytes of diff"
+		<< std::endl;
+}
+
+// patch and roll back a one leaf change of a document of `section_count` nested sections,
+// returning a new document vs. patching in place
+static void bench_patch_inplace(size_t section_count, size_t iterations)
+{
+	fc::mutable_variant_object old_obj;
+	fc::mutable_variant_object new_obj;
+	for (size_t i = 0; i < section_count; i++)
+	{
+		old_obj["section-" + std::to_string(i)] = make_nested_document(3, 8, 1);
+		new_obj["section-" + std::to_string(i)] = make_nested_document(3, 8, i == section_count / 2 ? 2 : 1);
+	}
+	JsonValue old_json = old_obj;
+	JsonValue new_json = new_obj;
+	JsonDiff json_diff;
+	auto diff_result = json_diff.diff(old_json, new_json);
+	auto copying = measure([&]() { json_diff.patch(old_json, diff_result); return diff_result; }, iterations);
+	auto deep_clone = measure([&]() { json_deep_clone(old_json); return diff_result; }, iterations);
+	JsonValue json = old_json;
+	auto inplace = measure([&]() {
+		json_diff.patch_inplace(json, *diff_result);
+		json_diff.rollback_inplace(json, *diff_result);
+		return diff_result;
+	}, iterations);
+	if (json_dumps(json) != json_dumps(old_json))
+	{
+		std::cerr << "in place patch mismatch" << std::endl;
+		std::exit(1);
+	}
+	std::cout << "patch_one_leaf sections=" << std::setw(5) << section_count
+		<< " | patch: " << std::setw(12) << (size_t)copying.ns << " ns " << std::setw(8) << copying.allocs << " allocs"
+		<< " | patch_inplace + rollback_inplace: " << std::setw(12) << (size_t)inplace.ns << " ns " << std::setw(8) << inplace.allocs << " allocs"
+		<< " | json_deep_clone alone: " << std::setw(12) << (size_t)deep_clone.ns << " ns"
+		<< std::endl;
+}
+
+// objects of `leaf_count` number/bool/null leaves in groups of 16, every 1000th leaf changed.
+// compares the typed scalar comparison of the diff with comparing serialized leaves
+static void bench_leaf_heavy_diff(size_t leaf_count, size_t iterations)
+{
+	fc::mutable_variant_object old_obj;
+	fc::mutable_variant_object new_obj;
+	std::vector<std::pair<JsonValue, JsonValue>> leaves;
+	leaves.reserve(leaf_count);
+	for (size_t group = 0; group * 16 < leaf_count; group++)
+	{
+		fc::mutable_variant_object old_group;
+		fc::mutable_variant_object new_group;
+		for (size_t i = group * 16; i < leaf_count && i < group * 16 + 16; i++)
+		{
+			JsonValue leaf;
+			switch (i % 4)
+			{
+			case 0: leaf = JsonValue((int64_t)(6000000000LL + i)); break;
+			case 1: leaf = JsonValue(i * 0.25); break;
+			case 2: leaf = JsonValue(i % 3 == 0); break;
+			default: break;
+			}
+			auto key = "v" + std::to_string(i % 16);
+			old_group[key] = leaf;
+			new_group[key] = i % 1000 == 0 ? JsonValue((int64_t)i) : leaf;
+			leaves.push_back(std::make_pair(leaf, i % 1000 == 0 ? JsonValue((int64_t)i) : leaf));
+		}
+		old_obj["group-" + std::to_string(group)] = old_group;
+		new_obj["group-" + std::to_string(group)] = new_group;
+	}
+	JsonValue old_json = old_obj;
+	JsonValue new_json = new_obj;
+	JsonDiff json_diff;
+	auto diff_record = measure([&]() { return json_diff.diff(old_json, new_json); }, iterations);
+	size_t changed = 0;
+	auto serialized = measure([&]() {
+		for (const auto& leaf : leaves)
+			changed += json_dumps(leaf.first) != json_dumps(leaf.second);
+		return DiffResult::make_undefined_diff_result();
+	}, iterations);
+	auto typed = measure([&]() {
+		for (const auto& leaf : leaves)
+			changed += !json_scalar_equal(leaf.first, leaf.second);
+		return DiffResult::make_undefined_diff_result();
+	}, iterations);
+	std::cout << "leaf_heavy_diff leaves=" << std::setw(8) << leaf_count
+		<< " | diff: " << std::setw(12) << (size_t)diff_record.ns << " ns " << std::setw(8) << diff_record.allocs << " allocs"
+		<< " | leaves by json_dumps: " << std::setw(12) << (size_t)serialized.ns << " ns " << std::setw(8) << serialized.allocs << " allocs"
+		<< " | leaves by json_scalar_equal: " << std::setw(12) << (size_t)typed.ns << " ns " << std::setw(8) << typed.allocs << " allocs"
+		<< std::endl;
+}
+
+// apply one diff touching `changed_count` sections of a document to replicas,
+// decoding the diff json on every apply vs. compiling it once
+static void bench_compiled_patch(size_t section_count, size_t changed_count, size_t iterations)
+{
+	fc::mutable_variant_object old_obj;
+	fc::mutable_variant_object new_obj;
+	for (size_t i = 0; i < section_count; i++)
+	{
+		auto key = "section-" + std::to_string(i);
+		old_obj[key] = make_nested_document(2, 8, 1);
+		if (i % (section_count / changed_count) == 0)
+			new_obj[i % 2 ? key : "renamed-" + key] = make_nested_document(2, 8, 2);
+		else
+			new_obj[key] = make_nested_document(2, 8, 1);
+	}
+	JsonValue old_json = old_obj;
+	JsonValue new_json = new_obj;
+	JsonDiff json_diff;
+	auto diff_json = json_diff.diff(old_json, new_json)->value();
+	JsonValue replica = old_json;
+	auto decoding = measure([&]() {
+		// a fresh DiffResult has no compiled form yet, so every apply decodes the diff json
+		DiffResult diff_result(diff_json);
+		json_diff.patch_inplace(replica, diff_result);
+		json_diff.rollback_inplace(replica, diff_result);
+		return DiffResult::make_undefined_diff_result();
+	}, iterations);
+	CompiledDiff compiled(diff_json);
+	auto precompiled = measure([&]() {
+		json_diff.patch_inplace(replica, compiled);
+		json_diff.rollback_inplace(replica, compiled);
+		return DiffResult::make_undefined_diff_result();
+	}, iterations);
+	auto compile_only = measure([&]() { CompiledDiff compiled_again(diff_json); return DiffResult::make_undefined_diff_result(); }, iterations);
+	if (!json_equal(replica, old_json))
+	{
+		std::cerr << "compiled patch mismatch" << std::endl;
+		std::exit(1);
+	}
+	std::cout << "compiled_patch sections=" << std::setw(5) << section_count << " changed=" << std::setw(4) << changed_count
+		<< " | decode + patch + rollback: " << std::setw(12) << (size_t)decoding.ns << " ns " << std::setw(8) << decoding.allocs << " allocs"
+		<< " | compiled patch + rollback: " << std::setw(12) << (size_t)precompiled.ns << " ns " << std::setw(8) << precompiled.allocs << " allocs"
+		<< " | compile: " << std::setw(12) << (size_t)compile_only.ns << " ns"
+		<< std::endl;
+}
+
+// size and speed of the binary diff form against the json text form
+static void bench_binary_format(const char* name, const JsonValue& old_json, const JsonValue& new_json, size_t iterations)
+{
+	JsonDiff json_diff;
+	auto diff_result = json_diff.diff(old_json, new_json);
+	auto text = diff_result->str();
+	auto binary = diff_result->binary();
+	if (DiffResult::from_binary(binary)->str() != text)
+	{
+		std::cerr << "binary diff round trip mismatch in " << name << std::endl;
+		std::exit(1);
+	}
+	auto str_record = measure([&]() { text = diff_result->str(); return diff_result; }, iterations);
+	auto loads_record = measure([&]() { return std::make_shared<DiffResult>(json_loads(text)); }, iterations);
+	auto encode_record = measure([&]() { binary = diff_result->binary(); return diff_result; }, iterations);
+	auto decode_record = measure([&]() { return DiffResult::from_binary(binary); }, iterations);
+	std::cout << "binary_format " << std::setw(16) << name
+		<< " | json: " << std::setw(10) << text.size() << " bytes str " << std::setw(11) << (size_t)str_record.ns << " ns json_loads " << std::setw(11) << (size_t)loads_record.ns << " ns"
+		<< " | binary: " << std::setw(10) << binary.size() << " bytes encode " << std::setw(11) << (size_t)encode_record.ns << " ns decode " << std::setw(11) << (size_t)decode_record.ns << " ns"
+		<< std::endl;
+}
+
+static void bench_binary_formats()
+{
+	bench_binary_format("nested", make_nested_document(16, 64, 1), make_nested_document(16, 64, 2), 200);
+	{
+		JsonValue old_json;
+		JsonValue new_json;
+		make_wide_objects(20000, old_json, new_json);
+		bench_binary_format("wide_object", old_json, new_json, 50);
+	}
+	{
+		// a whole section added and another deleted, the diff is mostly values
+		fc::mutable_variant_object old_obj;
+		fc::mutable_variant_object new_obj;
+		for (size_t i = 0; i < 200; i++)
+		{
+			if (i != 0)
+				old_obj["section-" + std::to_string(i)] = make_nested_document(3, 8, (int64_t)i);
+			if (i != 199)
+				new_obj["section-" + std::to_string(i)] = make_nested_document(3, 8, (int64_t)(i % 10 == 0 ? i * 3 : i));
+		}
+		bench_binary_format("added_sections", old_obj, new_obj, 50);
+	}
+	{
+		fc::variants old_items;
+		fc::variants new_items;
+		for (size_t i = 0; i < 20000; i++)
+		{
+			old_items.push_back(fc::mutable_variant_object("id", (int64_t)i)("price", 1.5 * i));
+			if (i % 10 != 0)
+				new_items.push_back(old_items.back());
+			if (i % 7 == 0)
+				new_items.push_back(fc::mutable_variant_object("id", (int64_t)i)("price", 2.5 * i));
+		}
+		bench_binary_format("array_items", JsonValue(old_items), JsonValue(new_items), 20);
+	}
+}
+
+// peak resident set size of the process in bytes, memory mapped input pages included
+static size_t peak_rss_bytes()
+{
+#ifdef _WIN32
+	return 0;
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return (size_t)usage.ru_maxrss * 1024;
+#endif
+}
+
+// two versions of a state snapshot of about target_bytes each: a map of account buckets and a list of contracts.
+// the new version has every 1000th balance changed, every 5000th account deleted, an account added after every 7000th
+// and one contract near the end modified
+static void write_state_snapshots(const std::string& old_path, const std::string& new_path, size_t target_bytes, uint32_t seed)
+{
+	std::mt19937 rng(seed);
+	std::ofstream old_file(old_path, std::ios::binary);
+	std::ofstream new_file(new_path, std::ios::binary);
+	std::string header = "{\"height\":" + std::to_string(rng() % 1000000) + ",\"accounts\":{";
+	old_file << header;
+	new_file << header;
+	auto write_account = [&](std::ofstream& out, bool first, size_t id, uint64_t balance) {
+		char name[32];
+		snprintf(name, sizeof(name), "acc-%010u", (unsigned)id);
+		out << (first ? "" : ",") << "\"" << name << "\":{\"id\":" << id << ",\"name\":\"user " << id << "\",\"balance\":" << balance
+			<< ",\"frozen\":" << (id % 13 == 0 ? "true" : "false") << ",\"tags\":[\"t" << id % 7 << "\",\"t" << id % 11 << "\"],\"history\":[";
+		for (size_t h = 0; h < 3; h++)
+			out << (h ? "," : "") << "{\"block\":" << id * 3 + h << ",\"amount\":" << (balance >> h) << ",\"memo\":\"transfer " << h << "\"}";
+		out << "]}";
+	};
+	// accounts are grouped in buckets of 1000, a flat object of millions of keys takes quadratic time to parse into fc
+	size_t account_count = target_bytes / 300;
+	bool new_first = true;
+	for (size_t id = 0; id < account_count; id++)
+	{
+		if (id % 1000 == 0)
+		{
+			std::string bucket = std::string(id ? "}," : "") + "\"bucket-" + std::to_string(id / 1000) + "\":{";
+			old_file << bucket;
+			new_file << bucket;
+			new_first = true;
+		}
+		uint64_t balance = rng() % 100000000;
+		write_account(old_file, id % 1000 == 0, id, balance);
+		if (id % 5000 != 4999)
+		{
+			write_account(new_file, new_first, id, id % 1000 == 999 ? balance + 1 : balance);
+			new_first = false;
+		}
+		if (id % 7000 == 6999)
+		{
+			write_account(new_file, new_first, account_count + id, balance);
+			new_first = false;
+		}
+	}
+	if (account_count > 0)
+	{
+		old_file << "}";
+		new_file << "}";
+	}
+	old_file << "},\"contracts\":[";
+	new_file << "},\"contracts\":[";
+	for (size_t i = 0; i < 1000; i++)
+	{
+		std::string contract = std::string(i ? "," : "") + "{\"address\":\"c" + std::to_string(i) + "\",\"code_size\":" + std::to_string(i * 17) + "}";
+		old_file << contract;
+		if (i == 990)
+			new_file << ",{\"address\":\"c990\",\"code_size\":1}";
+		else
+			new_file << contract;
+	}
+	old_file << "]}";
+	new_file << "]}";
+}
+
+struct StreamBenchRecord
+{
+	double seconds;
+	size_t heap_peak;
+	size_t rss_peak;
+	std::string output;
+};
+
+static StreamBenchRecord run_file_diff(const std::string& old_path, const std::string& new_path, bool streaming)
+{
+	StreamBenchRecord record;
+	g_peak_bytes = g_live_bytes.load();
+	auto heap_before = g_live_bytes.load();
+	auto start = std::chrono::steady_clock::now();
+	JsonDiff json_diff;
+	if (streaming)
+	{
+		std::stringstream out;
+		json_diff.diff_files(old_path, new_path, out);
+		record.output = out.str();
+	}
+	else
+	{
+		auto read_file = [](const std::string& path) {
+			std::ifstream in(path, std::ios::binary);
+			std::stringstream ss;
+			ss << in.rdbuf();
+			return ss.str();
+		};
+		record.output = json_diff.diff_by_string(read_file(old_path), read_file(new_path))->str();
+	}
+	record.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	record.heap_peak = g_peak_bytes - heap_before;
+	record.rss_peak = peak_rss_bytes();
+	return record;
+}
+
+static void print_file_diff(const char* name, const StreamBenchRecord& record, size_t input_bytes)
+{
+	std::cout << " | " << name << ": " << std::setw(9) << (size_t)(record.seconds * 1000) << " ms "
+		<< std::setw(7) << (size_t)(input_bytes / record.seconds / (1 << 20)) << " MB/s heap peak " << std::setw(7) << (record.heap_peak >> 20) << " MB"
+		<< " rss peak " << std::setw(7) << (record.rss_peak >> 20) << " MB";
+}
+
+// streaming diff against parse-both-then-diff on generated snapshots of size_mb each. the peak rss is the process's,
+// so the streaming diff runs first; run one mode per process (`jsondiff_bench stream <mb> [dom]`) for separate peaks
+static void bench_stream_diff(size_t size_mb, bool with_stream, bool with_dom)
+{
+	std::string old_path = "jsondiff_bench_old.json";
+	std::string new_path = "jsondiff_bench_new.json";
+	write_state_snapshots(old_path, new_path, size_mb << 20, 20240501);
+	size_t input_bytes = 0;
+	{
+		MappedFile old_file(old_path);
+		MappedFile new_file(new_path);
+		input_bytes = old_file.size() + new_file.size();
+	}
+	std::cout << "stream_diff input=" << std::setw(6) << (input_bytes >> 20) << " MB";
+	StreamBenchRecord stream_record;
+	StreamBenchRecord dom_record;
+	if (with_stream)
+	{
+		stream_record = run_file_diff(old_path, new_path, true);
+		print_file_diff("stream", stream_record, input_bytes);
+	}
+	if (with_dom)
+	{
+		dom_record = run_file_diff(old_path, new_path, false);
+		print_file_diff("parse both", dom_record, input_bytes);
+	}
+	std::cout << " | " << std::max(stream_record.output.size(), dom_record.output.size()) << " bytes of diff" << std::endl;
+	std::remove(old_path.c_str());
+	std::remove(new_path.c_str());
+	if (with_stream && with_dom && stream_record.output != dom_record.output)
+	{
+		std::cerr << "stream diff output mismatch" << std::endl;
+		std::exit(1);
+	}
+}
+
+// the benchmark suite: every public operation on seeded synthetic corpora, one record per operation.
+// `jsondiff_bench suite --format json` prints one json object per line for tracking results between releases
+struct SuiteOptions
+{
+	std::string format;
+	uint32_t seed;
+	std::vector<double> ratios;
+	double scale;
+	double min_seconds;
+	std::vector<bench::CorpusShape> shapes;
+
+	SuiteOptions() : format("text"), seed(20240501), scale(1), min_seconds(0.2)
+	{
+		ratios.push_back(0.001);
+		ratios.push_back(0.01);
+		ratios.push_back(0.1);
+		for (int i = 0; i < bench::CS_SHAPE_COUNT; i++)
+			shapes.push_back((bench::CorpusShape)i);
+	}
+};
+
+struct SuiteRecord
+{
+	bench::CorpusShape shape;
+	size_t size;
+	double change_ratio;
+	size_t input_bytes;
+	std::string op;
+	size_t iterations;
+	double ns;
+	size_t allocs;
+	size_t bytes;
+	size_t output_bytes;
+};
+
+// run f at least once and until min_seconds have passed, the counters are per call
+template <typename F>
+static SuiteRecord measure_for(F f, double min_seconds)
+{
+	SuiteRecord record;
+	auto allocs_before = g_alloc_count.load();
+	auto bytes_before = g_alloc_bytes.load();
+	auto start = std::chrono::steady_clock::now();
+	size_t iterations = 0;
+	double elapsed = 0;
+	do
+	{
+		f();
+		iterations++;
+		elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	} while (elapsed < min_seconds);
+	record.iterations = iterations;
+	record.ns = elapsed * 1e9 / iterations;
+	record.allocs = (g_alloc_count - allocs_before) / iterations;
+	record.bytes = (g_alloc_bytes - bytes_before) / iterations;
+	record.output_bytes = 0;
+	return record;
+}
+
+static void print_suite_header(const SuiteOptions& options)
+{
+	if (options.format == "csv")
+		std::cout << "shape,size,change_ratio,seed,input_bytes,op,iterations,ns_per_op,allocs_per_op,bytes_per_op,output_bytes" << std::endl;
+}
+
+static void print_suite_record(const SuiteOptions& options, const SuiteRecord& record)
+{
+	auto shape = bench::corpus_shape_name(record.shape);
+	if (options.format == "json")
+	{
+		std::cout << "{\"shape\":\"" << shape << "\",\"size\":" << record.size << ",\"change_ratio\":" << record.change_ratio
+			<< ",\"seed\":" << options.seed << ",\"input_bytes\":" << record.input_bytes << ",\"op\":\"" << record.op
+			<< "\",\"iterations\":" << record.iterations << ",\"ns_per_op\":" << std::fixed << std::setprecision(1) << record.ns
+			<< std::defaultfloat << ",\"allocs_per_op\":" << record.allocs << ",\"bytes_per_op\":" << record.bytes
+			<< ",\"output_bytes\":" << record.output_bytes << "}" << std::endl;
+	}
+	else if (options.format == "csv")
+	{
+		std::cout << shape << "," << record.size << "," << record.change_ratio << "," << options.seed << "," << record.input_bytes
+			<< "," << record.op << "," << record.iterations << "," << std::fixed << std::setprecision(1) << record.ns << std::defaultfloat
+			<< "," << record.allocs << "," << record.bytes << "," << record.output_bytes << std::endl;
+	}
+	else
+	{
+		std::cout << std::left << std::setw(13) << shape << std::right << " size=" << std::setw(6) << record.size
+			<< " ratio=" << std::setw(6) << record.change_ratio << " | " << std::left << std::setw(21) << record.op << std::right
+			<< std::setw(13) << (size_t)record.ns << " ns/op " << std::setw(9) << record.allocs << " allocs "
+			<< std::setw(11) << record.bytes << " bytes " << std::setw(10) << record.output_bytes << " bytes out" << std::endl;
+	}
+}
+
+// an output stream that drops what is written, so the streaming writers are timed alone
+class DiscardBuffer : public std::streambuf
+{
+protected:
+	int overflow(int c) override
+	{
+		return c;
+	}
+	std::streamsize xsputn(const char*, std::streamsize count) override
+	{
+		return count;
+	}
+};
+
+static void bench_suite_corpus(const SuiteOptions& options, bench::CorpusShape shape, double change_ratio)
+{
+	size_t size = (size_t)(bench::corpus_default_size(shape) * options.scale);
+	if (size == 0)
+		size = 1;
+	auto corpus = bench::make_corpus(shape, size, change_ratio, options.seed);
+	const auto& old_json = corpus.old_json;
+	const auto& new_json = corpus.new_json;
+	auto old_text = json_dumps(old_json);
+	auto new_text = json_dumps(new_json);
+	JsonDiff json_diff;
+	auto diff_result = json_diff.diff(old_json, new_json);
+	if (!json_equal(json_diff.patch(old_json, diff_result), new_json) || !json_equal(json_diff.rollback(new_json, diff_result), old_json))
+	{
+		std::cerr << "suite patch mismatch in " << bench::corpus_shape_name(shape) << " at change ratio " << change_ratio << std::endl;
+		std::exit(1);
+	}
+	auto diff_text = diff_result->str();
+	auto pretty_text = diff_result->pretty_diff_str();
+	// the native documents are parsed once for native_diff and again on every native_diff_by_string run, reusing their arenas
+	NativeJsonDocument old_doc, new_doc;
+	old_doc.parse(old_text);
+	new_doc.parse(new_text);
+	if (json_diff.diff(old_doc.root(), new_doc.root())->str() != diff_text)
+	{
+		std::cerr << "suite native diff mismatch in " << bench::corpus_shape_name(shape) << " at change ratio " << change_ratio << std::endl;
+		std::exit(1);
+	}
+
+	std::vector<SuiteRecord> records;
+	records.push_back(measure_for([&]() { json_diff.diff(old_json, new_json); }, options.min_seconds));
+	records.back().op = "diff";
+	records.back().output_bytes = diff_text.size();
+	records.push_back(measure_for([&]() { json_diff.diff_by_string(old_text, new_text); }, options.min_seconds));
+	records.back().op = "diff_by_string";
+	records.back().output_bytes = diff_text.size();
+	records.push_back(measure_for([&]() { json_diff.diff(old_doc.root(), new_doc.root()); }, options.min_seconds));
+	records.back().op = "native_diff";
+	records.back().output_bytes = diff_text.size();
+	records.push_back(measure_for([&]() {
+		old_doc.parse(old_text);
+		new_doc.parse(new_text);
+		json_diff.diff(old_doc.root(), new_doc.root());
+	}, options.min_seconds));
+	records.back().op = "native_diff_by_string";
+	records.back().output_bytes = diff_text.size();
+	records.push_back(measure_for([&]() { json_diff.patch(old_json, diff_result); }, options.min_seconds));
+	records.back().op = "patch";
+	records.back().output_bytes = new_text.size();
+	records.push_back(measure_for([&]() { json_diff.rollback(new_json, diff_result); }, options.min_seconds));
+	records.back().op = "rollback";
+	records.back().output_bytes = old_text.size();
+	records.push_back(measure_for([&]() { diff_result->str(); }, options.min_seconds));
+	records.back().op = "str";
+	records.back().output_bytes = diff_text.size();
+	records.push_back(measure_for([&]() { diff_result->pretty_diff_str(); }, options.min_seconds));
+	records.back().op = "pretty_diff_str";
+	records.back().output_bytes = pretty_text.size();
+	DiscardBuffer discard_buffer;
+	std::ostream discard(&discard_buffer);
+	records.push_back(measure_for([&]() { diff_result->write_json(discard); }, options.min_seconds));
+	records.back().op = "write_json";
+	records.back().output_bytes = diff_text.size();
+	records.push_back(measure_for([&]() { diff_result->write_pretty_diff(discard); }, options.min_seconds));
+	records.back().op = "write_pretty_diff";
+	records.back().output_bytes = pretty_text.size();
+	for (auto& record : records)
+	{
+		record.shape = shape;
+		record.size = size;
+		record.change_ratio = change_ratio;
+		record.input_bytes = old_text.size();
+		print_suite_record(options, record);
+	}
+}
+
+static std::vector<std::string> split_list(const std::string& text)
+{
+	std::vector<std::string> items;
+	std::stringstream ss(text);
+	std::string item;
+	while (std::getline(ss, item, ','))
+	{
+		if (!item.empty())
+			items.push_back(item);
+	}
+	return items;
+}
+
+static bool parse_suite_options(int argc, char** argv, SuiteOptions& options)
+{
+	for (int i = 2; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (i + 1 >= argc)
+			return false;
+		std::string value = argv[++i];
+		if (arg == "--format")
+		{
+			if (value != "text" && value != "json" && value != "csv")
+				return false;
+			options.format = value;
+		}
+		else if (arg == "--seed")
+			options.seed = (uint32_t)std::stoul(value);
+		else if (arg == "--scale")
+			options.scale = std::stod(value);
+		else if (arg == "--min-time-ms")
+			options.min_seconds = std::stod(value) / 1000;
+		else if (arg == "--ratios")
+		{
+			options.ratios.clear();
+			for (const auto& item : split_list(value))
+				options.ratios.push_back(std::stod(item));
+		}
+		else if (arg == "--shapes")
+		{
+			options.shapes.clear();
+			for (const auto& item : split_list(value))
+			{
+				auto shape = bench::corpus_shape_by_name(item);
+				if (shape == bench::CS_SHAPE_COUNT)
+					return false;
+				options.shapes.push_back(shape);
+			}
+		}
+		else
+			return false;
+	}
+	return true;
+}
+
+static int run_suite(int argc, char** argv)
+{
+	SuiteOptions options;
+	bool parsed = false;
+	try
+	{
+		parsed = parse_suite_options(argc, argv, options);
+	}
+	catch (const std::exception&)
+	{
+		parsed = false;
+	}
+	if (!parsed)
+	{
+		std::cerr << "usage: jsondiff_bench suite [--format text|json|csv] [--seed n] [--scale factor] [--min-time-ms ms]"
+			<< " [--ratios 0.001,0.01,...] [--shapes wide_object,deep_nesting,scalar_array,record_array,big_strings]" << std::endl;
+		return 1;
+	}
+	print_suite_header(options);
+	for (auto shape : options.shapes)
+	{
+		for (auto ratio : options.ratios)
+			bench_suite_corpus(options, shape, ratio);
+	}
+	return 0;
+}
+
+// diff time of a corpus shape on pools of 1 to max_threads threads against the serial diff,
+// the parallel diffs are checked to be byte-identical to the serial one
+static void bench_parallel_scaling(bench::CorpusShape shape, double scale, size_t max_threads, double min_seconds)
+{
+	size_t size = (size_t)(bench::corpus_default_size(shape) * scale);
+	if (size == 0)
+		size = 1;
+	auto corpus = bench::make_corpus(shape, size, 0.01, 20240501);
+	JsonDiff serial_diff;
+	auto expected = serial_diff.diff(corpus.old_json, corpus.new_json)->str();
+	auto serial = measure_for([&]() { serial_diff.diff(corpus.old_json, corpus.new_json); }, min_seconds);
+	std::cout << std::left << std::setw(13) << bench::corpus_shape_name(shape) << std::right << " size=" << std::setw(7) << size
+		<< " | serial      " << std::setw(13) << (size_t)serial.ns << " ns/op" << std::endl;
+	for (size_t threads = 1; ; threads = std::min(threads * 2, max_threads))
+	{
+		DiffOptions options;
+		options.thread_pool = std::make_shared<ThreadPool>(threads);
+		JsonDiff parallel_diff(options);
+		if (parallel_diff.diff(corpus.old_json, corpus.new_json)->str() != expected)
+		{
+			std::cerr << "parallel diff mismatch in " << bench::corpus_shape_name(shape) << " with " << threads << " threads" << std::endl;
+			std::exit(1);
+		}
+		auto record = measure_for([&]() { parallel_diff.diff(corpus.old_json, corpus.new_json); }, min_seconds);
+		std::cout << std::left << std::setw(13) << bench::corpus_shape_name(shape) << std::right << " size=" << std::setw(7) << size
+			<< " | threads=" << std::setw(3) << threads << " " << std::setw(13) << (size_t)record.ns << " ns/op "
+			<< std::fixed << std::setprecision(2) << std::setw(6) << serial.ns / record.ns << "x" << std::defaultfloat << std::endl;
+		if (threads >= max_threads)
+			break;
+	}
+}
+
+// small contract storage like documents, each new one with one or two members changed
+static void make_storage_pairs(size_t count, std::vector<std::string>& old_texts, std::vector<std::string>& new_texts)
+{
+	std::mt19937 rng(20240501);
+	for (size_t i = 0; i < count; i++)
+	{
+		fc::mutable_variant_object allowances;
+		for (int k = 0; k < 3; k++)
+			allowances.set("spender" + std::to_string(rng() % 1000), (int64_t)(rng() % 100000));
+		fc::variants history;
+		for (int k = 0; k < 4; k++)
+			history.push_back((int64_t)(rng() % 1000000));
+		fc::mutable_variant_object storage;
+		storage.set("owner", "addr" + std::to_string(rng()));
+		storage.set("balance", (int64_t)(rng() % 1000000000));
+		storage.set("nonce", (int64_t)i);
+		storage.set("frozen", false);
+		storage.set("allowances", allowances);
+		storage.set("history", history);
+		old_texts.push_back(json_dumps(JsonValue(storage)));
+		storage.set("balance", (int64_t)(rng() % 1000000000));
+		if (rng() % 2 == 0)
+		{
+			history.push_back((int64_t)(rng() % 1000000));
+			storage.set("history", history);
+		}
+		new_texts.push_back(json_dumps(JsonValue(storage)));
+	}
+}
+
+// pairs per second of diff_batch against one diff call per pair, on the same small documents
+static void bench_batch_diff(size_t count, size_t threads)
+{
+	std::vector<std::string> old_texts, new_texts;
+	make_storage_pairs(count, old_texts, new_texts);
+	std::vector<JsonValue> old_values, new_values;
+	std::vector<JsonValuePair> value_pairs;
+	std::vector<JsonTextPair> text_pairs;
+	for (size_t i = 0; i < count; i++)
+	{
+		old_values.push_back(json_loads(old_texts[i]));
+		new_values.push_back(json_loads(new_texts[i]));
+		text_pairs.push_back(JsonTextPair(old_texts[i], new_texts[i]));
+	}
+	for (size_t i = 0; i < count; i++)
+		value_pairs.push_back(JsonValuePair(old_values[i], new_values[i]));
+
+	JsonDiff json_diff;
+	DiffOptions pool_options;
+	pool_options.thread_pool = std::make_shared<ThreadPool>(threads);
+	JsonDiff pool_diff(pool_options);
+	std::vector<DiffResult> results;
+	DiffBatchScratch scratch;
+	std::vector<std::string> expected;
+	for (size_t i = 0; i < count; i++)
+		expected.push_back(json_diff.diff_by_string(old_texts[i], new_texts[i])->str());
+	auto check = [&](const char* name) {
+		for (size_t i = 0; i < count; i++)
+		{
+			if (results[i].str() != expected[i])
+			{
+				std::cerr << "batch diff mismatch in " << name << " at pair " << i << std::endl;
+				std::exit(1);
+			}
+		}
+	};
+	json_diff.diff_batch(value_pairs.data(), count, results);
+	check("values");
+	json_diff.diff_batch(text_pairs.data(), count, results, scratch);
+	check("texts");
+	pool_diff.diff_batch(text_pairs.data(), count, results, scratch);
+	check("texts on pool");
+
+	auto report = [&](const char* name, const SuiteRecord& record) {
+		std::cout << "batch_diff pairs=" << std::setw(7) << count << " | " << std::left << std::setw(28) << name << std::right
+			<< std::setw(12) << (size_t)(count * 1e9 / record.ns) << " pairs/s " << std::setw(9) << record.allocs / count
+			<< " allocs/pair" << std::endl;
+	};
+	report("diff_by_string loop", measure_for([&]() {
+		for (size_t i = 0; i < count; i++)
+			json_diff.diff_by_string(old_texts[i], new_texts[i]);
+	}, 1));
+	report("diff loop", measure_for([&]() {
+		for (size_t i = 0; i < count; i++)
+			json_diff.diff(old_values[i], new_values[i]);
+	}, 1));
+	report("diff_batch values", measure_for([&]() { json_diff.diff_batch(value_pairs.data(), count, results); }, 1));
+	report("diff_batch texts", measure_for([&]() { json_diff.diff_batch(text_pairs.data(), count, results, scratch); }, 1));
+	std::string pool_name = "diff_batch texts threads=" + std::to_string(threads);
+	report(pool_name.c_str(), measure_for([&]() { pool_diff.diff_batch(text_pairs.data(), count, results, scratch); }, 1));
+}
+
+// merging the diffs of a chain of versions of a record array: compose against replaying the chain and diffing the ends
+static void bench_compose(size_t item_count, size_t version_count)
+{
+	std::mt19937 rng(7);
+	fc::variants items;
+	for (size_t i = 0; i < item_count; i++)
+		items.push_back(JsonValue(fc::mutable_variant_object("id", (uint64_t)i)("v", (uint64_t)rng())));
+	JsonDiff json_diff;
+	JsonValue first = items;
+	JsonValue previous = first;
+	std::vector<DiffResultP> diffs;
+	size_t next_id = item_count;
+	for (size_t k = 0; k < version_count; k++)
+	{
+		// each version changes a few records, drops one and adds one
+		for (size_t c = 0; c < 8; c++)
+			items[rng() % items.size()] = JsonValue(fc::mutable_variant_object("id", (uint64_t)(next_id++))("v", (uint64_t)rng()));
+		items.erase(items.begin() + rng() % items.size());
+		items.insert(items.begin() + rng() % items.size(), JsonValue(fc::mutable_variant_object("id", (uint64_t)(next_id++))("v", 0)));
+		JsonValue version = items;
+		diffs.push_back(json_diff.diff(previous, version));
+		previous = version;
+	}
+	JsonValue last = items;
+	auto composed = measure([&]() { return json_diff.compose(diffs); }, 1);
+	auto replayed = measure([&]() {
+		JsonValue json = first;
+		for (const auto& diff : diffs)
+			json_diff.patch_inplace(json, *diff);
+		return json_diff.diff(first, json);
+	}, 1);
+	auto result = json_diff.compose(diffs);
+	if (!json_equal(json_diff.patch(first, result), last) || !json_equal(json_diff.rollback(last, result), first))
+	{
+		std::cerr << "compose mismatch" << std::endl;
+		std::exit(1);
+	}
+	std::cout << "compose items=" << std::setw(7) << item_count << " versions=" << std::setw(4) << version_count
+		<< " | compose: " << std::setw(12) << (size_t)composed.ns << " ns " << std::setw(8) << composed.allocs << " allocs"
+		<< " | replay + diff: " << std::setw(12) << (size_t)replayed.ns << " ns " << std::setw(8) << replayed.allocs << " allocs"
+		<< std::endl;
+}
+
+// latency of reading random versions of a version store against the length of its history,
+// with keyframes against a log holding only the first version whole (and the newest one in memory)
+static void bench_version_store(size_t history, size_t keyframe_interval)
+{
+	std::mt19937 rng(11);
+	fc::variants items;
+	for (size_t i = 0; i < 2000; i++)
+		items.push_back(JsonValue(fc::mutable_variant_object("id", (uint64_t)i)("v", (uint64_t)rng())));
+	auto run = [&](size_t interval) {
+		std::string path = "jsondiff_bench_versions.log";
+		std::remove(path.c_str());
+		VersionStoreOptions options;
+		options.keyframe_interval = interval;
+		std::vector<double> latencies;
+		size_t log_size = 0;
+		{
+			VersionStore store(path, options);
+			fc::variants version_items = items;
+			std::mt19937 version_rng(13);
+			for (size_t k = 0; k < history; k++)
+			{
+				for (size_t c = 0; c < 4; c++)
+					version_items[version_rng() % version_items.size()] = JsonValue(fc::mutable_variant_object("id", (uint64_t)k)("v", (uint64_t)version_rng()));
+				store.commit(JsonValue(version_items));
+			}
+			store.flush();
+			std::mt19937 pick(17);
+			for (size_t i = 0; i < 200; i++)
+			{
+				uint64_t version = pick() % history;
+				auto start = std::chrono::steady_clock::now();
+				auto json = store.get(version);
+				latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+			}
+			log_size = (size_t)MappedFile(path).size();
+		}
+		std::remove(path.c_str());
+		std::sort(latencies.begin(), latencies.end());
+		double total = 0;
+		for (auto latency : latencies)
+			total += latency;
+		std::cout << "version_store history=" << std::setw(6) << history << " keyframe_interval=" << std::setw(6) << interval
+			<< " | random get: mean " << std::setw(10) << (size_t)(total / latencies.size()) << " us p50 " << std::setw(10) << (size_t)latencies[latencies.size() / 2]
+			<< " us p99 " << std::setw(10) << (size_t)latencies[latencies.size() * 99 / 100] << " us | log " << std::setw(10) << log_size << " bytes" << std::endl;
+	};
+	run(keyframe_interval);
+	run(history);
+}
+
+// equality and bounded diffs of two objects of `key_count` keys: equal ones, ones differing in their first member
+// and ones with every other member changed, diffed whole and with a budget of 16 changes
+static void bench_equal_and_budget(size_t key_count, size_t iterations)
+{
+	JsonValue base_json, equal_json, first_changed_json, half_changed_json;
+	{
+		fc::mutable_variant_object base_obj, equal_obj, first_obj, half_obj;
+		for (size_t i = 0; i < key_count; i++)
+		{
+			auto key = "key-" + std::to_string(i);
+			base_obj[key] = make_nested_document(1, 4, 1);
+			equal_obj[key] = make_nested_document(1, 4, 1);
+			first_obj[key] = make_nested_document(1, 4, i == 0 ? 2 : 1);
+			half_obj[key] = make_nested_document(1, 4, i % 2 == 0 ? 2 : 1);
+		}
+		base_json = base_obj;
+		equal_json = equal_obj;
+		first_changed_json = first_obj;
+		half_changed_json = half_obj;
+	}
+	JsonDiff whole_diff;
+	DiffOptions budget_options;
+	budget_options.max_changes = 16;
+	JsonDiff budget_diff(budget_options);
+
+	// measure wants a diff back, the equality results are checked once below
+	auto undefined = DiffResult::make_undefined_diff_result();
+	auto equal = measure([&]() { json_equal(base_json, equal_json); return undefined; }, iterations);
+	auto first_changed = measure([&]() { json_equal(base_json, first_changed_json); return undefined; }, iterations);
+	if (!json_equal(base_json, equal_json) || json_equal(base_json, first_changed_json))
+	{
+		std::cerr << "json_equal mismatch" << std::endl;
+		std::exit(1);
+	}
+	auto whole = measure([&]() { return whole_diff.diff(base_json, half_changed_json); }, iterations);
+	auto bounded = measure([&]() { return budget_diff.diff(base_json, half_changed_json); }, iterations);
+	std::cout << "equal_budget keys=" << std::setw(6) << key_count
+		<< " | json_equal(equal): " << std::setw(10) << (size_t)equal.ns << " ns " << std::setw(6) << equal.allocs << " allocs"
+		<< " | json_equal(first differs): " << std::setw(8) << (size_t)first_changed.ns << " ns"
+		<< " | diff: " << std::setw(10) << (size_t)whole.ns << " ns " << std::setw(8) << whole.allocs << " allocs"
+		<< " | diff max_changes=16: " << std::setw(10) << (size_t)bounded.ns << " ns " << std::setw(6) << bounded.allocs << " allocs"
+		<< std::endl;
+}
+
+// an object of 16 hex blobs of `blob_size` bytes with a few bytes edited in each, diffed with string deltas and
+// with whole __old/__new strings
+static void bench_string_delta(size_t blob_size, size_t iterations)
+{
+	JsonValue old_json, new_json;
+	{
+		std::mt19937 rng(7);
+		fc::mutable_variant_object old_obj, new_obj;
+		for (size_t i = 0; i < 16; i++)
+		{
+			std::string blob(blob_size, '0');
+			for (auto& c : blob)
+				c = "0123456789abcdef"[rng() % 16];
+			std::string edited = blob;
+			for (size_t k = 0; k < 4; k++)
+				edited[rng() % blob_size] = 'x';
+			old_obj["blob-" + std::to_string(i)] = blob;
+			new_obj["blob-" + std::to_string(i)] = edited;
+		}
+		old_json = old_obj;
+		new_json = new_obj;
+	}
+	DiffOptions delta_options;
+	delta_options.string_delta_min_size = 1024;
+	JsonDiff delta_diff(delta_options);
+	JsonDiff whole_diff;
+
+	auto delta = measure([&]() { return delta_diff.diff(old_json, new_json); }, iterations);
+	auto whole = measure([&]() { return whole_diff.diff(old_json, new_json); }, iterations);
+	auto diff_result = delta_diff.diff(old_json, new_json);
+	auto patch = measure([&]() { JsonValue json(old_json); delta_diff.patch_inplace(json, *diff_result); return diff_result; }, iterations);
+	std::cout << "string_delta blob=" << std::setw(8) << blob_size
+		<< " | delta: " << std::setw(10) << (size_t)delta.ns << " ns " << std::setw(8) << delta.output.size() << " bytes"
+		<< " | whole strings: " << std::setw(10) << (size_t)whole.ns << " ns " << std::setw(9) << whole.output.size() << " bytes"
+		<< " | patch delta: " << std::setw(10) << (size_t)patch.ns << " ns"
+		<< std::endl;
+}
+
+// the diff of an object of `key_count` nested documents, every other one changed, written out in the native format
+// and as an RFC 6902 json patch and an RFC 7386 merge patch, and the two patches applied back
+static void bench_patch_formats(size_t key_count, size_t iterations)
+{
+	JsonValue old_json, new_json;
+	{
+		fc::mutable_variant_object old_obj, new_obj;
+		for (size_t i = 0; i < key_count; i++)
+		{
+			auto key = "key-" + std::to_string(i);
+			old_obj[key] = make_nested_document(2, 4, 1);
+			new_obj[key] = make_nested_document(2, 4, i % 2 == 0 ? 2 : 1);
+		}
+		old_json = old_obj;
+		new_json = new_obj;
+	}
+	JsonDiff json_diff;
+	DiscardBuffer discard_buffer;
+	std::ostream discard(&discard_buffer);
+	auto undefined = DiffResult::make_undefined_diff_result();
+	auto native = measure([&]() { json_diff.diff(old_json, new_json)->write_json(discard); return undefined; }, iterations);
+	auto json_patch = measure([&]() { json_diff.diff_json_patch(old_json, new_json, discard); return undefined; }, iterations);
+	auto merge_patch = measure([&]() { json_diff.diff_merge_patch(old_json, new_json, discard); return undefined; }, iterations);
+	std::ostringstream json_patch_text;
+	std::ostringstream merge_patch_text;
+	json_diff.diff_json_patch(old_json, new_json, json_patch_text);
+	json_diff.diff_merge_patch(old_json, new_json, merge_patch_text);
+	auto json_patch_json = json_loads(json_patch_text.str());
+	auto merge_patch_json = json_loads(merge_patch_text.str());
+	auto apply_json_patch = measure([&]() { JsonValue json(old_json); json_patch_apply(json, json_patch_json); return undefined; }, iterations);
+	auto apply_merge_patch = measure([&]() { JsonValue json(old_json); json_merge_patch_apply(json, merge_patch_json); return undefined; }, iterations);
+	std::cout << "patch_formats keys=" << std::setw(6) << key_count
+		<< " | native: " << std::setw(10) << (size_t)native.ns << " ns " << std::setw(8) << native.allocs << " allocs"
+		<< " | json patch: " << std::setw(10) << (size_t)json_patch.ns << " ns " << std::setw(8) << json_patch.allocs << " allocs " << std::setw(9) << json_patch_text.str().size() << " bytes"
+		<< " | merge patch: " << std::setw(10) << (size_t)merge_patch.ns << " ns " << std::setw(8) << merge_patch.allocs << " allocs " << std::setw(9) << merge_patch_text.str().size() << " bytes"
+		<< " | apply: " << std::setw(10) << (size_t)apply_json_patch.ns << " / " << std::setw(10) << (size_t)apply_merge_patch.ns << " ns"
+		<< std::endl;
+}
+
+// diff and patch of an object of `key_count` nested documents, every other one changed, without and with fingerprints,
+// against a patch checked by comparing the whole result with the new document, as values and as serialized text
+static void bench_verified_patch(size_t key_count, size_t iterations)
+{
+	JsonValue old_json, new_json;
+	{
+		fc::mutable_variant_object old_obj, new_obj;
+		for (size_t i = 0; i < key_count; i++)
+		{
+			auto key = "key-" + std::to_string(i);
+			old_obj[key] = make_nested_document(2, 4, 1);
+			new_obj[key] = make_nested_document(2, 4, i % 2 == 0 ? 2 : 1);
+		}
+		old_json = old_obj;
+		new_json = new_obj;
+	}
+	JsonDiff plain_diff;
+	DiffOptions fingerprint_options;
+	fingerprint_options.diff_fingerprints = true;
+	JsonDiff fingerprint_diff(fingerprint_options);
+
+	auto plain = measure([&]() { return plain_diff.diff(old_json, new_json); }, iterations);
+	auto with_fingerprints = measure([&]() { return fingerprint_diff.diff(old_json, new_json); }, iterations);
+	CompiledDiff plain_compiled(plain_diff.diff(old_json, new_json)->value());
+	CompiledDiff fingerprint_compiled(fingerprint_diff.diff(old_json, new_json)->value());
+	auto undefined = DiffResult::make_undefined_diff_result();
+	auto patch = measure([&]() { JsonValue json(old_json); plain_diff.patch_inplace(json, plain_compiled); return undefined; }, iterations);
+	auto compared = measure([&]() {
+		JsonValue json(old_json);
+		plain_diff.patch_inplace(json, plain_compiled);
+		if (!json_equal(json, new_json))
+			throw JsonDiffException("patched document differs");
+		return undefined;
+	}, iterations);
+	auto new_text = json_dumps(new_json);
+	auto reserialized = measure([&]() {
+		JsonValue json(old_json);
+		plain_diff.patch_inplace(json, plain_compiled);
+		if (json_dumps(json) != json_dumps(json_loads(new_text)))
+			throw JsonDiffException("patched document differs");
+		return undefined;
+	}, iterations);
+	auto verified = measure([&]() { JsonValue json(old_json); plain_diff.patch_inplace(json, fingerprint_compiled); return undefined; }, iterations);
+	std::cout << "verified_patch keys=" << std::setw(6) << key_count
+		<< " | diff: " << std::setw(10) << (size_t)plain.ns << " ns " << std::setw(8) << plain.output.size() << " bytes"
+		<< " | with fingerprints: " << std::setw(10) << (size_t)with_fingerprints.ns << " ns " << std::setw(8) << with_fingerprints.output.size() << " bytes"
+		<< " | patch: " << std::setw(10) << (size_t)patch.ns << " ns"
+		<< " | patch + json_equal: " << std::setw(10) << (size_t)compared.ns << " ns"
+		<< " | patch + json_dumps: " << std::setw(10) << (size_t)reserialized.ns << " ns"
+		<< " | verified patch: " << std::setw(10) << (size_t)verified.ns << " ns"
+		<< std::endl;
+}
+
+// diff and patch of an object of `key_count` nested documents, half of them changed, without and with
+// a stats collector, to see what counting the work costs
+static void bench_stats_overhead(size_t key_count, size_t iterations)
+{
+	JsonValue old_json, new_json;
+	{
+		fc::mutable_variant_object old_obj, new_obj;
+		for (size_t i = 0; i < key_count; i++)
+		{
+			auto key = "key-" + std::to_string(i);
+			old_obj[key] = make_nested_document(2, 8, 1);
+			new_obj[key] = make_nested_document(2, 8, i % 2 == 0 ? 2 : 1);
+		}
+		old_json = old_obj;
+		new_json = new_obj;
+	}
+	JsonDiff plain_diff;
+	DiffOptions stats_options;
+	stats_options.stats = std::make_shared<DiffStatsCollector>();
+	JsonDiff stats_diff(stats_options);
+
+	auto plain = measure([&]() { return plain_diff.diff(old_json, new_json); }, iterations);
+	auto counted = measure([&]() { return stats_diff.diff(old_json, new_json); }, iterations);
+	auto diff_result = plain_diff.diff(old_json, new_json);
+	auto compiled = diff_result->compiled();
+	auto plain_patch = measure([&]() { JsonValue json(old_json); plain_diff.patch_inplace(json, *compiled); return diff_result; }, iterations);
+	auto counted_patch = measure([&]() { JsonValue json(old_json); stats_diff.patch_inplace(json, *compiled); return diff_result; }, iterations);
+	auto stats = stats_options.stats->total(DSO_DIFF);
+	std::cout << "stats keys=" << std::setw(6) << key_count
+		<< " | diff: " << std::setw(10) << (size_t)plain.ns << " ns"
+		<< " | diff with stats: " << std::setw(10) << (size_t)counted.ns << " ns (" << std::setw(10) << stats.serialize_ns / stats.calls << " ns writing the text)"
+		<< " | patch: " << std::setw(9) << (size_t)plain_patch.ns << " ns"
+		<< " | patch with stats: " << std::setw(9) << (size_t)counted_patch.ns << " ns"
+		<< " | visited " << stats.visited[JVT_OBJECT] / stats.calls << " objects, " << stats.changes / stats.calls << " changes"
+		<< std::endl;
+}
+
+// a document with `section_count` changed sections under /meta and one changed leaf under /storage/balances,
+// diffed whole, with only /storage/balances included, with /meta excluded and with a depth limit
+static void bench_path_filter(size_t section_count, size_t iterations)
+{
+	fc::mutable_variant_object old_meta, new_meta;
+	for (size_t i = 0; i < section_count; i++)
+	{
+		old_meta["section-" + std::to_string(i)] = make_nested_document(3, 8, 1);
+		new_meta["section-" + std::to_string(i)] = make_nested_document(3, 8, 2);
+	}
+	fc::mutable_variant_object old_balances, new_balances;
+	old_balances["a"] = 1;
+	new_balances["a"] = 2;
+	fc::mutable_variant_object old_storage, new_storage;
+	old_storage["balances"] = old_balances;
+	new_storage["balances"] = new_balances;
+	fc::mutable_variant_object old_obj, new_obj;
+	old_obj["meta"] = old_meta;
+	old_obj["storage"] = old_storage;
+	new_obj["meta"] = new_meta;
+	new_obj["storage"] = new_storage;
+	JsonValue old_json = old_obj;
+	JsonValue new_json = new_obj;
+
+	JsonDiff whole_diff;
+	DiffOptions include_options;
+	include_options.include_paths.push_back("/storage/balances");
+	JsonDiff include_diff(include_options);
+	DiffOptions exclude_options;
+	exclude_options.exclude_paths.push_back("/meta");
+	JsonDiff exclude_diff(exclude_options);
+	DiffOptions depth_options;
+	depth_options.max_depth = 2;
+	JsonDiff depth_diff(depth_options);
+
+	auto whole = measure([&]() { return whole_diff.diff(old_json, new_json); }, iterations);
+	auto included = measure([&]() { return include_diff.diff(old_json, new_json); }, iterations);
+	auto excluded = measure([&]() { return exclude_diff.diff(old_json, new_json); }, iterations);
+	auto depth = measure([&]() { return depth_diff.diff(old_json, new_json); }, iterations);
+	if (included.output != excluded.output)
+	{
+		std::cerr << "path filter output mismatch" << std::endl;
+		std::exit(1);
+	}
+	std::cout << "path_filter sections=" << std::setw(5) << section_count
+		<< " | whole: " << std::setw(12) << (size_t)whole.ns << " ns " << std::setw(8) << whole.allocs << " allocs"
+		<< " | include: " << std::setw(12) << (size_t)included.ns << " ns " << std::setw(8) << included.allocs << " allocs"
+		<< " | exclude: " << std::setw(12) << (size_t)excluded.ns << " ns " << std::setw(8) << excluded.allocs << " allocs"
+		<< " | max_depth=2: " << std::setw(12) << (size_t)depth.ns << " ns " << std::setw(8) << depth.allocs << " allocs"
+		<< std::endl;
+}
+
+// a few changes to a large state document: recorded by a tracked document against copying the state and diffing it whole
+static void bench_tracked_document(size_t section_count, size_t change_count)
+{
+	fc::mutable_variant_object state;
+	for (size_t i = 0; i < section_count; i++)
+		state["section-" + std::to_string(i)] = make_nested_document(2, 8, 1);
+	JsonValue origin = state;
+	JsonDiff json_diff;
+	std::vector<std::string> pointers;
+	std::mt19937 rng(5);
+	for (size_t i = 0; i < change_count; i++)
+		pointers.push_back("/section-" + std::to_string(rng() % section_count) + "/key-" + std::to_string(rng() % 8));
+	JsonValue tracked_result;
+	auto tracked = measure([&]() {
+		TrackedDocument doc(origin);
+		for (size_t i = 0; i < pointers.size(); i++)
+			doc.set(pointers[i], JsonValue((uint64_t)i));
+		tracked_result = doc.json();
+		return doc.diff();
+	}, 1);
+	auto compared = measure([&]() {
+		// the old state is copied before the changes, and the two trees are compared after them
+		JsonValue old_json = json_loads(json_dumps(origin));
+		TrackedDocument doc(origin);
+		for (size_t i = 0; i < pointers.size(); i++)
+			doc.set(pointers[i], JsonValue((uint64_t)i));
+		return json_diff.diff(old_json, doc.json());
+	}, 1);
+	TrackedDocument check(origin);
+	for (size_t i = 0; i < pointers.size(); i++)
+		check.set(pointers[i], JsonValue((uint64_t)i));
+	if (!json_equal(json_diff.patch(origin, check.diff()), tracked_result))
+	{
+		std::cerr << "tracked document mismatch" << std::endl;
+		std::exit(1);
+	}
+	std::cout << "tracked_document sections=" << std::setw(6) << section_count << " changes=" << std::setw(5) << change_count
+		<< " | tracked: " << std::setw(12) << (size_t)tracked.ns << " ns " << std::setw(8) << tracked.allocs << " allocs"
+		<< " | copy + diff: " << std::setw(12) << (size_t)compared.ns << " ns " << std::setw(8) << compared.allocs << " allocs"
+		<< std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc >= 2 && std::string(argv[1]) == "suite")
+		return run_suite(argc, argv);
+	if (argc >= 2 && std::string(argv[1]) == "batch")
+	{
+		// jsondiff_bench batch [pairs] [threads]
+		size_t count = argc >= 3 ? (size_t)std::stoull(argv[2]) : 10000;
+		size_t threads = argc >= 4 ? (size_t)std::stoull(argv[3]) : std::thread::hardware_concurrency();
+		bench_batch_diff(count, threads > 0 ? threads : 1);
+		return 0;
+	}
+	if (argc >= 2 && std::string(argv[1]) == "parallel")
+	{
+		// jsondiff_bench parallel [max_threads] [scale]
+		size_t max_threads = argc >= 3 ? (size_t)std::stoull(argv[2]) : std::thread::hardware_concurrency();
+		double scale = argc >= 4 ? std::stod(argv[3]) : 10;
+		if (max_threads == 0)
+			max_threads = 1;
+		bench_parallel_scaling(bench::CS_RECORD_ARRAY, scale, max_threads, 1);
+		bench_parallel_scaling(bench::CS_SCALAR_ARRAY, scale, max_threads, 1);
+		bench_parallel_scaling(bench::CS_WIDE_OBJECT, 1, max_threads, 1);
+		return 0;
+	}
+	if (argc >= 2 && std::string(argv[1]) == "compose")
+	{
+		// jsondiff_bench compose [items] [versions]
+		size_t count = argc >= 3 ? (size_t)std::stoull(argv[2]) : 100000;
+		size_t versions = argc >= 4 ? (size_t)std::stoull(argv[3]) : 64;
+		bench_compose(count > 0 ? count : 1, versions > 0 ? versions : 1);
+		return 0;
+	}
+	if (argc >= 2 && std::string(argv[1]) == "tracked")
+	{
+		// jsondiff_bench tracked [sections] [changes]
+		size_t sections = argc >= 3 ? (size_t)std::stoull(argv[2]) : 10000;
+		size_t changes = argc >= 4 ? (size_t)std::stoull(argv[3]) : 100;
+		bench_tracked_document(sections > 0 ? sections : 1, changes);
+		return 0;
+	}
+	if (argc >= 2 && std::string(argv[1]) == "budget")
+	{
+		// jsondiff_bench budget [keys] [iterations]
+		size_t keys = argc >= 3 ? (size_t)std::stoull(argv[2]) : 10000;
+		size_t iterations = argc >= 4 ? (size_t)std::stoull(argv[3]) : 20;
+		bench_equal_and_budget(keys > 0 ? keys : 1, iterations > 0 ? iterations : 1);
+		return 0;
+	}
+	if (argc >= 2 && std::string(argv[1]) == "strings")
+	{
+		// jsondiff_bench strings [blob_size] [iterations]
+		size_t blob_size = argc >= 3 ? (size_t)std::stoull(argv[2]) : 65536;
+		size_t iterations = argc >= 4 ? (size_t)std::stoull(argv[3]) : 20;
+		bench_string_delta(blob_size > 0 ? blob_size : 1, iterations > 0 ? iterations : 1);
+		return 0;
+	}
+	if (argc >= 2 && std::string(argv[1]) == "patch_formats")
+	{
+		// jsondiff_bench patch_formats [keys] [iterations]
+		size_t keys = argc >= 3 ? (size_t)std::stoull(argv[2]) : 10000;
+		size_t iterations = argc >= 4 ? (size_t)std::stoull(argv[3]) : 20;
+		bench_patch_formats(keys > 0 ? keys : 1, iterations > 0 ? iterations : 1);
+		return 0;
+	}
+	if (argc >= 2 && std::string(argv[1]) == "verify")
+	{
+		// jsondiff_bench verify [keys] [iterations]
+		size_t keys = argc >= 3 ? (size_t)std::stoull(argv[2]) : 10000;
+		size_t iterations = argc >= 4 ? (size_t)std::stoull(argv[3]) : 20;
+		bench_verified_patch(keys > 0 ? keys : 1, iterations > 0 ? iterations : 1);
+		return 0;
+	}
+	if (argc >= 2 && std::string(argv[1]) == "stats")
+	{
+		// jsondiff_bench stats [iterations]
+		size_t iterations = argc >= 3 ? (size_t)std::stoull(argv[2]) : 20;
+		bench_stats_overhead(100, iterations > 0 ? iterations : 1);
+		bench_stats_overhead(10000, iterations > 0 ? iterations : 1);
+		return 0;
+	}
+	if (argc >= 2 && std::string(argv[1]) == "filter")
+	{
+		// jsondiff_bench filter [sections] [iterations]
+		size_t sections = argc >= 3 ? (size_t)std::stoull(argv[2]) : 1000;
+		size_t iterations = argc >= 4 ? (size_t)std::stoull(argv[3]) : 20;
+		bench_path_filter(sections > 0 ? sections : 1, iterations > 0 ? iterations : 1);
+		return 0;
+	}
+	if (argc >= 2 && std::string(argv[1]) == "versions")
+	{
+		// jsondiff_bench versions [max_history] [keyframe_interval]
+		size_t max_history = argc >= 3 ? (size_t)std::stoull(argv[2]) : 4096;
+		size_t interval = argc >= 4 ? (size_t)std::stoull(argv[3]) : JSONDIFF_VERSION_STORE_KEYFRAME_INTERVAL;
+		for (size_t history = 64; history <= max_history; history *= 4)
+			bench_version_store(history, interval > 0 ? interval : 1);
+		return 0;
+	}
+	if (argc >= 3 && std::string(argv[1]) == "stream")
+	{
+		bool dom = argc >= 4 && std::string(argv[3]) == "dom";
+		bench_stream_diff((size_t)std::stoull(argv[2]), !dom, dom);
+		return 0;
+	}
+	bench_nested_diff(4, 16, 200);
+	bench_nested_diff(16, 16, 50);
+	bench_nested_diff(64, 16, 10);
+	bench_nested_diff(16, 256, 10);
+	bench_wide_object(1000, 20, true);
+	bench_wide_object(5000, 5, true);
+	bench_wide_object(20000, 2, true);
+	bench_wide_object(50000, 1, false);
+	// high churn: every key renamed, the diff has two entries per key
+	bench_wide_object(20000, 1, false, 1);
+	bench_repeated_diff_against_base(100, 20);
+	bench_repeated_diff_against_base(1000, 5);
+	bench_array_diff(100000, 1, 0, 2);
+	bench_array_diff(100000, 10, 0, 2);
+	bench_array_diff(100000, 1, 1000, 2);
+	bench_array_diff(100000, 0, 10, 2);
+	bench_leaf_heavy_diff(100000, 10);
+	bench_leaf_heavy_diff(1000000, 2);
+	bench_patch_inplace(100, 50);
+	bench_patch_inplace(1000, 20);
+	bench_compiled_patch(1000, 100, 50);
+	bench_compiled_patch(1000, 1000, 20);
+	bench_keyed_array_diff(100000, 10, 2);
+	bench_keyed_array_diff(100000, 1000, 2);
+	bench_binary_formats();
+	bench_stream_diff(32, true, true);
+	return 0;
+}
@@ -0,0 +1,825 @@
+#include "cli.h"
+
+#include <jsondiff/diff_batch.h>
+#include <jsondiff/exceptions.h>
+#include <jsondiff/jsondiff.h>
+#include <jsondiff/json_writer.h>
+#include <jsondiff/mapped_file.h>
+#include <jsondiff/native_json.h>
+#include <jsondiff/thread_pool.h>
+
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+namespace jsondiff
+{
+	namespace cli
+	{
+		// lines of a batch handed to the pool at once, at most this many bytes of them
+		static const size_t batch_chunk_lines = 65536;
+		static const size_t batch_chunk_bytes = 32 * 1024 * 1024;
+		// tasks per thread of the pool for one chunk, so a slow record doesn't hold up a whole thread's share
+		static const size_t batch_tasks_per_thread = 4;
+		// stdin is read in blocks of this size
+		static const size_t stdin_block_size = 1024 * 1024;
+
+		static const char* usage_text =
+			"usage:\n"
+			"  jsondiff_cpp_runner [test]                          run the self tests\n"
+			"  jsondiff_cpp_runner diff <old> <new> [options]      the diff of two json files\n"
+			"  jsondiff_cpp_runner patch <json> <diff> [options]   the new version of a json file\n"
+			"  jsondiff_cpp_runner rollback <json> <diff> [options]\n"
+			"                                                      the old version of a json file\n"
+			"  jsondiff_cpp_runner compose <diff> <diff>... [options]\n"
+			"                                                      one diff doing the diffs in order\n"
+			"  jsondiff_cpp_runner <command> --batch [<ndjson>] [options]\n"
+			"      one json record per line (stdin without a file), one output line per record, in order:\n"
+			"        diff [<old>, <new>]   patch, rollback [<json>, <diff>]   compose [<diff>, <diff>, ...]\n"
+			"      a record that fails gives {\"error\": <message>, \"line\": <line>}\n"
+			"options:\n"
+			"  -o, --output <file>        write to file instead of stdout\n"
+			"  --format json|pretty|binary\n"
+			"                             output form, json by default. binary is for diffs, without --batch\n"
+			"  --threads <n>              threads of the batch pool, or of the diff of two big files.\n"
+			"                             0 is one per hardware thread, the default of --batch\n"
+			"  --fingerprints             diffs carry fingerprints their patch and rollback check\n"
+			"  --stream                   diff: read both files token by token without building them (json output)\n"
+			"  --stats                    throughput and latency percentiles on stderr\n"
+			"diff files are json text or the binary form, told apart by their first bytes\n";
+
+		enum CliCommand
+		{
+			CC_DIFF = 0,
+			CC_PATCH = 1,
+			CC_ROLLBACK = 2,
+			CC_COMPOSE = 3
+		};
+
+		enum CliFormat
+		{
+			CF_JSON = 0,
+			CF_PRETTY = 1,
+			CF_BINARY = 2
+		};
+
+		struct CliOptions
+		{
+			CliCommand command;
+			std::vector<std::string> inputs;
+			// empty for stdout
+			std::string output;
+			CliFormat format;
+			bool batch;
+			// SIZE_MAX when not given
+			size_t threads;
+			bool fingerprints;
+			bool stream;
+			bool stats;
+
+			CliOptions()
+				: command(CC_DIFF), format(CF_JSON), batch(false), threads(SIZE_MAX), fingerprints(false), stream(false), stats(false)
+			{
+			}
+		};
+
+		static const char* command_name(CliCommand command)
+		{
+			static const char* names[] = { "diff", "patch", "rollback", "compose" };
+			return names[command];
+		}
+
+		// false with error set if the arguments don't make a command
+		static bool parse_args(int argc, char** argv, CliOptions& options, std::string& error)
+		{
+			std::string command = argc > 1 ? argv[1] : "";
+			if (command == "diff")
+				options.command = CC_DIFF;
+			else if (command == "patch")
+				options.command = CC_PATCH;
+			else if (command == "rollback")
+				options.command = CC_ROLLBACK;
+			else if (command == "compose")
+				options.command = CC_COMPOSE;
+			else
+			{
+				error = "unknown command " + command;
+				return false;
+			}
+			for (int i = 2; i < argc; i++)
+			{
+				std::string arg = argv[i];
+				bool has_value = i + 1 < argc;
+				if ((arg == "-o" || arg == "--output") && has_value)
+					options.output = argv[++i];
+				else if (arg == "--format" && has_value)
+				{
+					std::string format = argv[++i];
+					if (format == "json")
+						options.format = CF_JSON;
+					else if (format == "pretty")
+						options.format = CF_PRETTY;
+					else if (format == "binary")
+						options.format = CF_BINARY;
+					else
+					{
+						error = "unknown format " + format;
+						return false;
+					}
+				}
+				else if (arg == "--threads" && has_value)
+				{
+					char* end = nullptr;
+					options.threads = (size_t)strtoull(argv[++i], &end, 10);
+					if (!end || *end != '\0')
+					{
+						error = std::string("bad thread count ") + argv[i];
+						return false;
+					}
+				}
+				else if (arg == "--batch")
+					options.batch = true;
+				else if (arg == "--fingerprints")
+					options.fingerprints = true;
+				else if (arg == "--stream")
+					options.stream = true;
+				else if (arg == "--stats")
+					options.stats = true;
+				else if (arg.size() > 1 && arg[0] == '-')
+				{
+					error = "unknown option " + arg;
+					return false;
+				}
+				else
+					options.inputs.push_back(arg);
+			}
+			if (options.batch)
+			{
+				if (options.inputs.size() > 1)
+					error = "--batch reads one ndjson file";
+				else if (options.format != CF_JSON)
+					error = "--batch writes one json line per record, --format json only";
+				else if (options.stream)
+					error = "--stream diffs two files, not a batch";
+			}
+			else if (options.command == CC_COMPOSE ? options.inputs.size() < 2 : options.inputs.size() != 2)
+				error = std::string(command_name(options.command)) + " takes " + (options.command == CC_COMPOSE ? "two or more files" : "two files");
+			else if (options.format == CF_BINARY && (options.command == CC_PATCH || options.command == CC_ROLLBACK))
+				error = "binary output is for diffs, a document is written as json";
+			else if (options.stream && (options.command != CC_DIFF || options.format != CF_JSON || options.fingerprints))
+				error = "--stream writes the json diff of two files, without fingerprints";
+			return error.empty();
+		}
+
+		// appends what is written to a string
+		class StringBuffer : public std::streambuf
+		{
+		private:
+			std::string& _text;
+		public:
+			explicit StringBuffer(std::string& text) : _text(text) {}
+		protected:
+			virtual int_type overflow(int_type c) override
+			{
+				if (c != traits_type::eof())
+					_text.push_back((char)c);
+				return c;
+			}
+			virtual std::streamsize xsputn(const char* data, std::streamsize size) override
+			{
+				_text.append(data, (size_t)size);
+				return size;
+			}
+		};
+
+		// passes what is written on to another buffer and counts the bytes
+		class CountingBuffer : public std::streambuf
+		{
+		private:
+			std::streambuf* _target;
+			uint64_t _count;
+		public:
+			explicit CountingBuffer(std::streambuf* target) : _target(target), _count(0) {}
+
+			uint64_t count() const { return _count; }
+		protected:
+			virtual int_type overflow(int_type c) override
+			{
+				if (c == traits_type::eof())
+					return c;
+				_count++;
+				return _target->sputc((char)c);
+			}
+			virtual std::streamsize xsputn(const char* data, std::streamsize size) override
+			{
+				auto written = _target->sputn(data, size);
+				_count += (uint64_t)written;
+				return written;
+			}
+			virtual int sync() override
+			{
+				return _target->pubsync();
+			}
+		};
+
+		// stdout or the file of --output, counting the bytes written
+		class CliOutput
+		{
+		private:
+			std::ofstream _file;
+			std::unique_ptr<CountingBuffer> _buffer;
+			std::unique_ptr<std::ostream> _out;
+		public:
+			// @throws JsonDiffException if the file can't be created
+			explicit CliOutput(const std::string& path)
+			{
+				std::streambuf* target;
+				if (path.empty())
+				{
+#ifdef _WIN32
+					_setmode(_fileno(stdout), _O_BINARY);
+#endif
+					target = std::cout.rdbuf();
+				}
+				else
+				{
+					_file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+					if (!_file)
+						throw JsonDiffException("can't create " + path);
+					target = _file.rdbuf();
+				}
+				_buffer.reset(new CountingBuffer(target));
+				_out.reset(new std::ostream(_buffer.get()));
+			}
+
+			std::ostream& stream() { return *_out; }
+			uint64_t bytes() const { return _buffer->count(); }
+
+			// @throws JsonDiffException if the output couldn't be written
+			void close()
+			{
+				_out->flush();
+				if (_file.is_open())
+					_file.close();
+				if (!*_out || _file.fail())
+					throw JsonDiffException("can't write the output");
+			}
+		};
+
+		// latencies in buckets of about 3% of their value, so millions of records take a fixed amount of memory.
+		// values below 64 ns have a bucket each, larger ones 32 buckets per power of two
+		class LatencyHistogram
+		{
+		private:
+			static const size_t linear_buckets = 64;
+			static const size_t sub_buckets = 32;
+			static const size_t bucket_count = linear_buckets + (64 - 6) * sub_buckets;
+			std::vector<uint64_t> _counts;
+			uint64_t _total;
+			uint64_t _max;
+
+			static size_t bucket(uint64_t ns)
+			{
+				if (ns < linear_buckets)
+					return (size_t)ns;
+				size_t exponent = 63;
+				while (!(ns >> exponent))
+					exponent--;
+				size_t sub = (size_t)((ns >> (exponent - 5)) & (sub_buckets - 1));
+				return linear_buckets + (exponent - 6) * sub_buckets + sub;
+			}
+
+			// the middle of a bucket
+			static uint64_t bucket_value(size_t index)
+			{
+				if (index < linear_buckets)
+					return index;
+				size_t exponent = (index - linear_buckets) / sub_buckets + 6;
+				uint64_t sub = (index - linear_buckets) % sub_buckets;
+				uint64_t low = (sub_buckets + sub) << (exponent - 5);
+				return low + ((uint64_t)1 << (exponent - 5)) / 2;
+			}
+		public:
+			LatencyHistogram() : _counts(bucket_count), _total(0), _max(0) {}
+
+			void record(uint64_t ns)
+			{
+				_counts[bucket(ns)]++;
+				_total++;
+				_max = std::max(_max, ns);
+			}
+
+			void merge(const LatencyHistogram& other)
+			{
+				for (size_t i = 0; i < bucket_count; i++)
+					_counts[i] += other._counts[i];
+				_total += other._total;
+				_max = std::max(_max, other._max);
+			}
+
+			void clear()
+			{
+				std::fill(_counts.begin(), _counts.end(), 0);
+				_total = 0;
+				_max = 0;
+			}
+
+			uint64_t total() const { return _total; }
+			uint64_t max() const { return _max; }
+
+			// the latency below which a fraction q of the records are, 0 < q <= 1
+			uint64_t percentile(double q) const
+			{
+				if (_total == 0)
+					return 0;
+				uint64_t rank = (uint64_t)(q * (double)_total + 0.999999);
+				rank = std::max<uint64_t>(1, std::min(rank, _total));
+				uint64_t seen = 0;
+				for (size_t i = 0; i < bucket_count; i++)
+				{
+					seen += _counts[i];
+					if (seen >= rank)
+						return std::min(bucket_value(i), _max);
+				}
+				return _max;
+			}
+		};
+
+		static uint64_t elapsed_ns(std::chrono::steady_clock::time_point start)
+		{
+			return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		static std::string format_mb(uint64_t bytes)
+		{
+			char text[32];
+			snprintf(text, sizeof(text), "%.1f MB", (double)bytes / (1024.0 * 1024.0));
+			return text;
+		}
+
+		static std::string format_ms(uint64_t ns)
+		{
+			char text[32];
+			snprintf(text, sizeof(text), "%.1f ms", (double)ns / 1e6);
+			return text;
+		}
+
+		// the lines of an ndjson input, from a memory mapped file or read from stdin in blocks
+		class LineReader
+		{
+		private:
+			std::unique_ptr<MappedFile> _file;
+			const char* _pos;
+			const char* _end;
+			// stdin: the bytes read and not yet handed out as lines start at _buffer_pos
+			std::string _buffer;
+			size_t _buffer_pos;
+			bool _eof;
+			uint64_t _bytes;
+			uint64_t _line_count;
+
+			// the lines of [data, data + size) up to the limits, false if a line doesn't end before the end of the data.
+			// consumed is the size of the lines taken
+			bool split(const char* data, size_t size, bool at_end, std::vector<std::pair<const char*, size_t>>& lines,
+				size_t& consumed)
+			{
+				consumed = 0;
+				while (consumed < size && lines.size() < batch_chunk_lines && (consumed < batch_chunk_bytes || lines.empty()))
+				{
+					auto line = data + consumed;
+					auto newline = (const char*)memchr(line, '\n', size - consumed);
+					if (!newline && !at_end)
+						return lines.empty() ? false : true;
+					size_t line_size = newline ? (size_t)(newline - line) : size - consumed;
+					consumed += line_size + (newline ? 1 : 0);
+					if (line_size > 0 && line[line_size - 1] == '\r')
+						line_size--;
+					lines.push_back(std::make_pair(line, line_size));
+				}
+				return true;
+			}
+		public:
+			// stdin for "" or "-"
+			// @throws JsonDiffException if the file can't be mapped
+			explicit LineReader(const std::string& path)
+				: _pos(nullptr), _end(nullptr), _buffer_pos(0), _eof(false), _bytes(0), _line_count(0)
+			{
+				if (path.empty() || path == "-")
+					return;
+				_file.reset(new MappedFile(path));
+				_pos = _file->data();
+				_end = _pos + _file->size();
+			}
+
+			// the next lines, without their line breaks. they stay valid until the next call
+			// @returns false at the end of the input
+			bool read(std::vector<std::pair<const char*, size_t>>& lines)
+			{
+				lines.clear();
+				size_t consumed;
+				if (_file)
+				{
+					// the lines of the last chunk are done with
+					_file->release_before(_pos);
+					if (_pos == _end)
+						return false;
+					split(_pos, (size_t)(_end - _pos), true, lines, consumed);
+					_pos += consumed;
+					_bytes += consumed;
+				}
+				else
+				{
+					_buffer.erase(0, _buffer_pos);
+					_buffer_pos = 0;
+					while (true)
+					{
+						if (!_eof && _buffer.size() < batch_chunk_bytes)
+						{
+							size_t size = _buffer.size();
+							_buffer.resize(size + stdin_block_size);
+							size_t read_size = fread(&_buffer[size], 1, stdin_block_size, stdin);
+							_buffer.resize(size + read_size);
+							if (read_size == 0)
+								_eof = true;
+							continue;
+						}
+						if (_buffer.empty())
+							return false;
+						if (split(_buffer.data(), _buffer.size(), _eof, lines, consumed))
+							break;
+						// a line longer than the buffer, read more of it
+						lines.clear();
+						if (_eof)
+							break;
+						size_t size = _buffer.size();
+						_buffer.resize(size + stdin_block_size);
+						size_t read_size = fread(&_buffer[size], 1, stdin_block_size, stdin);
+						_buffer.resize(size + read_size);
+						if (read_size == 0)
+							_eof = true;
+					}
+					_buffer_pos = consumed;
+					_bytes += consumed;
+				}
+				_line_count += lines.size();
+				return !lines.empty();
+			}
+
+			uint64_t bytes() const { return _bytes; }
+			// lines handed out so far
+			uint64_t line_count() const { return _line_count; }
+		};
+
+		// a diff file, json text or binary
+		// @throws JsonDiffException
+		static DiffResultP read_diff(const std::string& path, uint64_t& bytes)
+		{
+			MappedFile file(path);
+			bytes += file.size();
+			if (file.size() >= 2 && file.data()[0] == 'J' && file.data()[1] == 'D')
+				return DiffResult::from_binary(file.data(), file.size());
+			NativeJsonDocument doc;
+			doc.parse(file.data(), file.size());
+			return std::make_shared<DiffResult>(doc.to_json());
+		}
+
+		static void write_diff(std::ostream& out, const DiffResult& diff_result, CliFormat format)
+		{
+			if (format == CF_BINARY)
+			{
+				auto data = diff_result.binary();
+				out.write(data.data(), (std::streamsize)data.size());
+				return;
+			}
+			if (format == CF_PRETTY)
+				diff_result.write_pretty_json(out);
+			else
+				diff_result.write_json(out);
+			out.put('\n');
+		}
+
+		// wall time of the steps of one command, for --stats
+		struct StepTimes
+		{
+			std::vector<std::pair<const char*, uint64_t>> steps;
+			std::chrono::steady_clock::time_point start;
+
+			StepTimes() : start(std::chrono::steady_clock::now()) {}
+
+			// the time since the last step
+			void step(const char* name)
+			{
+				auto now = std::chrono::steady_clock::now();
+				steps.push_back(std::make_pair(name, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now - start).count()));
+				start = now;
+			}
+		};
+
+		static void print_step_stats(const CliOptions& options, const StepTimes& times, uint64_t input_bytes, uint64_t output_bytes)
+		{
+			uint64_t total_ns = 0;
+			for (const auto& step : times.steps)
+				total_ns += step.second;
+			std::cerr << command_name(options.command) << ": " << options.inputs.size() << " files, "
+				<< format_mb(input_bytes) << " in, " << format_mb(output_bytes) << " out |";
+			for (size_t i = 0; i < times.steps.size(); i++)
+				std::cerr << (i ? ", " : " ") << times.steps[i].first << " " << format_ms(times.steps[i].second);
+			std::cerr << " | " << std::fixed << std::setprecision(1)
+				<< (total_ns ? (double)input_bytes / (1024.0 * 1024.0) / ((double)total_ns / 1e9) : 0.0) << " MB/s" << std::endl;
+		}
+
+		static void run_single(const CliOptions& options, JsonDiff& json_diff, CliOutput& output)
+		{
+			StepTimes times;
+			uint64_t input_bytes = 0;
+			auto& out = output.stream();
+			if (options.command == CC_DIFF)
+			{
+				MappedFile old_file(options.inputs[0]);
+				MappedFile new_file(options.inputs[1]);
+				input_bytes = old_file.size() + new_file.size();
+				if (options.stream)
+				{
+					// mapped again by diff_files, which releases the pages it has read
+					json_diff.diff_files(options.inputs[0], options.inputs[1], out);
+					out.put('\n');
+					times.step("diff");
+				}
+				else
+				{
+					NativeJsonDocument old_doc, new_doc;
+					old_doc.parse(old_file.data(), old_file.size());
+					new_doc.parse(new_file.data(), new_file.size());
+					times.step("parse");
+					auto diff_result = json_diff.diff(old_doc.root(), new_doc.root());
+					times.step("diff");
+					write_diff(out, *diff_result, options.format);
+					times.step("write");
+				}
+			}
+			else if (options.command == CC_PATCH || options.command == CC_ROLLBACK)
+			{
+				MappedFile file(options.inputs[0]);
+				input_bytes = file.size();
+				NativeJsonDocument doc;
+				doc.parse(file.data(), file.size());
+				auto diff_result = read_diff(options.inputs[1], input_bytes);
+				times.step("parse");
+				if (options.command == CC_PATCH)
+					json_diff.patch_inplace(doc, *diff_result);
+				else
+					json_diff.rollback_inplace(doc, *diff_result);
+				times.step(command_name(options.command));
+				if (options.format == CF_PRETTY)
+					json_pretty_write(out, doc.to_json());
+				else
+					json_write(out, doc.to_json());
+				out.put('\n');
+				times.step("write");
+			}
+			else
+			{
+				std::vector<DiffResultP> diffs;
+				for (const auto& path : options.inputs)
+					diffs.push_back(read_diff(path, input_bytes));
+				times.step("parse");
+				auto composed = json_diff.compose(diffs);
+				times.step("compose");
+				write_diff(out, *composed, options.format);
+				times.step("write");
+			}
+			output.close();
+			if (options.stats)
+				print_step_stats(options, times, input_bytes, output.bytes());
+		}
+
+		// a run of consecutive lines of a chunk, done by one task
+		struct BatchSlice
+		{
+			size_t begin;
+			size_t end;
+			std::string output;
+			uint64_t errors;
+			LatencyHistogram latency;
+
+			BatchSlice() : begin(0), end(0), errors(0) {}
+		};
+
+		// the lines of a batch read at once, and their output
+		struct BatchChunk
+		{
+			std::vector<std::pair<const char*, size_t>> lines;
+			// line number of the first line, from 1
+			uint64_t first_line;
+			std::vector<BatchSlice> slices;
+
+			BatchChunk() : first_line(1) {}
+		};
+
+		static const NativeJsonArray& record_items(const NativeJsonDocument& doc, size_t min_size, size_t max_size, const char* layout)
+		{
+			const auto& root = doc.root();
+			if (!root.is_array() || root.get_array().size() < min_size || root.get_array().size() > max_size)
+				throw JsonDiffException(std::string("a record of this command is ") + layout);
+			return root.get_array();
+		}
+
+		// parse one line into doc, run the command on it and write its output line to out
+		// @throws JsonDiffException
+		static void run_record(const CliOptions& options, JsonDiff& json_diff, NativeJsonDocument& doc, const char* line, size_t size,
+			std::ostream& out)
+		{
+			doc.parse(line, size);
+			if (options.command == CC_DIFF)
+			{
+				const auto& items = record_items(doc, 2, 2, "[<old>, <new>]");
+				json_diff.diff(items[0], items[1])->write_json(out);
+			}
+			else if (options.command == CC_PATCH || options.command == CC_ROLLBACK)
+			{
+				const auto& items = record_items(doc, 2, 2, "[<json>, <diff>]");
+				auto json = native_to_json(items[0]);
+				DiffResult diff_result(native_to_json(items[1]));
+				if (options.command == CC_PATCH)
+					json_diff.patch_inplace(json, diff_result);
+				else
+					json_diff.rollback_inplace(json, diff_result);
+				json_write(out, json);
+			}
+			else
+			{
+				const auto& items = record_items(doc, 1, SIZE_MAX, "[<diff>, <diff>, ...]");
+				std::vector<DiffResultP> diffs;
+				diffs.reserve(items.size());
+				for (size_t i = 0; i < items.size(); i++)
+					diffs.push_back(std::make_shared<DiffResult>(native_to_json(items[i])));
+				json_diff.compose(diffs)->write_json(out);
+			}
+		}
+
+		static void run_slice(const CliOptions& options, JsonDiff& json_diff, NativeJsonDocument& doc, const BatchChunk& chunk,
+			BatchSlice& slice)
+		{
+			slice.output.clear();
+			slice.errors = 0;
+			slice.latency.clear();
+			StringBuffer buffer(slice.output);
+			std::ostream out(&buffer);
+			for (size_t i = slice.begin; i < slice.end; i++)
+			{
+				auto start = std::chrono::steady_clock::now();
+				size_t output_size = slice.output.size();
+				std::string error;
+				try
+				{
+					run_record(options, json_diff, doc, chunk.lines[i].first, chunk.lines[i].second, out);
+				}
+				catch (const std::exception& e)
+				{
+					error = e.what();
+					if (error.empty())
+						error = "failed";
+				}
+				if (!error.empty())
+				{
+					// drop what the record wrote before it failed
+					out.flush();
+					slice.output.resize(output_size);
+					slice.errors++;
+					JsonWriter writer(out);
+					writer.write("{\"error\":", 9);
+					writer.write_string(error);
+					writer.write(",\"line\":", 8);
+					writer.write(std::to_string(chunk.first_line + i));
+					writer.put('}');
+				}
+				out.put('\n');
+				slice.latency.record(elapsed_ns(start));
+			}
+		}
+
+		static void write_chunk(const BatchChunk& chunk, std::ostream& out)
+		{
+			for (const auto& slice : chunk.slices)
+				out.write(slice.output.data(), (std::streamsize)slice.output.size());
+		}
+
+		// the records of a chunk run on the pool while the output of the chunk before is written, so the output keeps
+		// the order of the input with one chunk of records in memory besides the one being written
+		// @returns the number of records that failed
+		static uint64_t run_batch(const CliOptions& options, JsonDiff& json_diff, CliOutput& output)
+		{
+			auto start = std::chrono::steady_clock::now();
+			LineReader reader(options.inputs.empty() ? std::string() : options.inputs[0]);
+			ThreadPool pool(options.threads == SIZE_MAX ? 0 : options.threads);
+			size_t max_slices = pool.thread_count() * batch_tasks_per_thread;
+			DiffBatchScratch scratch;
+			scratch.reserve(max_slices);
+			BatchChunk chunks[2];
+			size_t current = 0;
+			bool pending = false;
+			uint64_t errors = 0;
+			LatencyHistogram latency;
+			auto& out = output.stream();
+			while (true)
+			{
+				auto& chunk = chunks[current];
+				chunk.first_line = reader.line_count() + 1;
+				if (!reader.read(chunk.lines))
+					break;
+				size_t slice_count = std::min(max_slices, chunk.lines.size());
+				chunk.slices.resize(slice_count);
+				for (size_t i = 0; i < slice_count; i++)
+				{
+					chunk.slices[i].begin = chunk.lines.size() * i / slice_count;
+					chunk.slices[i].end = chunk.lines.size() * (i + 1) / slice_count;
+				}
+				{
+					TaskGroup group(pool);
+					for (size_t i = 0; i < slice_count; i++)
+					{
+						group.run([&options, &json_diff, &scratch, &chunk, i]() {
+							run_slice(options, json_diff, scratch.document(i), chunk, chunk.slices[i]);
+						});
+					}
+					if (pending)
+						write_chunk(chunks[1 - current], out);
+					group.wait();
+				}
+				for (const auto& slice : chunk.slices)
+				{
+					errors += slice.errors;
+					if (options.stats)
+						latency.merge(slice.latency);
+				}
+				pending = true;
+				current = 1 - current;
+			}
+			if (pending)
+				write_chunk(chunks[1 - current], out);
+			output.close();
+			if (options.stats)
+			{
+				auto total_ns = elapsed_ns(start);
+				double seconds = (double)total_ns / 1e9;
+				std::cerr << command_name(options.command) << " --batch: " << latency.total() << " records, " << errors << " errors, "
+					<< format_mb(reader.bytes()) << " in, " << format_mb(output.bytes()) << " out, " << pool.thread_count() << " threads, "
+					<< format_ms(total_ns) << " | " << std::fixed << std::setprecision(0)
+					<< (seconds > 0 ? (double)latency.total() / seconds : 0.0) << " records/s, " << std::setprecision(1)
+					<< (seconds > 0 ? (double)reader.bytes() / (1024.0 * 1024.0) / seconds : 0.0) << " MB/s" << std::endl;
+				std::cerr << "latency (us): p50 " << (double)latency.percentile(0.5) / 1e3 << " p90 " << (double)latency.percentile(0.9) / 1e3
+					<< " p99 " << (double)latency.percentile(0.99) / 1e3 << " p99.9 " << (double)latency.percentile(0.999) / 1e3
+					<< " max " << (double)latency.max() / 1e3 << std::endl;
+			}
+			return errors;
+		}
+
+		int run_cli(int argc, char** argv)
+		{
+			CliOptions options;
+			std::string error;
+			if (!parse_args(argc, argv, options, error))
+			{
+				std::cerr << error << std::endl << usage_text;
+				return 2;
+			}
+			std::ios::sync_with_stdio(false);
+			try
+			{
+				DiffOptions diff_options;
+				diff_options.diff_fingerprints = options.fingerprints;
+				// a pool for the diff of two big documents, the batch runs the records on a pool of its own
+				if (!options.batch && options.command == CC_DIFF && options.threads != SIZE_MAX)
+					diff_options.thread_pool = std::make_shared<ThreadPool>(options.threads);
+				JsonDiff json_diff(diff_options);
+				CliOutput output(options.output);
+				if (!options.batch)
+				{
+					run_single(options, json_diff, output);
+					return 0;
+				}
+				return run_batch(options, json_diff, output) == 0 ? 0 : 1;
+			}
+			catch (const std::exception& e)
+			{
+				std::cerr << command_name(options.command) << ": " << e.what() << std::endl;
+				return 1;
+			}
+		}
+	}
+}
@@ -0,0 +1,15 @@
+#ifndef JSONDIFF_RUNNER_CLI_H
+#define JSONDIFF_RUNNER_CLI_H
+
+namespace jsondiff
+{
+	namespace cli
+	{
+		// the diff, patch, rollback and compose commands of jsondiff_cpp_runner, argv[1] is the command.
+		// run it without arguments for the usage
+		// @returns the exit code: 0 done, 1 failed (or some records of a batch failed), 2 bad arguments
+		int run_cli(int argc, char** argv);
+	}
+}
+
+#endif
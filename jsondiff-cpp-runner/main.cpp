@@ -1,11 +1,20 @@
+#include <fstream>
 #include <iostream>
+#include <sstream>
 #include <cassert>
+#include <jsondiff/exceptions.h>
 #include <jsondiff/jsondiff.h>
+#include <jsondiff/json_patch.h>
+#include <jsondiff/tracked_document.h>
+#include <jsondiff/version_store.h>
+#include "cli.h"
 
 using namespace jsondiff;
 
-int main()
+int main(int argc, char** argv)
 {
+	if (argc > 1 && std::string(argv[1]) != "test")
+		return cli::run_cli(argc, argv);
 	std::cout << "Hello World!" << std::endl;
 	{
 		JsonDiff json_diff;
@@ -84,6 +93,16 @@ int main()
 		auto diff_result_pretty_str = diff_result->pretty_diff_str();
 		std::cout << "diff: " << std::endl << diff_result_str << std::endl;
 		std::cout << "diff pretty: " << std::endl << diff_result_pretty_str << std::endl;
+		std::ostringstream json_out, pretty_json_out, pretty_diff_out;
+		diff_result->write_json(json_out);
+		diff_result->write_pretty_json(pretty_json_out);
+		diff_result->write_pretty_diff(pretty_diff_out);
+		assert(json_out.str() == json_dumps(diff_result->value()));
+		assert(pretty_json_out.str() == json_pretty_dumps(diff_result->value()));
+		assert(pretty_diff_out.str() == diff_result_pretty_str);
+		// a string escape doesn't break the pretty layout of the rest of the diff, as it does in fc's pretty printer
+		auto escaped = json_diff.diff_by_string("{\"a\":\"x\"}", "{\"a\":\"tab\\there\",\"b\":[1]}");
+		assert(escaped->pretty_str() == "{\n  \"a\": {\n    \"__old\": \"x\",\n    \"__new\": \"tab\\there\"\n  },\n  \"b__added\": [\n    1\n  ]\n}");
 		auto patched = json_diff.patch_by_string(origin, diff_result);
 		std::cout << "patched: " << json_dumps(patched) << std::endl;
 		assert(json_dumps(patched) == json_dumps(json_loads(result)));
@@ -92,6 +111,135 @@ int main()
 		std::cout << "rollbacked: " << json_dumps(rollbacked) << std::endl;
 		assert(json_dumps(rollbacked) == json_dumps(json_loads(origin)));
 	}
+	{
+		// the fingerprints of a base version are cached once and reused by the diffs against it
+		DiffOptions options;
+		options.use_fingerprints = true;
+		JsonDiff json_diff(options);
+		JsonDiff plain_diff;
+		auto origin = json_loads("{\"a\":{\"b\":[1,2,{\"c\":3}]},\"d\":[{\"e\":1},{\"e\":2}],\"f\":1}");
+		auto result1 = json_loads("{\"a\":{\"b\":[1,2,{\"c\":3}]},\"d\":[{\"e\":1},{\"e\":5}],\"f\":1}");
+		auto result2 = json_loads("{\"a\":{\"b\":[1,2,{\"c\":4}]},\"d\":[{\"e\":1},{\"e\":2}],\"f\":2}");
+		JsonFingerprintCache origin_fingerprints;
+		auto diff1 = json_diff.diff(origin, result1, origin_fingerprints);
+		assert(diff1->str() == plain_diff.diff(origin, result1)->str());
+		auto cached = origin_fingerprints.size();
+		assert(cached > 0);
+		auto diff2 = json_diff.diff(origin, result2, origin_fingerprints);
+		assert(diff2->str() == plain_diff.diff(origin, result2)->str());
+		assert(origin_fingerprints.size() == cached);
+		(void)cached;
+		JsonFingerprintCache result_fingerprints;
+		assert(json_diff.diff(origin, origin, origin_fingerprints, result_fingerprints)->is_undefined());
+		std::cout << "fingerprint cache tests passed" << std::endl;
+	}
+	{
+		// arrays are diffed into the fewest inserts and removes, also when the search is cut short
+		JsonDiff json_diff;
+		assert(json_diff.diff_by_string("[1,2,3,4,5,6]", "[1,3,4,7,5,6]")->str() == "[[\"-\",1,2],[\"+\",3,7]]");
+		assert(json_diff.diff_by_string("[1,2,3,4,5,6,7,8]", "[8,1,2,3,4,5,6,7]")->str() == "[[\"+\",0,8],[\"-\",7,8]]");
+		DiffOptions options;
+		options.array_diff_max_cost = 1;
+		JsonDiff bounded_diff(options);
+		std::string origin = "[1,2,3,4,5,6,7,8]";
+		std::string result = "[8,1,9,3,4,6,7,10]";
+		auto diff_result = bounded_diff.diff_by_string(origin, result);
+		assert(json_equal(bounded_diff.patch_by_string(origin, diff_result), json_loads(result)));
+		assert(json_equal(bounded_diff.rollback_by_string(result, diff_result), json_loads(origin)));
+		// a search cut short at every step splits large disjoint arrays one element at a time, without running out of stack
+		fc::variants disjoint_old, disjoint_new;
+		for (size_t i = 0; i < 300000; i++)
+		{
+			disjoint_old.push_back(JsonValue((uint64_t)i));
+			disjoint_new.push_back(JsonValue((uint64_t)(i + 300000)));
+		}
+		auto disjoint_diff = bounded_diff.diff(JsonValue(disjoint_old), JsonValue(disjoint_new));
+		assert(json_equal(bounded_diff.patch(JsonValue(disjoint_old), disjoint_diff), JsonValue(disjoint_new)));
+		std::cout << "array lcs tests passed" << std::endl;
+	}
+	{
+		// keyed arrays match elements by key, reordered ones become moves
+		DiffOptions options;
+		options.array_keys.push_back(ArrayKey("/list", "id"));
+		JsonDiff json_diff(options);
+		auto origin = json_loads("{\"list\":[{\"id\":1,\"v\":1},{\"id\":2,\"v\":2},{\"id\":3,\"v\":3}]}");
+		auto result = json_loads("{\"list\":[{\"id\":3,\"v\":3},{\"id\":1,\"v\":5},{\"id\":2,\"v\":2},{\"id\":4}]}");
+		auto diff_result = json_diff.diff(origin, result);
+		assert(diff_result->str() == "{\"list\":[[\"~\",0,{\"v\":{\"__old\":1,\"__new\":5}}],[\">\",2,0],[\"+\",3,{\"id\":4}]]}");
+		assert(json_equal(json_diff.patch(origin, diff_result), result));
+		assert(json_equal(json_diff.rollback(result, diff_result), origin));
+		auto patched = origin;
+		json_diff.patch_inplace(patched, *diff_result);
+		assert(json_equal(patched, result));
+		json_diff.rollback_inplace(patched, *diff_result);
+		assert(json_equal(patched, origin));
+		std::cout << "keyed array tests passed" << std::endl;
+	}
+	{
+		// the overloads taking the document by && or in place give the same results as patch and rollback
+		JsonDiff json_diff;
+		auto origin = json_loads("{\"a\":[1,2,3],\"b\":{\"c\":\"x\"},\"d\":1}");
+		auto result = json_loads("{\"a\":[1,3,4],\"b\":{\"c\":\"y\",\"e\":null}}");
+		auto diff_result = json_diff.diff(origin, result);
+		auto moved = origin;
+		assert(json_equal(json_diff.patch(std::move(moved), diff_result), result));
+		moved = result;
+		assert(json_equal(json_diff.rollback(std::move(moved), diff_result), origin));
+		auto inplace = origin;
+		json_diff.patch_inplace(inplace, *diff_result);
+		assert(json_equal(inplace, result));
+		json_diff.rollback_inplace(inplace, *diff_result);
+		assert(json_equal(inplace, origin));
+		std::cout << "patch overload tests passed" << std::endl;
+	}
+	{
+		// a diff is compiled once and applied to many replicas
+		JsonDiff json_diff;
+		auto origin = json_loads("{\"a\":[1,2,3],\"b\":{\"c\":\"x\"}}");
+		auto result = json_loads("{\"a\":[0,1,2],\"b\":{\"d\":true}}");
+		auto diff_result = json_diff.diff(origin, result);
+		assert(diff_result->compiled() == diff_result->compiled());
+		CompiledDiff compiled(diff_result->value());
+		std::vector<JsonValue> replicas(3, origin);
+		for (auto& replica : replicas)
+		{
+			json_diff.patch_inplace(replica, compiled);
+			assert(json_equal(replica, result));
+		}
+		for (auto& replica : replicas)
+		{
+			json_diff.rollback_inplace(replica, compiled);
+			assert(json_equal(replica, origin));
+		}
+		std::cout << "compiled diff tests passed" << std::endl;
+	}
+	{
+		// most members of a large object deleted and put back in place, on both backends
+		JsonDiff json_diff;
+		fc::mutable_variant_object wide_obj, narrow_obj;
+		for (size_t i = 0; i < 5000; i++)
+		{
+			wide_obj("key-" + std::to_string(i), JsonValue((uint64_t)i));
+			if (i % 10 == 0)
+				narrow_obj("key-" + std::to_string(i), JsonValue((uint64_t)i));
+		}
+		narrow_obj("added", JsonValue(true));
+		JsonValue wide = wide_obj;
+		JsonValue narrow = narrow_obj;
+		auto diff_result = json_diff.diff(wide, narrow);
+		auto patched = wide;
+		json_diff.patch_inplace(patched, *diff_result);
+		assert(json_dumps(patched) == json_dumps(narrow));
+		json_diff.rollback_inplace(patched, *diff_result);
+		assert(json_equal(patched, wide));
+		NativeJsonDocument doc;
+		doc.parse(json_dumps(wide));
+		json_diff.patch_inplace(doc, *diff_result);
+		assert(json_dumps(doc.to_json()) == json_dumps(narrow));
+		json_diff.rollback_inplace(doc, *diff_result);
+		assert(json_equal(doc.to_json(), wide));
+		std::cout << "object member removal tests passed" << std::endl;
+	}
 	{
 		// test big int and big double
 		int64_t a = 6000000000;
@@ -100,13 +248,552 @@ int main()
 		const auto& b_json_str = json_dumps(b);
 		auto a_loaded = json_loads(a_json_str);
 		auto b_loaded = json_loads(b_json_str);
-		auto a_type = a_loaded.get_type();
 		assert(a_loaded.is_integer() && a_loaded.as_int64() == a);
 		assert(b_loaded.is_double() && abs(b_loaded.as_double() - b) < 0.0001);
 		std::cout << "big int and big double tests passed" << std::endl;
 	}
-	int a;
-	std::cout << "press any char and enter to exit";
-	std::cin >> a;
+	{
+		// typed scalar comparison
+		JsonDiff json_diff;
+		assert(json_diff.diff(JsonValue((int64_t)6000000000), JsonValue((uint64_t)6000000000))->is_undefined());
+		assert(json_diff.diff(JsonValue((int64_t)-1), JsonValue(UINT64_MAX))->is_undefined() == false);
+		assert(json_diff.diff(JsonValue((int64_t)1), JsonValue(1.0))->is_undefined());
+		assert(json_diff.diff(JsonValue((int64_t)1), JsonValue(1.5))->is_undefined() == false);
+		assert(json_diff.diff_by_string("{\"a\":1,\"b\":[0.0,2]}", "{\"a\":1.0,\"b\":[-0.0,2.0]}")->is_undefined());
+		assert(json_fingerprint(json_loads("[1,0]")) == json_fingerprint(json_loads("[1.0,-0.0]")));
+		assert(json_diff.diff(JsonValue(1.23456789), JsonValue(1.23456789))->is_undefined());
+		auto diff_result = json_diff.diff_by_string("{\"a\":6000000000,\"b\":1.5,\"c\":null}", "{\"a\":6000000001,\"b\":1.5,\"c\":false}");
+		assert(diff_result->str() == "{\"a\":{\"__old\":6000000000,\"__new\":6000000001},\"c\":{\"__old\":null,\"__new\":false}}");
+		std::cout << "typed scalar comparison tests passed" << std::endl;
+	}
+	{
+		// binary diff form
+		JsonDiff json_diff;
+		auto diff_result = json_diff.diff_by_string("{\"a\":[1,2,3],\"b\":-5,\"c\":1.25,\"d\":\"x\"}", "{\"a\":[0,1,3],\"b\":6000000000,\"d\":\"y\",\"e\":{\"f\":null}}");
+		auto binary = diff_result->binary();
+		auto loaded = DiffResult::from_binary(binary);
+		assert(binary.size() < diff_result->str().size());
+		assert(loaded->str() == diff_result->str());
+		assert(DiffResult::from_binary(DiffResult::make_undefined_diff_result()->binary())->is_undefined());
+		std::cout << "binary diff tests passed" << std::endl;
+	}
+	{
+		// stream diff writes the same text as diff_by_string
+		JsonDiff json_diff;
+		std::string origin = "{\"a\": 1.50, \"b\\u0041\": \"x\\/y\", \"c\": [1, 2, 3], \"e\": {\"f\": [{\"g\": 1}]}}";
+		std::string result = "{\"a\":1.5,\"bA\":\"x/y\",\"c\":[1,2,4],\"d\":true,\"e\":{\"f\":[{\"g\":2}]}}";
+		std::stringstream ss;
+		json_diff.diff_stream(origin.data(), origin.size(), result.data(), result.size(), ss);
+		assert(ss.str() == json_diff.diff_by_string(origin, result)->str());
+		std::stringstream same;
+		json_diff.diff_stream(origin.data(), origin.size(), origin.data(), origin.size(), same);
+		assert(same.str() == "null");
+		bool thrown = false;
+		try
+		{
+			std::stringstream bad;
+			json_diff.diff_stream(origin.data(), origin.size() - 1, result.data(), result.size(), bad);
+		}
+		catch (const std::exception&)
+		{
+			thrown = true;
+		}
+		assert(thrown);
+		(void)thrown;
+		// duplicate keys are read as json_loads reads them, the last value wins
+		std::string duplicated = "{\"a\":1,\"b\":{\"c\":1,\"c\":2},\"a\":2}";
+		std::string deduplicated = "{\"a\":2,\"b\":{\"c\":2}}";
+		std::stringstream dup;
+		json_diff.diff_stream(duplicated.data(), duplicated.size(), deduplicated.data(), deduplicated.size(), dup);
+		assert(dup.str() == "null");
+		// arrays changed at the front, in the middle, at the end, by moves, and with objects in other key orders
+		const char* array_pairs[][2] = {
+			{ "[1,2,3,4,5,6]", "[0,2,3,4,5,6]" },
+			{ "[1,2,3,4,5,6]", "[1,2,9,8,4,5,6]" },
+			{ "[1,2,3,4,5,6]", "[1,2,3,4,5]" },
+			{ "[1,2,3]", "[1,2,3,4,5]" },
+			{ "[1,2,3]", "[]" },
+			{ "[1,2,3,4,5,6]", "[6,5,4,3,2,1]" },
+			{ "[{\"x\":1,\"y\":2},3,{\"z\":[1,2]}]", "[{\"y\":2,\"x\":1},{\"z\":[1,3]},3]" },
+			{ "[[1,2],[3,4],[5,6],[1,2]]", "[[1,2],[5,6],[3,5],[1,2]]" },
+			{ "[null,{\"x\":1,\"y\":2},\"s\",5]", "[null,{\"y\":2,\"x\":1},\"s\",5,5]" },
+			{ "{\"a\":[1,{\"b\":1},2]}", "{\"a\":[1,{\"b\":2},2,2]}" },
+		};
+		for (const auto& pair : array_pairs)
+		{
+			std::string old_text = pair[0];
+			std::string new_text = pair[1];
+			std::stringstream array_ss;
+			json_diff.diff_stream(old_text.data(), old_text.size(), new_text.data(), new_text.size(), array_ss);
+			assert(array_ss.str() == json_diff.diff_by_string(old_text, new_text)->str());
+		}
+		// path filters apply to the elements diffed one at a time
+		DiffOptions filter_options;
+		filter_options.exclude_paths.push_back("/a/1/b");
+		JsonDiff filter_diff(filter_options);
+		std::string filter_old = "{\"a\":[0,{\"b\":1,\"c\":1},2]}";
+		std::string filter_new = "{\"a\":[0,{\"b\":2,\"c\":2},2]}";
+		std::stringstream filter_ss;
+		filter_diff.diff_stream(filter_old.data(), filter_old.size(), filter_new.data(), filter_new.size(), filter_ss);
+		assert(filter_ss.str() == filter_diff.diff_by_string(filter_old, filter_new)->str());
+		assert(filter_ss.str().find("\"b\"") == std::string::npos);
+		std::cout << "stream diff tests passed" << std::endl;
+	}
+	{
+		// native documents diff, patch and roll back like fc values
+		JsonDiff json_diff;
+		std::string origin = "{\"a\":[1,2,3,{\"x\":\"a long string of the arena\"}],\"b\":-5,\"c\":1.25,\"d\":\"x\",\"n\":18446744073709551615}";
+		std::string result = "{\"a\":[0,1,3,{\"x\":\"another long string of the arena\"}],\"b\":6000000000,\"d\":\"y\",\"e\":{\"f\":null},\"n\":1}";
+		NativeJsonDocument old_doc, new_doc;
+		old_doc.parse(origin);
+		new_doc.parse(result);
+		auto diff_result = json_diff.diff(old_doc.root(), new_doc.root());
+		assert(diff_result->str() == json_diff.diff_by_string(origin, result)->str());
+		json_diff.patch_inplace(old_doc, *diff_result);
+		assert(json_equal(old_doc.to_json(), json_loads(result)));
+		json_diff.rollback_inplace(old_doc, *diff_result);
+		assert(json_equal(old_doc.to_json(), json_loads(origin)));
+		assert(json_diff.diff(old_doc.root(), old_doc.root())->is_undefined());
+		// a duplicate key keeps its first position and takes the last value, as json_loads reads it
+		old_doc.parse("{\"k\":1,\"j\":2,\"k\":3.5}");
+		assert(json_dumps(old_doc.to_json()) == json_dumps(json_loads("{\"k\":1,\"j\":2,\"k\":3.5}")));
+		// arrays are spliced in place by patch and rollback, on both backends
+		const char* splice_pairs[][2] = {
+			{ "[1,2,3,4,5,6]", "[0,1,2,3,{\"x\":4},5]" },
+			{ "[1,2,3,4,5,6]", "[1,9,3,8,7,6,5]" },
+			{ "[1,2,3,4,5,6]", "[2,[3],5]" },
+			{ "[]", "[1,2]" },
+		};
+		for (const auto& pair : splice_pairs)
+		{
+			auto splice_diff = json_diff.diff_by_string(pair[0], pair[1]);
+			old_doc.parse(pair[0]);
+			json_diff.patch_inplace(old_doc, *splice_diff);
+			assert(json_equal(old_doc.to_json(), json_loads(pair[1])));
+			json_diff.rollback_inplace(old_doc, *splice_diff);
+			assert(json_equal(old_doc.to_json(), json_loads(pair[0])));
+			auto splice_json = json_loads(pair[0]);
+			json_diff.patch_inplace(splice_json, *splice_diff);
+			assert(json_equal(splice_json, json_loads(pair[1])));
+			json_diff.rollback_inplace(splice_json, *splice_diff);
+			assert(json_equal(splice_json, json_loads(pair[0])));
+		}
+		std::cout << "native json tests passed" << std::endl;
+	}
+	{
+		// a parallel diff is the same as the serial one
+		fc::mutable_variant_object old_obj, new_obj;
+		fc::variants old_items, new_items;
+		for (int i = 0; i < 3000; i++)
+		{
+			auto key = "k" + std::to_string(i);
+			old_obj[key] = i;
+			new_obj[key] = i % 7 == 0 ? i + 1 : i;
+			old_items.push_back(JsonValue(fc::mutable_variant_object("id", i)("v", i)));
+			if (i % 11 != 0)
+				new_items.push_back(JsonValue(fc::mutable_variant_object("id", i)("v", i % 13 == 0 ? -i : i)));
+		}
+		old_obj["items"] = old_items;
+		new_obj["items"] = new_items;
+		DiffOptions options;
+		options.thread_pool = std::make_shared<ThreadPool>(4);
+		JsonDiff serial_diff;
+		JsonDiff parallel_diff(options);
+		auto expected = serial_diff.diff(JsonValue(old_obj), JsonValue(new_obj));
+		assert(parallel_diff.diff(JsonValue(old_obj), JsonValue(new_obj))->str() == expected->str());
+		assert(json_equal(parallel_diff.patch(JsonValue(old_obj), expected), JsonValue(new_obj)));
+		std::cout << "parallel diff tests passed" << std::endl;
+	}
+	{
+		// batch diff gives the diffs of the pairs in order
+		JsonDiff json_diff;
+		std::vector<std::string> texts = { "{\"a\":1,\"b\":[1,2]}", "{\"a\":2,\"b\":[1,2,3]}", "[1,{\"c\":null}]", "[1,{\"c\":true}]", "\"x\"", "\"x\"" };
+		std::vector<JsonTextPair> text_pairs;
+		std::vector<JsonValue> values;
+		for (const auto& text : texts)
+			values.push_back(json_loads(text));
+		std::vector<JsonValuePair> value_pairs;
+		for (size_t i = 0; i < texts.size(); i += 2)
+		{
+			text_pairs.push_back(JsonTextPair(texts[i], texts[i + 1]));
+			value_pairs.push_back(JsonValuePair(values[i], values[i + 1]));
+		}
+		std::vector<DiffResult> results;
+		json_diff.diff_batch(value_pairs.data(), value_pairs.size(), results);
+		assert(results.size() == 3);
+		for (size_t i = 0; i < results.size(); i++)
+			assert(results[i].str() == json_diff.diff_by_string(texts[2 * i], texts[2 * i + 1])->str());
+		assert(results[2].is_undefined());
+		DiffOptions options;
+		options.thread_pool = std::make_shared<ThreadPool>(2);
+		JsonDiff pool_diff(options);
+		DiffBatchScratch scratch;
+		pool_diff.diff_batch(text_pairs.data(), text_pairs.size(), results, scratch);
+		for (size_t i = 0; i < results.size(); i++)
+			assert(results[i].str() == json_diff.diff_by_string(texts[2 * i], texts[2 * i + 1])->str());
+		std::cout << "batch diff tests passed" << std::endl;
+	}
+	{
+		// composed diffs patch and roll back like the diff of the first and last versions
+		JsonDiff json_diff;
+		std::vector<std::string> versions = { "{\"a\":1,\"b\":[1,2,3],\"c\":{\"d\":true}}", "{\"b\":[0,1,3],\"c\":{\"d\":false},\"e\":\"x\"}",
+			"{\"a\":2,\"b\":[0,3,4],\"c\":5,\"e\":\"y\"}", "{\"a\":2,\"b\":[4,0,3],\"c\":5}" };
+		std::vector<DiffResultP> diffs;
+		for (size_t i = 0; i + 1 < versions.size(); i++)
+			diffs.push_back(json_diff.diff_by_string(versions[i], versions[i + 1]));
+		auto first = json_loads(versions.front());
+		auto last = json_loads(versions.back());
+		auto composed = json_diff.compose(diffs);
+		assert(json_equal(json_diff.patch(first, composed), last));
+		assert(json_equal(json_diff.rollback(last, composed), first));
+		auto pair = json_diff.compose(diffs[0], diffs[1]);
+		assert(json_equal(json_diff.patch(first, pair), json_loads(versions[2])));
+		assert(json_diff.compose(diffs[0], json_diff.diff_by_string(versions[1], versions[0]))->is_undefined());
+		assert(json_diff.compose(json_diff.diff_by_string("1", "2"), json_diff.diff_by_string("2", "1"))->is_undefined());
+		assert(json_diff.compose(diffs[1], DiffResult::make_undefined_diff_result())->str() == diffs[1]->str());
+		std::cout << "compose tests passed" << std::endl;
+	}
+	{
+		// a version store gives back every committed version, also after it is opened again
+		std::string path = "jsondiff_runner_versions.log";
+		std::remove(path.c_str());
+		std::vector<JsonValue> versions;
+		VersionStoreOptions options;
+		options.keyframe_interval = 4;
+		{
+			VersionStore store(path, options);
+			for (int i = 0; i < 11; i++)
+			{
+				versions.push_back(json_loads("{\"n\":" + std::to_string(i) + ",\"items\":[" + std::to_string(i % 3) + ",1,2],\"name\":\"v" + std::to_string(i / 2) + "\"}"));
+				assert(store.commit(versions.back()) == (uint64_t)i);
+			}
+			for (size_t i = 0; i < versions.size(); i++)
+				assert(json_equal(store.get(i), versions[i]));
+			assert(json_equal(JsonDiff().patch(versions[2], store.changes(2, 9)), versions[9]));
+		}
+		{
+			VersionStore store(path, options);
+			assert(store.version_count() == versions.size());
+			assert(json_equal(store.head(), versions.back()));
+			versions.push_back(json_loads("[]"));
+			store.commit(versions.back());
+			for (size_t i = 0; i < versions.size(); i++)
+				assert(json_equal(store.get(i), versions[i]));
+		}
+		std::streamoff log_size;
+		{
+			std::ifstream file(path, std::ios::binary | std::ios::ate);
+			log_size = file.tellg();
+		}
+		{
+			// a record cut short at the end is dropped
+			std::ofstream file(path, std::ios::binary | std::ios::app);
+			file.write("D\x40\0\0\0\0\0\0\0", 9);
+		}
+		{
+			VersionStore store(path, options);
+			assert(store.version_count() == versions.size());
+		}
+		{
+			std::ifstream file(path, std::ios::binary | std::ios::ate);
+			assert(file.tellg() == log_size);
+		}
+		{
+			// a damaged record with records after it makes opening fail and keeps the file as it is
+			std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+			file.seekg(5 + 17 + 2);
+			char c = (char)file.get();
+			file.seekp(5 + 17 + 2);
+			file.put((char)(c ^ 1));
+		}
+		std::string error;
+		try
+		{
+			VersionStore store(path, options);
+		}
+		catch (const JsonDiffException& e)
+		{
+			error = e.what();
+		}
+		{
+			std::ifstream file(path, std::ios::binary | std::ios::ate);
+			assert(file.tellg() == log_size);
+		}
+		(void)log_size;
+		assert(error == "corrupt version log " + path);
+		std::remove(path.c_str());
+		std::cout << "version store tests passed" << std::endl;
+	}
+	{
+		// a tracked document gives the diff of its changes without comparing the documents
+		JsonDiff json_diff;
+		auto origin = json_loads("{\"a\":1,\"b\":{\"c\":[1,2,3]},\"d\":\"x\"}");
+		TrackedDocument doc(origin);
+		doc.set("/a", JsonValue(2));
+		doc.set("/b/e", JsonValue(true));
+		doc.insert("/b/c/0", JsonValue(0));
+		doc.erase("/b/c/2");
+		doc.set("/b/c/-", JsonValue(4));
+		doc.erase("/d");
+		doc.set("/d", JsonValue("x"));
+		auto result = json_loads("{\"a\":2,\"b\":{\"c\":[0,1,3,4],\"e\":true},\"d\":\"x\"}");
+		assert(json_equal(doc.json(), result));
+		auto diff_result = doc.diff();
+		assert(json_equal(json_diff.patch(origin, diff_result), result));
+		assert(json_equal(json_diff.rollback(result, diff_result), origin));
+		doc.set("/a", JsonValue(1));
+		doc.erase("/b/e");
+		doc.set("/b/c", json_loads("[1,2,3]"));
+		assert(doc.diff()->is_undefined());
+		doc.reset();
+		doc.set("/a", JsonValue(1));
+		assert(doc.change_count() == 0 && doc.diff()->is_undefined());
+		// path filters don't drop changes, every change is made and is in the diff
+		DiffOptions filtered_options;
+		filtered_options.exclude_paths.push_back("/a");
+		TrackedDocument filtered(origin, filtered_options);
+		filtered.set("/a", JsonValue(2));
+		filtered.set("/b/c/1", JsonValue(5));
+		auto filtered_result = json_loads("{\"a\":2,\"b\":{\"c\":[1,5,3]},\"d\":\"x\"}");
+		assert(json_equal(filtered.json(), filtered_result));
+		assert(json_equal(json_diff.patch(origin, filtered.diff()), filtered_result));
+		std::cout << "tracked document tests passed" << std::endl;
+	}
+	{
+		// only the changes under the included paths, without the excluded ones, and whole subtrees below the depth limit
+		DiffOptions options;
+		options.include_paths.push_back("/storage/balances");
+		options.exclude_paths.push_back("/storage/balances/*/nonce");
+		JsonDiff json_diff(options);
+		auto origin = json_loads("{\"meta\":{\"time\":1},\"storage\":{\"balances\":{\"a\":{\"amount\":1,\"nonce\":1}},\"code\":\"x\"}}");
+		auto result = json_loads("{\"meta\":{\"time\":2},\"storage\":{\"balances\":{\"a\":{\"amount\":2,\"nonce\":2},\"b\":{\"amount\":3}},\"code\":\"y\"}}");
+		auto diff_result = json_diff.diff(origin, result);
+		assert(diff_result->str() == "{\"storage\":{\"balances\":{\"a\":{\"amount\":{\"__old\":1,\"__new\":2}},\"b__added\":{\"amount\":3}}}}");
+		auto patched = json_diff.patch(origin, diff_result);
+		assert(json_dumps(patched) == "{\"meta\":{\"time\":1},\"storage\":{\"balances\":{\"a\":{\"amount\":2,\"nonce\":1},\"b\":{\"amount\":3}},\"code\":\"x\"}}");
+		assert(json_equal(json_diff.rollback(patched, diff_result), origin));
+
+		DiffOptions depth_options;
+		depth_options.max_depth = 2;
+		JsonDiff depth_diff(depth_options);
+		assert(depth_diff.diff(origin, result)->str() == "{\"meta\":{\"time\":{\"__old\":1,\"__new\":2}},\"storage\":{\"balances\":{\"__old\":"
+			+ json_dumps(origin["storage"]["balances"]) + ",\"__new\":" + json_dumps(result["storage"]["balances"]) + "},\"code\":{\"__old\":\"x\",\"__new\":\"y\"}}}");
+		std::cout << "path filter tests passed" << std::endl;
+	}
+	{
+		// equality stops at the first difference, a bounded diff gives up on large changes
+		fc::mutable_variant_object old_obj, new_obj;
+		for (int i = 0; i < 2000; i++)
+		{
+			old_obj["k" + std::to_string(i)] = i;
+			new_obj["k" + std::to_string(i)] = i % 100 == 0 ? i + 1 : i;
+		}
+		JsonValue origin = old_obj;
+		JsonValue result = new_obj;
+		assert(!json_equal(origin, result) && json_equal(origin, json_loads(json_dumps(origin))));
+
+		DiffOptions options;
+		options.max_changes = 10;
+		options.thread_pool = std::make_shared<ThreadPool>(2);
+		JsonDiff json_diff(options);
+		auto diff_result = json_diff.diff(origin, result);
+		assert(diff_result->str() == "{\"__old\":" + json_dumps(origin) + ",\"__new\":" + json_dumps(result) + "}");
+		options.max_changes = 20;
+		assert(JsonDiff(options).diff(origin, result)->str() == JsonDiff().diff(origin, result)->str());
+		options.max_compared_values = 100;
+		options.budget_action = DBA_THROW;
+		bool too_large = false;
+		try
+		{
+			JsonDiff(options).diff(origin, result);
+		}
+		catch (const JsonDiffBudgetException&)
+		{
+			too_large = true;
+		}
+		assert(too_large);
+		(void)too_large;
+		// the stream diff counts the budget like diff
+		auto origin_text = json_dumps(origin);
+		auto result_text = json_dumps(result);
+		for (size_t max_changes : { 10, 20 })
+		{
+			DiffOptions stream_options;
+			stream_options.max_changes = max_changes;
+			JsonDiff stream_diff(stream_options);
+			std::stringstream stream_ss;
+			stream_diff.diff_stream(origin_text.data(), origin_text.size(), result_text.data(), result_text.size(), stream_ss);
+			assert(stream_ss.str() == stream_diff.diff(origin, result)->str());
+		}
+		std::string array_old = "[{\"a\":[1,2,3]},[4,5],6]";
+		std::string array_new = "[{\"a\":[1,3]},[4,5,7],8]";
+		for (size_t max_compared_values = 0; max_compared_values < 12; max_compared_values++)
+		{
+			DiffOptions stream_options;
+			stream_options.max_compared_values = max_compared_values;
+			JsonDiff stream_diff(stream_options);
+			std::stringstream stream_ss;
+			stream_diff.diff_stream(array_old.data(), array_old.size(), array_new.data(), array_new.size(), stream_ss);
+			assert(stream_ss.str() == stream_diff.diff_by_string(array_old, array_new)->str());
+		}
+		too_large = false;
+		try
+		{
+			std::stringstream stream_ss;
+			JsonDiff(options).diff_stream(origin_text.data(), origin_text.size(), result_text.data(), result_text.size(), stream_ss);
+		}
+		catch (const JsonDiffBudgetException&)
+		{
+			too_large = true;
+		}
+		assert(too_large);
+		std::cout << "diff budget tests passed" << std::endl;
+
+		// the stats of each call go to the callback and the totals, the parallel tasks of a diff included
+		size_t calls = 0;
+		auto collector = std::make_shared<DiffStatsCollector>([&calls](const DiffStats&) { calls++; });
+		DiffOptions stats_options;
+		stats_options.thread_pool = std::make_shared<ThreadPool>(2);
+		stats_options.parallel_min_size = 100;
+		stats_options.stats = collector;
+		JsonDiff stats_diff(stats_options);
+		diff_result = stats_diff.diff(origin, result);
+		auto diff_stats = collector->total(DSO_DIFF);
+		assert(diff_stats.calls == 1 && diff_stats.visited[JVT_OBJECT] == 1 && diff_stats.visited[JVT_INTEGER] == 2000);
+		assert(diff_stats.changes == 20 && diff_stats.max_depth == 1 && diff_stats.output_bytes == diff_result->str().size());
+		assert(diff_stats.object_fanout[DiffStats::fanout_bucket(2000)] == 1 && diff_stats.diff_values == 61);
+		(void)diff_stats;
+		assert(json_equal(stats_diff.rollback(stats_diff.patch(origin, diff_result), diff_result), origin));
+		assert(collector->total(DSO_PATCH).changes == 20 && collector->total(DSO_ROLLBACK).calls == 1 && calls == 3);
+		collector->reset();
+		assert(collector->total(DSO_DIFF).calls == 0);
+		std::cout << "diff stats tests passed" << std::endl;
+	}
+	{
+		// long strings keep the changed bytes only, and still patch, roll back, stream and compose
+		std::string code;
+		for (int i = 0; i < 2048; i++)
+			code += "0123456789abcdef"[i % 16];
+		std::string edited = code;
+		edited[100] = 'x';
+		edited[1500] = 'y';
+		auto origin = json_loads("{\"code\":\"" + code + "\",\"n\":1}");
+		auto result = json_loads("{\"code\":\"" + edited + "\",\"n\":1}");
+		DiffOptions delta_options;
+		delta_options.string_delta_min_size = 1024;
+		JsonDiff json_diff(delta_options);
+		auto diff_result = json_diff.diff(origin, result);
+		assert(diff_result->str() == "{\"code\":{\"__strdelta\":[[100,\"4\",\"x\"],[1500,\"c\",\"y\"]]}}");
+		assert(json_equal(json_diff.patch(origin, diff_result), result));
+		assert(json_equal(json_diff.rollback(result, diff_result), origin));
+		assert(diff_result->pretty_diff_str() == "\tcode:\n\t@100\n\t-\"4\"\n\t+\"x\"\n\t@1500\n\t-\"c\"\n\t+\"y\"\n\n");
+		auto old_text = json_dumps(origin);
+		auto new_text = json_dumps(result);
+		std::ostringstream stream_out;
+		json_diff.diff_stream(old_text.data(), old_text.size(), new_text.data(), new_text.size(), stream_out);
+		assert(stream_out.str() == diff_result->str());
+
+		auto appended = json_loads("{\"code\":\"" + edited + "ff\",\"n\":1}");
+		auto composed = json_diff.compose(diff_result, json_diff.diff(result, appended));
+		assert(json_equal(json_diff.patch(origin, composed), appended));
+		assert(json_equal(json_diff.rollback(appended, composed), origin));
+
+		// off by default, diffs keep the whole strings
+		assert(JsonDiff().diff(origin, result)->str() == "{\"code\":{\"__old\":\"" + code + "\",\"__new\":\"" + edited + "\"}}");
+		std::cout << "string delta tests passed" << std::endl;
+	}
+	{
+		// the standard patch formats, written from the diff and applied back in place
+		auto origin = json_loads("{\"a\":1,\"b\":[1,2,3,{\"x\":1}],\"c\":{\"d\":\"x\",\"e/f\":2}}");
+		auto result = json_loads("{\"a\":2,\"b\":[1,3,{\"x\":2},4],\"c\":{\"d\":\"x\"},\"g\":[1]}");
+		JsonDiff json_diff;
+		std::ostringstream patch_out;
+		json_diff.diff_json_patch(origin, result, patch_out);
+		assert(patch_out.str() == "[{\"op\":\"replace\",\"path\":\"/a\",\"value\":2},{\"op\":\"replace\",\"path\":\"/b/3/x\",\"value\":2},"
+			"{\"op\":\"remove\",\"path\":\"/b/1\"},{\"op\":\"add\",\"path\":\"/b/3\",\"value\":4},"
+			"{\"op\":\"remove\",\"path\":\"/c/e~1f\"},{\"op\":\"add\",\"path\":\"/g\",\"value\":[1]}]");
+		auto patched = origin;
+		json_patch_apply(patched, json_loads(patch_out.str()));
+		assert(json_equal(patched, result));
+		std::ostringstream merge_out;
+		json_diff.diff_merge_patch(origin, result, merge_out);
+		assert(merge_out.str() == "{\"a\":2,\"b\":[1,3,{\"x\":2},4],\"c\":{\"e/f\":null},\"g\":[1]}");
+		patched = origin;
+		json_merge_patch_apply(patched, json_loads(merge_out.str()));
+		assert(json_equal(patched, result));
+
+		bool failed = false;
+		try
+		{
+			json_patch_apply(patched, json_loads("[{\"op\":\"test\",\"path\":\"/a\",\"value\":1}]"));
+		}
+		catch (const JsonDiffException&)
+		{
+			failed = true;
+		}
+		assert(failed);
+		(void)failed;
+		// numbers are tested by value
+		json_patch_apply(patched, json_loads("[{\"op\":\"test\",\"path\":\"/a\",\"value\":2.0},{\"op\":\"test\",\"path\":\"/b\",\"value\":[1.0,3,{\"x\":2},4.0]}]"));
+		json_patch_apply(patched, json_loads("[{\"op\":\"move\",\"from\":\"/g\",\"path\":\"/b/0\"},{\"op\":\"copy\",\"from\":\"/a\",\"path\":\"/c/a\"}]"));
+		assert(json_equal(patched, json_loads("{\"a\":2,\"b\":[[1],1,3,{\"x\":2},4],\"c\":{\"d\":\"x\",\"a\":2}}")));
+		std::cout << "json patch tests passed" << std::endl;
+	}
+	{
+		// a diff with fingerprints checks the document it is applied to, and the one it produces
+		auto origin = json_loads("{\"a\":1,\"b\":[1,2,3,{\"x\":1}],\"c\":{\"d\":\"x\",\"e\":2}}");
+		auto result = json_loads("{\"a\":2,\"b\":[1,3,{\"x\":2},4],\"c\":{\"d\":\"x\"}}");
+		DiffOptions options;
+		options.diff_fingerprints = true;
+		JsonDiff json_diff(options);
+		auto diff_result = json_diff.diff(origin, result);
+		assert(json_equal(json_diff.patch(origin, diff_result), result));
+		assert(json_equal(json_diff.rollback(result, diff_result), origin));
+		std::ostringstream patch_out;
+		json_patch_write(patch_out, *diff_result, origin, result);
+		auto patched = origin;
+		json_patch_apply(patched, json_loads(patch_out.str()));
+		assert(json_equal(patched, result));
+
+		std::string error;
+		try
+		{
+			json_diff.patch(json_loads("{\"a\":1,\"b\":[1,2,3,{\"x\":5}],\"c\":{\"d\":\"x\",\"e\":2}}"), diff_result);
+		}
+		catch (const JsonDiffException& e)
+		{
+			error = e.what();
+		}
+		assert(error == "base document doesn't match the fingerprints of the diff at \"/b/3\"");
+		// a stale base isn't touched
+		auto stale = json_loads("{\"a\":1,\"b\":[1,2,3,{\"x\":1}],\"c\":{\"d\":\"y\",\"e\":3}}");
+		auto stale_copy = stale;
+		error.clear();
+		try
+		{
+			json_diff.patch_inplace(stale, *diff_result);
+		}
+		catch (const JsonDiffException& e)
+		{
+			error = e.what();
+		}
+		assert(error == "base document doesn't match the fingerprints of the diff at \"/c\"");
+		assert(json_equal(stale, stale_copy));
+
+		// the whole document replaced
+		auto replaced = json_diff.diff(json_loads("1"), json_loads("[1]"));
+		assert(json_equal(json_diff.patch(json_loads("1"), replaced), json_loads("[1]")));
+		error.clear();
+		try
+		{
+			json_diff.patch(json_loads("2"), replaced);
+		}
+		catch (const JsonDiffException& e)
+		{
+			error = e.what();
+		}
+		assert(error == "base document doesn't match the fingerprints of the diff at \"\"");
+		std::cout << "diff fingerprints tests passed" << std::endl;
+	}
 	return 0;
 }
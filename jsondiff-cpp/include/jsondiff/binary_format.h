@@ -0,0 +1,39 @@
+#ifndef JSONDIFF_BINARY_FORMAT_H
+#define JSONDIFF_BINARY_FORMAT_H
+
+#include <jsondiff/config.h>
+#include <jsondiff/json_value_types.h>
+
+#include <string>
+
+namespace jsondiff
+{
+	// compact binary encoding of a diff json. it holds the same value as the json form, so decoding gives back
+	// a diff whose str() is identical to the one encoded.
+	//
+	// layout: 'J' 'D' <version varint>
+	//         <key count varint> (<length varint> <bytes>)*       dictionary of object keys, suffixes split off
+	//         <value>
+	// value:  a tag byte followed by
+	//         null/false/true                       nothing
+	//         int64                                 zigzag varint
+	//         uint64                                varint
+	//         double                                8 bytes, little endian
+	//         string                                <length varint> <bytes>
+	//         array                                 <count varint> <value>*
+	//         object                                <count varint> (<key ref varint> <value>)*
+	//                                               key ref = dictionary index << 2 | suffix (0 none, 1 __added, 2 __deleted)
+	//         replace { __old: a, __new: b }        <value a> <value b>
+	//         array diff item [op, pos, item]       <op byte '+' '-' '~' '>'> <pos varint> <value item>
+	// integers are LEB128 varints
+#define JSONDIFF_BINARY_FORMAT_VERSION 1
+
+	// @throws JsonDiffException if the json holds a value type json can't express
+	void encode_binary_diff(const JsonValue& diff_json, std::string& out);
+
+	// decode straight into the json value of the diff, no text form is built on the way
+	// @throws JsonDiffException if data is truncated, malformed or of an unknown version
+	JsonValue decode_binary_diff(const char* data, size_t size);
+}
+
+#endif
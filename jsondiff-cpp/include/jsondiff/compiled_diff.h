@@ -0,0 +1,102 @@
+#ifndef JSONDIFF_COMPILED_DIFF_H
+#define JSONDIFF_COMPILED_DIFF_H
+
+#include <jsondiff/config.h>
+#include <jsondiff/json_value_types.h>
+
+#include <string>
+#include <memory>
+#include <vector>
+
+namespace jsondiff
+{
+	enum DiffNodeType
+	{
+		DNT_INVALID = 0, // json that is not a diff, kept as it is
+		DNT_REPLACE = 1, // { __old: <old value>, __new: <new value> }
+		DNT_OBJECT = 2, // { <key>__added: <value>, <key>__deleted: <value>, <key>: <diff>, ... }
+		DNT_ARRAY = 3, // [ [<op>, <pos>, <item>], ... ]
+		DNT_STRING_DELTA = 4 // { __strdelta: [ [<pos>, <old text>, <new text>], ... ] }
+	};
+
+	enum DiffOpType
+	{
+		DOT_MEMBER_ADDED = 0, // <key>__added
+		DOT_MEMBER_DELETED = 1, // <key>__deleted
+		DOT_MEMBER_MODIFIED = 2, // <key>
+		DOT_ITEM_INSERTED = 3, // ['+', pos, value]
+		DOT_ITEM_REMOVED = 4, // ['-', pos, value]
+		DOT_ITEM_MODIFIED = 5, // ['~', pos, diff]
+		DOT_ITEM_MOVED = 6, // ['>', pos, target]
+		DOT_ITEM_INVALID = 7 // entry of an array diff that is not [op, pos, item]
+	};
+
+	struct CompiledDiffNode;
+
+	// one operation of an object or array diff
+	struct CompiledDiffOp
+	{
+		DiffOpType type;
+		// member ops: the member key without its __added/__deleted suffix
+		std::string key;
+		// member ops: the key as written in the diff json
+		const std::string* json_key;
+		// item ops: index in the old array ('-', '~', '>') or in the new array ('+')
+		size_t pos;
+		// DOT_ITEM_MOVED: index in the new array
+		size_t target;
+		// the added, deleted, inserted or removed value, the nested diff json of modified ops,
+		// the whole entry of DOT_ITEM_INVALID
+		const JsonValue* value;
+		// DOT_MEMBER_MODIFIED and DOT_ITEM_MODIFIED: the nested diff
+		std::unique_ptr<CompiledDiffNode> diff;
+
+		CompiledDiffOp();
+	};
+
+	// a diff json decoded into enum ops, split keys and integer positions
+	struct CompiledDiffNode
+	{
+		DiffNodeType type;
+		// the diff json of this node
+		const JsonValue* json;
+		// DNT_REPLACE
+		const JsonValue* old_value;
+		const JsonValue* new_value;
+		// DNT_STRING_DELTA: the array of hunks
+		const JsonValue* hunks;
+		// the [<old>, <new>] fingerprints of the node when the diff carries them, see jsondiff/diff_fingerprints.h
+		const JsonValue* fingerprints;
+		// DNT_OBJECT and DNT_ARRAY, in the order of the diff json
+		std::vector<CompiledDiffOp> ops;
+
+		CompiledDiffNode();
+	};
+
+	// the compiled form of a diff, built once and applied to any number of documents without parsing the diff json again.
+	// the nodes point into the diff json held by this object, so it can't be copied
+	class CompiledDiff
+	{
+	private:
+		JsonValue _diff_json;
+		CompiledDiffNode _root;
+	public:
+		explicit CompiledDiff(const JsonValue& diff_json);
+		explicit CompiledDiff(JsonValue&& diff_json);
+		virtual ~CompiledDiff();
+
+		CompiledDiff(const CompiledDiff&) = delete;
+		CompiledDiff& operator=(const CompiledDiff&) = delete;
+
+		const JsonValue& json() const;
+		const CompiledDiffNode& root() const;
+		bool is_undefined() const;
+
+		// decode diff_json into node, node keeps pointers into diff_json. never throws, malformed parts become invalid nodes/ops
+		static void compile_node(const JsonValue& diff_json, CompiledDiffNode& node);
+	};
+
+	typedef std::shared_ptr<const CompiledDiff> CompiledDiffP;
+}
+
+#endif
@@ -11,6 +11,48 @@ namespace jsondiff
 
 #define JSONDIFF_KEY_OLD_VALUE "__old"
 #define JSONDIFF_KEY_NEW_VALUE "__new"
+
+// key of the diff of two long strings, see jsondiff/string_delta.h
+#define JSONDIFF_KEY_STRING_DELTA "__strdelta"
+
+// key of the fingerprints of an object diff, and op of the entry holding them in an array diff, see jsondiff/diff_fingerprints.h
+#define JSONDIFF_KEY_FINGERPRINTS "__fp"
+#define JSONDIFF_ITEM_FINGERPRINTS "#"
+
+// default DiffOptions::string_delta_min_size: off, so diffs keep the { __old, __new } form existing readers expect.
+// string deltas are opt in, 1024 suits documents with long text values
+#define JSONDIFF_STRING_DELTA_MIN_SIZE SIZE_MAX
+
+// objects with at least this many keys are matched through a hash index instead of linear find
+#define JSONDIFF_OBJECT_KEY_INDEX_MIN_SIZE 16
+
+// default DiffOptions::array_diff_max_cost
+#define JSONDIFF_ARRAY_DIFF_MAX_COST 256
+
+// default DiffOptions::parallel_min_size
+#define JSONDIFF_PARALLEL_MIN_SIZE 1024
+
+// a parallel diff of one object or array is split into this many tasks per pool thread, so stealing evens out the load
+#define JSONDIFF_PARALLEL_TASKS_PER_THREAD 4
+
+// nesting limit when decoding a binary diff, so corrupt input can't exhaust the stack
+#define JSONDIFF_BINARY_MAX_DEPTH 10000
+
+// size of the first block of a JsonArena, later blocks double up to JSONDIFF_ARENA_MAX_BLOCK_SIZE
+#define JSONDIFF_ARENA_BLOCK_SIZE (64 << 10)
+#define JSONDIFF_ARENA_MAX_BLOCK_SIZE (64 << 20)
+
+// default VersionStoreOptions::keyframe_interval
+#define JSONDIFF_VERSION_STORE_KEYFRAME_INTERVAL 64
+
+// MappedFile::release_before drops pages once this many bytes have been read past the last release
+#define JSONDIFF_MAPPED_FILE_RELEASE_STEP (16 << 20)
+
+// bytes a JsonWriter collects before writing them to its stream
+#define JSONDIFF_JSON_WRITER_BUFFER_SIZE 4096
+
+// buckets of the fan-out histograms of DiffStats, the last one counts objects and arrays of 2^14 or more children
+#define JSONDIFF_STATS_FANOUT_BUCKETS 16
 }
 
 #endif
@@ -0,0 +1,70 @@
+#ifndef JSONDIFF_DIFF_BATCH_H
+#define JSONDIFF_DIFF_BATCH_H
+
+#include <jsondiff/config.h>
+#include <jsondiff/json_value_types.h>
+#include <jsondiff/native_json.h>
+
+#include <stddef.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace jsondiff
+{
+	// one (old, new) pair of a batch diff, the values are not copied and must outlive the call
+	struct JsonValuePair
+	{
+		const JsonValue* old_json;
+		const JsonValue* new_json;
+
+		JsonValuePair() : old_json(nullptr), new_json(nullptr) {}
+		JsonValuePair(const JsonValue& old_json_, const JsonValue& new_json_)
+			: old_json(&old_json_), new_json(&new_json_)
+		{
+		}
+	};
+
+	// one (old, new) pair of json texts of a batch diff, the texts are not copied and must outlive the call
+	struct JsonTextPair
+	{
+		const char* old_json;
+		size_t old_size;
+		const char* new_json;
+		size_t new_size;
+
+		JsonTextPair() : old_json(nullptr), old_size(0), new_json(nullptr), new_size(0) {}
+		JsonTextPair(const char* old_json_, size_t old_size_, const char* new_json_, size_t new_size_)
+			: old_json(old_json_), old_size(old_size_), new_json(new_json_), new_size(new_size_)
+		{
+		}
+		JsonTextPair(const std::string& old_json_, const std::string& new_json_)
+			: old_json(old_json_.data()), old_size(old_json_.size()), new_json(new_json_.data()), new_size(new_json_.size())
+		{
+		}
+	};
+
+	// the documents the texts of a batch are parsed into, two per task. they keep their arenas between the pairs
+	// of a batch, and between batches when the same scratch is passed again
+	class DiffBatchScratch
+	{
+	private:
+		std::vector<std::unique_ptr<NativeJsonDocument>> _documents;
+	public:
+		DiffBatchScratch();
+		virtual ~DiffBatchScratch();
+
+		DiffBatchScratch(const DiffBatchScratch&) = delete;
+		DiffBatchScratch& operator=(const DiffBatchScratch&) = delete;
+
+		// make sure there are at least count documents, not thread safe
+		void reserve(size_t count);
+
+		// a document made by reserve, tasks may use different documents at the same time
+		NativeJsonDocument& document(size_t i);
+
+		size_t size() const;
+	};
+}
+
+#endif
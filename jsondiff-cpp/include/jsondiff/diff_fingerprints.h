@@ -0,0 +1,45 @@
+#ifndef JSONDIFF_DIFF_FINGERPRINTS_H
+#define JSONDIFF_DIFF_FINGERPRINTS_H
+
+#include <jsondiff/config.h>
+#include <jsondiff/compiled_diff.h>
+#include <jsondiff/json_value_types.h>
+
+namespace jsondiff
+{
+	// fingerprints a diff carries so a patch or rollback can check its documents (DiffOptions::diff_fingerprints):
+	//   object diff: { ..., __fp: [<old>, <new>] }
+	//   array diff: [ ..., ["#", 0, [<old>, <new>]] ]
+	//   a diff replacing the whole document: { __old, __new, __fp: [<old>, <new>] }
+	// <old> and <new> are 16 hex digit checksums of the sites of the node in the old and in the new document.
+	// the sites of an object diff are the members it adds, deletes or replaces (absent ones included), the sites of
+	// an array diff are its size and the elements it removes, inserts, moves or replaces, by position. nested object
+	// and array diffs have fingerprints of their own (none for an object diff that only holds nested ones), so checking
+	// a diff hashes the values at its sites and nothing else of the documents
+
+	enum DiffSide
+	{
+		DS_OLD = 0,
+		DS_NEW = 1
+	};
+
+	// true if json is the [<old>, <new>] pair of a node
+	bool is_diff_fingerprints(const JsonValue& json);
+	// true if json is the ["#", 0, [<old>, <new>]] entry of an array diff
+	bool is_diff_fingerprints_item(const JsonValue& json);
+
+	// add the fingerprints to diff_json, the diff of old_json to new_json
+	// @throws JsonDiffException if diff_json isn't the diff of the two documents
+	template <typename Value>
+	void add_diff_fingerprints(JsonValue& diff_json, const Value& old_json, const Value& new_json);
+
+	// true if the diff of root carries fingerprints
+	bool has_diff_fingerprints(const CompiledDiffNode& root);
+
+	// check that json is the side of the diff of root. nodes without fingerprints aren't checked, their nested nodes are
+	// @throws JsonDiffException naming document_name and the json pointer of the first node that doesn't match
+	template <typename Value>
+	void verify_diff_fingerprints(const Value& json, const CompiledDiffNode& root, DiffSide side, const char* document_name);
+}
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef JSONDIFF_DIFF_OPTIONS_H
+#define JSONDIFF_DIFF_OPTIONS_H
+
+#include <jsondiff/config.h>
+#include <jsondiff/diff_stats.h>
+#include <jsondiff/thread_pool.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace jsondiff
+{
+	// identity of the elements of the arrays at one location, the keyed array diff matches old and new elements by it
+	struct ArrayKey
+	{
+		// json pointer of the arrays, a "*" token matches any object key or array index, e.g. "/blocks/*/transactions".
+		// "" is the root value
+		std::string path;
+		// name of the element member holding its identity, or a json pointer into the element such as "/meta/id"
+		std::string key;
+
+		ArrayKey() {}
+		ArrayKey(const std::string& path_, const std::string& key_)
+			: path(path_), key(key_)
+		{
+		}
+	};
+
+	// what a diff does when it runs out of its budget
+	enum DiffBudgetAction
+	{
+		DBA_REPLACE = 0, // stop and return the whole documents as one { __old, __new } replacement
+		DBA_THROW = 1 // stop and throw JsonDiffBudgetException, the "too large" signal
+	};
+
+	// settings of a JsonDiff instance, the defaults give the plain recursive diff
+	struct DiffOptions
+	{
+		// compare object/array subtrees by structural fingerprint before recursing into them,
+		// so equal subtrees are skipped without walking them. see jsondiff/fingerprint.h, the fingerprints are not
+		// collision resistant against crafted documents, so leave this off for untrusted input
+		bool use_fingerprints;
+
+		// edit distance at which the array diff stops looking for the minimal diff of a region and splits it heuristically,
+		// bounds the diff of large, very different arrays to about O((N+M) * array_diff_max_cost)
+		size_t array_diff_max_cost;
+
+		// arrays at these locations are diffed by element identity instead of by position:
+		// elements are matched through a hash of their key, reordered elements become moves ('>').
+		// an array with an element missing the key or with duplicate keys falls back to the sequence diff
+		std::vector<ArrayKey> array_keys;
+
+		// the members of large objects and the elements of large arrays are diffed as tasks on this pool,
+		// nullptr diffs on the calling thread only. the diff is the same either way
+		ThreadPoolP thread_pool;
+
+		// objects and arrays with fewer children than this are diffed on one thread, even with a thread_pool
+		size_t parallel_min_size;
+
+		// json pointers of the values to diff, a "*" token matches any object key or array index, e.g. "/storage/*/balances".
+		// object members outside of them are skipped without reading them, values on the way to them are walked into
+		// (and reported whole when they are added, deleted or change type). empty diffs the whole document
+		std::vector<std::string> include_paths;
+
+		// json pointers of the values left out of the diff, also inside included ones, e.g. "/meta". array elements
+		// are matched by their old index; the inserts and removes of an array in the diff are kept as they are,
+		// so patch can place them, only the changes inside its elements are filtered
+		std::vector<std::string> exclude_paths;
+
+		// objects and arrays this many levels below the root are compared, not diffed: when they differ they are
+		// reported whole as { __old, __new }. 0 compares the documents as a whole, SIZE_MAX (the default) has no limit
+		size_t max_depth;
+
+		// bound on the work of one diff (of one pair of a batch): the number of value pairs it compares,
+		// counting every object member and array element it goes into. SIZE_MAX (the default) has no bound
+		size_t max_compared_values;
+
+		// bound on the size of one diff: the number of changes in it, i.e. its replaced values,
+		// added/deleted members and inserted/removed/moved elements. SIZE_MAX (the default) has no bound
+		size_t max_changes;
+
+		// what diff does when max_compared_values or max_changes is exceeded, diff_stream and diff_files included
+		DiffBudgetAction budget_action;
+
+		// receives the DiffStats of every diff, diff_batch, patch and rollback call (not of diff_stream, diff_files and diff_at).
+		// nullptr (the default) collects nothing and costs a pointer test per value diffed
+		DiffStatsCollectorP stats;
+
+		// two different strings of which one is at least this long are diffed into a string delta
+		// ({ __strdelta: ... }, see jsondiff/string_delta.h) instead of { __old, __new } when the delta is smaller.
+		// SIZE_MAX (the default) always keeps the whole strings. string deltas change the diff format, so only readers
+		// that know { __strdelta } should get diffs made with a smaller value
+		size_t string_delta_min_size;
+
+		// diffs carry fingerprints of the values they change in both documents (see jsondiff/diff_fingerprints.h),
+		// and patch and rollback check the document they are given and the one they produce against them, in about
+		// the time of the patch itself. a mismatch throws, before anything is changed when it is the given document.
+		// patch and rollback check every diff that carries them, whatever this option. diff_stream, diff_files and
+		// diff_at don't add them
+		bool diff_fingerprints;
+
+		DiffOptions()
+			: use_fingerprints(false), array_diff_max_cost(JSONDIFF_ARRAY_DIFF_MAX_COST), parallel_min_size(JSONDIFF_PARALLEL_MIN_SIZE),
+			max_depth(SIZE_MAX), max_compared_values(SIZE_MAX), max_changes(SIZE_MAX), budget_action(DBA_REPLACE),
+			string_delta_min_size(JSONDIFF_STRING_DELTA_MIN_SIZE), diff_fingerprints(false)
+		{
+		}
+	};
+}
+
+#endif
@@ -3,6 +3,8 @@
 
 #include <string>
 #include <memory>
+#include <ostream>
+#include <jsondiff/compiled_diff.h>
 #include <jsondiff/json_value_types.h>
 
 namespace jsondiff
@@ -15,22 +17,48 @@ namespace jsondiff
 	private:
 		JsonValue _diff_json;
 		bool _is_undefined;
+		mutable CompiledDiffP _compiled;
 	public:
 		DiffResult();
 		DiffResult(const JsonValue& diff_json);
+		DiffResult(JsonValue&& diff_json);
+		DiffResult(const DiffResult& other) = default;
+		DiffResult(DiffResult&& other) = default;
 		virtual ~DiffResult();
 
+		DiffResult& operator=(const DiffResult& other) = default;
+		DiffResult& operator=(DiffResult&& other) = default;
+
 		std::string str() const;
+		// the text of json_pretty_dumps(value()), apart from the strings with escapes fc's pretty printer gets wrong,
+		// see JsonWriter
 		std::string pretty_str() const;
 		bool is_undefined() const;
 
-		JsonValue value() const;
+		// write the text of str() / pretty_str() to out in one pass, without building it in memory
+		// @throws JsonDiffException
+		void write_json(std::ostream& out) const;
+		void write_pretty_json(std::ostream& out) const;
+
+		const JsonValue& value() const;
+
+		// the diff with its operations decoded, built on first use and shared by every later patch/rollback/pretty_diff_str
+		CompiledDiffP compiled() const;
 
 		//  json diffתѺÿɶַ
 		std::string pretty_diff_str(size_t indent_count=0) const;
+		// write the text of pretty_diff_str to out in one pass, without building it in memory
+		void write_pretty_diff(std::ostream& out, size_t indent_count=0) const;
+
+		// compact binary form of the diff, see jsondiff/binary_format.h
+		std::string binary() const;
 
 	public:
 		static std::shared_ptr<DiffResult> make_undefined_diff_result();
+		// @throws JsonDiffException
+		static std::shared_ptr<DiffResult> from_binary(const char* data, size_t size);
+		// @throws JsonDiffException
+		static std::shared_ptr<DiffResult> from_binary(const std::string& data);
 	};
 
 	typedef std::shared_ptr<DiffResult> DiffResultP;
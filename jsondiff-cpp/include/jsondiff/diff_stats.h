@@ -0,0 +1,92 @@
+#ifndef JSONDIFF_DIFF_STATS_H
+#define JSONDIFF_DIFF_STATS_H
+
+#include <jsondiff/config.h>
+#include <jsondiff/json_value_types.h>
+
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace jsondiff
+{
+	enum DiffStatsOperation
+	{
+		DSO_DIFF = 0,
+		DSO_PATCH = 1,
+		DSO_ROLLBACK = 2
+	};
+
+	// what one diff, patch or rollback call did, or the sum of many calls (see DiffStatsCollector::total).
+	// a patch or rollback walks the diff, so its counts are about the nodes of the diff it applied
+	struct DiffStats
+	{
+		DiffStatsOperation operation;
+		// 1 for one call, the number of calls in a total
+		uint64_t calls;
+
+		// values compared by a diff, by the JsonValueType of the old value. a patch or rollback counts
+		// the object and array nodes of the diff it walks, and its replacements by the type of the value they put in
+		uint64_t visited[JVT_ARRAY + 1];
+		// object and array subtrees found equal without walking them (shared storage, fingerprints,
+		// array elements matched as equal)
+		uint64_t skipped_equal;
+		// deepest nesting level walked, the root is 0. the maximum in a total
+		uint64_t max_depth;
+		// fan-out histograms of the objects and arrays walked, see fanout_bucket
+		uint64_t object_fanout[JSONDIFF_STATS_FANOUT_BUCKETS];
+		uint64_t array_fanout[JSONDIFF_STATS_FANOUT_BUCKETS];
+
+		// replaced values, added and deleted members, inserted, removed and moved elements and string delta hunks of the diff
+		uint64_t changes;
+		// json values in the diff: the fc values a diff builds or copies in, about one allocation each
+		uint64_t diff_values;
+		// bytes of the diff as json text (DiffResult::str), only measured for diff
+		uint64_t output_bytes;
+
+		// wall time in nanoseconds of parsing the json texts (diff_by_string), of the diff, patch or rollback itself,
+		// and of measuring output_bytes by writing the text of the diff
+		uint64_t parse_ns;
+		uint64_t diff_ns;
+		uint64_t serialize_ns;
+
+		DiffStats();
+		explicit DiffStats(DiffStatsOperation operation_);
+
+		// add the counts of other, keeping the larger max_depth
+		void merge(const DiffStats& other);
+
+		// bucket 0 counts empty objects or arrays, bucket k > 0 the ones with [2^(k-1), 2^k) members or elements,
+		// the last bucket everything larger
+		static size_t fanout_bucket(size_t count);
+	};
+
+	// receives the DiffStats of the calls of the JsonDiff instances it is set on (DiffOptions::stats), sums them
+	// per operation and passes each one to the callback, e.g. to export them to a metrics pipeline.
+	// the callback is called on the thread that made the call, under no lock. thread safe
+	class DiffStatsCollector
+	{
+	private:
+		mutable std::mutex _mutex;
+		DiffStats _totals[DSO_ROLLBACK + 1];
+		std::function<void(const DiffStats&)> _callback;
+	public:
+		DiffStatsCollector();
+		explicit DiffStatsCollector(const std::function<void(const DiffStats&)>& callback);
+		virtual ~DiffStatsCollector();
+
+		// add the stats of one call to the totals and pass them to the callback.
+		// override it to send the stats elsewhere without the lock of the totals
+		virtual void record(const DiffStats& stats);
+
+		// the sum of the calls of operation since construction or the last reset
+		DiffStats total(DiffStatsOperation operation) const;
+
+		void reset();
+	};
+
+	typedef std::shared_ptr<DiffStatsCollector> DiffStatsCollectorP;
+}
+
+#endif
@@ -60,6 +60,19 @@ namespace jsondiff
 			jsondiff::JsonDiffException::dynamic_rethrow_exception();
 		}
 	};
+
+	// thrown by a diff that ran out of the budget of its DiffOptions, see DiffOptions::budget_action
+	class JsonDiffBudgetException : public JsonDiffException
+	{
+	public:
+		inline JsonDiffBudgetException(const std::string &msg)
+			: JsonDiffException(msg) {}
+
+		inline virtual std::shared_ptr<jsondiff::JsonDiffException> dynamic_copy_exception()const
+		{
+			return std::make_shared<JsonDiffBudgetException>(*this);
+		}
+	};
 }
 
 #endif
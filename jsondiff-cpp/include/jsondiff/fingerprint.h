@@ -0,0 +1,56 @@
+#ifndef JSONDIFF_FINGERPRINT_H
+#define JSONDIFF_FINGERPRINT_H
+
+#include <jsondiff/config.h>
+#include <jsondiff/json_value_types.h>
+
+#include <stdint.h>
+#include <string>
+#include <memory>
+#include <unordered_map>
+
+namespace jsondiff
+{
+	// 64 bit structural hash of a json value.
+	// equal values (as the diff sees them) have equal fingerprints: object fingerprints don't depend on key order,
+	// number fingerprints don't depend on int64/uint64/double storage. different values collide with probability ~2^-64
+	// for documents that aren't made to collide: the hash is fast and unkeyed, not cryptographic, so someone who
+	// controls a document can craft a changed subtree with the fingerprint of the old one. don't skip subtrees by
+	// fingerprint (DiffOptions::use_fingerprints) for untrusted documents
+	typedef uint64_t JsonFingerprint;
+
+	JsonFingerprint json_fingerprint(const JsonValue& json_value);
+	// a native value has the fingerprint of the same fc value
+	JsonFingerprint json_fingerprint(const NativeJsonValue& json_value);
+
+	// fingerprint of a string's bytes, shared by the structural hash and the callers hashing raw strings
+	JsonFingerprint fingerprint_bytes(const char* data, size_t size, JsonFingerprint seed = 0);
+
+	// true if two object/array values share the same fc storage, and so are equal without looking at them
+	bool json_shares_storage(const JsonValue& a, const JsonValue& b);
+
+	// fingerprints of the object/array nodes of one document, computed once per node and cached by node address.
+	// the cache is only valid while the document it was filled from is alive and unmodified,
+	// so it can be kept with a base version and reused for every diff against that version
+	class JsonFingerprintCache
+	{
+	private:
+		std::unordered_map<const JsonValue*, JsonFingerprint> _fingerprints;
+	public:
+		JsonFingerprintCache();
+		virtual ~JsonFingerprintCache();
+
+		// fingerprint of json_value, served from the cache for object/array nodes seen before
+		JsonFingerprint fingerprint(const JsonValue& json_value);
+
+		// compare a node of this cache's document with a node of the other cache's document by fingerprint
+		bool equal(const JsonValue& json_value, JsonFingerprintCache& other_cache, const JsonValue& other_json_value);
+
+		size_t size() const;
+		void clear();
+	};
+
+	typedef std::shared_ptr<JsonFingerprintCache> JsonFingerprintCacheP;
+}
+
+#endif
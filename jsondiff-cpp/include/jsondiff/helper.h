@@ -2,20 +2,115 @@
 #define JSONDIFF_HELPER_H
 
 #include <jsondiff/config.h>
+#include <jsondiff/fingerprint.h>
 
 #include <fc/io/json.hpp>
 #include <fc/string.hpp>
 #include <fc/variant.hpp>
 #include <fc/variant_object.hpp>
 
+#include <functional>
+#include <utility>
+#include <vector>
+
 namespace jsondiff
 {
 	namespace utils
 	{
-		bool string_ends_with(std::string str, std::string end);
+		bool string_ends_with(const std::string& str, const std::string& end);
 
 		// ҵһַstrȡ׺extʣַ
-		std::string string_without_ext(std::string str, std::string ext);
+		std::string string_without_ext(const std::string& str, const std::string& ext);
+
+		// append entries to obj in order through fc's operator(), which doesn't look the keys up like set does.
+		// their keys must be distinct and not already in obj
+		void append_object_entries(fc::mutable_variant_object& obj, std::vector<fc::mutable_variant_object::entry>& entries,
+			size_t first = 0);
+
+		// drop the entries of obj flagged in removed (indexed by entry position) and append the appended entries in order,
+		// in one pass that keeps the order of the remaining entries. appended keys must not already exist in obj
+		void replace_object_entries(fc::mutable_variant_object& obj, const std::vector<bool>& removed,
+			std::vector<fc::mutable_variant_object::entry>& appended);
+
+		// hash of an object key, std::string or the key type of another value backend
+		template <typename Key>
+		inline size_t key_hash(const Key& key)
+		{
+			return (size_t)fingerprint_bytes(key.data(), key.size());
+		}
+
+		// open addressing hash index from key to entry position of an fc object (or an object of another value backend),
+		// so matching the keys of two objects is O(n) instead of the linear find() of fc objects.
+		// objects smaller than JSONDIFF_OBJECT_KEY_INDEX_MIN_SIZE are searched linearly without building the index.
+		// the index holds positions, so it is only valid while the object's key set is unchanged
+		template <typename ObjectType>
+		class ObjectKeyIndex
+		{
+		public:
+			typedef decltype(std::declval<ObjectType&>().begin()) iterator;
+
+			explicit ObjectKeyIndex(ObjectType& obj)
+				: _obj(obj), _mask(0)
+			{
+				size_t count = obj.size();
+				if (count < JSONDIFF_OBJECT_KEY_INDEX_MIN_SIZE)
+					return;
+				size_t capacity = 16;
+				while (capacity < count * 2)
+					capacity <<= 1;
+				_mask = capacity - 1;
+				_slots.resize(capacity);
+				size_t pos = 0;
+				for (auto i = obj.begin(); i != obj.end(); i++, pos++)
+				{
+					auto hash = key_hash(i->key());
+					auto slot = hash & _mask;
+					while (_slots[slot].pos != 0)
+						slot = (slot + 1) & _mask;
+					_slots[slot].hash = hash;
+					_slots[slot].pos = pos + 1;
+				}
+			}
+
+			template <typename Key>
+			iterator find(const Key& key) const
+			{
+				if (_slots.empty())
+					return _obj.find(key);
+				auto hash = key_hash(key);
+				for (auto slot = hash & _mask; _slots[slot].pos != 0; slot = (slot + 1) & _mask)
+				{
+					if (_slots[slot].hash != hash)
+						continue;
+					auto found = _obj.begin() + (_slots[slot].pos - 1);
+					if (found->key() == key)
+						return found;
+				}
+				return _obj.end();
+			}
+
+			template <typename Key>
+			bool contains(const Key& key) const
+			{
+				return find(key) != _obj.end();
+			}
+
+			iterator end() const
+			{
+				return _obj.end();
+			}
+
+		private:
+			struct Slot
+			{
+				size_t hash;
+				size_t pos; // position + 1, 0 means empty slot
+				Slot() : hash(0), pos(0) {}
+			};
+			ObjectType& _obj;
+			std::vector<Slot> _slots;
+			size_t _mask;
+		};
 	}
 }
 
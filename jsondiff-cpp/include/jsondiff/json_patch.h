@@ -0,0 +1,37 @@
+#ifndef JSONDIFF_JSON_PATCH_H
+#define JSONDIFF_JSON_PATCH_H
+
+#include <jsondiff/config.h>
+#include <jsondiff/diff_result.h>
+#include <jsondiff/json_value_types.h>
+
+#include <ostream>
+
+namespace jsondiff
+{
+	// the standard patch formats, for services that don't read the diff format of this library:
+	//   RFC 6902 json patch: [ { "op": "add" | "remove" | "replace" | ..., "path": <json pointer>, "value": ... }, ... ]
+	//   RFC 7386 merge patch: the members of the new document that changed, null for the deleted ones
+
+	// write diff_info, the diff of old_json to new_json, to out as json patch operations in one walk of the diff json.
+	// the values are written from the diff and the documents as they are, nothing is copied. an undefined diff is
+	// written as []. a string delta becomes a replace of the string, an element moved in an array a remove and an add
+	// @throws JsonDiffException if diff_info isn't the diff of old_json and new_json
+	void json_patch_write(std::ostream& out, const DiffResult& diff_info, const JsonValue& old_json, const JsonValue& new_json);
+
+	// write diff_info, the diff of old_json to new_json, to out as a merge patch, {} for an undefined diff of objects.
+	// arrays are replaced whole, and a member whose new value is null can't be told from a deleted one (RFC 7386)
+	// @throws JsonDiffException if diff_info isn't the diff of old_json and new_json
+	void json_merge_patch_write(std::ostream& out, const DiffResult& diff_info, const JsonValue& old_json, const JsonValue& new_json);
+
+	// apply the operations of an RFC 6902 json patch to json in place, the objects on the path of each operation are
+	// rebuilt and arrays are changed where they are. json is left partially patched if an exception is thrown
+	// @throws JsonDiffException if the patch is malformed, a path isn't found or a test operation fails
+	void json_patch_apply(JsonValue& json, const JsonValue& patch);
+
+	// apply an RFC 7386 merge patch to json in place
+	// @throws JsonDiffException
+	void json_merge_patch_apply(JsonValue& json, const JsonValue& patch);
+}
+
+#endif
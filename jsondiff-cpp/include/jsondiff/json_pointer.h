@@ -0,0 +1,27 @@
+#ifndef JSONDIFF_JSON_POINTER_H
+#define JSONDIFF_JSON_POINTER_H
+
+#include <jsondiff/config.h>
+#include <jsondiff/json_value_types.h>
+
+#include <string>
+#include <vector>
+
+namespace jsondiff
+{
+	// RFC 6901 json pointer split into its unescaped reference tokens, "" is the whole document
+	// @throws JsonDiffException
+	std::vector<std::string> json_pointer_parse(const std::string& pointer);
+
+	// escape one reference token ('~' => "~0", '/' => "~1")
+	std::string json_pointer_escape(const std::string& token);
+
+	// read a reference token as an array index, false if it isn't one (leading zeros, "-" and signs are not)
+	bool json_pointer_parse_index(const std::string& token, size_t& index);
+
+	// the value the tokens point to in json_value, nullptr if there is none
+	const JsonValue* json_pointer_find(const JsonValue& json_value, const std::vector<std::string>& tokens);
+	const NativeJsonValue* json_pointer_find(const NativeJsonValue& json_value, const std::vector<std::string>& tokens);
+}
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef JSONDIFF_JSON_TOKENIZER_H
+#define JSONDIFF_JSON_TOKENIZER_H
+
+#include <jsondiff/config.h>
+#include <jsondiff/exceptions.h>
+#include <jsondiff/json_value_types.h>
+
+#include <string>
+#include <vector>
+
+namespace jsondiff
+{
+	enum JsonTokenType
+	{
+		JTT_BEGIN_OBJECT = 0,
+		JTT_END_OBJECT = 1,
+		JTT_BEGIN_ARRAY = 2,
+		JTT_END_ARRAY = 3,
+		JTT_KEY = 4, // an object member key, the ':' after it is consumed with it
+		JTT_STRING = 5,
+		JTT_NUMBER = 6,
+		JTT_TRUE = 7,
+		JTT_FALSE = 8,
+		JTT_NULL = 9,
+		JTT_END = 10 // end of the input
+	};
+
+	// one token, begin/end point into the tokenized text. string and key tokens include their quotes
+	struct JsonToken
+	{
+		JsonTokenType type;
+		const char* begin;
+		const char* end;
+
+		bool is_scalar() const;
+		// the unescaped string of a key or string token
+		// @throws JsonDiffException
+		std::string decode_string() const;
+		// the value of a scalar token, as json_loads reads it
+		// @throws JsonDiffException
+		JsonValue decode_scalar() const;
+	};
+
+	// true if two scalar or key tokens hold equal values, as json_scalar_equal sees them
+	// @throws JsonDiffException
+	bool json_token_equal(const JsonToken& a, const JsonToken& b);
+
+	// pull tokenizer over one json text, e.g. a memory mapped file. nothing is copied or allocated per token;
+	// the structure is validated as it is read, number formats only when a token is decoded
+	class JsonTokenizer
+	{
+	private:
+		enum Expect
+		{
+			EXPECT_VALUE,
+			EXPECT_VALUE_OR_END,
+			EXPECT_KEY,
+			EXPECT_KEY_OR_END,
+			EXPECT_COMMA_OR_END,
+			EXPECT_EOF
+		};
+
+		const char* _begin;
+		const char* _pos;
+		const char* _end;
+		Expect _expect;
+		// '{' or '[' of every open container
+		std::vector<char> _stack;
+		JsonToken _peeked;
+		bool _has_peeked;
+
+		JsonToken read_token();
+		void after_value();
+		const char* scan_string(const char* p);
+		JsonDiffException error(const char* what) const;
+	public:
+		JsonTokenizer(const char* begin, const char* end);
+
+		// @throws JsonDiffException on malformed json
+		JsonToken next();
+		// the token next() will return
+		// @throws JsonDiffException on malformed json
+		const JsonToken& peek();
+
+		// where reading continues, past the peeked token if there is one
+		const char* position() const;
+
+		// consume the next value, whatever its size, and return its text range
+		// @throws JsonDiffException
+		void skip_value(const char*& value_begin, const char*& value_end);
+	};
+}
+
+#endif
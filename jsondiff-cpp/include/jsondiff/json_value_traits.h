@@ -0,0 +1,211 @@
+#ifndef JSONDIFF_JSON_VALUE_TRAITS_H
+#define JSONDIFF_JSON_VALUE_TRAITS_H
+
+#include <jsondiff/config.h>
+#include <jsondiff/fingerprint.h>
+#include <jsondiff/helper.h>
+#include <jsondiff/json_pointer.h>
+#include <jsondiff/json_value_types.h>
+#include <jsondiff/native_json.h>
+
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace jsondiff
+{
+	// a key of an object member being added by a patch or rollback, and its value
+	typedef std::pair<const std::string*, const JsonValue*> JsonMemberRef;
+
+	// what JsonDiff needs from a json value type, one specialization per value backend.
+	//
+	// read by diff, patch and rollback:
+	//   object_type, array_type    objects have begin()/end()/size()/find(key) over members with key() and value(),
+	//                              keys have data() and size() and compare with std::string. arrays have size() and operator[]
+	//   type(v)                    the JsonValueType of v
+	//   get_object(v), get_array(v)
+	//   scalar_equal(a, b), equal(a, b), fingerprint(v), pointer_find(v, tokens)
+	//                              json_scalar_equal, json_equal, json_fingerprint and json_pointer_find for the backend
+	//   shares_storage(a, b)       true if a and b are known to be equal without looking at them
+	//   to_json(v)                 v as a JsonValue, for the values copied into a diff
+	//   key_string(key)            an object key as a std::string
+	//
+	// written by patch and rollback, new nodes are placed by an allocator_type:
+	//   assign(v, json, allocator) replace v by a copy of json
+	//   ObjectEdit(v, allocator)   edit of the object v: object() has mutable members, set(member, json) replaces the value
+	//                              of one, commit(removed, appended) drops the members flagged by position, appends the
+	//                              JsonMemberRefs and stores the object back into v
+	//   ArrayEdit(v, allocator)    edit of the array v: items() are mutable, make_items(n) is a new array of n nulls,
+	//                              set(items, i, json) places a copy of json, replace(items) stores new items into v,
+	//                              resize(n) drops the last items of v or appends nulls
+	template <typename Value>
+	struct JsonValueTraits;
+
+	template <>
+	struct JsonValueTraits<JsonValue>
+	{
+		typedef fc::variant_object object_type;
+		typedef fc::variants array_type;
+		// fc allocates its nodes itself
+		struct allocator_type {};
+
+		static JsonValueType type(const JsonValue& value) { return guess_json_value_type(value); }
+		static const object_type& get_object(const JsonValue& value) { return value.get_object(); }
+		static const array_type& get_array(const JsonValue& value) { return value.get_array(); }
+		static bool scalar_equal(const JsonValue& a, const JsonValue& b) { return json_scalar_equal(a, b); }
+		static bool equal(const JsonValue& a, const JsonValue& b) { return json_equal(a, b); }
+		static bool shares_storage(const JsonValue& a, const JsonValue& b) { return json_shares_storage(a, b); }
+		static JsonFingerprint fingerprint(const JsonValue& value) { return json_fingerprint(value); }
+		static const JsonValue* pointer_find(const JsonValue& value, const std::vector<std::string>& tokens) { return json_pointer_find(value, tokens); }
+		static const JsonValue& to_json(const JsonValue& value) { return value; }
+		static const std::string& key_string(const std::string& key) { return key; }
+
+		static void assign(JsonValue& value, const JsonValue& json, allocator_type&) { value = json; }
+
+		// fc objects are immutable, so the object is rebuilt from its entries and stored back
+		class ObjectEdit
+		{
+		private:
+			JsonValue& _value;
+			fc::mutable_variant_object _obj;
+		public:
+			typedef fc::mutable_variant_object object_type;
+
+			ObjectEdit(JsonValue& value, allocator_type&) : _value(value), _obj(value.get_object()) {}
+
+			object_type& object() { return _obj; }
+
+			void set(object_type::iterator member, const JsonValue& json) { member->set(json); }
+
+			void commit(const std::vector<bool>& removed, const std::vector<JsonMemberRef>& appended)
+			{
+				std::vector<fc::mutable_variant_object::entry> entries;
+				entries.reserve(appended.size());
+				for (const auto& member : appended)
+					entries.push_back(fc::mutable_variant_object::entry(*member.first, *member.second));
+				utils::replace_object_entries(_obj, removed, entries);
+				_value.get_object() = std::move(_obj);
+			}
+		};
+
+		class ArrayEdit
+		{
+		private:
+			JsonValue& _value;
+		public:
+			typedef fc::variants items_type;
+
+			ArrayEdit(JsonValue& value, allocator_type&) : _value(value) {}
+
+			items_type& items() { return _value.get_array(); }
+			items_type make_items(size_t size) { return items_type(size); }
+			void set(items_type& items, size_t i, const JsonValue& json) { items[i] = json; }
+			void replace(items_type& items) { _value.get_array().swap(items); }
+			void resize(size_t size) { _value.get_array().resize(size); }
+		};
+	};
+
+	template <>
+	struct JsonValueTraits<NativeJsonValue>
+	{
+		typedef NativeJsonObject object_type;
+		typedef NativeJsonArray array_type;
+		// new nodes go to the arena of the document being patched
+		typedef JsonArena allocator_type;
+
+		static JsonValueType type(const NativeJsonValue& value) { return guess_json_value_type(value); }
+		static const object_type& get_object(const NativeJsonValue& value) { return value.get_object(); }
+		static const array_type& get_array(const NativeJsonValue& value) { return value.get_array(); }
+		static bool scalar_equal(const NativeJsonValue& a, const NativeJsonValue& b) { return json_scalar_equal(a, b); }
+		static bool equal(const NativeJsonValue& a, const NativeJsonValue& b) { return json_equal(a, b); }
+		static bool shares_storage(const NativeJsonValue& a, const NativeJsonValue& b) { return &a == &b; }
+		static JsonFingerprint fingerprint(const NativeJsonValue& value) { return json_fingerprint(value); }
+		static const NativeJsonValue* pointer_find(const NativeJsonValue& value, const std::vector<std::string>& tokens) { return json_pointer_find(value, tokens); }
+		static JsonValue to_json(const NativeJsonValue& value) { return native_to_json(value); }
+		static std::string key_string(const NativeJsonString& key) { return key.str(); }
+
+		static void assign(NativeJsonValue& value, const JsonValue& json, allocator_type& arena) { value = json_to_native(arena, json); }
+
+		// members are edited where they are, a new member array is only placed in the arena if members are removed or added
+		class ObjectEdit
+		{
+		private:
+			NativeJsonValue& _value;
+			JsonArena& _arena;
+		public:
+			typedef NativeJsonObject object_type;
+
+			ObjectEdit(NativeJsonValue& value, allocator_type& arena) : _value(value), _arena(arena) {}
+
+			object_type& object() { return _value.get_object(); }
+
+			void set(object_type::iterator member, const JsonValue& json) { member->value() = json_to_native(_arena, json); }
+
+			void commit(const std::vector<bool>& removed, const std::vector<JsonMemberRef>& appended)
+			{
+				if (removed.empty() && appended.empty())
+					return;
+				auto& obj = _value.get_object();
+				size_t count = 0;
+				for (size_t i = 0; i < obj.size(); i++)
+					count += i >= removed.size() || !removed[i];
+				count += appended.size();
+				auto members = _arena.allocate_array<NativeJsonMember>(count);
+				size_t next = 0;
+				for (size_t i = 0; i < obj.size(); i++)
+				{
+					if (i >= removed.size() || !removed[i])
+						new (&members[next++]) NativeJsonMember(obj.begin()[i]);
+				}
+				for (const auto& member : appended)
+				{
+					auto& added = *new (&members[next++]) NativeJsonMember();
+					added.key().assign(_arena, member.first->data(), member.first->size());
+					added.value() = json_to_native(_arena, *member.second);
+				}
+				_value.set_object(NativeJsonObject::make(members, count));
+			}
+		};
+
+		class ArrayEdit
+		{
+		private:
+			NativeJsonValue& _value;
+			JsonArena& _arena;
+		public:
+			typedef NativeJsonArray items_type;
+
+			ArrayEdit(NativeJsonValue& value, allocator_type& arena) : _value(value), _arena(arena) {}
+
+			items_type& items() { return _value.get_array(); }
+
+			items_type make_items(size_t size)
+			{
+				auto items = _arena.allocate_array<NativeJsonValue>(size);
+				for (size_t i = 0; i < size; i++)
+					new (&items[i]) NativeJsonValue();
+				return NativeJsonArray::make(items, size);
+			}
+
+			void set(items_type& items, size_t i, const JsonValue& json) { items[i] = json_to_native(_arena, json); }
+			void replace(items_type& items) { _value.set_array(items); }
+
+			// a shorter array keeps its place in the arena, a longer one is copied to a new place
+			void resize(size_t size)
+			{
+				auto& items = _value.get_array();
+				if (size <= items.size())
+				{
+					_value.set_array(NativeJsonArray::make(items.begin(), size));
+					return;
+				}
+				auto result = make_items(size);
+				std::copy(items.begin(), items.end(), result.begin());
+				_value.set_array(result);
+			}
+		};
+	};
+}
+
+#endif
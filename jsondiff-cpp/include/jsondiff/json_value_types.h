@@ -27,6 +27,9 @@ namespace jsondiff
 
 	typedef fc::mutable_variant_object JsonObject;
 
+	// a node of the native backend, see jsondiff/native_json.h
+	class NativeJsonValue;
+
 	inline bool is_scalar_json_value_type(const JsonValueType& json_value_type)
 	{
 		return json_value_type == JVT_NULL || json_value_type == JVT_INTEGER
@@ -46,6 +49,28 @@ namespace jsondiff
 	bool json_has_key(const JsonObject& json_value, std::string key);
 
 	bool is_scalar_value_diff_format(const JsonValue& diff_json);
+
+	// typed equality of two scalar values (null, bool, integer, float, string) without serializing them:
+	// - integers are compared by value, so int64 6000000000 equals uint64 6000000000, a negative int64 never equals a uint64
+	// - an integer equals a float holding exactly its value, so 1 and 1.0 are equal (fc writes both as 1)
+	// - floats are compared by value, so 0.0 equals -0.0, and all NaNs are equal
+	// values of different json types are never equal
+	bool json_scalar_equal(const JsonValue& a, const JsonValue& b);
+
+	// deep equality as the diff sees it: object key order is ignored, scalars are compared by json_scalar_equal.
+	// stops at the first difference and skips subtrees sharing storage, nothing is allocated for objects whose keys
+	// are in the same order
+	// @throws JsonDiffException
+	bool json_equal(const JsonValue& a, const JsonValue& b);
+
+	// the same functions for values of the native backend
+	// @throws JsonDiffException
+	JsonValueType guess_json_value_type(const NativeJsonValue& json_data);
+	bool json_scalar_equal(const NativeJsonValue& a, const NativeJsonValue& b);
+	bool json_equal(const NativeJsonValue& a, const NativeJsonValue& b);
+
+	// build one [op, pos, item] entry of an array diff
+	JsonValue make_array_diff_item(const char* op, uint64_t pos, JsonValue item);
 }
 
 #endif
@@ -0,0 +1,70 @@
+#ifndef JSONDIFF_JSON_WRITER_H
+#define JSONDIFF_JSON_WRITER_H
+
+#include <jsondiff/config.h>
+#include <jsondiff/json_value_types.h>
+
+#include <ostream>
+#include <string>
+
+namespace jsondiff
+{
+	// writes json text to an ostream in one pass through a fixed buffer, so nothing is allocated per value.
+	// the text is the same as json_dumps. the pretty form is the layout of json_pretty_dumps but not always its text:
+	// after a string with an escape other than \\, \" and \n, fc's pretty printer takes the rest of the text for
+	// the inside of a string and stops breaking lines, this writer keeps the layout to the end.
+	// the buffer is written to the stream by flush and by the destructor
+	class JsonWriter
+	{
+	private:
+		std::ostream& _out;
+		char _buffer[JSONDIFF_JSON_WRITER_BUFFER_SIZE];
+		size_t _size;
+
+		void write_number(const JsonValue& json_value);
+		void write_pretty_indent(size_t level);
+		void flush_buffer();
+	public:
+		explicit JsonWriter(std::ostream& out);
+		virtual ~JsonWriter();
+
+		JsonWriter(const JsonWriter&) = delete;
+		JsonWriter& operator=(const JsonWriter&) = delete;
+
+		// raw text, written as it is
+		void write(const char* data, size_t size);
+		void write(const std::string& text)
+		{
+			write(text.data(), text.size());
+		}
+		void put(char c)
+		{
+			if (_size == sizeof(_buffer))
+				flush_buffer();
+			_buffer[_size++] = c;
+		}
+		void put(char c, size_t count);
+
+		// a json string with the escapes of fc's json generator
+		void write_string(const std::string& str);
+
+		// @throws JsonDiffException for a value that isn't json
+		void write_json(const JsonValue& json_value);
+		// the layout of json_pretty_dumps (see above), two spaces per level. level is the nesting of json_value,
+		// nested lines are indented by level + 1
+		// @throws JsonDiffException for a value that isn't json
+		void write_pretty_json(const JsonValue& json_value, size_t level = 0);
+
+		// write the buffer and flush the stream
+		void flush();
+	};
+
+	// write json_value as json text to out, the text of json_dumps without building it in memory
+	// @throws JsonDiffException
+	void json_write(std::ostream& out, const JsonValue& json_value);
+	// write json_value as pretty json text to out in the layout of json_pretty_dumps (see JsonWriter), without building it in memory
+	// @throws JsonDiffException
+	void json_pretty_write(std::ostream& out, const JsonValue& json_value);
+}
+
+#endif
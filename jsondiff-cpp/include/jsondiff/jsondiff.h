@@ -2,11 +2,18 @@
 #define JSONDIFF_JSONDIFF_H
 
 #include <jsondiff/config.h>
+#include <jsondiff/compiled_diff.h>
+#include <jsondiff/diff_batch.h>
+#include <jsondiff/diff_options.h>
 #include <jsondiff/diff_result.h>
+#include <jsondiff/fingerprint.h>
 #include <jsondiff/json_value_types.h>
+#include <jsondiff/native_json.h>
 
+#include <ostream>
 #include <string>
 #include <memory>
+#include <vector>
 
 #include <fc/io/json.hpp>
 #include <fc/string.hpp>
@@ -19,30 +26,215 @@ namespace jsondiff
 	class JsonDiff
 	{
 	private:
+		struct DiffContext;
 
+		DiffOptions _options;
+
+		// DiffOptions::array_keys with the json pointers split into tokens
+		struct ArrayKeyPattern
+		{
+			std::vector<std::string> path;
+			std::vector<std::string> key;
+		};
+		std::vector<ArrayKeyPattern> _array_key_patterns;
+		// DiffOptions::include_paths and exclude_paths split into tokens
+		std::vector<std::vector<std::string>> _include_patterns;
+		std::vector<std::vector<std::string>> _exclude_patterns;
+		// some option depends on the location of the values being diffed
+		bool _track_path;
+
+		// false if the value at path is left out by the include and exclude paths
+		bool path_in_scope(const std::vector<std::string>& path) const;
+		// same for the member or element token of the value at ctx.path
+		bool child_in_scope(DiffContext& ctx, const std::string& token) const;
+
+		// Value is JsonValue or NativeJsonValue, new nodes are placed by allocator, see JsonValueTraits
+		// @throws JsonDiffException
+		template <typename Value, typename Allocator>
+		void patch_node(Value& json, const CompiledDiffNode& node, Allocator& allocator);
+		// @throws JsonDiffException
+		template <typename Value, typename Allocator>
+		void rollback_node(Value& json, const CompiledDiffNode& node, Allocator& allocator);
+		// patch_node and rollback_node of the root, checking the documents when the diff carries fingerprints
+		// @throws JsonDiffException
+		template <typename Value, typename Allocator>
+		void patch_root(Value& json, const CompiledDiff& diff, Allocator& allocator);
+		// @throws JsonDiffException
+		template <typename Value, typename Allocator>
+		void rollback_root(Value& json, const CompiledDiff& diff, Allocator& allocator);
+
+		// the pattern whose path matches path, the location of the array being diffed, nullptr if none
+		const ArrayKeyPattern* find_array_key_pattern(const std::vector<std::string>& path) const;
+
+		// diff two arrays by element identity, appends the entries to diff_json_array
+		// @returns false if the keys can't identify the elements and the sequence diff has to be used
+		template <typename Value>
+		bool diff_keyed_array(DiffContext& ctx, const ArrayKeyPattern& pattern, const Value& old_json, const Value& new_json, fc::variants& diff_json_array);
+
+		// diff_value from the root of two documents, under the budget of the options when they have one.
+		// records the stats of the call when the options collect them, parse_ns is the time spent parsing the documents
+		// @throws JsonDiffException, JsonDiffBudgetException with DBA_THROW
+		template <typename Value>
+		bool diff_root(DiffContext& ctx, const Value& old_json, const Value& new_json, JsonValue& diff_json, uint64_t parse_ns = 0);
+		template <typename Value>
+		bool diff_within_budget(DiffContext& ctx, const Value& old_json, const Value& new_json, JsonValue& diff_json);
+
+		// diff with the parse time of the documents for the stats, diff_json is only written when they differ
+		// @returns true if old_json and new_json differ
+		// @throws JsonDiffException
+		bool diff_parsed(const JsonValue& old_json, const JsonValue& new_json, uint64_t parse_ns, JsonValue& diff_json);
+
+		// diff_at under the budget of the options, which has already counted compared_values and changes, both updated.
+		// for the subtrees a stream diff parses
+		// @throws JsonDiffException, JsonDiffBudgetException
+		bool diff_at(const std::vector<std::string>& path, const JsonValue& old_json, const JsonValue& new_json, JsonValue& diff_json,
+			size_t& compared_values, size_t& changes);
+
+		// hand the stats of a patch or rollback of diff that took apply_ns to the collector of the options
+		void record_apply_stats(DiffStatsOperation operation, const CompiledDiff& diff, uint64_t apply_ns) const;
+
+		// diff_json is only written when old_json and new_json differ
+		// @returns true if old_json and new_json differ
+		// @throws JsonDiffException
+		template <typename Value>
+		bool diff_value(DiffContext& ctx, const Value& old_json, const Value& new_json, JsonValue& diff_json);
+
+		// state of one diff_stream call
+		class StreamDiffer;
+		// state of one compose call
+		class DiffComposer;
 	public:
 		JsonDiff();
+		// @throws JsonDiffException if a json pointer of options.array_keys, include_paths or exclude_paths is malformed
+		JsonDiff(const DiffOptions& options);
 		virtual ~JsonDiff();
 
+		const DiffOptions& options() const;
 
 		DiffResultP diff_by_string(const std::string &old_json_str, const std::string &new_json_str);
 
 		// jsonַҪֱjson_loadsΪjsondiffֱӵdiff_by_string
-		// @throws JsonDiffException
+		// @throws JsonDiffException, JsonDiffBudgetException when the budget of the options runs out with DBA_THROW
 		DiffResultP diff(const JsonValue& old_json, const JsonValue& new_json);
 
+		// diff against a base version whose subtree fingerprints are kept in old_fingerprints,
+		// equal subtrees are skipped in O(1). old_fingerprints is filled on first use and can be reused
+		// by every later diff against the same, unmodified old_json
+		// @throws JsonDiffException
+		DiffResultP diff(const JsonValue& old_json, const JsonValue& new_json, JsonFingerprintCache& old_fingerprints);
+
+		// same as above with the fingerprints of new_json cached too, e.g. when new_json is the base of a later diff
+		// @throws JsonDiffException
+		DiffResultP diff(const JsonValue& old_json, const JsonValue& new_json, JsonFingerprintCache& old_fingerprints, JsonFingerprintCache& new_fingerprints);
+
+		// same as diff(const JsonValue&, const JsonValue&) over native documents, the result is the same
+		// @throws JsonDiffException
+		DiffResultP diff(const NativeJsonValue& old_json, const NativeJsonValue& new_json);
+
+		// diff two subtrees found at path (json pointer tokens), for callers that walk the documents themselves.
+		// diff_json is only written when old_json and new_json differ
+		// @returns true if old_json and new_json differ
+		// @throws JsonDiffException
+		bool diff_at(const std::vector<std::string>& path, const JsonValue& old_json, const JsonValue& new_json, JsonValue& diff_json);
+
+		// diff many (old, new) pairs, results[i] is the diff of pairs[i]. results is resized to count and its storage reused,
+		// the work of the pairs is spread over options().thread_pool when there is one.
+		// the DiffResults are the same as the ones diff returns
+		// @throws JsonDiffException, the one of the first failing pair
+		void diff_batch(const JsonValuePair* pairs, size_t count, std::vector<DiffResult>& results);
+
+		// same as above over json texts, parsed into the native documents of scratch instead of fc values.
+		// keep the scratch for the next batch to parse it without allocating
+		// @throws JsonDiffException on malformed json, the error of the first failing pair
+		void diff_batch(const JsonTextPair* pairs, size_t count, std::vector<DiffResult>& results, DiffBatchScratch& scratch);
+
+		// @throws JsonDiffException
+		void diff_batch(const JsonTextPair* pairs, size_t count, std::vector<DiffResult>& results);
+
+		// diff two json texts without building either document: both are read token by token in lockstep and the diff
+		// is written to out as it is found. only the subtrees that differ are parsed, equal ones are skipped in place.
+		// out receives the same text as diff_by_string(old, new)->str(), the budget of the options included: with one, the diff
+		// is only written to out once it is complete. an object with a key written twice is parsed and diffed
+		// whole, the last value wins as with json_loads, which throws if part of its diff was already handed to out
+		// @throws JsonDiffException
+		void diff_stream(const char* old_json, size_t old_size, const char* new_json, size_t new_size, std::ostream& out);
+
+		// same as above over two memory mapped files, e.g. multi GB snapshots
+		// @throws JsonDiffException
+		void diff_files(const std::string& old_path, const std::string& new_path, std::ostream& out);
+
+		// diff two documents and write the diff to out as an RFC 6902 json patch, see json_patch_write.
+		// the whole diff is built first, as diff does, and the operations are written from it
+		// @throws JsonDiffException
+		void diff_json_patch(const JsonValue& old_json, const JsonValue& new_json, std::ostream& out);
+
+		// same as above as an RFC 7386 merge patch, see json_merge_patch_write
+		// @throws JsonDiffException
+		void diff_merge_patch(const JsonValue& old_json, const JsonValue& new_json, std::ostream& out);
+
 		JsonValue patch_by_string(const std::string& old_json_value, DiffResultP diff_info);
 
 		// Ѿɰ汾json,ʹdiffõ°汾
 		// @throws JsonDiffException
 		JsonValue patch(const JsonValue& old_json, const DiffResultP& diff_info);
 
+		// same as above, reusing the storage of old_json
+		// @throws JsonDiffException
+		JsonValue patch(JsonValue&& old_json, const DiffResultP& diff_info);
+
+		// patch json to the new version in place, the work depends on the size of the diff, not of the document
+		// (apart from the members of each object on the path of a change, which fc makes us copy).
+		// json is left partially patched if an exception is thrown. a diff carrying fingerprints (DiffOptions::diff_fingerprints)
+		// is checked against json before the patch, which throws if json isn't its old version, and against the result after
+		// @throws JsonDiffException
+		void patch_inplace(JsonValue& json, const DiffResult& diff_info);
+
+		// same as above with a diff compiled once, e.g. to apply it to many replicas
+		// @throws JsonDiffException
+		void patch_inplace(JsonValue& json, const CompiledDiff& diff);
+
+		// patch a native document in place, the new nodes are placed in its arena
+		// @throws JsonDiffException
+		void patch_inplace(NativeJsonDocument& doc, const DiffResult& diff_info);
+
+		// @throws JsonDiffException
+		void patch_inplace(NativeJsonDocument& doc, const CompiledDiff& diff);
+
 		JsonValue rollback_by_string(const std::string& new_json_value, DiffResultP diff_info);
 
 		// °汾ʹdiffعɰ汾
 		// @throws JsonDiffException
 		JsonValue rollback(const JsonValue& new_json, DiffResultP diff_info);
 
+		// same as above, reusing the storage of new_json
+		// @throws JsonDiffException
+		JsonValue rollback(JsonValue&& new_json, DiffResultP diff_info);
+
+		// roll json back to the old version in place, see patch_inplace
+		// @throws JsonDiffException
+		void rollback_inplace(JsonValue& json, const DiffResult& diff_info);
+
+		// @throws JsonDiffException
+		void rollback_inplace(JsonValue& json, const CompiledDiff& diff);
+
+		// roll a native document back in place, see patch_inplace
+		// @throws JsonDiffException
+		void rollback_inplace(NativeJsonDocument& doc, const DiffResult& diff_info);
+
+		// @throws JsonDiffException
+		void rollback_inplace(NativeJsonDocument& doc, const CompiledDiff& diff);
+
+		// merge the diff of v0 to v1 and the diff of v1 to v2 into one diff of v0 to v2, without the documents.
+		// the work depends on the size of the two diffs: only the values the diffs hold are patched or diffed again,
+		// array ops are mapped through each other by position. the result patches and rolls back like diff(v0, v2),
+		// though it may not be the same text (e.g. an element removed by first and inserted again by second stays two ops)
+		// @throws JsonDiffException if second doesn't apply to the result of first
+		DiffResultP compose(const DiffResultP& first, const DiffResultP& second);
+
+		// compose diffs[0], diffs[1], ... in order, undefined if diffs is empty
+		// @throws JsonDiffException
+		DiffResultP compose(const std::vector<DiffResultP>& diffs);
+
 	};
 }
 
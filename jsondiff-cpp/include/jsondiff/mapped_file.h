@@ -0,0 +1,45 @@
+#ifndef JSONDIFF_MAPPED_FILE_H
+#define JSONDIFF_MAPPED_FILE_H
+
+#include <jsondiff/config.h>
+
+#include <stddef.h>
+#include <string>
+
+namespace jsondiff
+{
+	// a whole file mapped read only into memory, pages are read in by the os as they are touched
+	class MappedFile
+	{
+	private:
+		const char* _data;
+		size_t _size;
+		// pages before this point have been released
+		const char* _released;
+#ifdef _WIN32
+		void* _file;
+		void* _mapping;
+#endif
+	public:
+		// @throws JsonDiffException if the file can't be opened or mapped
+		explicit MappedFile(const std::string& path);
+		virtual ~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		// nullptr for an empty file
+		const char* data() const;
+		size_t size() const;
+
+		// drop the pages before position from memory, they are read from the file again if touched later.
+		// keeps the resident size of a front to back scan bounded, released in steps of JSONDIFF_MAPPED_FILE_RELEASE_STEP.
+		// does nothing on windows
+		void release_before(const char* position);
+
+		// a scan goes back to position, release_before drops the pages after it again as the scan passes them
+		void rescan_from(const char* position);
+	};
+}
+
+#endif
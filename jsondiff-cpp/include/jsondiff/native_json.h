@@ -0,0 +1,311 @@
+#ifndef JSONDIFF_NATIVE_JSON_H
+#define JSONDIFF_NATIVE_JSON_H
+
+#include <jsondiff/config.h>
+#include <jsondiff/fingerprint.h>
+#include <jsondiff/json_pointer.h>
+#include <jsondiff/json_value_types.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace jsondiff
+{
+	// bump allocator for the nodes of native json documents. memory is only given back all at once,
+	// by reset() or by the destructor, whatever the number of nodes
+	class JsonArena
+	{
+	private:
+		std::vector<char*> _blocks;
+		char* _pos;
+		char* _end;
+		size_t _next_block_size;
+		// bytes of all blocks
+		size_t _capacity;
+
+		void* allocate_slow(size_t size, size_t align);
+	public:
+		explicit JsonArena(size_t first_block_size = JSONDIFF_ARENA_BLOCK_SIZE);
+		virtual ~JsonArena();
+
+		JsonArena(const JsonArena&) = delete;
+		JsonArena& operator=(const JsonArena&) = delete;
+
+		// align must be a power of 2
+		void* allocate(size_t size, size_t align)
+		{
+			size_t padding = (size_t)(-(intptr_t)_pos) & (align - 1);
+			if ((size_t)(_end - _pos) < size + padding)
+				return allocate_slow(size, align);
+			char* p = _pos + padding;
+			_pos = p + size;
+			return p;
+		}
+
+		template <typename T>
+		T* allocate_array(size_t count)
+		{
+			return (T*)allocate(count * sizeof(T), alignof(T));
+		}
+
+		// forget every allocation. the blocks are merged into one of their total size and kept,
+		// so filling the arena again with as much data allocates nothing
+		void reset();
+
+		size_t capacity() const;
+	};
+
+	enum NativeJsonType
+	{
+		NJT_NULL = 0,
+		NJT_BOOL = 1,
+		NJT_INT64 = 2,
+		NJT_UINT64 = 3,
+		NJT_DOUBLE = 4,
+		NJT_STRING = 5,
+		NJT_ARRAY = 6,
+		NJT_OBJECT = 7
+	};
+
+	class NativeJsonValue;
+	class NativeJsonMember;
+
+	// a string of a native document, up to small_size bytes are stored in place, longer ones in the arena
+	class NativeJsonString
+	{
+	public:
+		static const size_t small_size = 12;
+	private:
+		uint32_t _size;
+		// the bytes of a small string, otherwise the arena pointer
+		char _bytes[small_size];
+	public:
+		const char* data() const
+		{
+			if (_size <= small_size)
+				return _bytes;
+			const char* p;
+			memcpy(&p, _bytes, sizeof(p));
+			return p;
+		}
+
+		size_t size() const { return _size; }
+		std::string str() const { return std::string(data(), _size); }
+
+		// @throws JsonDiffException for strings of 4GB or more
+		void assign(JsonArena& arena, const char* data, size_t size);
+
+		bool operator==(const NativeJsonString& other) const
+		{
+			return _size == other._size && memcmp(data(), other.data(), _size) == 0;
+		}
+		bool operator!=(const NativeJsonString& other) const { return !(*this == other); }
+	};
+
+	inline bool operator==(const NativeJsonString& a, const std::string& b)
+	{
+		return a.size() == b.size() && memcmp(a.data(), b.data(), b.size()) == 0;
+	}
+	inline bool operator==(const std::string& a, const NativeJsonString& b) { return b == a; }
+	inline bool operator!=(const NativeJsonString& a, const std::string& b) { return !(a == b); }
+	inline bool operator!=(const std::string& a, const NativeJsonString& b) { return !(b == a); }
+
+	// the items of a native array, contiguous in the arena
+	class NativeJsonArray
+	{
+	private:
+		NativeJsonValue* _items;
+		size_t _size;
+	public:
+		typedef NativeJsonValue* iterator;
+		typedef const NativeJsonValue* const_iterator;
+
+		static NativeJsonArray make(NativeJsonValue* items, size_t size)
+		{
+			NativeJsonArray result;
+			result._items = items;
+			result._size = size;
+			return result;
+		}
+
+		size_t size() const { return _size; }
+		bool empty() const { return _size == 0; }
+		iterator begin() { return _items; }
+		inline iterator end();
+		const_iterator begin() const { return _items; }
+		inline const_iterator end() const;
+		inline NativeJsonValue& operator[](size_t i);
+		inline const NativeJsonValue& operator[](size_t i) const;
+	};
+
+	// the members of a native object, contiguous in the arena in document order. keys are unique
+	class NativeJsonObject
+	{
+	private:
+		NativeJsonMember* _members;
+		size_t _size;
+	public:
+		typedef NativeJsonMember* iterator;
+		typedef const NativeJsonMember* const_iterator;
+
+		static NativeJsonObject make(NativeJsonMember* members, size_t size)
+		{
+			NativeJsonObject result;
+			result._members = members;
+			result._size = size;
+			return result;
+		}
+
+		size_t size() const { return _size; }
+		iterator begin() { return _members; }
+		inline iterator end();
+		const_iterator begin() const { return _members; }
+		inline const_iterator end() const;
+
+		// linear search, see utils::ObjectKeyIndex for a hash index
+		template <typename Key>
+		iterator find(const Key& key);
+		template <typename Key>
+		const_iterator find(const Key& key) const;
+	};
+
+	// one node of a native json document. nodes are plain values that point into the arena,
+	// copying one copies the reference to its strings, items and members, not them
+	class NativeJsonValue
+	{
+	private:
+		uint8_t _type;
+		union
+		{
+			bool _bool;
+			int64_t _int64;
+			uint64_t _uint64;
+			double _double;
+			NativeJsonString _string;
+			NativeJsonArray _array;
+			NativeJsonObject _object;
+		};
+	public:
+		NativeJsonValue() : _type(NJT_NULL), _uint64(0) {}
+
+		NativeJsonType get_type() const { return (NativeJsonType)_type; }
+		bool is_null() const { return _type == NJT_NULL; }
+		bool is_bool() const { return _type == NJT_BOOL; }
+		bool is_string() const { return _type == NJT_STRING; }
+		bool is_array() const { return _type == NJT_ARRAY; }
+		bool is_object() const { return _type == NJT_OBJECT; }
+
+		// the accessors don't convert, the value must have the type asked for
+		bool as_bool() const { return _bool; }
+		int64_t as_int64() const { return _int64; }
+		uint64_t as_uint64() const { return _uint64; }
+		double as_double() const { return _double; }
+		const NativeJsonString& get_string() const { return _string; }
+		const NativeJsonArray& get_array() const { return _array; }
+		NativeJsonArray& get_array() { return _array; }
+		const NativeJsonObject& get_object() const { return _object; }
+		NativeJsonObject& get_object() { return _object; }
+
+		void set_null() { _type = NJT_NULL; _uint64 = 0; }
+		void set_bool(bool value) { _type = NJT_BOOL; _uint64 = 0; _bool = value; }
+		void set_int64(int64_t value) { _type = NJT_INT64; _int64 = value; }
+		void set_uint64(uint64_t value) { _type = NJT_UINT64; _uint64 = value; }
+		void set_double(double value) { _type = NJT_DOUBLE; _double = value; }
+		// @throws JsonDiffException for strings of 4GB or more
+		void set_string(JsonArena& arena, const char* data, size_t size) { _type = NJT_STRING; _string.assign(arena, data, size); }
+		void set_array(const NativeJsonArray& items) { _type = NJT_ARRAY; _array = items; }
+		void set_object(const NativeJsonObject& members) { _type = NJT_OBJECT; _object = members; }
+	};
+
+	class NativeJsonMember
+	{
+	private:
+		NativeJsonString _key;
+		NativeJsonValue _value;
+	public:
+		const NativeJsonString& key() const { return _key; }
+		NativeJsonString& key() { return _key; }
+		const NativeJsonValue& value() const { return _value; }
+		NativeJsonValue& value() { return _value; }
+	};
+
+	inline NativeJsonArray::iterator NativeJsonArray::end() { return _items + _size; }
+	inline NativeJsonArray::const_iterator NativeJsonArray::end() const { return _items + _size; }
+	inline NativeJsonValue& NativeJsonArray::operator[](size_t i) { return _items[i]; }
+	inline const NativeJsonValue& NativeJsonArray::operator[](size_t i) const { return _items[i]; }
+
+	inline NativeJsonObject::iterator NativeJsonObject::end() { return _members + _size; }
+	inline NativeJsonObject::const_iterator NativeJsonObject::end() const { return _members + _size; }
+
+	template <typename Key>
+	NativeJsonObject::iterator NativeJsonObject::find(const Key& key)
+	{
+		for (auto i = begin(); i != end(); i++)
+		{
+			if (i->key() == key)
+				return i;
+		}
+		return end();
+	}
+
+	template <typename Key>
+	NativeJsonObject::const_iterator NativeJsonObject::find(const Key& key) const
+	{
+		return const_cast<NativeJsonObject*>(this)->find(key);
+	}
+
+	// a native json document: a tree of NativeJsonValue nodes with all their strings, items and members in one arena.
+	// the nodes are not refcounted and not freed one by one, the document frees them all at once.
+	// parsing into the same document again reuses its arena and scratch space, so a loop over documents of similar size
+	// stops allocating after the first few
+	class NativeJsonDocument
+	{
+	private:
+		JsonArena _arena;
+		NativeJsonValue _root;
+		// the items and members of the containers being parsed, copied into the arena when their container closes
+		std::vector<NativeJsonValue> _item_stack;
+		std::vector<NativeJsonMember> _member_stack;
+		// positions + 1 of the members of the object being closed by key hash, to drop duplicate keys
+		std::vector<size_t> _key_slots;
+
+		class Parser;
+	public:
+		NativeJsonDocument();
+		explicit NativeJsonDocument(size_t arena_block_size);
+		virtual ~NativeJsonDocument();
+
+		NativeJsonDocument(const NativeJsonDocument&) = delete;
+		NativeJsonDocument& operator=(const NativeJsonDocument&) = delete;
+
+		// replace the document by the parsed json text. numbers and duplicate keys are read as json_loads reads them
+		// @throws JsonDiffException on malformed json, the document is null then
+		void parse(const char* json, size_t size);
+		void parse(const std::string& json);
+
+		// replace the document by a copy of an fc value
+		void assign(const JsonValue& json);
+
+		// an empty (null) document, the arena is kept for reuse
+		void clear();
+
+		NativeJsonValue& root();
+		const NativeJsonValue& root() const;
+		JsonArena& arena();
+
+		JsonValue to_json() const;
+	};
+
+	// a copy of an fc value, its nodes placed in arena
+	// @throws JsonDiffException
+	NativeJsonValue json_to_native(JsonArena& arena, const JsonValue& json_value);
+
+	// a copy of a native value as an fc value
+	JsonValue native_to_json(const NativeJsonValue& json_value);
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef JSONDIFF_SEQUENCE_DIFF_H
+#define JSONDIFF_SEQUENCE_DIFF_H
+
+#include <jsondiff/config.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <utility>
+
+namespace jsondiff
+{
+	// (old index, new index) of an element kept by a sequence diff
+	typedef std::pair<size_t, size_t> SequenceMatch;
+
+	// longest common subsequence of two symbol sequences, as matches in increasing order of both indexes.
+	// uses Myers' O((N+M)D) algorithm with the linear space middle snake refinement.
+	// a middle snake search that exceeds max_cost edits stops and splits at its furthest reaching path instead,
+	// so the work on huge inputs stays bounded at the price of a diff that may not be minimal
+	std::vector<SequenceMatch> sequence_lcs(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b, size_t max_cost);
+
+	// ranges of both sequences still to be diffed, or with matched set, a run of matches still to be written
+	struct SequenceLcsTask
+	{
+		size_t a_lo, a_hi, b_lo, b_hi;
+		bool matched;
+	};
+
+	// the buffers of the middle snake search, kept by callers that diff many sequences
+	struct SequenceLcsScratch
+	{
+		std::vector<int64_t> forward;
+		std::vector<int64_t> backward;
+		std::vector<SequenceLcsTask> tasks;
+	};
+
+	// same as above, the matches are written to matches and the search reuses the buffers of scratch
+	void sequence_lcs(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b, size_t max_cost,
+		SequenceLcsScratch& scratch, std::vector<SequenceMatch>& matches);
+}
+
+#endif
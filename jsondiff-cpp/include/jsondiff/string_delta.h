@@ -0,0 +1,35 @@
+#ifndef JSONDIFF_STRING_DELTA_H
+#define JSONDIFF_STRING_DELTA_H
+
+#include <jsondiff/config.h>
+#include <jsondiff/json_value_types.h>
+
+#include <string>
+
+namespace jsondiff
+{
+	// the diff of two long strings that only differ in some places:
+	//   { __strdelta: [[<pos>, <old text>, <new text>], ...] }
+	// each hunk replaces the old text found at byte offset pos of the old string by the new text. the hunks are
+	// in the order of pos and don't overlap, hunk boundaries never split an utf-8 sequence
+
+	// the delta of two different strings: the common prefix and suffix are left out, and when what remains has
+	// the same size on both sides, the runs of changed bytes become separate hunks. linear in the string sizes
+	// @returns false if the delta wouldn't be smaller than { __old, __new }, diff_json is only written when it is
+	bool make_string_delta(const char* old_data, size_t old_size, const char* new_data, size_t new_size, JsonValue& diff_json);
+
+	// true if hunks_json is a well formed array of hunks, see above
+	bool is_string_delta_hunks(const JsonValue& hunks_json);
+
+	// the old string with the hunks applied, or the new one with them reverted when rollback is true
+	// @throws JsonDiffException if the texts of the hunks aren't found in the string
+	std::string apply_string_delta(const char* data, size_t size, const JsonArray& hunks, bool rollback);
+
+	// the delta of first followed by second, from the hunks alone. the work depends on the size of the hunks,
+	// not of the string
+	// @returns false if the composed delta changes nothing, diff_json is only written when it does
+	// @throws JsonDiffException if second doesn't follow first
+	bool compose_string_delta(const JsonArray& first, const JsonArray& second, JsonValue& diff_json);
+}
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef JSONDIFF_THREAD_POOL_H
+#define JSONDIFF_THREAD_POOL_H
+
+#include <jsondiff/config.h>
+
+#include <stddef.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace jsondiff
+{
+	class TaskGroup;
+
+	// fixed set of worker threads, each with its own task queue. a worker runs the newest task of its own queue first
+	// and steals the oldest task of another queue when its own is empty, so nested tasks stay on the thread that
+	// spawned them while the big, early ones spread out
+	class ThreadPool
+	{
+	private:
+		struct Task
+		{
+			std::function<void()> run;
+			TaskGroup* group;
+		};
+
+		struct Queue
+		{
+			std::mutex mutex;
+			std::deque<Task> tasks;
+		};
+
+		std::vector<std::unique_ptr<Queue>> _queues;
+		std::vector<std::thread> _threads;
+		// tasks in all queues
+		std::atomic<size_t> _queued;
+		// spreads the tasks pushed from outside the pool over the queues
+		std::atomic<size_t> _next_queue;
+		bool _stopping;
+		// idle workers and waiting TaskGroups sleep here
+		std::mutex _wake_mutex;
+		std::condition_variable _wake;
+
+		// the queue of the calling thread if it is a worker of this pool, otherwise SIZE_MAX
+		size_t current_queue() const;
+		void push(Task&& task);
+		// pop a task of the caller's own queue, or steal one
+		bool try_pop(Task& task);
+		void run_task(Task& task);
+		void worker_loop(size_t index);
+
+		friend class TaskGroup;
+	public:
+		// thread_count 0 uses one thread per hardware thread
+		explicit ThreadPool(size_t thread_count = 0);
+		// waits for the running tasks, the queued ones are dropped
+		virtual ~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		size_t thread_count() const;
+	};
+
+	typedef std::shared_ptr<ThreadPool> ThreadPoolP;
+
+	// tasks run on a pool and waited for together. wait() runs queued tasks on the calling thread until the group is
+	// done, so a task can start and wait for a group of its own without tying up its worker
+	class TaskGroup
+	{
+	private:
+		ThreadPool& _pool;
+		std::atomic<size_t> _pending;
+		std::exception_ptr _error;
+		std::mutex _error_mutex;
+
+		void finish(std::exception_ptr error);
+
+		friend class ThreadPool;
+	public:
+		explicit TaskGroup(ThreadPool& pool);
+		// waits for the tasks still pending
+		virtual ~TaskGroup();
+
+		TaskGroup(const TaskGroup&) = delete;
+		TaskGroup& operator=(const TaskGroup&) = delete;
+
+		void run(std::function<void()> task);
+
+		// @throws the first exception thrown by a task of the group
+		void wait();
+	};
+}
+
+#endif
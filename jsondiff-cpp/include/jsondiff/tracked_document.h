@@ -0,0 +1,82 @@
+#ifndef JSONDIFF_TRACKED_DOCUMENT_H
+#define JSONDIFF_TRACKED_DOCUMENT_H
+
+#include <jsondiff/config.h>
+#include <jsondiff/diff_options.h>
+#include <jsondiff/diff_result.h>
+#include <jsondiff/json_value_types.h>
+#include <jsondiff/jsondiff.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace jsondiff
+{
+	struct TrackedNode;
+
+	// a json document changed through set/erase/insert on json pointers, which records its changes as it goes.
+	// each change is kept as the small diff of the one value it touches, diff() composes them (see JsonDiff::compose),
+	// so neither a copy of the old document nor a walk of the whole tree is needed. the objects and arrays on the path
+	// of a change are held as their members or elements from the first change in them on, so the work depends on
+	// the number of changes and the size of the values they touch, not on the size of the containers they are made in.
+	// json() puts the containers back together, the next change in one splits it up again.
+	// the path filters and budget of the options don't apply, every change is made and is in the diff.
+	// not thread safe
+	class TrackedDocument
+	{
+	private:
+		JsonDiff _json_diff;
+		std::unique_ptr<TrackedNode> _root;
+		// the diffs of the changes since the last reset, in order. diff() folds them into one
+		std::vector<DiffResultP> _changes;
+		size_t _change_count;
+
+		enum ChangeType
+		{
+			CT_SET = 0,
+			CT_ERASE = 1,
+			CT_INSERT = 2
+		};
+
+		// @throws JsonDiffException
+		void change(ChangeType type, const std::string& pointer, const JsonValue* value);
+	public:
+		explicit TrackedDocument(const JsonValue& json);
+		TrackedDocument(const JsonValue& json, const DiffOptions& options);
+		virtual ~TrackedDocument();
+
+		TrackedDocument(const TrackedDocument&) = delete;
+		TrackedDocument& operator=(const TrackedDocument&) = delete;
+
+		// the document with the changes made so far, the reference is valid until the next change
+		const JsonValue& json() const;
+
+		// set the value at pointer: replace the member or element there, or add the missing object member.
+		// "-" as the last token appends to an array, "" replaces the whole document
+		// @throws JsonDiffException if the parent of pointer is missing or not an object or array
+		void set(const std::string& pointer, const JsonValue& value);
+
+		// remove the object member or array element at pointer, the later elements move down
+		// @throws JsonDiffException if there is no such member or element
+		void erase(const std::string& pointer);
+
+		// insert value into an array before the element at pointer, "-" or the array size as the last token appends.
+		// on an object member it is the same as set
+		// @throws JsonDiffException if the parent of pointer is missing or the index is out of range
+		void insert(const std::string& pointer, const JsonValue& value);
+
+		// the changes since construction or the last reset as one diff, in the format of JsonDiff::diff,
+		// which patch and rollback take as it is
+		// @throws JsonDiffException
+		DiffResultP diff();
+
+		// forget the changes made so far, later diffs start from the current document
+		void reset();
+
+		// changes recorded since the last reset, a change that left the document as it was isn't counted
+		size_t change_count() const;
+	};
+}
+
+#endif
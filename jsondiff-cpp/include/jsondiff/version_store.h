@@ -0,0 +1,112 @@
+#ifndef JSONDIFF_VERSION_STORE_H
+#define JSONDIFF_VERSION_STORE_H
+
+#include <jsondiff/config.h>
+#include <jsondiff/diff_options.h>
+#include <jsondiff/diff_result.h>
+#include <jsondiff/json_value_types.h>
+#include <jsondiff/jsondiff.h>
+#include <jsondiff/mapped_file.h>
+
+#include <stdint.h>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace jsondiff
+{
+	struct VersionStoreOptions
+	{
+		// every keyframe_interval-th version is stored whole next to its diff, so reading any version
+		// takes at most keyframe_interval / 2 patches or rollbacks. 1 stores every version whole
+		size_t keyframe_interval;
+
+		// options of the diffs between versions
+		DiffOptions diff_options;
+
+		VersionStoreOptions()
+			: keyframe_interval(JSONDIFF_VERSION_STORE_KEYFRAME_INTERVAL)
+		{
+		}
+	};
+
+	// the history of one json document in an append only log file:
+	//
+	//   'J' 'D' 'V' 'S' <format version byte>
+	//   record*   <type byte> <payload size u64> <payload checksum u64> <payload>
+	//
+	// every version has a diff record, the binary diff (see jsondiff/binary_format.h) from the version before it.
+	// keyframe versions are followed by a snapshot record holding the version as json text.
+	// the log is memory mapped for reading and indexed when opened; a record cut short by a crash during a commit
+	// is dropped from the end of the file, a damaged record before the last one makes opening throw. not thread safe
+	class VersionStore
+	{
+	private:
+		struct VersionEntry
+		{
+			// offsets of the payloads in the log, the snapshot one is 0 if the version is no keyframe
+			uint64_t diff_offset;
+			uint64_t diff_size;
+			uint64_t snapshot_offset;
+			uint64_t snapshot_size;
+		};
+
+		std::string _path;
+		VersionStoreOptions _options;
+		JsonDiff _json_diff;
+		std::vector<VersionEntry> _versions;
+		// the keyframe versions, ascending
+		std::vector<uint64_t> _keyframes;
+		// the newest version, kept whole so commits only diff against memory
+		JsonValue _head;
+		std::ofstream _writer;
+		uint64_t _log_size;
+		// mapped up to the size of the log at the last remap, remapped when a newer record is read
+		std::unique_ptr<MappedFile> _log;
+
+		void open_log();
+		// @throws JsonDiffException if the log can't be written
+		uint64_t append_record(char type, const std::string& payload);
+		const char* read_payload(uint64_t offset, uint64_t size);
+		DiffResultP read_diff(uint64_t version);
+		JsonValue read_snapshot(uint64_t version);
+	public:
+		// open the log at path, created if missing
+		// @throws JsonDiffException if the file can't be opened or isn't a version log
+		explicit VersionStore(const std::string& path, const VersionStoreOptions& options = VersionStoreOptions());
+		virtual ~VersionStore();
+
+		VersionStore(const VersionStore&) = delete;
+		VersionStore& operator=(const VersionStore&) = delete;
+
+		// append json as the next version
+		// @returns the number of the new version, 0 for the first one
+		// @throws JsonDiffException
+		uint64_t commit(const JsonValue& json);
+
+		uint64_t version_count() const;
+
+		// the newest version, null if there is none
+		const JsonValue& head() const;
+
+		// the document as it was at version, rebuilt from the nearest keyframe (or the head)
+		// with at most keyframe_interval / 2 patches or rollbacks
+		// @throws JsonDiffException if there is no such version
+		JsonValue get(uint64_t version);
+
+		// the diff from version - 1 to version, from null for version 0
+		// @throws JsonDiffException if there is no such version
+		DiffResultP version_diff(uint64_t version);
+
+		// the diff from version from to version to (from <= to), composed from the diffs between them
+		// @throws JsonDiffException
+		DiffResultP changes(uint64_t from, uint64_t to);
+
+		// write the buffered records to the file
+		// @throws JsonDiffException
+		void flush();
+	};
+}
+
+#endif
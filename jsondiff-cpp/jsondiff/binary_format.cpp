@@ -0,0 +1,432 @@
+#include <jsondiff/binary_format.h>
+#include <jsondiff/exceptions.h>
+#include <jsondiff/helper.h>
+
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+namespace jsondiff
+{
+	enum BinaryTag
+	{
+		BT_NULL = 0,
+		BT_FALSE = 1,
+		BT_TRUE = 2,
+		BT_INT64 = 3,
+		BT_UINT64 = 4,
+		BT_DOUBLE = 5,
+		BT_STRING = 6,
+		BT_ARRAY = 7,
+		BT_OBJECT = 8,
+		BT_REPLACE = 9,
+		BT_ITEM = 10, // [op, pos, item] with a uint64 pos, as the diff writes it
+		BT_ITEM_INT64 = 11 // [op, pos, item] with an int64 pos, as json_loads reads it
+	};
+
+	enum BinaryKeySuffix
+	{
+		BKS_NONE = 0,
+		BKS_ADDED = 1,
+		BKS_DELETED = 2
+	};
+
+	static const char binary_magic[2] = { 'J', 'D' };
+
+	static const size_t added_postfix_size = sizeof(JSONDIFF_KEY_ADDED_POSTFIX) - 1;
+	static const size_t deleted_postfix_size = sizeof(JSONDIFF_KEY_DELETED_POSTFIX) - 1;
+
+	static BinaryKeySuffix split_key_suffix(const std::string& key, size_t& name_size)
+	{
+		if (key.size() > added_postfix_size && utils::string_ends_with(key, JSONDIFF_KEY_ADDED_POSTFIX))
+		{
+			name_size = key.size() - added_postfix_size;
+			return BKS_ADDED;
+		}
+		if (key.size() > deleted_postfix_size && utils::string_ends_with(key, JSONDIFF_KEY_DELETED_POSTFIX))
+		{
+			name_size = key.size() - deleted_postfix_size;
+			return BKS_DELETED;
+		}
+		name_size = key.size();
+		return BKS_NONE;
+	}
+
+	static bool is_replace_object(const fc::variant_object& obj)
+	{
+		if (obj.size() != 2)
+			return false;
+		auto i = obj.begin();
+		if (i->key() != JSONDIFF_KEY_OLD_VALUE)
+			return false;
+		++i;
+		return i->key() == JSONDIFF_KEY_NEW_VALUE;
+	}
+
+	// op byte of an [op, pos, item] entry, 0 if the array is not one
+	static char array_item_op(const JsonArray& arr)
+	{
+		if (arr.size() != 3 || !arr[0].is_string())
+			return 0;
+		const auto& op = arr[0].get_string();
+		if (op.size() != 1 || (op[0] != '+' && op[0] != '-' && op[0] != '~' && op[0] != '>'))
+			return 0;
+		if (arr[1].get_type() == fc::variant::uint64_type)
+			return op[0];
+		if (arr[1].get_type() == fc::variant::int64_type && arr[1].as_int64() >= 0)
+			return op[0];
+		return 0;
+	}
+
+	class BinaryEncoder
+	{
+	private:
+		std::string& _out;
+		std::unordered_map<std::string, uint64_t> _key_indexes;
+		std::vector<const std::string*> _keys;
+		// key ref of every object member in traversal order, filled by collect_keys and consumed by write_value
+		std::vector<uint64_t> _key_refs;
+		size_t _next_key_ref;
+		std::string _name;
+	public:
+		explicit BinaryEncoder(std::string& out) : _out(out), _next_key_ref(0) {}
+
+		void encode(const JsonValue& diff_json)
+		{
+			collect_keys(diff_json);
+			_out.append(binary_magic, sizeof(binary_magic));
+			write_varint(JSONDIFF_BINARY_FORMAT_VERSION);
+			write_varint(_keys.size());
+			for (auto key : _keys)
+				write_string(*key);
+			write_value(diff_json);
+		}
+
+	private:
+		void write_varint(uint64_t v)
+		{
+			while (v >= 0x80)
+			{
+				_out.push_back((char)((v & 0x7f) | 0x80));
+				v >>= 7;
+			}
+			_out.push_back((char)v);
+		}
+
+		void write_string(const std::string& s)
+		{
+			write_varint(s.size());
+			_out.append(s);
+		}
+
+		void collect_keys(const JsonValue& value)
+		{
+			if (value.is_object())
+			{
+				const auto& obj = value.get_object();
+				if (is_replace_object(obj))
+				{
+					collect_keys(obj.begin()->value());
+					collect_keys((obj.begin() + 1)->value());
+					return;
+				}
+				for (auto i = obj.begin(); i != obj.end(); ++i)
+				{
+					size_t name_size;
+					auto suffix = split_key_suffix(i->key(), name_size);
+					_name.assign(i->key(), 0, name_size);
+					auto inserted = _key_indexes.insert(std::make_pair(_name, (uint64_t)_keys.size()));
+					if (inserted.second)
+						_keys.push_back(&inserted.first->first);
+					_key_refs.push_back((inserted.first->second << 2) | suffix);
+					collect_keys(i->value());
+				}
+			}
+			else if (value.is_array())
+			{
+				for (const auto& item : value.get_array())
+					collect_keys(item);
+			}
+		}
+
+		void write_value(const JsonValue& value)
+		{
+			switch (value.get_type())
+			{
+			case fc::variant::null_type:
+				_out.push_back((char)BT_NULL);
+				break;
+			case fc::variant::bool_type:
+				_out.push_back((char)(value.as_bool() ? BT_TRUE : BT_FALSE));
+				break;
+			case fc::variant::int64_type:
+			{
+				_out.push_back((char)BT_INT64);
+				auto v = value.as_int64();
+				write_varint(((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+				break;
+			}
+			case fc::variant::uint64_type:
+				_out.push_back((char)BT_UINT64);
+				write_varint(value.as_uint64());
+				break;
+			case fc::variant::double_type:
+			{
+				_out.push_back((char)BT_DOUBLE);
+				auto d = value.as_double();
+				uint64_t bits;
+				memcpy(&bits, &d, sizeof(bits));
+				for (int i = 0; i < 8; i++)
+					_out.push_back((char)(bits >> (8 * i)));
+				break;
+			}
+			case fc::variant::string_type:
+				_out.push_back((char)BT_STRING);
+				write_string(value.get_string());
+				break;
+			case fc::variant::array_type:
+			{
+				const auto& arr = value.get_array();
+				auto op = array_item_op(arr);
+				if (op)
+				{
+					_out.push_back((char)(arr[1].get_type() == fc::variant::uint64_type ? BT_ITEM : BT_ITEM_INT64));
+					_out.push_back(op);
+					write_varint(arr[1].as_uint64());
+					write_value(arr[2]);
+					break;
+				}
+				_out.push_back((char)BT_ARRAY);
+				write_varint(arr.size());
+				for (const auto& item : arr)
+					write_value(item);
+				break;
+			}
+			case fc::variant::object_type:
+			{
+				const auto& obj = value.get_object();
+				if (is_replace_object(obj))
+				{
+					_out.push_back((char)BT_REPLACE);
+					write_value(obj.begin()->value());
+					write_value((obj.begin() + 1)->value());
+					break;
+				}
+				_out.push_back((char)BT_OBJECT);
+				write_varint(obj.size());
+				for (auto i = obj.begin(); i != obj.end(); ++i)
+				{
+					write_varint(_key_refs[_next_key_ref++]);
+					write_value(i->value());
+				}
+				break;
+			}
+			default:
+				throw JsonDiffException(std::string("can't encode json value of type ") + std::to_string((int)value.get_type()));
+			}
+		}
+	};
+
+	class BinaryDecoder
+	{
+	private:
+		const unsigned char* _pos;
+		const unsigned char* _end;
+		std::vector<std::string> _keys;
+		size_t _depth;
+	public:
+		BinaryDecoder(const char* data, size_t size)
+			: _pos((const unsigned char*)data), _end((const unsigned char*)data + size), _depth(0) {}
+
+		JsonValue decode()
+		{
+			if ((size_t)(_end - _pos) < sizeof(binary_magic) || memcmp(_pos, binary_magic, sizeof(binary_magic)) != 0)
+				throw JsonDiffException("not a binary diff");
+			_pos += sizeof(binary_magic);
+			auto version = read_varint();
+			if (version != JSONDIFF_BINARY_FORMAT_VERSION)
+				throw JsonDiffException(std::string("unsupported binary diff version ") + std::to_string(version));
+			auto key_count = read_count();
+			_keys.reserve(key_count);
+			for (size_t i = 0; i < key_count; i++)
+			{
+				_keys.push_back(std::string());
+				read_string(_keys.back());
+			}
+			auto value = read_value();
+			if (_pos != _end)
+				throw JsonDiffException("trailing bytes after binary diff");
+			return value;
+		}
+
+	private:
+		void fail_truncated()
+		{
+			throw JsonDiffException("truncated binary diff");
+		}
+
+		unsigned char read_byte()
+		{
+			if (_pos == _end)
+				fail_truncated();
+			return *_pos++;
+		}
+
+		uint64_t read_varint()
+		{
+			uint64_t v = 0;
+			for (int shift = 0; shift < 64; shift += 7)
+			{
+				auto b = read_byte();
+				v |= (uint64_t)(b & 0x7f) << shift;
+				if (!(b & 0x80))
+					return v;
+			}
+			throw JsonDiffException("invalid varint in binary diff");
+		}
+
+		// a length or element count, every element takes at least one byte so it can't exceed what is left
+		size_t read_count()
+		{
+			auto count = read_varint();
+			if (count > (uint64_t)(_end - _pos))
+				fail_truncated();
+			return (size_t)count;
+		}
+
+		void read_string(std::string& s)
+		{
+			auto size = read_count();
+			s.assign((const char*)_pos, size);
+			_pos += size;
+		}
+
+		JsonValue read_value()
+		{
+			if (++_depth > JSONDIFF_BINARY_MAX_DEPTH)
+				throw JsonDiffException("binary diff nested too deep");
+			auto tag = read_byte();
+			JsonValue value;
+			switch (tag)
+			{
+			case BT_NULL:
+				break;
+			case BT_FALSE:
+				value = JsonValue(false);
+				break;
+			case BT_TRUE:
+				value = JsonValue(true);
+				break;
+			case BT_INT64:
+			{
+				auto v = read_varint();
+				value = JsonValue((int64_t)((v >> 1) ^ (~(v & 1) + 1)));
+				break;
+			}
+			case BT_UINT64:
+				value = JsonValue(read_varint());
+				break;
+			case BT_DOUBLE:
+			{
+				if (_end - _pos < 8)
+					fail_truncated();
+				uint64_t bits = 0;
+				for (int i = 0; i < 8; i++)
+					bits |= (uint64_t)_pos[i] << (8 * i);
+				_pos += 8;
+				double d;
+				memcpy(&d, &bits, sizeof(d));
+				value = JsonValue(d);
+				break;
+			}
+			case BT_STRING:
+			{
+				std::string s;
+				read_string(s);
+				value = JsonValue(std::move(s));
+				break;
+			}
+			case BT_ARRAY:
+			{
+				auto count = read_count();
+				JsonArray arr;
+				arr.reserve(count);
+				for (size_t i = 0; i < count; i++)
+					arr.push_back(read_value());
+				value = JsonValue(std::move(arr));
+				break;
+			}
+			case BT_OBJECT:
+			{
+				auto count = read_count();
+				JsonObject obj;
+				obj.reserve(count);
+				for (size_t i = 0; i < count; i++)
+				{
+					auto key_ref = read_varint();
+					auto index = key_ref >> 2;
+					if (index >= _keys.size())
+						throw JsonDiffException("invalid key index in binary diff");
+					std::string key = _keys[(size_t)index];
+					switch (key_ref & 3)
+					{
+					case BKS_NONE:
+						break;
+					case BKS_ADDED:
+						key += JSONDIFF_KEY_ADDED_POSTFIX;
+						break;
+					case BKS_DELETED:
+						key += JSONDIFF_KEY_DELETED_POSTFIX;
+						break;
+					default:
+						throw JsonDiffException("invalid key suffix in binary diff");
+					}
+					obj.set(std::move(key), read_value());
+				}
+				value = JsonValue(std::move(obj));
+				break;
+			}
+			case BT_REPLACE:
+			{
+				JsonObject obj;
+				obj.reserve(2);
+				obj.set(JSONDIFF_KEY_OLD_VALUE, read_value());
+				obj.set(JSONDIFF_KEY_NEW_VALUE, read_value());
+				value = JsonValue(std::move(obj));
+				break;
+			}
+			case BT_ITEM:
+			case BT_ITEM_INT64:
+			{
+				auto op = (char)read_byte();
+				if (op != '+' && op != '-' && op != '~' && op != '>')
+					throw JsonDiffException("invalid array diff op in binary diff");
+				auto pos = read_varint();
+				JsonArray item;
+				item.reserve(3);
+				item.push_back(JsonValue(std::string(1, op)));
+				item.push_back(tag == BT_ITEM ? JsonValue(pos) : JsonValue((int64_t)pos));
+				item.push_back(read_value());
+				value = JsonValue(std::move(item));
+				break;
+			}
+			default:
+				throw JsonDiffException(std::string("invalid tag in binary diff: ") + std::to_string((int)tag));
+			}
+			--_depth;
+			return value;
+		}
+	};
+
+	void encode_binary_diff(const JsonValue& diff_json, std::string& out)
+	{
+		BinaryEncoder encoder(out);
+		encoder.encode(diff_json);
+	}
+
+	JsonValue decode_binary_diff(const char* data, size_t size)
+	{
+		BinaryDecoder decoder(data, size);
+		return decoder.decode();
+	}
+}
@@ -0,0 +1,173 @@
+#include <jsondiff/compiled_diff.h>
+#include <jsondiff/diff_fingerprints.h>
+#include <jsondiff/helper.h>
+#include <jsondiff/string_delta.h>
+
+#include <cstring>
+
+namespace jsondiff
+{
+	CompiledDiffOp::CompiledDiffOp()
+		: type(DOT_ITEM_INVALID), json_key(nullptr), pos(0), target(0), value(nullptr)
+	{
+	}
+
+	CompiledDiffNode::CompiledDiffNode()
+		: type(DNT_INVALID), json(nullptr), old_value(nullptr), new_value(nullptr), hunks(nullptr), fingerprints(nullptr)
+	{
+	}
+
+	CompiledDiff::CompiledDiff(const JsonValue& diff_json)
+		: _diff_json(diff_json)
+	{
+		compile_node(_diff_json, _root);
+	}
+
+	CompiledDiff::CompiledDiff(JsonValue&& diff_json)
+		: _diff_json(std::move(diff_json))
+	{
+		compile_node(_diff_json, _root);
+	}
+
+	CompiledDiff::~CompiledDiff()
+	{
+	}
+
+	const JsonValue& CompiledDiff::json() const
+	{
+		return _diff_json;
+	}
+
+	const CompiledDiffNode& CompiledDiff::root() const
+	{
+		return _root;
+	}
+
+	bool CompiledDiff::is_undefined() const
+	{
+		return _diff_json.is_null();
+	}
+
+	static bool compile_array_item(const JsonValue& item_json, CompiledDiffOp& op)
+	{
+		if (!item_json.is_array())
+			return false;
+		const auto& item = item_json.get_array();
+		if (item.size() != 3 || !item[0].is_string() || !item[1].is_integer())
+			return false;
+		const auto& op_item = item[0].get_string();
+		if (op_item.size() != 1)
+			return false;
+		op.pos = (size_t)item[1].as_uint64();
+		op.value = &item[2];
+		switch (op_item[0])
+		{
+		case '+':
+			op.type = DOT_ITEM_INSERTED;
+			return true;
+		case '-':
+			op.type = DOT_ITEM_REMOVED;
+			return true;
+		case '~':
+			op.type = DOT_ITEM_MODIFIED;
+			op.diff.reset(new CompiledDiffNode());
+			CompiledDiff::compile_node(item[2], *op.diff);
+			return true;
+		case '>':
+			if (!item[2].is_integer())
+				return false;
+			op.type = DOT_ITEM_MOVED;
+			op.target = (size_t)item[2].as_uint64();
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	void CompiledDiff::compile_node(const JsonValue& diff_json, CompiledDiffNode& node)
+	{
+		node.json = &diff_json;
+		node.fingerprints = nullptr;
+		node.ops.clear();
+		if (diff_json.is_object())
+		{
+			const auto& diff_json_obj = diff_json.get_object();
+			auto old_value = diff_json_obj.find(JSONDIFF_KEY_OLD_VALUE);
+			auto new_value = diff_json_obj.find(JSONDIFF_KEY_NEW_VALUE);
+			if (old_value != diff_json_obj.end() && new_value != diff_json_obj.end())
+			{
+				node.type = DNT_REPLACE;
+				node.old_value = &old_value->value();
+				node.new_value = &new_value->value();
+				auto fingerprints = diff_json_obj.find(JSONDIFF_KEY_FINGERPRINTS);
+				if (fingerprints != diff_json_obj.end() && is_diff_fingerprints(fingerprints->value()))
+					node.fingerprints = &fingerprints->value();
+				return;
+			}
+			auto hunks = diff_json_obj.find(JSONDIFF_KEY_STRING_DELTA);
+			if (diff_json_obj.size() == 1 && hunks != diff_json_obj.end() && is_string_delta_hunks(hunks->value()))
+			{
+				node.type = DNT_STRING_DELTA;
+				node.hunks = &hunks->value();
+				return;
+			}
+			node.type = DNT_OBJECT;
+			node.ops.reserve(diff_json_obj.size());
+			static const size_t added_postfix_size = strlen(JSONDIFF_KEY_ADDED_POSTFIX);
+			static const size_t deleted_postfix_size = strlen(JSONDIFF_KEY_DELETED_POSTFIX);
+			for (auto i = diff_json_obj.begin(); i != diff_json_obj.end(); i++)
+			{
+				const auto& key = i->key();
+				if (key == JSONDIFF_KEY_FINGERPRINTS && is_diff_fingerprints(i->value()))
+				{
+					node.fingerprints = &i->value();
+					continue;
+				}
+				node.ops.push_back(CompiledDiffOp());
+				auto& op = node.ops.back();
+				op.json_key = &key;
+				op.value = &i->value();
+				if (key.size() > added_postfix_size && utils::string_ends_with(key, JSONDIFF_KEY_ADDED_POSTFIX))
+				{
+					op.type = DOT_MEMBER_ADDED;
+					op.key.assign(key, 0, key.size() - added_postfix_size);
+				}
+				else if (key.size() > deleted_postfix_size && utils::string_ends_with(key, JSONDIFF_KEY_DELETED_POSTFIX))
+				{
+					op.type = DOT_MEMBER_DELETED;
+					op.key.assign(key, 0, key.size() - deleted_postfix_size);
+				}
+				else
+				{
+					op.type = DOT_MEMBER_MODIFIED;
+					op.key = key;
+					op.diff.reset(new CompiledDiffNode());
+					compile_node(i->value(), *op.diff);
+				}
+			}
+		}
+		else if (diff_json.is_array())
+		{
+			node.type = DNT_ARRAY;
+			const auto& items = diff_json.get_array();
+			node.ops.reserve(items.size());
+			for (size_t i = 0; i < items.size(); i++)
+			{
+				if (is_diff_fingerprints_item(items[i]))
+				{
+					node.fingerprints = &items[i].get_array()[2];
+					continue;
+				}
+				node.ops.push_back(CompiledDiffOp());
+				auto& op = node.ops.back();
+				if (!compile_array_item(items[i], op))
+				{
+					op = CompiledDiffOp();
+					op.value = &items[i];
+				}
+			}
+		}
+		else
+			node.type = DNT_INVALID;
+	}
+}
@@ -0,0 +1,578 @@
+#include <jsondiff/jsondiff.h>
+#include <jsondiff/exceptions.h>
+#include <jsondiff/fingerprint.h>
+#include <jsondiff/helper.h>
+#include <jsondiff/json_value_traits.h>
+#include <jsondiff/string_delta.h>
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace jsondiff
+{
+	// a run of consecutive slots of the array after a diff. the slots hold consecutive elements of the array before it,
+	// starting at source, or one inserted value (source is SIZE_MAX). length is SIZE_MAX for the run that goes on
+	// to the end of the array, whose length a diff doesn't tell
+	struct ArraySpan
+	{
+		size_t slot;
+		size_t length;
+		size_t source;
+		const JsonValue* value;
+		// inserted or moved to its slot, not filled in order
+		bool placed;
+	};
+
+	// elements kept from the first array to the last one of a composition, placed at slot of the last array
+	struct KeptSpan
+	{
+		size_t source;
+		size_t slot;
+		size_t length;
+	};
+
+	// an element inserted into the last array of a composition
+	struct InsertedItem
+	{
+		size_t slot;
+		const JsonValue* value;
+		// slot in the middle array when the first diff inserted it, SIZE_MAX when the second one did
+		size_t middle_slot;
+	};
+
+	// orders (position, ...) pairs by position
+	struct ByPosition
+	{
+		template <typename Entry>
+		bool operator()(const Entry& a, const Entry& b) const
+		{
+			return a.first < b.first;
+		}
+	};
+
+	// the ops of one array diff, sorted by position
+	struct SortedArrayOps
+	{
+		std::vector<std::pair<size_t, const JsonValue*>> removed;
+		std::vector<std::pair<size_t, const JsonValue*>> added;
+		std::vector<std::pair<size_t, const CompiledDiffNode*>> modified;
+		std::vector<std::pair<size_t, size_t>> moved;
+		// the sources that don't fill the free slots in order: removed and moved ones
+		std::vector<size_t> taken;
+
+		// @throws JsonDiffException
+		explicit SortedArrayOps(const CompiledDiffNode& node)
+		{
+			for (const auto& op : node.ops)
+			{
+				switch (op.type)
+				{
+				case DOT_ITEM_INSERTED:
+					added.push_back(std::make_pair(op.pos, op.value));
+					break;
+				case DOT_ITEM_REMOVED:
+					removed.push_back(std::make_pair(op.pos, op.value));
+					taken.push_back(op.pos);
+					break;
+				case DOT_ITEM_MODIFIED:
+					modified.push_back(std::make_pair(op.pos, op.diff.get()));
+					break;
+				case DOT_ITEM_MOVED:
+					moved.push_back(std::make_pair(op.pos, op.target));
+					taken.push_back(op.pos);
+					break;
+				default:
+					throw JsonDiffException("diffjson format error for array diff");
+				}
+			}
+			std::sort(removed.begin(), removed.end(), ByPosition());
+			std::sort(added.begin(), added.end(), ByPosition());
+			std::sort(modified.begin(), modified.end(), ByPosition());
+			std::sort(moved.begin(), moved.end());
+			std::sort(taken.begin(), taken.end());
+			for (size_t i = 1; i < taken.size(); i++)
+			{
+				if (taken[i] == taken[i - 1])
+					throw JsonDiffException("diffjson format error for array diff");
+			}
+			for (size_t i = 1; i < modified.size(); i++)
+			{
+				if (modified[i].first == modified[i - 1].first)
+					throw JsonDiffException("diffjson format error for array diff");
+			}
+		}
+
+		template <typename Entry>
+		static const Entry* find(const std::vector<Entry>& entries, size_t pos)
+		{
+			auto found = std::lower_bound(entries.begin(), entries.end(), pos, [](const Entry& entry, size_t p) { return entry.first < p; });
+			return found != entries.end() && found->first == pos ? &*found : nullptr;
+		}
+
+		const CompiledDiffNode* find_modified(size_t pos) const
+		{
+			auto found = find(modified, pos);
+			return found ? found->second : nullptr;
+		}
+
+		bool is_removed(size_t pos) const
+		{
+			return find(removed, pos) != nullptr;
+		}
+
+		// the slots of the array after the diff, from slot 0 on, as patch places them:
+		// inserted and moved elements at their targets, the other kept elements in order in the free slots
+		// @throws JsonDiffException
+		std::vector<ArraySpan> spans() const
+		{
+			std::vector<ArraySpan> placed;
+			for (const auto& item : added)
+				placed.push_back(ArraySpan{ item.first, 1, SIZE_MAX, item.second, true });
+			for (const auto& item : moved)
+				placed.push_back(ArraySpan{ item.second, 1, item.first, nullptr, true });
+			std::sort(placed.begin(), placed.end(), [](const ArraySpan& a, const ArraySpan& b) { return a.slot < b.slot; });
+			std::vector<ArraySpan> result;
+			size_t slot = 0;
+			size_t source = 0;
+			size_t next_taken = 0;
+			// fill count free slots from the kept sources, SIZE_MAX to the end of the array
+			auto fill = [&](size_t count) {
+				while (count > 0)
+				{
+					while (next_taken < taken.size() && taken[next_taken] == source)
+					{
+						source++;
+						next_taken++;
+					}
+					if (next_taken == taken.size() && count == SIZE_MAX)
+					{
+						result.push_back(ArraySpan{ slot, SIZE_MAX, source, nullptr, false });
+						return;
+					}
+					size_t length = next_taken < taken.size() ? std::min(count, taken[next_taken] - source) : count;
+					result.push_back(ArraySpan{ slot, length, source, nullptr, false });
+					slot += length;
+					source += length;
+					if (count != SIZE_MAX)
+						count -= length;
+				}
+			};
+			for (const auto& item : placed)
+			{
+				if (item.slot < slot)
+					throw JsonDiffException("diffjson format error for array diff");
+				fill(item.slot - slot);
+				result.push_back(item);
+				slot++;
+			}
+			fill(SIZE_MAX);
+			return result;
+		}
+	};
+
+	// the span holding slot, spans cover every slot from 0 on
+	static const ArraySpan& find_span(const std::vector<ArraySpan>& spans, size_t slot)
+	{
+		auto found = std::upper_bound(spans.begin(), spans.end(), slot, [](size_t s, const ArraySpan& span) { return s < span.slot; });
+		return *(found - 1);
+	}
+
+	// slots from the start of span to its end, SIZE_MAX when unbounded
+	static size_t span_rest(const ArraySpan& span, size_t slot)
+	{
+		return span.length == SIZE_MAX ? SIZE_MAX : span.length - (slot - span.slot);
+	}
+
+	// indexes of the spans, ordered by source, that keep their place: the chain of increasing slots holding the most elements
+	static std::vector<bool> heaviest_increasing_chain(const std::vector<KeptSpan>& spans)
+	{
+		std::vector<size_t> slots;
+		slots.reserve(spans.size());
+		for (const auto& span : spans)
+			slots.push_back(span.slot);
+		std::sort(slots.begin(), slots.end());
+		// fenwick tree of the heaviest chain ending at each slot rank, as (weight, span index + 1)
+		std::vector<std::pair<size_t, size_t>> tree(spans.size() + 1, std::make_pair((size_t)0, (size_t)0));
+		std::vector<size_t> previous(spans.size());
+		for (size_t k = 0; k < spans.size(); k++)
+		{
+			size_t rank = std::lower_bound(slots.begin(), slots.end(), spans[k].slot) - slots.begin() + 1;
+			std::pair<size_t, size_t> best(0, 0);
+			for (size_t r = rank - 1; r > 0; r -= r & (0 - r))
+				best = std::max(best, tree[r]);
+			previous[k] = best.second;
+			std::pair<size_t, size_t> chain(best.first + spans[k].length, k + 1);
+			for (size_t r = rank; r < tree.size(); r += r & (0 - r))
+				tree[r] = std::max(tree[r], chain);
+		}
+		std::pair<size_t, size_t> best(0, 0);
+		for (size_t r = spans.size(); r > 0; r -= r & (0 - r))
+			best = std::max(best, tree[r]);
+		std::vector<bool> result(spans.size());
+		for (size_t k = best.second; k > 0; k = previous[k - 1])
+			result[k - 1] = true;
+		return result;
+	}
+
+	// state of one compose call
+	class JsonDiff::DiffComposer
+	{
+	private:
+		JsonDiff& _json_diff;
+		// location of the nodes being composed, only kept when array keys depend on it
+		bool _track_path;
+		std::vector<std::string> _path;
+		JsonValueTraits<JsonValue>::allocator_type _allocator;
+
+		// a diff nested in a diff json, as a node of its own
+		static const CompiledDiffNode& nested_node(const CompiledDiffOp& op)
+		{
+			if (!op.diff || op.diff->type == DNT_INVALID)
+				throw JsonDiffException("diffjson format error, can't compose");
+			return *op.diff;
+		}
+
+		void push_path(const std::string& token)
+		{
+			if (_track_path)
+				_path.push_back(token);
+		}
+
+		void pop_path()
+		{
+			if (_track_path)
+				_path.pop_back();
+		}
+
+		// @throws JsonDiffException
+		bool compose_object(const CompiledDiffNode& first, const CompiledDiffNode& second, JsonValue& diff_json)
+		{
+			std::unordered_map<std::string, const CompiledDiffOp*> second_ops;
+			second_ops.reserve(second.ops.size());
+			for (const auto& op : second.ops)
+			{
+				if (!second_ops.insert(std::make_pair(op.key, &op)).second)
+					throw JsonDiffException("diffjson has a key changed twice, can't compose");
+			}
+			// the entries are collected and appended at the end without looking each key up, unless a member is named
+			// like a deleted or added one, e.g. "a__added" next to an added "a", and must replace that entry as set does
+			std::vector<fc::mutable_variant_object::entry> diff_entries;
+			bool postfixed_keys = false;
+			for (const auto* ops : { &first.ops, &second.ops })
+			{
+				for (const auto& op : *ops)
+				{
+					postfixed_keys = postfixed_keys || utils::string_ends_with(op.key, JSONDIFF_KEY_DELETED_POSTFIX)
+						|| utils::string_ends_with(op.key, JSONDIFF_KEY_ADDED_POSTFIX);
+				}
+			}
+			std::vector<bool> second_used(second.ops.size());
+			for (const auto& op : first.ops)
+			{
+				auto found = second_ops.find(op.key);
+				if (found == second_ops.end())
+				{
+					// only the first diff changes the member
+					diff_entries.emplace_back(*op.json_key, *op.value);
+					continue;
+				}
+				const auto& second_op = *found->second;
+				second_used[&second_op - second.ops.data()] = true;
+				push_path(op.key);
+				if (op.type == DOT_MEMBER_ADDED && second_op.type == DOT_MEMBER_DELETED)
+				{
+					// added then deleted again, nothing left
+				}
+				else if (op.type == DOT_MEMBER_ADDED && second_op.type == DOT_MEMBER_MODIFIED)
+				{
+					JsonValue value = *op.value;
+					_json_diff.patch_node(value, nested_node(second_op), _allocator);
+					diff_entries.emplace_back(*op.json_key, std::move(value));
+				}
+				else if (op.type == DOT_MEMBER_ADDED && second_op.type == DOT_MEMBER_ADDED)
+				{
+					// a patch overwrites a member that is there already
+					diff_entries.emplace_back(*op.json_key, *second_op.value);
+				}
+				else if (op.type == DOT_MEMBER_DELETED && second_op.type == DOT_MEMBER_ADDED)
+				{
+					JsonValue member_diff;
+					if (_json_diff.diff_at(_path, *op.value, *second_op.value, member_diff))
+						diff_entries.emplace_back(op.key, std::move(member_diff));
+				}
+				else if (op.type == DOT_MEMBER_MODIFIED && second_op.type == DOT_MEMBER_MODIFIED)
+				{
+					JsonValue member_diff;
+					if (compose_node(nested_node(op), nested_node(second_op), member_diff))
+						diff_entries.emplace_back(op.key, std::move(member_diff));
+				}
+				else if (op.type == DOT_MEMBER_MODIFIED && second_op.type == DOT_MEMBER_DELETED)
+				{
+					JsonValue value = *second_op.value;
+					_json_diff.rollback_node(value, nested_node(op), _allocator);
+					diff_entries.emplace_back(*second_op.json_key, std::move(value));
+				}
+				else
+					throw JsonDiffException("diffjson of member " + op.key + " doesn't follow the first diff, can't compose");
+				pop_path();
+			}
+			for (size_t i = 0; i < second.ops.size(); i++)
+			{
+				// only the second diff changes the member
+				if (!second_used[i])
+					diff_entries.emplace_back(*second.ops[i].json_key, *second.ops[i].value);
+			}
+			if (diff_entries.empty())
+				return false;
+			fc::mutable_variant_object diff_json_obj;
+			if (postfixed_keys)
+			{
+				for (auto& entry : diff_entries)
+					diff_json_obj.set(entry.key(), std::move(entry.value()));
+			}
+			else
+				utils::append_object_entries(diff_json_obj, diff_entries);
+			diff_json = std::move(diff_json_obj);
+			return true;
+		}
+
+		// the first diff turns array x into y and the second y into z. the slots of y are mapped to x and the slots of z
+		// to y as spans, so z is read as spans of x without knowing the length of any of the arrays.
+		// the spans of x that don't keep their order in z are written as moves
+		// @throws JsonDiffException
+		bool compose_array(const CompiledDiffNode& first, const CompiledDiffNode& second, JsonValue& diff_json)
+		{
+			SortedArrayOps first_ops(first);
+			SortedArrayOps second_ops(second);
+			auto first_spans = first_ops.spans();
+			auto second_spans = second_ops.spans();
+
+			std::vector<KeptSpan> kept;
+			std::vector<InsertedItem> inserted;
+			for (const auto& span : second_spans)
+			{
+				if (span.source == SIZE_MAX)
+				{
+					inserted.push_back(InsertedItem{ span.slot, span.value, SIZE_MAX });
+					continue;
+				}
+				size_t slot = span.slot;
+				size_t middle_slot = span.source;
+				size_t count = span.length;
+				while (count > 0)
+				{
+					const auto& middle_span = find_span(first_spans, middle_slot);
+					size_t length = std::min(count, span_rest(middle_span, middle_slot));
+					if (middle_span.source == SIZE_MAX)
+						inserted.push_back(InsertedItem{ slot, middle_span.value, middle_slot });
+					else if (length == SIZE_MAX)
+					{
+						// the rest of x, always in place
+						break;
+					}
+					else
+						kept.push_back(KeptSpan{ middle_span.source + (middle_slot - middle_span.slot), slot, length });
+					if (count != SIZE_MAX)
+						count -= length;
+					slot += length;
+					middle_slot += length;
+				}
+			}
+
+			fc::variants diff_json_array;
+			// the element of x at slot of y, SIZE_MAX if the first diff inserted it
+			auto source_of = [&](size_t middle_slot) {
+				const auto& middle_span = find_span(first_spans, middle_slot);
+				return middle_span.source == SIZE_MAX ? SIZE_MAX : middle_span.source + (middle_slot - middle_span.slot);
+			};
+			// the spans filled in order have increasing sources
+			std::vector<const ArraySpan*> filled_spans;
+			for (const auto& span : first_spans)
+			{
+				if (!span.placed)
+					filled_spans.push_back(&span);
+			}
+			// the slot in y of the kept element of x at source
+			auto middle_slot_of = [&](size_t source) {
+				auto moved = SortedArrayOps::find(first_ops.moved, source);
+				if (moved)
+					return moved->second;
+				auto found = std::upper_bound(filled_spans.begin(), filled_spans.end(), source, [](size_t s, const ArraySpan* span) { return s < span->source; });
+				if (found == filled_spans.begin() || source - (*(found - 1))->source >= (*(found - 1))->length)
+					throw JsonDiffException("diffjson format error for array diff");
+				return (*(found - 1))->slot + (source - (*(found - 1))->source);
+			};
+			std::vector<std::pair<size_t, JsonValue>> removed;
+			std::vector<std::pair<size_t, JsonValue>> modified;
+			for (const auto& item : first_ops.removed)
+			{
+				if (first_ops.find_modified(item.first))
+					throw JsonDiffException("diffjson format error for array diff");
+				removed.push_back(std::make_pair(item.first, *item.second));
+			}
+			for (const auto& item : second_ops.removed)
+			{
+				if (second_ops.find_modified(item.first))
+					throw JsonDiffException("diffjson format error for array diff");
+				size_t source = source_of(item.first);
+				if (source == SIZE_MAX)
+					continue; // inserted by the first diff, removed by the second
+				JsonValue value = *item.second;
+				auto first_diff = first_ops.find_modified(source);
+				if (first_diff)
+					_json_diff.rollback_node(value, *first_diff, _allocator);
+				removed.push_back(std::make_pair(source, std::move(value)));
+			}
+			for (const auto& item : first_ops.modified)
+			{
+				size_t middle_slot = middle_slot_of(item.first);
+				if (second_ops.is_removed(middle_slot))
+					continue;
+				auto second_diff = second_ops.find_modified(middle_slot);
+				if (!second_diff)
+				{
+					modified.push_back(std::make_pair(item.first, *item.second->json));
+					continue;
+				}
+				JsonValue item_diff;
+				push_path(std::to_string(item.first));
+				bool changed = compose_node(*item.second, *second_diff, item_diff);
+				pop_path();
+				if (changed)
+					modified.push_back(std::make_pair(item.first, std::move(item_diff)));
+			}
+			for (const auto& item : second_ops.modified)
+			{
+				size_t source = source_of(item.first);
+				if (source != SIZE_MAX && !first_ops.find_modified(source))
+					modified.push_back(std::make_pair(source, *item.second->json));
+			}
+			std::sort(inserted.begin(), inserted.end(), [](const InsertedItem& a, const InsertedItem& b) { return a.slot < b.slot; });
+			std::vector<std::pair<size_t, JsonValue>> inserted_values;
+			inserted_values.reserve(inserted.size());
+			for (const auto& item : inserted)
+			{
+				inserted_values.push_back(std::make_pair(item.slot, *item.value));
+				auto second_diff = item.middle_slot != SIZE_MAX ? second_ops.find_modified(item.middle_slot) : nullptr;
+				if (second_diff)
+					_json_diff.patch_node(inserted_values.back().second, *second_diff, _allocator);
+			}
+			std::sort(removed.begin(), removed.end(), ByPosition());
+			std::sort(modified.begin(), modified.end(), ByPosition());
+
+			// an element removed by one diff and inserted again by the other is kept, e.g. a change and its revert
+			std::vector<bool> removed_kept(removed.size());
+			std::vector<bool> inserted_kept(inserted_values.size());
+			if (!removed.empty() && !inserted_values.empty())
+			{
+				std::unordered_multimap<JsonFingerprint, size_t> removed_by_fingerprint;
+				for (size_t k = 0; k < removed.size(); k++)
+					removed_by_fingerprint.insert(std::make_pair(json_fingerprint(removed[k].second), k));
+				for (size_t k = 0; k < inserted_values.size(); k++)
+				{
+					auto range = removed_by_fingerprint.equal_range(json_fingerprint(inserted_values[k].second));
+					for (auto i = range.first; i != range.second; i++)
+					{
+						if (!json_equal(removed[i->second].second, inserted_values[k].second))
+							continue;
+						removed_kept[i->second] = true;
+						inserted_kept[k] = true;
+						kept.push_back(KeptSpan{ removed[i->second].first, inserted_values[k].first, 1 });
+						removed_by_fingerprint.erase(i);
+						break;
+					}
+				}
+			}
+			for (size_t k = 0; k < removed.size(); k++)
+			{
+				if (!removed_kept[k])
+					diff_json_array.push_back(make_array_diff_item("-", removed[k].first, std::move(removed[k].second)));
+			}
+			for (auto& item : modified)
+				diff_json_array.push_back(make_array_diff_item("~", item.first, std::move(item.second)));
+
+			std::sort(kept.begin(), kept.end(), [](const KeptSpan& a, const KeptSpan& b) { return a.source < b.source; });
+			auto in_place = heaviest_increasing_chain(kept);
+			for (size_t k = 0; k < kept.size(); k++)
+			{
+				if (in_place[k])
+					continue;
+				for (size_t i = 0; i < kept[k].length; i++)
+					diff_json_array.push_back(make_array_diff_item(">", kept[k].source + i, (uint64_t)(kept[k].slot + i)));
+			}
+			for (size_t k = 0; k < inserted_values.size(); k++)
+			{
+				if (!inserted_kept[k])
+					diff_json_array.push_back(make_array_diff_item("+", inserted_values[k].first, std::move(inserted_values[k].second)));
+			}
+			if (diff_json_array.size() < 1)
+				return false;
+			diff_json = std::move(diff_json_array);
+			return true;
+		}
+
+	public:
+		explicit DiffComposer(JsonDiff& json_diff)
+			: _json_diff(json_diff), _track_path(!json_diff._array_key_patterns.empty())
+		{
+		}
+
+		// diff_json is only written when the composed diff changes something
+		// @returns true if the composed diff changes something
+		// @throws JsonDiffException
+		bool compose_node(const CompiledDiffNode& first, const CompiledDiffNode& second, JsonValue& diff_json)
+		{
+			if (first.type == DNT_INVALID || second.type == DNT_INVALID)
+				throw JsonDiffException("diffjson format error, can't compose");
+			if (first.type == DNT_REPLACE)
+			{
+				// the second diff applies to the new value the first one holds
+				JsonValue value = *first.new_value;
+				_json_diff.patch_node(value, second, _allocator);
+				return _json_diff.diff_at(_path, *first.old_value, value, diff_json);
+			}
+			if (second.type == DNT_REPLACE)
+			{
+				JsonValue value = *second.old_value;
+				_json_diff.rollback_node(value, first, _allocator);
+				return _json_diff.diff_at(_path, value, *second.new_value, diff_json);
+			}
+			if (first.type != second.type)
+				throw JsonDiffException("diffjson doesn't follow the first diff, can't compose");
+			if (first.type == DNT_STRING_DELTA)
+				return compose_string_delta(first.hunks->get_array(), second.hunks->get_array(), diff_json);
+			if (first.type == DNT_OBJECT)
+				return compose_object(first, second, diff_json);
+			return compose_array(first, second, diff_json);
+		}
+	};
+
+	DiffResultP JsonDiff::compose(const DiffResultP& first, const DiffResultP& second)
+	{
+		if (first->is_undefined() || first->value().is_null())
+			return second;
+		if (second->is_undefined() || second->value().is_null())
+			return first;
+		DiffComposer composer(*this);
+		JsonValue diff_json;
+		if (!composer.compose_node(first->compiled()->root(), second->compiled()->root(), diff_json))
+			return DiffResult::make_undefined_diff_result();
+		return std::make_shared<DiffResult>(std::move(diff_json));
+	}
+
+	DiffResultP JsonDiff::compose(const std::vector<DiffResultP>& diffs)
+	{
+		if (diffs.empty())
+			return DiffResult::make_undefined_diff_result();
+		// composed pairwise level by level, so each diff is merged into log(n) results instead of one growing result
+		std::vector<DiffResultP> level(diffs);
+		while (level.size() > 1)
+		{
+			size_t count = 0;
+			for (size_t i = 0; i < level.size(); i += 2)
+				level[count++] = i + 1 < level.size() ? compose(level[i], level[i + 1]) : level[i];
+			level.resize(count);
+		}
+		return level[0];
+	}
+}
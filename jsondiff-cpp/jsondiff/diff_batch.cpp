@@ -0,0 +1,28 @@
+#include <jsondiff/diff_batch.h>
+
+namespace jsondiff
+{
+	DiffBatchScratch::DiffBatchScratch()
+	{
+	}
+
+	DiffBatchScratch::~DiffBatchScratch()
+	{
+	}
+
+	void DiffBatchScratch::reserve(size_t count)
+	{
+		while (_documents.size() < count)
+			_documents.push_back(std::unique_ptr<NativeJsonDocument>(new NativeJsonDocument()));
+	}
+
+	NativeJsonDocument& DiffBatchScratch::document(size_t i)
+	{
+		return *_documents[i];
+	}
+
+	size_t DiffBatchScratch::size() const
+	{
+		return _documents.size();
+	}
+}
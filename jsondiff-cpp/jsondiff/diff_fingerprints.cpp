@@ -0,0 +1,351 @@
+#include <jsondiff/diff_fingerprints.h>
+#include <jsondiff/exceptions.h>
+#include <jsondiff/helper.h>
+#include <jsondiff/json_pointer.h>
+#include <jsondiff/json_value_traits.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+
+namespace jsondiff
+{
+	// seeds of the site hashes, so a member, an element and an array size with the same value hash apart
+	static const JsonFingerprint member_site_seed = 0x9e3779b97f4a7c15ULL;
+	static const JsonFingerprint item_site_seed = 0xc2b2ae3d27d4eb4fULL;
+	static const JsonFingerprint size_site_seed = 0x165667b19e3779f9ULL;
+	// the value of a member a side doesn't have
+	static const JsonFingerprint absent_fingerprint = 0x27d4eb2f165667c5ULL;
+
+	// hash of a 64 bit value, byte order fixed so the fingerprints of a diff read the same on any machine
+	static JsonFingerprint fingerprint_u64(uint64_t value, JsonFingerprint seed)
+	{
+		char bytes[8];
+		for (size_t i = 0; i < 8; i++)
+			bytes[i] = (char)((value >> (i * 8)) & 0xff);
+		return fingerprint_bytes(bytes, sizeof(bytes), seed);
+	}
+
+	static JsonFingerprint member_site(const std::string& key, JsonFingerprint value_fingerprint)
+	{
+		return fingerprint_u64(value_fingerprint, fingerprint_bytes(key.data(), key.size(), member_site_seed));
+	}
+
+	static JsonFingerprint item_site(size_t pos, JsonFingerprint value_fingerprint)
+	{
+		return fingerprint_u64(value_fingerprint, fingerprint_u64((uint64_t)pos, item_site_seed));
+	}
+
+	static bool is_hex_fingerprint(const JsonValue& json)
+	{
+		if (!json.is_string())
+			return false;
+		const auto& str = json.get_string();
+		if (str.size() != 16)
+			return false;
+		for (auto c : str)
+		{
+			if (!isxdigit((unsigned char)c))
+				return false;
+		}
+		return true;
+	}
+
+	bool is_diff_fingerprints(const JsonValue& json)
+	{
+		if (!json.is_array())
+			return false;
+		const auto& pair = json.get_array();
+		return pair.size() == 2 && is_hex_fingerprint(pair[0]) && is_hex_fingerprint(pair[1]);
+	}
+
+	bool is_diff_fingerprints_item(const JsonValue& json)
+	{
+		if (!json.is_array())
+			return false;
+		const auto& item = json.get_array();
+		return item.size() == 3 && item[0].is_string() && item[0].get_string() == JSONDIFF_ITEM_FINGERPRINTS
+			&& item[1].is_integer() && is_diff_fingerprints(item[2]);
+	}
+
+	bool has_diff_fingerprints(const CompiledDiffNode& root)
+	{
+		if (root.fingerprints)
+			return true;
+		for (const auto& op : root.ops)
+		{
+			if (op.diff && has_diff_fingerprints(*op.diff))
+				return true;
+		}
+		return false;
+	}
+
+	static JsonFingerprint read_fingerprint(const CompiledDiffNode& node, DiffSide side)
+	{
+		return (JsonFingerprint)strtoull(node.fingerprints->get_array()[side].get_string().c_str(), nullptr, 16);
+	}
+
+	static JsonValue fingerprints_json(const JsonFingerprint fingerprints[2])
+	{
+		fc::variants pair;
+		char hex[17];
+		for (size_t i = 0; i < 2; i++)
+		{
+			snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)fingerprints[i]);
+			pair.push_back(JsonValue(std::string(hex)));
+		}
+		return JsonValue(pair);
+	}
+
+	// object and array diffs are checked on their own, other nested diffs are sites of their parent
+	static bool is_nested_node(const CompiledDiffNode& node)
+	{
+		return node.type == DNT_OBJECT || node.type == DNT_ARRAY;
+	}
+
+	// a nested object or array diff and its value in one side. key is set for a member, pos for an element
+	template <typename Value>
+	struct NestedDiff
+	{
+		const CompiledDiffNode* node;
+		const Value* value;
+		const std::string* key;
+		size_t pos;
+	};
+
+	// the positions in the new array of the elements an array diff modifies, by op, in one pass over the sorted ops
+	static std::vector<size_t> modified_item_targets(const CompiledDiffNode& node)
+	{
+		std::vector<size_t> dropped, placed, modified;
+		std::vector<std::pair<size_t, size_t>> moved;
+		for (size_t i = 0; i < node.ops.size(); i++)
+		{
+			const auto& op = node.ops[i];
+			if (op.type == DOT_ITEM_REMOVED)
+				dropped.push_back(op.pos);
+			else if (op.type == DOT_ITEM_INSERTED)
+				placed.push_back(op.pos);
+			else if (op.type == DOT_ITEM_MOVED)
+			{
+				dropped.push_back(op.pos);
+				placed.push_back(op.target);
+				moved.push_back(std::make_pair(op.pos, op.target));
+			}
+			else if (op.type == DOT_ITEM_MODIFIED)
+				modified.push_back(i);
+		}
+		std::vector<size_t> targets(node.ops.size());
+		if (modified.empty())
+			return targets;
+		std::sort(dropped.begin(), dropped.end());
+		std::sort(placed.begin(), placed.end());
+		std::sort(moved.begin(), moved.end());
+		std::sort(modified.begin(), modified.end(), [&](size_t a, size_t b) { return node.ops[a].pos < node.ops[b].pos; });
+		// a modified element can be moved too. the kept elements fill the free slots of the new array in order:
+		// the k-th kept element goes to the k-th free slot
+		size_t dropped_before = 0, placed_before = 0;
+		for (auto i : modified)
+		{
+			auto pos = node.ops[i].pos;
+			auto move = std::lower_bound(moved.begin(), moved.end(), std::make_pair(pos, (size_t)0));
+			if (move != moved.end() && move->first == pos)
+			{
+				targets[i] = move->second;
+				continue;
+			}
+			while (dropped_before < dropped.size() && dropped[dropped_before] < pos)
+				dropped_before++;
+			auto rank = pos - dropped_before;
+			while (placed_before < placed.size() && placed[placed_before] <= rank + placed_before)
+				placed_before++;
+			targets[i] = rank + placed_before;
+		}
+		return targets;
+	}
+
+	// the checksum of the sites of an object or array diff in one side, added to *checksum when it isn't null, and the
+	// nested object and array diffs with their values. false if json isn't the side of the diff
+	template <typename Value>
+	static bool node_sites(const CompiledDiffNode& node, const Value& json, DiffSide side, JsonFingerprint* checksum,
+		std::vector<NestedDiff<Value>>& nested)
+	{
+		typedef JsonValueTraits<Value> Traits;
+		if (node.type == DNT_OBJECT)
+		{
+			if (Traits::type(json) != JVT_OBJECT)
+				return false;
+			const auto& obj = Traits::get_object(json);
+			utils::ObjectKeyIndex<const typename Traits::object_type> index(obj);
+			for (const auto& op : node.ops)
+			{
+				auto found = index.find(op.key);
+				if (op.type == DOT_MEMBER_MODIFIED && is_nested_node(*op.diff))
+				{
+					if (found == index.end())
+						return false;
+					nested.push_back(NestedDiff<Value>{ op.diff.get(), &found->value(), &op.key, 0 });
+					continue;
+				}
+				if (checksum)
+					*checksum += member_site(op.key, found == index.end() ? absent_fingerprint : Traits::fingerprint(found->value()));
+			}
+			return true;
+		}
+		if (Traits::type(json) != JVT_ARRAY)
+			return false;
+		const auto& items = Traits::get_array(json);
+		if (checksum)
+			*checksum += fingerprint_u64((uint64_t)items.size(), size_site_seed);
+		std::vector<size_t> targets;
+		if (side == DS_NEW)
+			targets = modified_item_targets(node);
+		for (size_t i = 0; i < node.ops.size(); i++)
+		{
+			const auto& op = node.ops[i];
+			size_t pos;
+			if (op.type == DOT_ITEM_INVALID || (op.type == DOT_ITEM_INSERTED && side == DS_OLD) || (op.type == DOT_ITEM_REMOVED && side == DS_NEW))
+				continue;
+			else if (op.type == DOT_ITEM_MOVED && side == DS_NEW)
+				pos = op.target;
+			else if (op.type == DOT_ITEM_MODIFIED && side == DS_NEW)
+				pos = targets[i];
+			else
+				pos = op.pos;
+			if (pos >= items.size())
+				return false;
+			if (op.type == DOT_ITEM_MODIFIED && is_nested_node(*op.diff))
+				nested.push_back(NestedDiff<Value>{ op.diff.get(), &items[pos], nullptr, pos });
+			else if (checksum)
+				*checksum += item_site(pos, Traits::fingerprint(items[pos]));
+		}
+		return true;
+	}
+
+	// true if a node has sites of its own. an object diff whose members are all nested object and array diffs has none,
+	// its nested diffs are checked instead
+	static bool has_own_sites(const CompiledDiffNode& node)
+	{
+		if (node.type == DNT_ARRAY)
+			return true;
+		for (const auto& op : node.ops)
+		{
+			if (op.type != DOT_MEMBER_MODIFIED || !is_nested_node(*op.diff))
+				return true;
+		}
+		return false;
+	}
+
+	// children first, the fingerprints of a node are written into its diff json once its nested diffs hold theirs.
+	// the nested diffs of every level are kept on the same two vectors
+	template <typename Value>
+	static void add_node_fingerprints(const CompiledDiffNode& node, const Value& old_json, const Value& new_json,
+		std::vector<NestedDiff<Value>>& old_nested, std::vector<NestedDiff<Value>>& new_nested)
+	{
+		JsonFingerprint fingerprints[2] = { 0, 0 };
+		size_t begin = old_nested.size();
+		if (!node_sites(node, old_json, DS_OLD, &fingerprints[DS_OLD], old_nested)
+			|| !node_sites(node, new_json, DS_NEW, &fingerprints[DS_NEW], new_nested)
+			|| old_nested.size() != new_nested.size())
+			throw JsonDiffException("diffjson isn't the diff of these json values, can't add its fingerprints");
+		size_t end = old_nested.size();
+		for (size_t i = begin; i < end; i++)
+		{
+			auto old_item = old_nested[i];
+			auto new_item = new_nested[i];
+			add_node_fingerprints(*old_item.node, *old_item.value, *new_item.value, old_nested, new_nested);
+		}
+		old_nested.resize(begin);
+		new_nested.resize(begin);
+		if (!has_own_sites(node))
+			return;
+		// the diff json is owned by the caller, the compiled nodes only point into it
+		auto& diff_json = const_cast<JsonValue&>(*node.json);
+		if (node.type == DNT_OBJECT)
+		{
+			// a member named like the fingerprints is changed by this diff, this node goes without them
+			for (const auto& op : node.ops)
+			{
+				if (*op.json_key == JSONDIFF_KEY_FINGERPRINTS)
+					return;
+			}
+			fc::mutable_variant_object diff_json_obj(diff_json.get_object());
+			diff_json_obj.set(JSONDIFF_KEY_FINGERPRINTS, fingerprints_json(fingerprints));
+			diff_json = std::move(diff_json_obj);
+		}
+		else
+			diff_json.get_array().push_back(make_array_diff_item(JSONDIFF_ITEM_FINGERPRINTS, 0, fingerprints_json(fingerprints)));
+	}
+
+	template <typename Value>
+	void add_diff_fingerprints(JsonValue& diff_json, const Value& old_json, const Value& new_json)
+	{
+		typedef JsonValueTraits<Value> Traits;
+		CompiledDiffNode root;
+		CompiledDiff::compile_node(diff_json, root);
+		if (root.type == DNT_REPLACE)
+		{
+			JsonFingerprint fingerprints[2] = { Traits::fingerprint(old_json), Traits::fingerprint(new_json) };
+			fc::mutable_variant_object diff_json_obj(diff_json.get_object());
+			diff_json_obj.set(JSONDIFF_KEY_FINGERPRINTS, fingerprints_json(fingerprints));
+			diff_json = std::move(diff_json_obj);
+		}
+		else if (is_nested_node(root))
+		{
+			std::vector<NestedDiff<Value>> old_nested, new_nested;
+			add_node_fingerprints(root, old_json, new_json, old_nested, new_nested);
+		}
+	}
+
+	// false if json doesn't match the fingerprints of node or of a nested diff, failed_path gets the tokens of the path
+	// to the node that doesn't, innermost first. the nested diffs of every level are kept on the same vector
+	template <typename Value>
+	static bool verify_node(const Value& json, const CompiledDiffNode& node, DiffSide side, std::vector<NestedDiff<Value>>& nested,
+		std::vector<std::string>& failed_path)
+	{
+		typedef JsonValueTraits<Value> Traits;
+		if (node.type == DNT_REPLACE)
+			return !node.fingerprints || Traits::fingerprint(json) == read_fingerprint(node, side);
+		if (!is_nested_node(node))
+			return true;
+		JsonFingerprint checksum = 0;
+		size_t begin = nested.size();
+		if (!node_sites(node, json, side, node.fingerprints ? &checksum : nullptr, nested))
+		{
+			// a node without fingerprints that doesn't fit json is left to the patch to report
+			nested.resize(begin);
+			return !node.fingerprints;
+		}
+		bool matches = !node.fingerprints || checksum == read_fingerprint(node, side);
+		size_t end = nested.size();
+		for (size_t i = begin; matches && i < end; i++)
+		{
+			auto item = nested[i];
+			if (!verify_node(*item.value, *item.node, side, nested, failed_path))
+			{
+				failed_path.push_back(item.key ? *item.key : std::to_string(item.pos));
+				matches = false;
+			}
+		}
+		nested.resize(begin);
+		return matches;
+	}
+
+	template <typename Value>
+	void verify_diff_fingerprints(const Value& json, const CompiledDiffNode& root, DiffSide side, const char* document_name)
+	{
+		std::vector<NestedDiff<Value>> nested;
+		std::vector<std::string> failed_path;
+		if (verify_node(json, root, side, nested, failed_path))
+			return;
+		std::string path;
+		for (auto i = failed_path.rbegin(); i != failed_path.rend(); i++)
+			path.append("/").append(json_pointer_escape(*i));
+		throw JsonDiffException(std::string(document_name) + " doesn't match the fingerprints of the diff at \"" + path + "\"");
+	}
+
+	template void add_diff_fingerprints(JsonValue& diff_json, const JsonValue& old_json, const JsonValue& new_json);
+	template void add_diff_fingerprints(JsonValue& diff_json, const NativeJsonValue& old_json, const NativeJsonValue& new_json);
+	template void verify_diff_fingerprints(const JsonValue& json, const CompiledDiffNode& root, DiffSide side, const char* document_name);
+	template void verify_diff_fingerprints(const NativeJsonValue& json, const CompiledDiffNode& root, DiffSide side, const char* document_name);
+}
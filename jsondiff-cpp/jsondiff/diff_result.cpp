@@ -1,6 +1,10 @@
 #include <jsondiff/diff_result.h>
 #include <jsondiff/json_value_types.h>
 #include <jsondiff/helper.h>
+#include <jsondiff/binary_format.h>
+#include <jsondiff/json_writer.h>
+#include <atomic>
+#include <cstdio>
 #include <sstream>
 
 namespace jsondiff
@@ -19,6 +23,12 @@ namespace jsondiff
 			_is_undefined = false;
 	}
 
+	DiffResult::DiffResult(JsonValue&& diff_json) :
+		_diff_json(std::move(diff_json))
+	{
+		_is_undefined = _diff_json.is_null();
+	}
+
 	std::shared_ptr<DiffResult> DiffResult::make_undefined_diff_result()
 	{
 		auto result = std::make_shared<DiffResult>();
@@ -28,12 +38,33 @@ namespace jsondiff
 
 	std::string DiffResult::str() const
 	{
-		return json_dumps(_diff_json);
+		std::ostringstream out;
+		write_json(out);
+		return out.str();
+	}
+
+	std::string DiffResult::binary() const
+	{
+		std::string out;
+		encode_binary_diff(_diff_json, out);
+		return out;
+	}
+
+	std::shared_ptr<DiffResult> DiffResult::from_binary(const char* data, size_t size)
+	{
+		return std::make_shared<DiffResult>(decode_binary_diff(data, size));
+	}
+
+	std::shared_ptr<DiffResult> DiffResult::from_binary(const std::string& data)
+	{
+		return from_binary(data.data(), data.size());
 	}
 
 	std::string DiffResult::pretty_str() const
 	{
-		return json_pretty_dumps(_diff_json);
+		std::ostringstream out;
+		write_pretty_json(out);
+		return out.str();
 	}
 
 	bool DiffResult::is_undefined() const
@@ -41,108 +72,153 @@ namespace jsondiff
 		return _is_undefined;
 	}
 
-	JsonValue DiffResult::value() const
+	const JsonValue& DiffResult::value() const
 	{
 		return _diff_json;
 	}
 
-	std::string DiffResult::pretty_diff_str(size_t indent_count) const
+	CompiledDiffP DiffResult::compiled() const
+	{
+		auto result = std::atomic_load(&_compiled);
+		if (result)
+			return result;
+		// built at most a few times if threads race, any of the results is fine
+		result = std::make_shared<CompiledDiff>(_diff_json);
+		std::atomic_store(&_compiled, result);
+		return result;
+	}
+
+	static void write_pretty_diff(JsonWriter& writer, const CompiledDiffNode& node, size_t indent_count)
 	{
-		// TODO: indents
-		std::stringstream indent_ss;
-		for (size_t i = 0; i < indent_count; i++)
-			indent_ss << "\t";
-		auto indents = indent_ss.str();
-		auto diff_json_type = guess_json_value_type(_diff_json);
-		std::stringstream ss;
-		if (is_scalar_json_value_type(diff_json_type))
+		if (node.type == DNT_REPLACE)
 		{
-			// 
-			ss << indents  << " " << json_dumps(_diff_json);
-			return ss.str();
+			//  {__old: ..., __new: ...}ʽʱ
+			writer.put('\t', indent_count);
+			writer.put('-');
+			writer.write_json(*node.old_value);
+			writer.put('\n');
+			writer.put('\t', indent_count);
+			writer.put('+');
+			writer.write_json(*node.new_value);
+			writer.put('\n');
 		}
-		else if (diff_json_type == JsonValueType::JVT_OBJECT)
+		else if (node.type == DNT_STRING_DELTA)
 		{
-			auto diff_json_obj = _diff_json.as<fc::mutable_variant_object>();
-			if (is_scalar_value_diff_format(_diff_json))
+			// each hunk as its byte offset and its old and new text
+			for (const auto& hunk_json : node.hunks->get_array())
 			{
-				//  {__old: ..., __new: ...}ʽʱ
-				ss << indents << "-" << json_dumps(diff_json_obj[JSONDIFF_KEY_OLD_VALUE]) << std::endl;
-				ss << indents << "+" << json_dumps(diff_json_obj[JSONDIFF_KEY_NEW_VALUE]) << std::endl;
-				return ss.str();
+				const auto& hunk = hunk_json.get_array();
+				char text[32];
+				int size = snprintf(text, sizeof(text), "@%llu\n", (unsigned long long)hunk[0].as_uint64());
+				writer.put('\t', indent_count);
+				writer.write(text, (size_t)size);
+				writer.put('\t', indent_count);
+				writer.put('-');
+				writer.write_json(hunk[1]);
+				writer.put('\n');
+				writer.put('\t', indent_count);
+				writer.put('+');
+				writer.write_json(hunk[2]);
+				writer.put('\n');
 			}
-			for (auto i = diff_json_obj.begin(); i != diff_json_obj.end(); i++)
+		}
+		else if (node.type == DNT_OBJECT)
+		{
+			for (const auto& op : node.ops)
 			{
-				auto key = i->key();
-				auto diff_item = i->value();
+				writer.put('\t', indent_count + 1);
 				// key <key>__deleted  <key>__addedɾӣ޸keyֵ
-				if (utils::string_ends_with(key, JSONDIFF_KEY_ADDED_POSTFIX) && key.size() > strlen(JSONDIFF_KEY_ADDED_POSTFIX))
+				if (op.type == DOT_MEMBER_ADDED || op.type == DOT_MEMBER_DELETED)
 				{
-					auto origin_key = utils::string_without_ext(key, JSONDIFF_KEY_ADDED_POSTFIX);
-					ss << indents << "\t+" << origin_key << ":" << json_dumps(diff_item) << std::endl;
-					continue;
+					writer.put(op.type == DOT_MEMBER_ADDED ? '+' : '-');
+					writer.write(op.key);
+					writer.put(':');
+					writer.write_json(*op.value);
+					writer.put('\n');
 				}
-				else if (utils::string_ends_with(key, JSONDIFF_KEY_DELETED_POSTFIX) && key.size() > strlen(JSONDIFF_KEY_DELETED_POSTFIX))
+				else
 				{
-					auto origin_key = utils::string_without_ext(key, JSONDIFF_KEY_DELETED_POSTFIX);
-					ss << indents << "\t-" << origin_key << ":" << json_dumps(diff_item) << std::endl;
-					continue;
+					// ޸keyֵ
+					writer.write(op.key);
+					writer.write(":\n", 2);
+					write_pretty_diff(writer, *op.diff, indent_count + 1);
+					writer.put('\n');
 				}
-				// ޸keyֵ
-				ss << indents << "\t" << key << ":" << std::endl << std::make_shared<DiffResult>(diff_item)->pretty_diff_str(indent_count+1) << std::endl;
 			}
-			return ss.str();
 		}
-		else if (diff_json_type == JsonValueType::JVT_ARRAY)
+		else if (node.type == DNT_ARRAY)
 		{
-			auto diff_json_array = _diff_json.as<fc::variants>();
-			for (size_t i = 0; i < diff_json_array.size(); i++)
+			for (const auto& op : node.ops)
 			{
-				if (!diff_json_array[i].is_array())
-				{
-					ss << indents << "\t " << json_dumps(diff_json_array[i]) << std::endl;
-					continue;
-				}
-				auto diff_item = diff_json_array[i].as<fc::variants>();
-				if (diff_item.size() != 3)
-				{
-					ss << indents << "\t " << json_dumps(diff_json_array[i]) << std::endl;
-					continue;
-				}
-				auto op_item = diff_item[0].as_string();
-				auto pos = diff_item[1].as_uint64();
-				auto inner_diff_json = diff_item[2];
-				// FIXME һarrayж仯ʱ diffԭʼindexӦҳ pos => old_jsonֵͬpos
-				if (op_item == std::string("+"))
+				writer.put('\t', indent_count + 1);
+				switch (op.type)
 				{
+				case DOT_ITEM_INSERTED:
 					// Ԫ
-					ss << indents << "\t+" << json_dumps(inner_diff_json) << std::endl;
-				}
-				else if (op_item == std::string("-"))
-				{
+					writer.put('+');
+					writer.write_json(*op.value);
+					writer.put('\n');
+					break;
+				case DOT_ITEM_REMOVED:
 					// ɾԪ
-					ss << indents << "\t-" << json_dumps(inner_diff_json) << std::endl;
-				}
-				else if (op_item == std::string("~"))
-				{
+					writer.put('-');
+					writer.write_json(*op.value);
+					writer.put('\n');
+					break;
+				case DOT_ITEM_MODIFIED:
 					// ޸Ԫ
-					ss << indents << "\t~" << std::endl << std::make_shared<DiffResult>(inner_diff_json)->pretty_diff_str(indent_count+1) << std::endl;
-				}
-				else
+					writer.write("~\n", 2);
+					write_pretty_diff(writer, *op.diff, indent_count + 1);
+					writer.put('\n');
+					break;
+				case DOT_ITEM_MOVED:
 				{
-					ss << indents << "\t " << json_dumps(diff_json_array[i]) << std::endl;
-					continue;
+					// element moved from index pos to index target
+					char text[48];
+					int size = snprintf(text, sizeof(text), ">%llu=>%llu\n", (unsigned long long)op.pos, (unsigned long long)op.target);
+					writer.write(text, (size_t)size);
+					break;
+				}
+				default:
+					writer.put(' ');
+					writer.write_json(*op.value);
+					writer.put('\n');
+					break;
 				}
 			}
-			return ss.str();
 		}
 		else
 		{
-			ss << indents << json_dumps(_diff_json);
-			return ss.str();
+			// 
+			writer.put('\t', indent_count);
+			writer.put(' ');
+			writer.write_json(*node.json);
 		}
 	}
 
+	void DiffResult::write_json(std::ostream& out) const
+	{
+		json_write(out, _diff_json);
+	}
+
+	void DiffResult::write_pretty_json(std::ostream& out) const
+	{
+		json_pretty_write(out, _diff_json);
+	}
+
+	void DiffResult::write_pretty_diff(std::ostream& out, size_t indent_count) const
+	{
+		JsonWriter writer(out);
+		jsondiff::write_pretty_diff(writer, compiled()->root(), indent_count);
+	}
+
+	std::string DiffResult::pretty_diff_str(size_t indent_count) const
+	{
+		std::ostringstream out;
+		write_pretty_diff(out, indent_count);
+		return out.str();
+	}
+
 	DiffResult::~DiffResult()
 	{
 
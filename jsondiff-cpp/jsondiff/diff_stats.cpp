@@ -0,0 +1,89 @@
+#include <jsondiff/diff_stats.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace jsondiff
+{
+	DiffStats::DiffStats()
+	{
+		memset(this, 0, sizeof(*this));
+		operation = DSO_DIFF;
+	}
+
+	DiffStats::DiffStats(DiffStatsOperation operation_)
+	{
+		memset(this, 0, sizeof(*this));
+		operation = operation_;
+	}
+
+	void DiffStats::merge(const DiffStats& other)
+	{
+		calls += other.calls;
+		for (size_t i = 0; i <= JVT_ARRAY; i++)
+			visited[i] += other.visited[i];
+		skipped_equal += other.skipped_equal;
+		max_depth = std::max(max_depth, other.max_depth);
+		for (size_t i = 0; i < JSONDIFF_STATS_FANOUT_BUCKETS; i++)
+		{
+			object_fanout[i] += other.object_fanout[i];
+			array_fanout[i] += other.array_fanout[i];
+		}
+		changes += other.changes;
+		diff_values += other.diff_values;
+		output_bytes += other.output_bytes;
+		parse_ns += other.parse_ns;
+		diff_ns += other.diff_ns;
+		serialize_ns += other.serialize_ns;
+	}
+
+	size_t DiffStats::fanout_bucket(size_t count)
+	{
+		size_t bucket = 0;
+		while (count > 0 && bucket < JSONDIFF_STATS_FANOUT_BUCKETS - 1)
+		{
+			count >>= 1;
+			bucket++;
+		}
+		return bucket;
+	}
+
+	DiffStatsCollector::DiffStatsCollector()
+	{
+		for (int i = 0; i <= DSO_ROLLBACK; i++)
+			_totals[i].operation = (DiffStatsOperation)i;
+	}
+
+	DiffStatsCollector::DiffStatsCollector(const std::function<void(const DiffStats&)>& callback)
+		: DiffStatsCollector()
+	{
+		_callback = callback;
+	}
+
+	DiffStatsCollector::~DiffStatsCollector()
+	{
+	}
+
+	void DiffStatsCollector::record(const DiffStats& stats)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_totals[stats.operation].merge(stats);
+		}
+		if (_callback)
+			_callback(stats);
+	}
+
+	DiffStats DiffStatsCollector::total(DiffStatsOperation operation) const
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _totals[operation];
+	}
+
+	void DiffStatsCollector::reset()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (int i = 0; i <= DSO_ROLLBACK; i++)
+			_totals[i] = DiffStats((DiffStatsOperation)i);
+	}
+}
@@ -0,0 +1,229 @@
+#include <jsondiff/fingerprint.h>
+#include <jsondiff/exceptions.h>
+#include <jsondiff/native_json.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace jsondiff
+{
+	static const uint64_t FINGERPRINT_NULL_TAG = 0x6a09e667f3bcc908ULL;
+	static const uint64_t FINGERPRINT_BOOL_TAG = 0xbb67ae8584caa73bULL;
+	static const uint64_t FINGERPRINT_INTEGER_TAG = 0x3c6ef372fe94f82bULL;
+	static const uint64_t FINGERPRINT_FLOAT_TAG = 0xa54ff53a5f1d36f1ULL;
+	static const uint64_t FINGERPRINT_STRING_TAG = 0x510e527fade682d1ULL;
+	static const uint64_t FINGERPRINT_ARRAY_TAG = 0x9b05688c2b3e6c1fULL;
+	static const uint64_t FINGERPRINT_OBJECT_TAG = 0x1f83d9abfb41bd6bULL;
+	static const uint64_t FINGERPRINT_MULTIPLIER = 0x9e3779b97f4a7c15ULL;
+
+	static inline uint64_t fingerprint_mix(uint64_t x)
+	{
+		x ^= x >> 33;
+		x *= 0xff51afd7ed558ccdULL;
+		x ^= x >> 33;
+		x *= 0xc4ceb9fe1a85ec53ULL;
+		x ^= x >> 33;
+		return x;
+	}
+
+	JsonFingerprint fingerprint_bytes(const char* data, size_t size, JsonFingerprint seed)
+	{
+		uint64_t h = seed ^ (size * FINGERPRINT_MULTIPLIER);
+		size_t i = 0;
+		for (; i + 8 <= size; i += 8)
+		{
+			uint64_t chunk;
+			memcpy(&chunk, data + i, 8);
+			h = (h ^ fingerprint_mix(chunk)) * FINGERPRINT_MULTIPLIER;
+			h = (h << 27) | (h >> 37);
+		}
+		uint64_t tail = 0;
+		for (size_t shift = 0; i < size; i++, shift += 8)
+			tail |= (uint64_t)(unsigned char)data[i] << shift;
+		return fingerprint_mix(h ^ fingerprint_mix(tail ^ FINGERPRINT_STRING_TAG));
+	}
+
+	static JsonFingerprint bool_fingerprint(bool value)
+	{
+		return fingerprint_mix(FINGERPRINT_BOOL_TAG ^ (value ? 1 : 0));
+	}
+
+	static JsonFingerprint uint64_fingerprint(uint64_t value)
+	{
+		return fingerprint_mix(FINGERPRINT_INTEGER_TAG ^ fingerprint_mix(value));
+	}
+
+	static JsonFingerprint int64_fingerprint(int64_t value)
+	{
+		if (value < 0)
+			return fingerprint_mix(FINGERPRINT_INTEGER_TAG ^ fingerprint_mix(~(uint64_t)value) ^ FINGERPRINT_MULTIPLIER);
+		// the same non-negative number stored as int64 or uint64 has the same fingerprint
+		return uint64_fingerprint((uint64_t)value);
+	}
+
+	static JsonFingerprint double_fingerprint(double value)
+	{
+		// a float holding an integer equals that integer, and 0.0 equals -0.0
+		if (value >= -9223372036854775808.0 && value < 0 && (double)(int64_t)value == value)
+			return int64_fingerprint((int64_t)value);
+		if (value >= 0 && value < 18446744073709551616.0 && (double)(uint64_t)value == value)
+			return uint64_fingerprint((uint64_t)value);
+		uint64_t bits;
+		if (std::isnan(value))
+			value = NAN;
+		memcpy(&bits, &value, sizeof(bits));
+		return fingerprint_mix(FINGERPRINT_FLOAT_TAG ^ fingerprint_mix(bits));
+	}
+
+	static JsonFingerprint scalar_fingerprint(const JsonValue& json_value)
+	{
+		switch (json_value.get_type())
+		{
+		case fc::variant::null_type:
+			return FINGERPRINT_NULL_TAG;
+		case fc::variant::bool_type:
+			return bool_fingerprint(json_value.as_bool());
+		case fc::variant::int64_type:
+			return int64_fingerprint(json_value.as_int64());
+		case fc::variant::uint64_type:
+			return uint64_fingerprint(json_value.as_uint64());
+		case fc::variant::double_type:
+			return double_fingerprint(json_value.as_double());
+		case fc::variant::string_type:
+		{
+			const auto& str = json_value.get_string();
+			return fingerprint_bytes(str.data(), str.size());
+		}
+		default:
+			throw JsonDiffException(std::string("not supported json value type to fingerprint ") + json_dumps(json_value));
+		}
+	}
+
+	static JsonFingerprint scalar_fingerprint(const NativeJsonValue& json_value)
+	{
+		switch (json_value.get_type())
+		{
+		case NJT_NULL:
+			return FINGERPRINT_NULL_TAG;
+		case NJT_BOOL:
+			return bool_fingerprint(json_value.as_bool());
+		case NJT_INT64:
+			return int64_fingerprint(json_value.as_int64());
+		case NJT_UINT64:
+			return uint64_fingerprint(json_value.as_uint64());
+		case NJT_DOUBLE:
+			return double_fingerprint(json_value.as_double());
+		case NJT_STRING:
+		{
+			const auto& str = json_value.get_string();
+			return fingerprint_bytes(str.data(), str.size());
+		}
+		default:
+			throw JsonDiffException("not supported json value type to fingerprint");
+		}
+	}
+
+	template <typename Value>
+	static JsonFingerprint compute_fingerprint(const Value& json_value, std::unordered_map<const Value*, JsonFingerprint>* cache)
+	{
+		if (!json_value.is_object() && !json_value.is_array())
+			return scalar_fingerprint(json_value);
+		if (cache)
+		{
+			auto found = cache->find(&json_value);
+			if (found != cache->end())
+				return found->second;
+		}
+		uint64_t h;
+		if (json_value.is_array())
+		{
+			// order dependent
+			const auto& items = json_value.get_array();
+			h = FINGERPRINT_ARRAY_TAG ^ (items.size() * FINGERPRINT_MULTIPLIER);
+			for (const auto& item : items)
+			{
+				h = (h ^ compute_fingerprint(item, cache)) * FINGERPRINT_MULTIPLIER;
+				h = (h << 31) | (h >> 33);
+			}
+		}
+		else
+		{
+			// order independent, the diff matches object members by key. the member fingerprints are chained in sorted
+			// order rather than added up, a sum would let members be picked to cancel each other out
+			const auto& obj = json_value.get_object();
+			std::vector<uint64_t> members;
+			members.reserve(obj.size());
+			for (auto i = obj.begin(); i != obj.end(); i++)
+			{
+				const auto& key = i->key();
+				auto key_fingerprint = fingerprint_bytes(key.data(), key.size(), FINGERPRINT_OBJECT_TAG);
+				members.push_back(fingerprint_mix(key_fingerprint ^ (compute_fingerprint(i->value(), cache) * FINGERPRINT_MULTIPLIER)));
+			}
+			std::sort(members.begin(), members.end());
+			h = FINGERPRINT_OBJECT_TAG ^ (obj.size() * FINGERPRINT_MULTIPLIER);
+			for (auto member : members)
+			{
+				h = (h ^ member) * FINGERPRINT_MULTIPLIER;
+				h = (h << 29) | (h >> 35);
+			}
+		}
+		auto result = fingerprint_mix(h);
+		if (cache)
+			(*cache)[&json_value] = result;
+		return result;
+	}
+
+	JsonFingerprint json_fingerprint(const JsonValue& json_value)
+	{
+		return compute_fingerprint<JsonValue>(json_value, nullptr);
+	}
+
+	JsonFingerprint json_fingerprint(const NativeJsonValue& json_value)
+	{
+		return compute_fingerprint<NativeJsonValue>(json_value, nullptr);
+	}
+
+	bool json_shares_storage(const JsonValue& a, const JsonValue& b)
+	{
+		if (&a == &b)
+			return true;
+		if (!a.is_object() || !b.is_object())
+			return false;
+		// fc objects are immutable and share their entries between copies
+		const auto& a_obj = a.get_object();
+		const auto& b_obj = b.get_object();
+		return a_obj.size() > 0 && a_obj.size() == b_obj.size() && &*a_obj.begin() == &*b_obj.begin();
+	}
+
+	JsonFingerprintCache::JsonFingerprintCache()
+	{
+	}
+
+	JsonFingerprintCache::~JsonFingerprintCache()
+	{
+	}
+
+	JsonFingerprint JsonFingerprintCache::fingerprint(const JsonValue& json_value)
+	{
+		return compute_fingerprint<JsonValue>(json_value, &_fingerprints);
+	}
+
+	bool JsonFingerprintCache::equal(const JsonValue& json_value, JsonFingerprintCache& other_cache, const JsonValue& other_json_value)
+	{
+		if (json_shares_storage(json_value, other_json_value))
+			return true;
+		return fingerprint(json_value) == other_cache.fingerprint(other_json_value);
+	}
+
+	size_t JsonFingerprintCache::size() const
+	{
+		return _fingerprints.size();
+	}
+
+	void JsonFingerprintCache::clear()
+	{
+		_fingerprints.clear();
+	}
+}
@@ -1,21 +1,48 @@
 #include <jsondiff/helper.h>
 #include <boost/algorithm/string/predicate.hpp>
+#include <algorithm>
 
 namespace jsondiff
 {
 	namespace utils
 	{
-		bool string_ends_with(std::string str, std::string end)
+		bool string_ends_with(const std::string& str, const std::string& end)
 		{
-			auto pos = str.find(end);
-			return pos >= 0 && (pos + end.size() == str.size());
+			return str.size() >= end.size() && str.compare(str.size() - end.size(), end.size(), end) == 0;
 		}
 
-		std::string string_without_ext(std::string str, std::string ext)
+		std::string string_without_ext(const std::string& str, const std::string& ext)
 		{
 			if (!string_ends_with(str, ext))
 				return str;
 			return str.substr(0, str.size() - ext.size());
 		}
+
+		void append_object_entries(fc::mutable_variant_object& obj, std::vector<fc::mutable_variant_object::entry>& entries,
+			size_t first)
+		{
+			if (first >= entries.size())
+				return;
+			obj.reserve(obj.size() + entries.size() - first);
+			for (size_t i = first; i < entries.size(); i++)
+				obj(entries[i].key(), std::move(entries[i].value()));
+		}
+
+		void replace_object_entries(fc::mutable_variant_object& obj, const std::vector<bool>& removed,
+			std::vector<fc::mutable_variant_object::entry>& appended)
+		{
+			// fc objects have no bulk erase, so the kept and appended entries are moved into a new object
+			fc::mutable_variant_object result;
+			result.reserve(obj.size() + appended.size());
+			size_t i = 0;
+			for (auto& entry : obj)
+			{
+				if (i >= removed.size() || !removed[i])
+					result(entry.key(), std::move(entry.value()));
+				i++;
+			}
+			append_object_entries(result, appended);
+			obj = std::move(result);
+		}
 	}
 }
@@ -0,0 +1,713 @@
+#include <jsondiff/json_patch.h>
+#include <jsondiff/jsondiff.h>
+#include <jsondiff/diff_fingerprints.h>
+#include <jsondiff/exceptions.h>
+#include <jsondiff/helper.h>
+#include <jsondiff/json_pointer.h>
+#include <jsondiff/string_delta.h>
+#include <jsondiff/json_writer.h>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fc/variant.hpp>
+#include <fc/variant_object.hpp>
+
+namespace jsondiff
+{
+	static const char* mismatch_error = "diff doesn't match the documents";
+
+	// append one reference token to a json pointer
+	static void append_pointer_token(std::string& path, const char* token, size_t size)
+	{
+		path.push_back('/');
+		for (size_t i = 0; i < size; i++)
+		{
+			if (token[i] == '~')
+				path.append("~0");
+			else if (token[i] == '/')
+				path.append("~1");
+			else
+				path.push_back(token[i]);
+		}
+	}
+
+	static void append_pointer_index(std::string& path, size_t index)
+	{
+		path.push_back('/');
+		path.append(std::to_string(index));
+	}
+
+	// the node type of a diff json, decoded the way CompiledDiff::compile_node does it without building the node.
+	// new_value is set for DNT_REPLACE
+	static DiffNodeType diff_node_type(const JsonValue& diff_json, const JsonValue*& new_value)
+	{
+		if (diff_json.is_array())
+			return DNT_ARRAY;
+		if (!diff_json.is_object())
+			return DNT_INVALID;
+		const auto& diff_json_obj = diff_json.get_object();
+		auto old_found = diff_json_obj.find(JSONDIFF_KEY_OLD_VALUE);
+		auto new_found = diff_json_obj.find(JSONDIFF_KEY_NEW_VALUE);
+		if (old_found != diff_json_obj.end() && new_found != diff_json_obj.end())
+		{
+			new_value = &new_found->value();
+			return DNT_REPLACE;
+		}
+		auto hunks = diff_json_obj.find(JSONDIFF_KEY_STRING_DELTA);
+		if (diff_json_obj.size() == 1 && hunks != diff_json_obj.end() && is_string_delta_hunks(hunks->value()))
+			return DNT_STRING_DELTA;
+		return DNT_OBJECT;
+	}
+
+	// the op of a member of an object diff json, name_size is the size of the member key without its suffix
+	static DiffOpType member_op_type(const std::string& key, size_t& name_size)
+	{
+		static const size_t added_postfix_size = strlen(JSONDIFF_KEY_ADDED_POSTFIX);
+		static const size_t deleted_postfix_size = strlen(JSONDIFF_KEY_DELETED_POSTFIX);
+		if (key.size() > added_postfix_size && utils::string_ends_with(key, JSONDIFF_KEY_ADDED_POSTFIX))
+		{
+			name_size = key.size() - added_postfix_size;
+			return DOT_MEMBER_ADDED;
+		}
+		if (key.size() > deleted_postfix_size && utils::string_ends_with(key, JSONDIFF_KEY_DELETED_POSTFIX))
+		{
+			name_size = key.size() - deleted_postfix_size;
+			return DOT_MEMBER_DELETED;
+		}
+		name_size = key.size();
+		return DOT_MEMBER_MODIFIED;
+	}
+
+	// the op, position and item of an entry of an array diff json, DOT_ITEM_INVALID if it isn't one
+	static DiffOpType array_op_type(const JsonValue& entry_json, size_t& pos, const JsonValue*& item)
+	{
+		if (!entry_json.is_array())
+			return DOT_ITEM_INVALID;
+		const auto& entry = entry_json.get_array();
+		if (entry.size() != 3 || !entry[0].is_string() || !entry[1].is_integer() || entry[0].get_string().size() != 1)
+			return DOT_ITEM_INVALID;
+		pos = (size_t)entry[1].as_uint64();
+		item = &entry[2];
+		switch (entry[0].get_string()[0])
+		{
+		case '+':
+			return DOT_ITEM_INSERTED;
+		case '-':
+			return DOT_ITEM_REMOVED;
+		case '~':
+			return DOT_ITEM_MODIFIED;
+		case '>':
+			return entry[2].is_integer() ? DOT_ITEM_MOVED : DOT_ITEM_INVALID;
+		default:
+			return DOT_ITEM_INVALID;
+		}
+	}
+
+	// the value of key in an object of a document, through the key index of the object
+	static const JsonValue& find_member(const utils::ObjectKeyIndex<const fc::variant_object>& index, const std::string& key)
+	{
+		auto found = index.find(key);
+		if (found == index.end())
+			throw JsonDiffException(mismatch_error);
+		return found->value();
+	}
+
+	// writes the operations of a diff json as it walks it, the json pointer of the current node is kept in one string
+	class JsonPatchWriter
+	{
+	private:
+		JsonWriter _writer;
+		std::string _path;
+		bool _first;
+
+		void write_op(const char* op, const JsonValue* value)
+		{
+			if (!_first)
+				_writer.put(',');
+			_first = false;
+			_writer.write("{\"op\":\"", 7);
+			_writer.write(op, strlen(op));
+			_writer.write("\",\"path\":", 9);
+			_writer.write_string(_path);
+			if (value)
+			{
+				_writer.write(",\"value\":", 9);
+				_writer.write_json(*value);
+			}
+			_writer.put('}');
+		}
+
+		void write_object(const JsonValue& diff_json, const JsonValue& old_json, const JsonValue& new_json)
+		{
+			if (!old_json.is_object() || !new_json.is_object())
+				throw JsonDiffException(mismatch_error);
+			const auto& diff_json_obj = diff_json.get_object();
+			utils::ObjectKeyIndex<const fc::variant_object> old_index(old_json.get_object());
+			utils::ObjectKeyIndex<const fc::variant_object> new_index(new_json.get_object());
+			size_t path_size = _path.size();
+			for (const auto& member : diff_json_obj)
+			{
+				const auto& key = member.key();
+				if (key == JSONDIFF_KEY_FINGERPRINTS && is_diff_fingerprints(member.value()))
+					continue;
+				size_t name_size;
+				auto type = member_op_type(key, name_size);
+				append_pointer_token(_path, key.data(), name_size);
+				if (type == DOT_MEMBER_ADDED)
+					write_op("add", &member.value());
+				else if (type == DOT_MEMBER_DELETED)
+					write_op("remove", nullptr);
+				else
+					write_node(member.value(), find_member(old_index, key), find_member(new_index, key));
+				_path.resize(path_size);
+			}
+		}
+
+		void write_array(const JsonValue& diff_json, const JsonValue& old_json, const JsonValue& new_json)
+		{
+			if (!old_json.is_array() || !new_json.is_array())
+				throw JsonDiffException(mismatch_error);
+			const auto& old_items = old_json.get_array();
+			const auto& new_items = new_json.get_array();
+			// old positions of the removed and moved away elements, new positions and values of the inserted and moved ones
+			std::vector<size_t> dropped;
+			std::vector<std::pair<size_t, const JsonValue*>> placed;
+			// old positions and nested diffs of the modified elements
+			std::vector<std::pair<size_t, const JsonValue*>> modified;
+			for (const auto& entry_json : diff_json.get_array())
+			{
+				if (is_diff_fingerprints_item(entry_json))
+					continue;
+				size_t pos;
+				const JsonValue* item;
+				auto type = array_op_type(entry_json, pos, item);
+				if (type == DOT_ITEM_INSERTED && pos < new_items.size())
+					placed.push_back(std::make_pair(pos, item));
+				else if (type == DOT_ITEM_REMOVED && pos < old_items.size())
+					dropped.push_back(pos);
+				else if (type == DOT_ITEM_MODIFIED && pos < old_items.size())
+					modified.push_back(std::make_pair(pos, item));
+				else if (type == DOT_ITEM_MOVED && pos < old_items.size() && item->as_uint64() < new_items.size())
+				{
+					size_t target = (size_t)item->as_uint64();
+					dropped.push_back(pos);
+					placed.push_back(std::make_pair(target, &new_items[target]));
+				}
+				else
+					throw JsonDiffException(mismatch_error);
+			}
+			if (old_items.size() - dropped.size() + placed.size() != new_items.size())
+				throw JsonDiffException(mismatch_error);
+			size_t path_size = _path.size();
+			// the modified elements first, while they are still at their old positions. a moved element is added
+			// whole at its target instead, and the kept elements fill the other slots of the new array in order
+			if (!modified.empty())
+			{
+				std::vector<bool> old_taken(old_items.size(), false);
+				std::vector<bool> new_taken(new_items.size(), false);
+				for (auto pos : dropped)
+					old_taken[pos] = true;
+				for (const auto& item : placed)
+					new_taken[item.first] = true;
+				std::vector<size_t> new_pos(old_items.size(), std::numeric_limits<size_t>::max());
+				size_t j = 0;
+				for (size_t i = 0; i < old_items.size(); i++)
+				{
+					if (old_taken[i])
+						continue;
+					while (j < new_items.size() && new_taken[j])
+						j++;
+					if (j == new_items.size())
+						throw JsonDiffException(mismatch_error);
+					new_pos[i] = j++;
+				}
+				for (const auto& item : modified)
+				{
+					if (old_taken[item.first])
+						continue;
+					append_pointer_index(_path, item.first);
+					write_node(*item.second, old_items[item.first], new_items[new_pos[item.first]]);
+					_path.resize(path_size);
+				}
+			}
+			// removed from the back so the positions of the others don't shift, then added from the front
+			// so each one lands at its final position
+			std::sort(dropped.begin(), dropped.end(), std::greater<size_t>());
+			for (auto pos : dropped)
+			{
+				append_pointer_index(_path, pos);
+				write_op("remove", nullptr);
+				_path.resize(path_size);
+			}
+			std::sort(placed.begin(), placed.end(), [](const std::pair<size_t, const JsonValue*>& a, const std::pair<size_t, const JsonValue*>& b) {
+				return a.first < b.first;
+			});
+			for (const auto& item : placed)
+			{
+				append_pointer_index(_path, item.first);
+				write_op("add", item.second);
+				_path.resize(path_size);
+			}
+		}
+	public:
+		explicit JsonPatchWriter(std::ostream& out)
+			: _writer(out), _first(true)
+		{
+		}
+
+		void write_node(const JsonValue& diff_json, const JsonValue& old_json, const JsonValue& new_json)
+		{
+			const JsonValue* new_value = nullptr;
+			switch (diff_node_type(diff_json, new_value))
+			{
+			case DNT_REPLACE:
+				write_op("replace", new_value);
+				break;
+			case DNT_STRING_DELTA:
+				write_op("replace", &new_json);
+				break;
+			case DNT_OBJECT:
+				write_object(diff_json, old_json, new_json);
+				break;
+			case DNT_ARRAY:
+				write_array(diff_json, old_json, new_json);
+				break;
+			default:
+				throw JsonDiffException("wrong format of diff json");
+			}
+		}
+
+		void write(const DiffResult& diff_info, const JsonValue& old_json, const JsonValue& new_json)
+		{
+			_writer.put('[');
+			if (!diff_info.is_undefined())
+				write_node(diff_info.value(), old_json, new_json);
+			_writer.put(']');
+		}
+	};
+
+	void json_patch_write(std::ostream& out, const DiffResult& diff_info, const JsonValue& old_json, const JsonValue& new_json)
+	{
+		JsonPatchWriter writer(out);
+		writer.write(diff_info, old_json, new_json);
+	}
+
+	// the merge patch of two values the diff has no nested object diff for: the members of two objects are merged,
+	// anything else is replaced by new_json
+	static void write_merge_value(JsonWriter& writer, const JsonValue& old_json, const JsonValue& new_json)
+	{
+		if (!old_json.is_object() || !new_json.is_object())
+		{
+			writer.write_json(new_json);
+			return;
+		}
+		const auto& old_obj = old_json.get_object();
+		const auto& new_obj = new_json.get_object();
+		utils::ObjectKeyIndex<const fc::variant_object> old_index(old_obj);
+		utils::ObjectKeyIndex<const fc::variant_object> new_index(new_obj);
+		bool first = true;
+		writer.put('{');
+		for (const auto& member : old_obj)
+		{
+			if (new_index.contains(member.key()))
+				continue;
+			if (!first)
+				writer.put(',');
+			first = false;
+			writer.write_string(member.key());
+			writer.write(":null", 5);
+		}
+		for (const auto& member : new_obj)
+		{
+			auto found = old_index.find(member.key());
+			if (found != old_index.end() && json_equal(found->value(), member.value()))
+				continue;
+			if (!first)
+				writer.put(',');
+			first = false;
+			writer.write_string(member.key());
+			writer.put(':');
+			if (found != old_index.end())
+				write_merge_value(writer, found->value(), member.value());
+			else
+				writer.write_json(member.value());
+		}
+		writer.put('}');
+	}
+
+	static void write_merge_node(JsonWriter& writer, const JsonValue& diff_json, const JsonValue& old_json, const JsonValue& new_json)
+	{
+		const JsonValue* new_value = nullptr;
+		auto type = diff_node_type(diff_json, new_value);
+		if (type == DNT_INVALID)
+			throw JsonDiffException("wrong format of diff json");
+		if (type != DNT_OBJECT)
+		{
+			write_merge_value(writer, old_json, new_json);
+			return;
+		}
+		if (!old_json.is_object() || !new_json.is_object())
+			throw JsonDiffException(mismatch_error);
+		utils::ObjectKeyIndex<const fc::variant_object> old_index(old_json.get_object());
+		utils::ObjectKeyIndex<const fc::variant_object> new_index(new_json.get_object());
+		writer.put('{');
+		bool first = true;
+		for (const auto& member : diff_json.get_object())
+		{
+			const auto& key = member.key();
+			if (key == JSONDIFF_KEY_FINGERPRINTS && is_diff_fingerprints(member.value()))
+				continue;
+			size_t name_size;
+			auto op_type = member_op_type(key, name_size);
+			if (!first)
+				writer.put(',');
+			first = false;
+			if (op_type != DOT_MEMBER_MODIFIED)
+			{
+				writer.write_string(key.substr(0, name_size));
+				writer.put(':');
+				if (op_type == DOT_MEMBER_ADDED)
+					writer.write_json(member.value());
+				else
+					writer.write("null", 4);
+				continue;
+			}
+			writer.write_string(key);
+			writer.put(':');
+			write_merge_node(writer, member.value(), find_member(old_index, key), find_member(new_index, key));
+		}
+		writer.put('}');
+	}
+
+	void json_merge_patch_write(std::ostream& out, const DiffResult& diff_info, const JsonValue& old_json, const JsonValue& new_json)
+	{
+		JsonWriter writer(out);
+		// with no change, {} for an object; a merge patch that leaves anything else as it is doesn't exist, so the value itself
+		if (diff_info.is_undefined())
+			write_merge_value(writer, old_json, new_json);
+		else
+			write_merge_node(writer, diff_info.value(), old_json, new_json);
+	}
+
+	enum PatchEditType
+	{
+		PET_ADD = 0,
+		PET_REMOVE = 1,
+		PET_REPLACE = 2
+	};
+
+	// an add, remove or replace operation of a json patch
+	struct PatchEdit
+	{
+		PatchEditType type;
+		std::vector<std::string> path;
+		const JsonValue* value;
+	};
+
+	static const char* path_not_found_error = "json patch path not found in the document";
+
+	static void apply_edits(JsonValue& json, const std::vector<PatchEdit>& edits, size_t begin, size_t end, size_t depth);
+
+	// the edits [begin, end) under an object, in order. the object is rebuilt once for all of them: the members
+	// are found through a key index, removed ones are flagged and new ones appended, all replaced at the end
+	static void apply_object_edits(JsonValue& json, const std::vector<PatchEdit>& edits, size_t begin, size_t end, size_t depth)
+	{
+		fc::mutable_variant_object obj(json.get_object());
+		utils::ObjectKeyIndex<fc::mutable_variant_object> index(obj);
+		std::vector<bool> removed;
+		std::vector<fc::mutable_variant_object::entry> appended;
+		std::vector<bool> appended_removed;
+		std::unordered_map<std::string, size_t> appended_pos;
+		auto find = [&](const std::string& key) -> JsonValue* {
+			auto appended_found = appended_pos.find(key);
+			if (appended_found != appended_pos.end())
+				return &appended[appended_found->second].value();
+			auto found = index.find(key);
+			if (found == index.end())
+				return nullptr;
+			size_t pos = found - obj.begin();
+			if (pos < removed.size() && removed[pos])
+				return nullptr;
+			return &found->value();
+		};
+		for (size_t i = begin; i < end;)
+		{
+			const auto& edit = edits[i];
+			const auto& key = edit.path[depth];
+			if (edit.path.size() > depth + 1)
+			{
+				// the edits of one member follow each other, they are applied to it together
+				size_t next = i + 1;
+				while (next < end && edits[next].path.size() > depth + 1 && edits[next].path[depth] == key)
+					next++;
+				auto* member = find(key);
+				if (!member)
+					throw JsonDiffException(path_not_found_error);
+				apply_edits(*member, edits, i, next, depth + 1);
+				i = next;
+				continue;
+			}
+			auto* member = find(key);
+			if (edit.type == PET_ADD && !member)
+			{
+				appended_pos[key] = appended.size();
+				appended.push_back(fc::mutable_variant_object::entry(key, *edit.value));
+				appended_removed.push_back(false);
+			}
+			else if (!member)
+				throw JsonDiffException(path_not_found_error);
+			else if (edit.type != PET_REMOVE)
+				*member = *edit.value;
+			else
+			{
+				auto appended_found = appended_pos.find(key);
+				if (appended_found != appended_pos.end())
+				{
+					appended_removed[appended_found->second] = true;
+					appended_pos.erase(appended_found);
+				}
+				else
+				{
+					removed.resize(obj.size(), false);
+					removed[index.find(key) - obj.begin()] = true;
+				}
+			}
+			i++;
+		}
+		if (!appended_pos.empty() || !removed.empty())
+		{
+			std::vector<fc::mutable_variant_object::entry> entries;
+			entries.reserve(appended_pos.size());
+			for (size_t k = 0; k < appended.size(); k++)
+			{
+				if (!appended_removed[k])
+					entries.push_back(std::move(appended[k]));
+			}
+			utils::replace_object_entries(obj, removed, entries);
+		}
+		json.get_object() = std::move(obj);
+	}
+
+	// the edits [begin, end) under an array, in order, changed in place
+	static void apply_array_edits(JsonValue& json, const std::vector<PatchEdit>& edits, size_t begin, size_t end, size_t depth)
+	{
+		auto& items = json.get_array();
+		for (size_t i = begin; i < end;)
+		{
+			const auto& edit = edits[i];
+			const auto& token = edit.path[depth];
+			size_t index;
+			if (edit.path.size() == depth + 1 && edit.type == PET_ADD)
+			{
+				if (token == "-")
+					index = items.size();
+				else if (!json_pointer_parse_index(token, index) || index > items.size())
+					throw JsonDiffException("json patch array index out of range");
+				items.insert(items.begin() + index, *edit.value);
+				i++;
+				continue;
+			}
+			if (!json_pointer_parse_index(token, index) || index >= items.size())
+				throw JsonDiffException(path_not_found_error);
+			if (edit.path.size() > depth + 1)
+			{
+				size_t next = i + 1;
+				while (next < end && edits[next].path.size() > depth + 1 && edits[next].path[depth] == token)
+					next++;
+				apply_edits(items[index], edits, i, next, depth + 1);
+				i = next;
+				continue;
+			}
+			if (edit.type == PET_REMOVE)
+				items.erase(items.begin() + index);
+			else
+				items[index] = *edit.value;
+			i++;
+		}
+	}
+
+	// apply the edits [begin, end) in order, their paths start with the path of json, which is depth tokens long
+	static void apply_edits(JsonValue& json, const std::vector<PatchEdit>& edits, size_t begin, size_t end, size_t depth)
+	{
+		for (size_t i = begin; i < end;)
+		{
+			if (edits[i].path.size() == depth)
+			{
+				// the root of the document, when a patch changes it as a whole
+				if (edits[i].type == PET_REMOVE)
+					throw JsonDiffException("json patch can't remove the whole document");
+				json = *edits[i].value;
+				i++;
+				continue;
+			}
+			size_t next = i + 1;
+			while (next < end && edits[next].path.size() > depth)
+				next++;
+			if (json.is_object())
+				apply_object_edits(json, edits, i, next, depth);
+			else if (json.is_array())
+				apply_array_edits(json, edits, i, next, depth);
+			else
+				throw JsonDiffException(path_not_found_error);
+			i = next;
+		}
+	}
+
+	static void apply_edit(JsonValue& json, PatchEditType type, std::vector<std::string> path, const JsonValue* value)
+	{
+		std::vector<PatchEdit> edits(1);
+		edits[0].type = type;
+		edits[0].path = std::move(path);
+		edits[0].value = value;
+		apply_edits(json, edits, 0, 1, 0);
+	}
+
+	static const JsonValue& find_value(const JsonValue& json, const std::vector<std::string>& path)
+	{
+		const auto* found = json_pointer_find(json, path);
+		if (!found)
+			throw JsonDiffException(path_not_found_error);
+		return *found;
+	}
+
+	static const JsonValue& operation_member(const fc::variant_object& op, const char* name)
+	{
+		auto found = op.find(name);
+		if (found == op.end())
+			throw JsonDiffException(std::string("json patch operation has no ") + name);
+		return found->value();
+	}
+
+	static std::vector<std::string> operation_path(const fc::variant_object& op, const char* name)
+	{
+		const auto& path = operation_member(op, name);
+		if (!path.is_string())
+			throw JsonDiffException(std::string("json patch operation has no ") + name);
+		return json_pointer_parse(path.get_string());
+	}
+
+	void json_patch_apply(JsonValue& json, const JsonValue& patch)
+	{
+		if (!patch.is_array())
+			throw JsonDiffException("json patch is not an array of operations");
+		// the add, remove and replace operations in a row are applied as one run, so an object on the path of
+		// many of them (the root at least) is rebuilt once instead of once per operation, which fc objects would make O(n^2)
+		std::vector<PatchEdit> edits;
+		for (const auto& op_json : patch.get_array())
+		{
+			if (!op_json.is_object())
+				throw JsonDiffException("json patch operation is not an object");
+			const auto& op = op_json.get_object();
+			const auto& name_json = operation_member(op, "op");
+			if (!name_json.is_string())
+				throw JsonDiffException("json patch operation has no op");
+			const auto& name = name_json.get_string();
+			PatchEdit edit;
+			edit.path = operation_path(op, "path");
+			edit.value = nullptr;
+			if (name == "add" || name == "replace")
+			{
+				edit.type = name == "add" ? PET_ADD : PET_REPLACE;
+				edit.value = &operation_member(op, "value");
+				edits.push_back(std::move(edit));
+				continue;
+			}
+			if (name == "remove")
+			{
+				edit.type = PET_REMOVE;
+				edits.push_back(std::move(edit));
+				continue;
+			}
+			// the other operations read the document, so the run before them is applied first
+			apply_edits(json, edits, 0, edits.size(), 0);
+			edits.clear();
+			if (name == "move")
+			{
+				auto from = operation_path(op, "from");
+				if (from == edit.path)
+					continue;
+				if (from.size() < edit.path.size() && std::equal(from.begin(), from.end(), edit.path.begin()))
+					throw JsonDiffException("json patch can't move a value into itself");
+				JsonValue value = find_value(json, from);
+				apply_edit(json, PET_REMOVE, std::move(from), nullptr);
+				apply_edit(json, PET_ADD, std::move(edit.path), &value);
+			}
+			else if (name == "copy")
+			{
+				JsonValue value = find_value(json, operation_path(op, "from"));
+				apply_edit(json, PET_ADD, std::move(edit.path), &value);
+			}
+			else if (name == "test")
+			{
+				if (!json_equal(find_value(json, edit.path), operation_member(op, "value")))
+					throw JsonDiffException("json patch test failed at " + operation_member(op, "path").get_string());
+			}
+			else
+				throw JsonDiffException("not supported json patch operation " + name);
+		}
+		apply_edits(json, edits, 0, edits.size(), 0);
+	}
+
+	void json_merge_patch_apply(JsonValue& json, const JsonValue& patch)
+	{
+		if (!patch.is_object())
+		{
+			json = patch;
+			return;
+		}
+		fc::mutable_variant_object obj;
+		if (json.is_object())
+			obj = json.get_object();
+		utils::ObjectKeyIndex<fc::mutable_variant_object> index(obj);
+		std::vector<bool> removed;
+		std::vector<fc::mutable_variant_object::entry> appended;
+		for (const auto& member : patch.get_object())
+		{
+			auto found = index.find(member.key());
+			if (member.value().is_null())
+			{
+				if (found == index.end())
+					continue;
+				removed.resize(obj.size(), false);
+				removed[found - obj.begin()] = true;
+			}
+			else if (found != index.end())
+				json_merge_patch_apply(found->value(), member.value());
+			else
+			{
+				// merged into nothing, so the nulls of a nested patch are dropped
+				JsonValue value;
+				json_merge_patch_apply(value, member.value());
+				appended.push_back(fc::mutable_variant_object::entry(member.key(), std::move(value)));
+			}
+		}
+		if (!removed.empty() || !appended.empty())
+			utils::replace_object_entries(obj, removed, appended);
+		json = std::move(obj);
+	}
+
+	void JsonDiff::diff_json_patch(const JsonValue& old_json, const JsonValue& new_json, std::ostream& out)
+	{
+		JsonValue diff_json;
+		if (diff_parsed(old_json, new_json, 0, diff_json))
+			json_patch_write(out, DiffResult(std::move(diff_json)), old_json, new_json);
+		else
+			json_patch_write(out, DiffResult(), old_json, new_json);
+	}
+
+	void JsonDiff::diff_merge_patch(const JsonValue& old_json, const JsonValue& new_json, std::ostream& out)
+	{
+		JsonValue diff_json;
+		if (diff_parsed(old_json, new_json, 0, diff_json))
+			json_merge_patch_write(out, DiffResult(std::move(diff_json)), old_json, new_json);
+		else
+			json_merge_patch_write(out, DiffResult(), old_json, new_json);
+	}
+}
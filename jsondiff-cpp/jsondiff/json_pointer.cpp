@@ -0,0 +1,104 @@
+#include <jsondiff/json_pointer.h>
+#include <jsondiff/exceptions.h>
+#include <jsondiff/native_json.h>
+
+namespace jsondiff
+{
+	std::vector<std::string> json_pointer_parse(const std::string& pointer)
+	{
+		std::vector<std::string> tokens;
+		if (pointer.empty())
+			return tokens;
+		if (pointer[0] != '/')
+			throw JsonDiffException(std::string("json pointer must start with '/': ") + pointer);
+		std::string token;
+		for (size_t i = 1; i <= pointer.size(); i++)
+		{
+			if (i == pointer.size() || pointer[i] == '/')
+			{
+				tokens.push_back(token);
+				token.clear();
+			}
+			else if (pointer[i] == '~')
+			{
+				if (i + 1 >= pointer.size() || (pointer[i + 1] != '0' && pointer[i + 1] != '1'))
+					throw JsonDiffException(std::string("invalid escape in json pointer: ") + pointer);
+				token.push_back(pointer[i + 1] == '0' ? '~' : '/');
+				i++;
+			}
+			else
+				token.push_back(pointer[i]);
+		}
+		return tokens;
+	}
+
+	std::string json_pointer_escape(const std::string& token)
+	{
+		if (token.find_first_of("~/") == std::string::npos)
+			return token;
+		std::string result;
+		result.reserve(token.size() + 2);
+		for (auto c : token)
+		{
+			if (c == '~')
+				result += "~0";
+			else if (c == '/')
+				result += "~1";
+			else
+				result.push_back(c);
+		}
+		return result;
+	}
+
+	bool json_pointer_parse_index(const std::string& token, size_t& index)
+	{
+		if (token.empty() || token.size() > 18 || (token.size() > 1 && token[0] == '0'))
+			return false;
+		index = 0;
+		for (auto c : token)
+		{
+			if (c < '0' || c > '9')
+				return false;
+			index = index * 10 + (size_t)(c - '0');
+		}
+		return true;
+	}
+
+	template <typename Value>
+	static const Value* find_by_pointer(const Value& json_value, const std::vector<std::string>& tokens)
+	{
+		const Value* current = &json_value;
+		for (const auto& token : tokens)
+		{
+			if (current->is_object())
+			{
+				const auto& obj = current->get_object();
+				auto found = obj.find(token);
+				if (found == obj.end())
+					return nullptr;
+				current = &found->value();
+			}
+			else if (current->is_array())
+			{
+				const auto& items = current->get_array();
+				size_t index;
+				if (!json_pointer_parse_index(token, index) || index >= items.size())
+					return nullptr;
+				current = &items[index];
+			}
+			else
+				return nullptr;
+		}
+		return current;
+	}
+
+	const JsonValue* json_pointer_find(const JsonValue& json_value, const std::vector<std::string>& tokens)
+	{
+		return find_by_pointer(json_value, tokens);
+	}
+
+	const NativeJsonValue* json_pointer_find(const NativeJsonValue& json_value, const std::vector<std::string>& tokens)
+	{
+		return find_by_pointer(json_value, tokens);
+	}
+}
@@ -0,0 +1,238 @@
+#include <jsondiff/json_tokenizer.h>
+
+#include <cstring>
+
+namespace jsondiff
+{
+	static bool has_escapes(const JsonToken& token)
+	{
+		return memchr(token.begin, '\\', token.end - token.begin) != nullptr;
+	}
+
+	bool JsonToken::is_scalar() const
+	{
+		return type == JTT_STRING || type == JTT_NUMBER || type == JTT_TRUE || type == JTT_FALSE || type == JTT_NULL;
+	}
+
+	std::string JsonToken::decode_string() const
+	{
+		if (!has_escapes(*this))
+			return std::string(begin + 1, end - 1);
+		return json_loads(std::string(begin, end)).get_string();
+	}
+
+	JsonValue JsonToken::decode_scalar() const
+	{
+		switch (type)
+		{
+		case JTT_NULL:
+			return JsonValue();
+		case JTT_TRUE:
+			return JsonValue(true);
+		case JTT_FALSE:
+			return JsonValue(false);
+		case JTT_STRING:
+		case JTT_KEY:
+			return JsonValue(decode_string());
+		case JTT_NUMBER:
+			return json_loads(std::string(begin, end));
+		default:
+			throw JsonDiffException("json token is not a scalar");
+		}
+	}
+
+	bool json_token_equal(const JsonToken& a, const JsonToken& b)
+	{
+		if (a.type != b.type)
+			return false;
+		size_t size = a.end - a.begin;
+		if (size == (size_t)(b.end - b.begin) && memcmp(a.begin, b.begin, size) == 0)
+			return true;
+		switch (a.type)
+		{
+		case JTT_STRING:
+		case JTT_KEY:
+			// the same string can be written with different escapes
+			if (!has_escapes(a) && !has_escapes(b))
+				return false;
+			return a.decode_string() == b.decode_string();
+		case JTT_NUMBER:
+			// e.g. 1.5 and 1.50
+			return json_scalar_equal(a.decode_scalar(), b.decode_scalar());
+		default:
+			return false;
+		}
+	}
+
+	JsonTokenizer::JsonTokenizer(const char* begin, const char* end)
+		: _begin(begin), _pos(begin), _end(end), _expect(EXPECT_VALUE), _has_peeked(false)
+	{
+		_peeked.type = JTT_END;
+		_peeked.begin = _peeked.end = begin;
+	}
+
+	JsonDiffException JsonTokenizer::error(const char* what) const
+	{
+		return JsonDiffException(std::string("json syntax error at offset ") + std::to_string(_pos - _begin) + ": " + what);
+	}
+
+	JsonToken JsonTokenizer::next()
+	{
+		if (_has_peeked)
+		{
+			_has_peeked = false;
+			return _peeked;
+		}
+		return read_token();
+	}
+
+	const JsonToken& JsonTokenizer::peek()
+	{
+		if (!_has_peeked)
+		{
+			_peeked = read_token();
+			_has_peeked = true;
+		}
+		return _peeked;
+	}
+
+	const char* JsonTokenizer::position() const
+	{
+		return _pos;
+	}
+
+	void JsonTokenizer::skip_value(const char*& value_begin, const char*& value_end)
+	{
+		auto token = next();
+		if (token.type == JTT_END || token.type == JTT_END_OBJECT || token.type == JTT_END_ARRAY || token.type == JTT_KEY)
+			throw error("expected a value");
+		value_begin = token.begin;
+		size_t depth = 0;
+		for (;;)
+		{
+			if (token.type == JTT_BEGIN_OBJECT || token.type == JTT_BEGIN_ARRAY)
+				depth++;
+			else if (token.type == JTT_END_OBJECT || token.type == JTT_END_ARRAY)
+				depth--;
+			if (depth == 0)
+				break;
+			token = next();
+		}
+		value_end = token.end;
+	}
+
+	void JsonTokenizer::after_value()
+	{
+		_expect = _stack.empty() ? EXPECT_EOF : EXPECT_COMMA_OR_END;
+	}
+
+	const char* JsonTokenizer::scan_string(const char* p)
+	{
+		// p is at the opening quote
+		for (p++; p < _end; p++)
+		{
+			if (*p == '"')
+				return p + 1;
+			if (*p == '\\')
+				p++;
+		}
+		throw error("unterminated string");
+	}
+
+	JsonToken JsonTokenizer::read_token()
+	{
+		JsonToken token;
+		for (;;)
+		{
+			while (_pos < _end && (*_pos == ' ' || *_pos == '\n' || *_pos == '\r' || *_pos == '\t'))
+				_pos++;
+			if (_expect == EXPECT_EOF)
+			{
+				if (_pos != _end)
+					throw error("unexpected data after the json value");
+				token.type = JTT_END;
+				token.begin = token.end = _pos;
+				return token;
+			}
+			if (_pos == _end)
+				throw error("unexpected end of json");
+			char c = *_pos;
+			token.begin = _pos;
+			if (_expect == EXPECT_COMMA_OR_END)
+			{
+				if (c == ',')
+				{
+					_pos++;
+					_expect = _stack.back() == '{' ? EXPECT_KEY : EXPECT_VALUE;
+					continue;
+				}
+				if (c != (_stack.back() == '{' ? '}' : ']'))
+					throw error("expected ',' or the end of the container");
+			}
+			if ((c == '}' && (_expect == EXPECT_COMMA_OR_END || _expect == EXPECT_KEY_OR_END))
+				|| (c == ']' && (_expect == EXPECT_COMMA_OR_END || _expect == EXPECT_VALUE_OR_END)))
+			{
+				token.type = c == '}' ? JTT_END_OBJECT : JTT_END_ARRAY;
+				token.end = ++_pos;
+				_stack.pop_back();
+				after_value();
+				return token;
+			}
+			if (_expect == EXPECT_KEY || _expect == EXPECT_KEY_OR_END)
+			{
+				if (c != '"')
+					throw error("expected an object key");
+				token.type = JTT_KEY;
+				token.end = _pos = scan_string(_pos);
+				while (_pos < _end && (*_pos == ' ' || *_pos == '\n' || *_pos == '\r' || *_pos == '\t'))
+					_pos++;
+				if (_pos == _end || *_pos != ':')
+					throw error("expected ':'");
+				_pos++;
+				_expect = EXPECT_VALUE;
+				return token;
+			}
+			// a value
+			switch (c)
+			{
+			case '{':
+			case '[':
+				token.type = c == '{' ? JTT_BEGIN_OBJECT : JTT_BEGIN_ARRAY;
+				token.end = ++_pos;
+				_stack.push_back(c);
+				_expect = c == '{' ? EXPECT_KEY_OR_END : EXPECT_VALUE_OR_END;
+				return token;
+			case '"':
+				token.type = JTT_STRING;
+				token.end = _pos = scan_string(_pos);
+				break;
+			case 't':
+			case 'f':
+			case 'n':
+			{
+				const char* literal = c == 't' ? "true" : (c == 'f' ? "false" : "null");
+				size_t size = strlen(literal);
+				if ((size_t)(_end - _pos) < size || memcmp(_pos, literal, size) != 0)
+					throw error("invalid literal");
+				token.type = c == 't' ? JTT_TRUE : (c == 'f' ? JTT_FALSE : JTT_NULL);
+				token.end = _pos += size;
+				break;
+			}
+			default:
+				if (c != '-' && (c < '0' || c > '9'))
+					throw error("unexpected character");
+				token.type = JTT_NUMBER;
+				for (_pos++; _pos < _end; _pos++)
+				{
+					char d = *_pos;
+					if (!((d >= '0' && d <= '9') || d == '.' || d == 'e' || d == 'E' || d == '+' || d == '-'))
+						break;
+				}
+				token.end = _pos;
+				break;
+			}
+			after_value();
+			return token;
+		}
+	}
+}
@@ -1,5 +1,11 @@
 #include <jsondiff/json_value_types.h>
 #include <jsondiff/exceptions.h>
+#include <jsondiff/helper.h>
+#include <jsondiff/native_json.h>
+
+#include <cmath>
+#include <cstring>
+#include <type_traits>
 
 namespace jsondiff
 {
@@ -59,7 +65,211 @@ namespace jsondiff
 	{
 		if (!diff_json.is_object())
 			return false;
-		auto diff_json_obj = diff_json.as<fc::mutable_variant_object>();
-		return json_has_key(diff_json_obj, JSONDIFF_KEY_OLD_VALUE) && json_has_key(diff_json_obj, JSONDIFF_KEY_NEW_VALUE);
+		const auto& diff_json_obj = diff_json.get_object();
+		return diff_json_obj.find(JSONDIFF_KEY_OLD_VALUE) != diff_json_obj.end()
+			&& diff_json_obj.find(JSONDIFF_KEY_NEW_VALUE) != diff_json_obj.end();
+	}
+
+	// an integer and a float are equal when the float holds exactly that integer
+	static bool int64_equals_double(int64_t value, double d)
+	{
+		return d >= -9223372036854775808.0 && d < 9223372036854775808.0 && (double)(int64_t)d == d && (int64_t)d == value;
+	}
+
+	static bool uint64_equals_double(uint64_t value, double d)
+	{
+		return d >= 0 && d < 18446744073709551616.0 && (double)(uint64_t)d == d && (uint64_t)d == value;
+	}
+
+	static bool double_equal(double a, double b)
+	{
+		if (std::isnan(a) || std::isnan(b))
+			return std::isnan(a) && std::isnan(b);
+		return a == b;
+	}
+
+	bool json_scalar_equal(const JsonValue& a, const JsonValue& b)
+	{
+		auto a_type = a.get_type();
+		auto b_type = b.get_type();
+		if (a_type != b_type)
+		{
+			// only numbers can be equal with different storage
+			if (a_type == fc::variant::int64_type && b_type == fc::variant::uint64_type)
+				return a.as_int64() >= 0 && (uint64_t)a.as_int64() == b.as_uint64();
+			if (a_type == fc::variant::uint64_type && b_type == fc::variant::int64_type)
+				return b.as_int64() >= 0 && (uint64_t)b.as_int64() == a.as_uint64();
+			if (a_type == fc::variant::int64_type && b_type == fc::variant::double_type)
+				return int64_equals_double(a.as_int64(), b.as_double());
+			if (a_type == fc::variant::double_type && b_type == fc::variant::int64_type)
+				return int64_equals_double(b.as_int64(), a.as_double());
+			if (a_type == fc::variant::uint64_type && b_type == fc::variant::double_type)
+				return uint64_equals_double(a.as_uint64(), b.as_double());
+			if (a_type == fc::variant::double_type && b_type == fc::variant::uint64_type)
+				return uint64_equals_double(b.as_uint64(), a.as_double());
+			return false;
+		}
+		switch (a_type)
+		{
+		case fc::variant::null_type:
+			return true;
+		case fc::variant::bool_type:
+			return a.as_bool() == b.as_bool();
+		case fc::variant::int64_type:
+			return a.as_int64() == b.as_int64();
+		case fc::variant::uint64_type:
+			return a.as_uint64() == b.as_uint64();
+		case fc::variant::double_type:
+			return double_equal(a.as_double(), b.as_double());
+		case fc::variant::string_type:
+		{
+			const auto& a_str = a.get_string();
+			const auto& b_str = b.get_string();
+			return a_str.size() == b_str.size() && a_str == b_str;
+		}
+		default:
+			throw JsonDiffException(std::string("not supported json value type to compare ") + json_dumps(a));
+		}
+	}
+
+	JsonValueType guess_json_value_type(const NativeJsonValue& json_data)
+	{
+		switch (json_data.get_type())
+		{
+		case NJT_NULL:
+			return JsonValueType::JVT_NULL;
+		case NJT_BOOL:
+			return JsonValueType::JVT_BOOLEAN;
+		case NJT_INT64:
+		case NJT_UINT64:
+			return JsonValueType::JVT_INTEGER;
+		case NJT_DOUBLE:
+			return JsonValueType::JVT_FLOAT;
+		case NJT_STRING:
+			return JsonValueType::JVT_STRING;
+		case NJT_ARRAY:
+			return JsonValueType::JVT_ARRAY;
+		case NJT_OBJECT:
+			return JsonValueType::JVT_OBJECT;
+		default:
+			throw JsonDiffException("don't known what json type of a native json value is");
+		}
+	}
+
+	bool json_scalar_equal(const NativeJsonValue& a, const NativeJsonValue& b)
+	{
+		auto a_type = a.get_type();
+		auto b_type = b.get_type();
+		if (a_type != b_type)
+		{
+			if (a_type == NJT_INT64 && b_type == NJT_UINT64)
+				return a.as_int64() >= 0 && (uint64_t)a.as_int64() == b.as_uint64();
+			if (a_type == NJT_UINT64 && b_type == NJT_INT64)
+				return b.as_int64() >= 0 && (uint64_t)b.as_int64() == a.as_uint64();
+			if (a_type == NJT_INT64 && b_type == NJT_DOUBLE)
+				return int64_equals_double(a.as_int64(), b.as_double());
+			if (a_type == NJT_DOUBLE && b_type == NJT_INT64)
+				return int64_equals_double(b.as_int64(), a.as_double());
+			if (a_type == NJT_UINT64 && b_type == NJT_DOUBLE)
+				return uint64_equals_double(a.as_uint64(), b.as_double());
+			if (a_type == NJT_DOUBLE && b_type == NJT_UINT64)
+				return uint64_equals_double(b.as_uint64(), a.as_double());
+			return false;
+		}
+		switch (a_type)
+		{
+		case NJT_NULL:
+			return true;
+		case NJT_BOOL:
+			return a.as_bool() == b.as_bool();
+		case NJT_INT64:
+			return a.as_int64() == b.as_int64();
+		case NJT_UINT64:
+			return a.as_uint64() == b.as_uint64();
+		case NJT_DOUBLE:
+			return double_equal(a.as_double(), b.as_double());
+		case NJT_STRING:
+			return a.get_string() == b.get_string();
+		default:
+			throw JsonDiffException("not supported native json value type to compare");
+		}
+	}
+
+	static bool same_storage(const JsonValue& a, const JsonValue& b)
+	{
+		return json_shares_storage(a, b);
+	}
+
+	static bool same_storage(const NativeJsonValue& a, const NativeJsonValue& b)
+	{
+		return &a == &b;
+	}
+
+	// deep equality of the values of one backend, stops at the first difference
+	template <typename Value>
+	static bool values_equal(const Value& a, const Value& b)
+	{
+		if (!a.is_object() && !a.is_array())
+			return json_scalar_equal(a, b);
+		if (a.get_type() != b.get_type())
+			return false;
+		if (same_storage(a, b))
+			return true;
+		if (a.is_array())
+		{
+			const auto& a_array = a.get_array();
+			const auto& b_array = b.get_array();
+			if (a_array.size() != b_array.size())
+				return false;
+			for (size_t i = 0; i < a_array.size(); i++)
+			{
+				if (!values_equal(a_array[i], b_array[i]))
+					return false;
+			}
+			return true;
+		}
+		const auto& a_obj = a.get_object();
+		const auto& b_obj = b.get_object();
+		if (a_obj.size() != b_obj.size())
+			return false;
+		// members in the same order are compared side by side, the key index is only built for the rest
+		// once the orders part. the keys before that point are on both sides, so the rest can't be among them
+		auto i = a_obj.begin();
+		auto j = b_obj.begin();
+		for (; i != a_obj.end() && i->key() == j->key(); i++, j++)
+		{
+			if (!values_equal(i->value(), j->value()))
+				return false;
+		}
+		if (i == a_obj.end())
+			return true;
+		utils::ObjectKeyIndex<typename std::remove_reference<decltype(b_obj)>::type> b_index(b_obj);
+		for (; i != a_obj.end(); i++)
+		{
+			auto found = b_index.find(i->key());
+			if (found == b_index.end() || !values_equal(i->value(), found->value()))
+				return false;
+		}
+		return true;
+	}
+
+	bool json_equal(const JsonValue& a, const JsonValue& b)
+	{
+		return values_equal(a, b);
+	}
+
+	bool json_equal(const NativeJsonValue& a, const NativeJsonValue& b)
+	{
+		return values_equal(a, b);
+	}
+
+	JsonValue make_array_diff_item(const char* op, uint64_t pos, JsonValue item)
+	{
+		fc::variants item_diff;
+		item_diff.reserve(3);
+		item_diff.push_back(op);
+		item_diff.push_back(pos);
+		item_diff.push_back(std::move(item));
+		return item_diff;
 	}
 }
@@ -0,0 +1,218 @@
+#include <jsondiff/json_writer.h>
+#include <jsondiff/exceptions.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+namespace jsondiff
+{
+	JsonWriter::JsonWriter(std::ostream& out)
+		: _out(out), _size(0)
+	{
+	}
+
+	JsonWriter::~JsonWriter()
+	{
+		flush_buffer();
+	}
+
+	void JsonWriter::flush_buffer()
+	{
+		if (_size > 0)
+			_out.write(_buffer, _size);
+		_size = 0;
+	}
+
+	void JsonWriter::flush()
+	{
+		flush_buffer();
+		_out.flush();
+	}
+
+	void JsonWriter::write(const char* data, size_t size)
+	{
+		if (size > sizeof(_buffer) - _size)
+		{
+			flush_buffer();
+			if (size > sizeof(_buffer))
+			{
+				_out.write(data, size);
+				return;
+			}
+		}
+		memcpy(_buffer + _size, data, size);
+		_size += size;
+	}
+
+	void JsonWriter::put(char c, size_t count)
+	{
+		while (count > 0)
+		{
+			if (_size == sizeof(_buffer))
+				flush_buffer();
+			size_t n = std::min(count, sizeof(_buffer) - _size);
+			memset(_buffer + _size, c, n);
+			_size += n;
+			count -= n;
+		}
+	}
+
+	void JsonWriter::write_string(const std::string& str)
+	{
+		// the escapes of fc's json generator, runs without escapes are copied as they are
+		put('"');
+		const char* data = str.data();
+		size_t run = 0;
+		for (size_t i = 0; i < str.size(); i++)
+		{
+			unsigned char c = (unsigned char)data[i];
+			const char* escape = nullptr;
+			switch (c)
+			{
+			case '\b': escape = "\\b"; break;
+			case '\t': escape = "\\t"; break;
+			case '\n': escape = "\\n"; break;
+			case '\f': escape = "\\f"; break;
+			case '\r': escape = "\\r"; break;
+			case '\\': escape = "\\\\"; break;
+			case '"': escape = "\\\""; break;
+			default:
+				if (c >= 0x20 && c != 0x7f)
+					continue;
+			}
+			write(data + run, i - run);
+			run = i + 1;
+			if (escape)
+				write(escape, 2);
+			else
+			{
+				char unicode[8];
+				snprintf(unicode, sizeof(unicode), "\\u%04x", c);
+				write(unicode, 6);
+			}
+		}
+		write(data + run, str.size() - run);
+		put('"');
+	}
+
+	void JsonWriter::write_number(const JsonValue& json_value)
+	{
+		char text[32];
+		int size;
+		if (json_value.get_type() == fc::variant::int64_type)
+			size = snprintf(text, sizeof(text), "%lld", (long long)json_value.as_int64());
+		else if (json_value.get_type() == fc::variant::uint64_type)
+			size = snprintf(text, sizeof(text), "%llu", (unsigned long long)json_value.as_uint64());
+		else
+			size = snprintf(text, sizeof(text), "%.*g", std::numeric_limits<double>::digits10 + 2, json_value.as_double());
+		write(text, (size_t)size);
+	}
+
+	void JsonWriter::write_pretty_indent(size_t level)
+	{
+		put('\n');
+		put(' ', level * 2);
+	}
+
+	void JsonWriter::write_json(const JsonValue& json_value)
+	{
+		if (json_value.is_null())
+			write("null", 4);
+		else if (json_value.is_string())
+			write_string(json_value.get_string());
+		else if (json_value.is_bool())
+		{
+			if (json_value.as_bool())
+				write("true", 4);
+			else
+				write("false", 5);
+		}
+		else if (json_value.is_numeric())
+			write_number(json_value);
+		else if (json_value.is_array())
+		{
+			put('[');
+			const auto& items = json_value.get_array();
+			for (size_t i = 0; i < items.size(); i++)
+			{
+				if (i > 0)
+					put(',');
+				write_json(items[i]);
+			}
+			put(']');
+		}
+		else if (json_value.is_object())
+		{
+			put('{');
+			bool first = true;
+			for (const auto& member : json_value.get_object())
+			{
+				if (!first)
+					put(',');
+				first = false;
+				write_string(member.key());
+				put(':');
+				write_json(member.value());
+			}
+			put('}');
+		}
+		else
+			throw JsonDiffException("not supported json value type to write");
+	}
+
+	void JsonWriter::write_pretty_json(const JsonValue& json_value, size_t level)
+	{
+		if (json_value.is_array())
+		{
+			const auto& items = json_value.get_array();
+			put('[');
+			for (size_t i = 0; i < items.size(); i++)
+			{
+				if (i > 0)
+					put(',');
+				// like fc, an object or array element starts on the line of the bracket or comma before it
+				if (!items[i].is_object() && !items[i].is_array())
+					write_pretty_indent(level + 1);
+				write_pretty_json(items[i], level + 1);
+			}
+			if (!items.empty())
+				write_pretty_indent(level);
+			put(']');
+		}
+		else if (json_value.is_object())
+		{
+			const auto& obj = json_value.get_object();
+			put('{');
+			bool first = true;
+			for (const auto& member : obj)
+			{
+				if (!first)
+					put(',');
+				first = false;
+				write_pretty_indent(level + 1);
+				write_string(member.key());
+				write(": ", 2);
+				write_pretty_json(member.value(), level + 1);
+			}
+			if (!first)
+				write_pretty_indent(level);
+			put('}');
+		}
+		else
+			write_json(json_value);
+	}
+
+	void json_write(std::ostream& out, const JsonValue& json_value)
+	{
+		JsonWriter writer(out);
+		writer.write_json(json_value);
+	}
+
+	void json_pretty_write(std::ostream& out, const JsonValue& json_value)
+	{
+		JsonWriter writer(out);
+		writer.write_pretty_json(json_value);
+	}
+}
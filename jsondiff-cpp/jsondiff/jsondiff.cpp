@@ -1,7 +1,24 @@
 #include <jsondiff/jsondiff.h>
 #include <jsondiff/exceptions.h>
 #include <jsondiff/diff_result.h>
+#include <jsondiff/diff_fingerprints.h>
 #include <jsondiff/helper.h>
+#include <jsondiff/json_pointer.h>
+#include <jsondiff/json_value_traits.h>
+#include <jsondiff/json_writer.h>
+#include <jsondiff/sequence_diff.h>
+#include <jsondiff/string_delta.h>
+#include <jsondiff/thread_pool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <unordered_map>
 
 #include <fc/io/json.hpp>
 #include <fc/string.hpp>
@@ -10,69 +27,942 @@
 
 namespace jsondiff
 {
+	struct ArraySymbolSlot
+	{
+		JsonFingerprint fingerprint;
+		uint32_t symbol; // UINT32_MAX for an empty slot
+	};
+
+	// buffers of the sequence array diff, reused by every array a DiffContext diffs. the symbols and the lcs buffers are
+	// done with before the diff goes into the elements, so nested arrays share them, the matches are kept per nesting level.
+	// a copy starts empty, so the tasks of a parallel diff each get their own
+	struct ArrayDiffScratch
+	{
+		std::vector<ArraySymbolSlot> symbol_slots;
+		// const Value* of the backend being diffed
+		std::vector<const void*> symbol_values;
+		std::vector<uint32_t> a_symbols;
+		std::vector<uint32_t> b_symbols;
+		std::vector<JsonFingerprint> fingerprints;
+		SequenceLcsScratch lcs;
+		// held by pointer, so the matches of the outer arrays stay in place while inner levels are added
+		std::vector<std::unique_ptr<std::vector<SequenceMatch>>> matches;
+		size_t depth;
+
+		ArrayDiffScratch() : depth(0) {}
+		ArrayDiffScratch(const ArrayDiffScratch&) : depth(0) {}
+		ArrayDiffScratch& operator=(const ArrayDiffScratch&) { return *this; }
+	};
+
+	// the budget of one diff, shared by its parallel tasks
+	struct DiffBudget
+	{
+		std::atomic<size_t> compared_values;
+		std::atomic<size_t> changes;
+		size_t max_compared_values;
+		size_t max_changes;
+
+		explicit DiffBudget(const DiffOptions& options)
+			: compared_values(0), changes(0), max_compared_values(options.max_compared_values), max_changes(options.max_changes)
+		{
+		}
+
+		// @throws JsonDiffBudgetException
+		void compare()
+		{
+			if (compared_values.fetch_add(1, std::memory_order_relaxed) >= max_compared_values)
+				throw JsonDiffBudgetException("the diff compared more values than its budget allows");
+		}
+
+		// @throws JsonDiffBudgetException
+		void change()
+		{
+			if (changes.fetch_add(1, std::memory_order_relaxed) >= max_changes)
+				throw JsonDiffBudgetException("the diff has more changes than its budget allows");
+		}
+	};
+
+	// per call state of JsonDiff::diff
+	static uint64_t elapsed_ns(std::chrono::steady_clock::time_point start)
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// json values in json_value, containers included
+	static uint64_t count_json_values(const JsonValue& json_value)
+	{
+		uint64_t count = 1;
+		if (json_value.is_object())
+		{
+			for (const auto& member : json_value.get_object())
+				count += count_json_values(member.value());
+		}
+		else if (json_value.is_array())
+		{
+			for (const auto& item : json_value.get_array())
+				count += count_json_values(item);
+		}
+		return count;
+	}
+
+	// a stream buffer that only counts the bytes written to it
+	class ByteCountBuffer : public std::streambuf
+	{
+	private:
+		uint64_t _count;
+	protected:
+		std::streamsize xsputn(const char*, std::streamsize size) override
+		{
+			_count += (uint64_t)size;
+			return size;
+		}
+		int_type overflow(int_type c) override
+		{
+			if (!traits_type::eq_int_type(c, traits_type::eof()))
+				_count++;
+			return traits_type::not_eof(c);
+		}
+	public:
+		ByteCountBuffer() : _count(0) {}
+		uint64_t count() const
+		{
+			return _count;
+		}
+	};
+
+	// the counts of a patch or rollback walking node, see DiffStats
+	static void count_diff_node(const CompiledDiffNode& node, DiffStatsOperation operation, size_t depth, DiffStats& stats)
+	{
+		stats.max_depth = std::max(stats.max_depth, (uint64_t)depth);
+		if (node.type == DNT_REPLACE)
+		{
+			auto type = guess_json_value_type(operation == DSO_PATCH ? *node.new_value : *node.old_value);
+			if (type <= JVT_ARRAY)
+				stats.visited[type]++;
+			stats.changes++;
+			return;
+		}
+		if (node.type == DNT_STRING_DELTA)
+		{
+			stats.visited[JVT_STRING]++;
+			stats.changes += node.hunks->get_array().size();
+			return;
+		}
+		if (node.type != DNT_OBJECT && node.type != DNT_ARRAY)
+			return;
+		if (node.type == DNT_OBJECT)
+		{
+			stats.visited[JVT_OBJECT]++;
+			stats.object_fanout[DiffStats::fanout_bucket(node.ops.size())]++;
+		}
+		else
+		{
+			stats.visited[JVT_ARRAY]++;
+			stats.array_fanout[DiffStats::fanout_bucket(node.ops.size())]++;
+		}
+		for (const auto& op : node.ops)
+		{
+			if (op.diff)
+				count_diff_node(*op.diff, operation, depth + 1, stats);
+			else if (op.type != DOT_ITEM_INVALID)
+				stats.changes++;
+		}
+	}
+
+	struct JsonDiff::DiffContext
+	{
+		// both set when equal subtrees are skipped by fingerprint
+		JsonFingerprintCache* old_fingerprints;
+		JsonFingerprintCache* new_fingerprints;
+		// location of the values being diffed, only kept when some option depends on it
+		bool track_path;
+		std::vector<std::string> path;
+		ArrayDiffScratch array_scratch;
+		// set when the options bound the diff
+		DiffBudget* budget;
+		// set when the options collect stats. a copy for a parallel task counts into its own stats,
+		// added to the ones it was copied from when the task is done
+		DiffStats* stats;
+		size_t depth;
+		std::unique_ptr<DiffStats> task_stats;
+		DiffStats* parent_stats;
+		std::shared_ptr<std::mutex> stats_mutex;
+
+		DiffContext()
+			: old_fingerprints(nullptr), new_fingerprints(nullptr), track_path(false), budget(nullptr),
+			stats(nullptr), depth(0), parent_stats(nullptr)
+		{
+		}
+
+		DiffContext(const DiffContext& other)
+			: old_fingerprints(other.old_fingerprints), new_fingerprints(other.new_fingerprints), track_path(other.track_path),
+			path(other.path), array_scratch(other.array_scratch), budget(other.budget), stats(nullptr), depth(other.depth),
+			parent_stats(other.stats), stats_mutex(other.stats_mutex)
+		{
+			if (parent_stats)
+			{
+				task_stats.reset(new DiffStats());
+				stats = task_stats.get();
+			}
+		}
+
+		~DiffContext()
+		{
+			if (task_stats)
+			{
+				std::lock_guard<std::mutex> lock(*stats_mutex);
+				parent_stats->merge(*task_stats);
+			}
+		}
+
+		// @throws JsonDiffBudgetException
+		void count_change()
+		{
+			if (budget)
+				budget->change();
+			if (stats)
+				stats->changes++;
+		}
+
+		// counts one value being diffed, nested values are diffed while the returned guard lives
+		struct StatsDepthGuard
+		{
+			DiffContext& ctx;
+			explicit StatsDepthGuard(DiffContext& ctx_) : ctx(ctx_)
+			{
+				if (!ctx.stats)
+					return;
+				ctx.stats->max_depth = std::max(ctx.stats->max_depth, (uint64_t)ctx.depth);
+				ctx.depth++;
+			}
+			~StatsDepthGuard()
+			{
+				if (ctx.stats)
+					ctx.depth--;
+			}
+		};
+
+		// fingerprints of array elements, served from the caches when the diff has them.
+		// without caches nested arrays hash their elements again at every level, which is still cheaper than filling a cache
+		JsonFingerprint old_fingerprint(const JsonValue& json_value)
+		{
+			return old_fingerprints ? old_fingerprints->fingerprint(json_value) : json_fingerprint(json_value);
+		}
+
+		JsonFingerprint new_fingerprint(const JsonValue& json_value)
+		{
+			return new_fingerprints ? new_fingerprints->fingerprint(json_value) : json_fingerprint(json_value);
+		}
+
+		// the caches only hold fc nodes, values of other backends are hashed on every use
+		template <typename Value>
+		JsonFingerprint old_fingerprint(const Value& json_value)
+		{
+			return JsonValueTraits<Value>::fingerprint(json_value);
+		}
+
+		template <typename Value>
+		JsonFingerprint new_fingerprint(const Value& json_value)
+		{
+			return JsonValueTraits<Value>::fingerprint(json_value);
+		}
+
+		// true if the caches tell the two subtrees are equal
+		bool cached_equal(const JsonValue& old_json, const JsonValue& new_json)
+		{
+			return old_fingerprints && old_fingerprints->equal(old_json, *new_fingerprints, new_json);
+		}
+
+		template <typename Value>
+		bool cached_equal(const Value&, const Value&)
+		{
+			return false;
+		}
+	};
+
+	// maps array elements to symbols so that equal elements (json_equal) get the same symbol.
+	// open addressing on the element fingerprints, sized for the number of elements interned
+	template <typename Value>
+	class ArraySymbolTable
+	{
+	private:
+		// the table's own buffers, or buffers kept by the caller for the next table
+		std::vector<ArraySymbolSlot> _own_slots;
+		std::vector<const void*> _own_values;
+		std::vector<ArraySymbolSlot>& _slots;
+		size_t _mask;
+		std::vector<const void*>& _values;
+
+		void init(size_t max_count)
+		{
+			size_t capacity = 16;
+			while (capacity < max_count * 2)
+				capacity <<= 1;
+			ArraySymbolSlot empty_slot = { 0, UINT32_MAX };
+			_slots.assign(capacity, empty_slot);
+			_mask = capacity - 1;
+			_values.clear();
+			_values.reserve(max_count);
+		}
+	public:
+		explicit ArraySymbolTable(size_t max_count)
+			: _slots(_own_slots), _values(_own_values)
+		{
+			init(max_count);
+		}
+
+		ArraySymbolTable(size_t max_count, std::vector<ArraySymbolSlot>& slots, std::vector<const void*>& values)
+			: _slots(slots), _values(values)
+		{
+			init(max_count);
+		}
+
+		uint32_t intern(const Value& value, JsonFingerprint fingerprint)
+		{
+			size_t i = (size_t)fingerprint & _mask;
+			for (; _slots[i].symbol != UINT32_MAX; i = (i + 1) & _mask)
+			{
+				if (_slots[i].fingerprint != fingerprint)
+					continue;
+				const auto& symbol_value = *(const Value*)_values[_slots[i].symbol];
+				if (JsonValueTraits<Value>::shares_storage(symbol_value, value) || JsonValueTraits<Value>::equal(symbol_value, value))
+					return _slots[i].symbol;
+				// fingerprint collision, keep probing
+			}
+			uint32_t symbol = (uint32_t)_values.size();
+			_slots[i].fingerprint = fingerprint;
+			_slots[i].symbol = symbol;
+			_values.push_back(&value);
+			return symbol;
+		}
+	};
+
+	// the changed children of an object or array found by one task, by position, in order
+	typedef std::vector<std::pair<size_t, JsonValue>> IndexedDiffs;
+
+	static size_t parallel_chunk_count(const ThreadPool& pool, size_t count)
+	{
+		return std::min(pool.thread_count() * JSONDIFF_PARALLEL_TASKS_PER_THREAD, count);
+	}
+
+	// runs body(task_ctx, chunk, begin, end) over [0, count) split into parallel_chunk_count chunks, one task per chunk
+	// on pool, each with its own copy of ctx. the exception of the first failing chunk is rethrown, the one the serial
+	// loop would have thrown
+	template <typename Context, typename Body>
+	static void run_chunks(ThreadPool& pool, const Context& ctx, size_t count, const Body& body)
+	{
+		size_t chunk_count = parallel_chunk_count(pool, count);
+		std::vector<std::exception_ptr> errors(chunk_count);
+		TaskGroup group(pool);
+		for (size_t c = 0; c < chunk_count; c++)
+		{
+			size_t begin = count * c / chunk_count;
+			size_t end = count * (c + 1) / chunk_count;
+			group.run([&ctx, &body, &errors, c, begin, end]() {
+				try
+				{
+					Context task_ctx(ctx);
+					body(task_ctx, c, begin, end);
+				}
+				catch (...)
+				{
+					errors[c] = std::current_exception();
+				}
+			});
+		}
+		group.wait();
+		for (const auto& error : errors)
+		{
+			if (error)
+				std::rethrow_exception(error);
+		}
+	}
+
+	// the diffs of all chunks in order
+	static IndexedDiffs join_chunk_diffs(std::vector<IndexedDiffs>& chunk_diffs)
+	{
+		IndexedDiffs result;
+		size_t count = 0;
+		for (const auto& diffs : chunk_diffs)
+			count += diffs.size();
+		result.reserve(count);
+		for (auto& diffs : chunk_diffs)
+			std::move(diffs.begin(), diffs.end(), std::back_inserter(result));
+		return result;
+	}
+
+	// runs body over the items of a batch, in chunks on pool when there is one, otherwise as one chunk on this thread
+	template <typename Context, typename Body>
+	static void run_batch(ThreadPool* pool, const Context& ctx, size_t count, const Body& body)
+	{
+		if (pool && count > 1)
+		{
+			run_chunks(*pool, ctx, count, body);
+			return;
+		}
+		Context batch_ctx(ctx);
+		body(batch_ctx, 0, 0, count);
+	}
+
+	// the ops of a compiled array diff grouped by type.
+	// positions of '-', '~' and '>' are indexes in the old array, positions of '+' are indexes in the new array
+	struct ArrayDiffOps
+	{
+		std::vector<std::pair<size_t, const JsonValue*>> removed;
+		std::vector<std::pair<size_t, const JsonValue*>> added;
+		std::vector<std::pair<size_t, const CompiledDiffNode*>> modified;
+		std::vector<std::pair<size_t, size_t>> moved;
+	};
+
+	// @throws JsonDiffException
+	static void group_array_diff_ops(const CompiledDiffNode& node, ArrayDiffOps& ops)
+	{
+		if (node.type != DNT_ARRAY)
+			throw JsonDiffException("diffjson format error for array diff");
+		for (const auto& op : node.ops)
+		{
+			switch (op.type)
+			{
+			case DOT_ITEM_INSERTED:
+				ops.added.push_back(std::make_pair(op.pos, op.value));
+				break;
+			case DOT_ITEM_REMOVED:
+				ops.removed.push_back(std::make_pair(op.pos, op.value));
+				break;
+			case DOT_ITEM_MODIFIED:
+				ops.modified.push_back(std::make_pair(op.pos, op.diff.get()));
+				break;
+			case DOT_ITEM_MOVED:
+				ops.moved.push_back(std::make_pair(op.pos, op.target));
+				break;
+			default:
+				throw JsonDiffException("diffjson format error for array diff");
+			}
+		}
+	}
+
+	// sort the array ops of one type by position if they aren't already
+	// @throws JsonDiffException on a repeated position or one not below size
+	template <typename T>
+	static void sort_positions(std::vector<std::pair<size_t, T>>& items, size_t size)
+	{
+		auto position_less = [](const std::pair<size_t, T>& x, const std::pair<size_t, T>& y) { return x.first < y.first; };
+		if (!std::is_sorted(items.begin(), items.end(), position_less))
+			std::sort(items.begin(), items.end(), position_less);
+		for (size_t i = 0; i < items.size(); i++)
+		{
+			if (items[i].first >= size || (i > 0 && items[i].first == items[i - 1].first))
+				throw JsonDiffException("diffjson format error for array diff");
+		}
+	}
+
+	// the '~' elements must be kept ones, both lists sorted by position
+	// @throws JsonDiffException
+	static void check_modified_kept(const std::vector<std::pair<size_t, const CompiledDiffNode*>>& modified,
+		const std::vector<std::pair<size_t, const JsonValue*>>& removed)
+	{
+		size_t next = 0;
+		for (const auto& item : modified)
+		{
+			while (next < removed.size() && removed[next].first < item.first)
+				next++;
+			if (next < removed.size() && removed[next].first == item.first)
+				throw JsonDiffException("diffjson format error for array diff");
+		}
+	}
+
+	// splice the array of a patch or rollback in place: the elements at the dropped positions are taken out, then the
+	// inserted elements are put in at their positions in the result. both are sorted by position and checked.
+	// only the elements after the first dropped or inserted one move, the ones before it stay where they are
+	template <typename ArrayEdit>
+	static void splice_array(ArrayEdit& edit, const std::vector<std::pair<size_t, const JsonValue*>>& dropped,
+		const std::vector<std::pair<size_t, const JsonValue*>>& inserted)
+	{
+		size_t size = edit.items().size();
+		if (!dropped.empty())
+		{
+			auto& items = edit.items();
+			size_t kept = dropped.front().first;
+			size_t next = 0;
+			for (size_t i = kept; i < size; i++)
+			{
+				if (next < dropped.size() && dropped[next].first == i)
+				{
+					next++;
+					continue;
+				}
+				items[kept++] = std::move(items[i]);
+			}
+			size = kept;
+			edit.resize(size);
+		}
+		if (inserted.empty())
+			return;
+		size_t target = size + inserted.size();
+		edit.resize(target);
+		auto& items = edit.items();
+		// from the back, the last inserted element is the last one to move the elements behind it
+		for (size_t next = inserted.size(); next > 0;)
+		{
+			target--;
+			if (inserted[next - 1].first == target)
+			{
+				edit.set(items, target, *inserted[next - 1].second);
+				next--;
+			}
+			else
+				items[target] = std::move(items[--size]);
+		}
+	}
+
+	// rebuild the array of a patch or rollback in place: the elements at the dropped positions are left out,
+	// the inserted elements and the moved (source index, result index) elements are placed at their positions in the result
+	// and the other elements fill the remaining slots in order. kept elements are moved, not copied.
+	// for diffs with moves, the others are spliced
+	// @throws JsonDiffException
+	template <typename ArrayEdit>
+	static void rebuild_array(ArrayEdit& edit, const std::vector<std::pair<size_t, const JsonValue*>>& dropped,
+		const std::vector<std::pair<size_t, const JsonValue*>>& inserted, const std::vector<std::pair<size_t, size_t>>& moved)
+	{
+		auto& items = edit.items();
+		std::vector<bool> source_taken(items.size());
+		for (const auto& item : dropped)
+		{
+			if (item.first >= items.size() || source_taken[item.first])
+				throw JsonDiffException("diffjson format error for array diff");
+			source_taken[item.first] = true;
+		}
+		size_t result_size = items.size() - dropped.size() + inserted.size();
+		auto result = edit.make_items(result_size);
+		std::vector<bool> result_taken(result_size);
+		for (const auto& item : inserted)
+		{
+			if (item.first >= result_size || result_taken[item.first])
+				throw JsonDiffException("diffjson format error for array diff");
+			result_taken[item.first] = true;
+			edit.set(result, item.first, *item.second);
+		}
+		for (const auto& item : moved)
+		{
+			if (item.first >= items.size() || source_taken[item.first] || item.second >= result_size || result_taken[item.second])
+				throw JsonDiffException("diffjson format error for array diff");
+			source_taken[item.first] = true;
+			result_taken[item.second] = true;
+			result[item.second] = std::move(items[item.first]);
+		}
+		size_t source_index = 0;
+		for (size_t result_index = 0; result_index < result_size; result_index++)
+		{
+			if (result_taken[result_index])
+				continue;
+			while (source_taken[source_index])
+				source_index++;
+			result[result_index] = std::move(items[source_index]);
+			source_index++;
+		}
+		edit.replace(result);
+	}
+
+	// indexes into seq of a longest strictly increasing subsequence
+	static std::vector<size_t> longest_increasing_subsequence(const std::vector<size_t>& seq)
+	{
+		std::vector<size_t> tails; // index into seq of the smallest tail of an increasing run of each length
+		std::vector<size_t> previous(seq.size());
+		for (size_t i = 0; i < seq.size(); i++)
+		{
+			size_t lo = 0, hi = tails.size();
+			while (lo < hi)
+			{
+				size_t mid = (lo + hi) / 2;
+				if (seq[tails[mid]] < seq[i])
+					lo = mid + 1;
+				else
+					hi = mid;
+			}
+			previous[i] = lo > 0 ? tails[lo - 1] : SIZE_MAX;
+			if (lo == tails.size())
+				tails.push_back(i);
+			else
+				tails[lo] = i;
+		}
+		std::vector<size_t> result(tails.size());
+		size_t i = tails.empty() ? SIZE_MAX : tails.back();
+		for (size_t k = result.size(); k > 0; k--)
+		{
+			result[k - 1] = i;
+			i = previous[i];
+		}
+		return result;
+	}
+
 	JsonDiff::JsonDiff()
+		: _track_path(false)
 	{
 
 	}
 
+	JsonDiff::JsonDiff(const DiffOptions& options)
+		: _options(options)
+	{
+		for (const auto& array_key : _options.array_keys)
+		{
+			ArrayKeyPattern pattern;
+			pattern.path = json_pointer_parse(array_key.path);
+			if (!array_key.key.empty() && array_key.key[0] == '/')
+				pattern.key = json_pointer_parse(array_key.key);
+			else
+				pattern.key.push_back(array_key.key);
+			_array_key_patterns.push_back(pattern);
+		}
+		for (const auto& path : _options.include_paths)
+			_include_patterns.push_back(json_pointer_parse(path));
+		for (const auto& path : _options.exclude_paths)
+			_exclude_patterns.push_back(json_pointer_parse(path));
+		_track_path = !_array_key_patterns.empty() || !_include_patterns.empty() || !_exclude_patterns.empty()
+			|| _options.max_depth != SIZE_MAX;
+	}
+
 	JsonDiff::~JsonDiff()
 	{
 
 	}
 
+	const DiffOptions& JsonDiff::options() const
+	{
+		return _options;
+	}
+
 	DiffResultP JsonDiff::diff_by_string(const std::string &old_json_str, const std::string &new_json_str)
 	{
-		return diff(json_loads(old_json_str), json_loads(new_json_str));
+		if (!_options.stats)
+			return diff(json_loads(old_json_str), json_loads(new_json_str));
+		auto start = std::chrono::steady_clock::now();
+		auto old_json = json_loads(old_json_str);
+		auto new_json = json_loads(new_json_str);
+		JsonValue diff_json;
+		if (!diff_parsed(old_json, new_json, elapsed_ns(start), diff_json))
+			return DiffResult::make_undefined_diff_result();
+		return std::make_shared<DiffResult>(std::move(diff_json));
 	}
 
 	DiffResultP JsonDiff::diff(const JsonValue& old_json, const JsonValue& new_json)
 	{
-		auto old_json_type = guess_json_value_type(old_json);
-		auto new_json_type = guess_json_value_type(new_json);
+		JsonValue diff_json;
+		if (!diff_parsed(old_json, new_json, 0, diff_json))
+			return DiffResult::make_undefined_diff_result();
+		return std::make_shared<DiffResult>(std::move(diff_json));
+	}
+
+	bool JsonDiff::diff_parsed(const JsonValue& old_json, const JsonValue& new_json, uint64_t parse_ns, JsonValue& diff_json)
+	{
+		DiffContext ctx;
+		ctx.track_path = _track_path;
+		JsonFingerprintCache old_fingerprints;
+		JsonFingerprintCache new_fingerprints;
+		if (_options.use_fingerprints)
+		{
+			ctx.old_fingerprints = &old_fingerprints;
+			ctx.new_fingerprints = &new_fingerprints;
+		}
+		return diff_root(ctx, old_json, new_json, diff_json, parse_ns);
+	}
+
+	DiffResultP JsonDiff::diff(const JsonValue& old_json, const JsonValue& new_json, JsonFingerprintCache& old_fingerprints)
+	{
+		JsonFingerprintCache new_fingerprints;
+		return diff(old_json, new_json, old_fingerprints, new_fingerprints);
+	}
+
+	DiffResultP JsonDiff::diff(const JsonValue& old_json, const JsonValue& new_json, JsonFingerprintCache& old_fingerprints, JsonFingerprintCache& new_fingerprints)
+	{
+		DiffContext ctx;
+		ctx.old_fingerprints = &old_fingerprints;
+		ctx.new_fingerprints = &new_fingerprints;
+		ctx.track_path = _track_path;
+		JsonValue diff_json;
+		if (!diff_root(ctx, old_json, new_json, diff_json))
+			return DiffResult::make_undefined_diff_result();
+		return std::make_shared<DiffResult>(std::move(diff_json));
+	}
+
+	DiffResultP JsonDiff::diff(const NativeJsonValue& old_json, const NativeJsonValue& new_json)
+	{
+		DiffContext ctx;
+		ctx.track_path = _track_path;
+		JsonValue diff_json;
+		if (!diff_root(ctx, old_json, new_json, diff_json))
+			return DiffResult::make_undefined_diff_result();
+		return std::make_shared<DiffResult>(std::move(diff_json));
+	}
+
+	void JsonDiff::diff_batch(const JsonValuePair* pairs, size_t count, std::vector<DiffResult>& results)
+	{
+		results.resize(count);
+		DiffContext ctx;
+		ctx.track_path = _track_path;
+		run_batch(_options.thread_pool.get(), ctx, count, [&](DiffContext& task_ctx, size_t, size_t begin, size_t end) {
+			// one pair of caches per task, cleared between the pairs so their buckets are reused
+			JsonFingerprintCache old_fingerprints;
+			JsonFingerprintCache new_fingerprints;
+			if (_options.use_fingerprints)
+			{
+				task_ctx.old_fingerprints = &old_fingerprints;
+				task_ctx.new_fingerprints = &new_fingerprints;
+			}
+			for (size_t k = begin; k < end; k++)
+			{
+				old_fingerprints.clear();
+				new_fingerprints.clear();
+				JsonValue diff_json;
+				if (diff_root(task_ctx, *pairs[k].old_json, *pairs[k].new_json, diff_json))
+					results[k] = DiffResult(std::move(diff_json));
+				else
+					results[k] = DiffResult();
+			}
+		});
+	}
+
+	void JsonDiff::diff_batch(const JsonTextPair* pairs, size_t count, std::vector<DiffResult>& results, DiffBatchScratch& scratch)
+	{
+		results.resize(count);
+		auto pool = _options.thread_pool.get();
+		size_t task_count = pool && count > 1 ? parallel_chunk_count(*pool, count) : 1;
+		scratch.reserve(task_count * 2);
+		DiffContext ctx;
+		ctx.track_path = _track_path;
+		run_batch(pool, ctx, count, [&](DiffContext& task_ctx, size_t chunk, size_t begin, size_t end) {
+			auto& old_doc = scratch.document(chunk * 2);
+			auto& new_doc = scratch.document(chunk * 2 + 1);
+			for (size_t k = begin; k < end; k++)
+			{
+				old_doc.parse(pairs[k].old_json, pairs[k].old_size);
+				new_doc.parse(pairs[k].new_json, pairs[k].new_size);
+				JsonValue diff_json;
+				if (diff_root(task_ctx, old_doc.root(), new_doc.root(), diff_json))
+					results[k] = DiffResult(std::move(diff_json));
+				else
+					results[k] = DiffResult();
+			}
+		});
+	}
+
+	void JsonDiff::diff_batch(const JsonTextPair* pairs, size_t count, std::vector<DiffResult>& results)
+	{
+		DiffBatchScratch scratch;
+		diff_batch(pairs, count, results, scratch);
+	}
+
+	bool JsonDiff::diff_at(const std::vector<std::string>& path, const JsonValue& old_json, const JsonValue& new_json, JsonValue& diff_json)
+	{
+		DiffContext ctx;
+		ctx.track_path = _track_path;
+		if (ctx.track_path)
+			ctx.path = path;
+		return diff_value(ctx, old_json, new_json, diff_json);
+	}
+
+	bool JsonDiff::diff_at(const std::vector<std::string>& path, const JsonValue& old_json, const JsonValue& new_json, JsonValue& diff_json,
+		size_t& compared_values, size_t& changes)
+	{
+		DiffContext ctx;
+		ctx.track_path = _track_path;
+		if (ctx.track_path)
+			ctx.path = path;
+		DiffBudget budget(_options);
+		budget.compared_values = compared_values;
+		budget.changes = changes;
+		ctx.budget = &budget;
+		bool changed = diff_value(ctx, old_json, new_json, diff_json);
+		compared_values = budget.compared_values;
+		changes = budget.changes;
+		return changed;
+	}
+
+	// true if the first count tokens of path match pattern, whose "*" tokens match any token
+	static bool path_pattern_match(const std::vector<std::string>& pattern, const std::vector<std::string>& path, size_t count)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			if (pattern[i] != "*" && pattern[i] != path[i])
+				return false;
+		}
+		return true;
+	}
+
+	bool JsonDiff::path_in_scope(const std::vector<std::string>& path) const
+	{
+		for (const auto& pattern : _exclude_patterns)
+		{
+			// at or below an excluded path
+			if (pattern.size() <= path.size() && path_pattern_match(pattern, path, pattern.size()))
+				return false;
+		}
+		if (_include_patterns.empty())
+			return true;
+		for (const auto& pattern : _include_patterns)
+		{
+			// at or below an included path, or on the way to one
+			if (path_pattern_match(pattern, path, std::min(pattern.size(), path.size())))
+				return true;
+		}
+		return false;
+	}
+
+	bool JsonDiff::child_in_scope(DiffContext& ctx, const std::string& token) const
+	{
+		if (_include_patterns.empty() && _exclude_patterns.empty())
+			return true;
+		ctx.path.push_back(token);
+		bool in_scope = path_in_scope(ctx.path);
+		ctx.path.pop_back();
+		return in_scope;
+	}
+
+	template <typename Value>
+	bool JsonDiff::diff_root(DiffContext& ctx, const Value& old_json, const Value& new_json, JsonValue& diff_json, uint64_t parse_ns)
+	{
+		if (!_options.stats)
+		{
+			if (!diff_within_budget(ctx, old_json, new_json, diff_json))
+				return false;
+			if (_options.diff_fingerprints)
+				add_diff_fingerprints(diff_json, old_json, new_json);
+			return true;
+		}
+		DiffStats stats(DSO_DIFF);
+		stats.calls = 1;
+		stats.parse_ns = parse_ns;
+		// the parallel tasks of this diff add their stats to these under one lock
+		auto saved_stats = ctx.stats;
+		auto saved_stats_mutex = ctx.stats_mutex;
+		ctx.stats_mutex = std::make_shared<std::mutex>();
+		ctx.stats = &stats;
+		auto start = std::chrono::steady_clock::now();
+		bool changed;
+		try
+		{
+			changed = diff_within_budget(ctx, old_json, new_json, diff_json);
+			if (changed && _options.diff_fingerprints)
+				add_diff_fingerprints(diff_json, old_json, new_json);
+		}
+		catch (...)
+		{
+			ctx.stats = saved_stats;
+			ctx.stats_mutex = saved_stats_mutex;
+			throw;
+		}
+		stats.diff_ns = elapsed_ns(start);
+		ctx.stats = saved_stats;
+		ctx.stats_mutex = saved_stats_mutex;
+		if (changed)
+		{
+			stats.diff_values = count_json_values(diff_json);
+			start = std::chrono::steady_clock::now();
+			ByteCountBuffer counter;
+			std::ostream out(&counter);
+			json_write(out, diff_json);
+			stats.output_bytes = counter.count();
+			stats.serialize_ns = elapsed_ns(start);
+		}
+		_options.stats->record(stats);
+		return changed;
+	}
+
+	template <typename Value>
+	bool JsonDiff::diff_within_budget(DiffContext& ctx, const Value& old_json, const Value& new_json, JsonValue& diff_json)
+	{
+		if (_options.max_compared_values == SIZE_MAX && _options.max_changes == SIZE_MAX)
+			return diff_value(ctx, old_json, new_json, diff_json);
+		typedef JsonValueTraits<Value> Traits;
+		DiffBudget budget(_options);
+		ctx.budget = &budget;
+		try
+		{
+			bool changed = diff_value(ctx, old_json, new_json, diff_json);
+			ctx.budget = nullptr;
+			return changed;
+		}
+		catch (const JsonDiffBudgetException&)
+		{
+			ctx.budget = nullptr;
+			ctx.path.clear();
+			if (_options.budget_action == DBA_THROW)
+				throw;
+		}
+		// the work done so far is dropped, the documents replace each other whole
+		fc::mutable_variant_object result_json;
+		result_json[JSONDIFF_KEY_OLD_VALUE] = Traits::to_json(old_json);
+		result_json[JSONDIFF_KEY_NEW_VALUE] = Traits::to_json(new_json);
+		diff_json = std::move(result_json);
+		return true;
+	}
+
+	template <typename Value>
+	bool JsonDiff::diff_value(DiffContext& ctx, const Value& old_json, const Value& new_json, JsonValue& diff_json)
+	{
+		typedef JsonValueTraits<Value> Traits;
+		// the subtrees left out by the path filters aren't looked at
+		if (ctx.track_path && !path_in_scope(ctx.path))
+			return false;
+		if (ctx.budget)
+			ctx.budget->compare();
+		auto old_json_type = Traits::type(old_json);
+		auto new_json_type = Traits::type(new_json);
+		DiffContext::StatsDepthGuard stats_depth_guard(ctx);
+		if (ctx.stats && old_json_type <= JVT_ARRAY)
+			ctx.stats->visited[old_json_type]++;
+
+		if (!is_scalar_json_value_type(old_json_type) && old_json_type == new_json_type)
+		{
+			// equal object/array subtrees are skipped without walking them
+			if (Traits::shares_storage(old_json, new_json) || ctx.cached_equal(old_json, new_json))
+			{
+				if (ctx.stats)
+					ctx.stats->skipped_equal++;
+				return false;
+			}
+			if (ctx.track_path && ctx.path.size() >= _options.max_depth)
+			{
+				// below the depth limit a changed subtree is replaced whole
+				if (Traits::equal(old_json, new_json))
+					return false;
+				ctx.count_change();
+				fc::mutable_variant_object result_json;
+				result_json[JSONDIFF_KEY_OLD_VALUE] = Traits::to_json(old_json);
+				result_json[JSONDIFF_KEY_NEW_VALUE] = Traits::to_json(new_json);
+				diff_json = std::move(result_json);
+				return true;
+			}
+		}
 
 		if (is_scalar_json_value_type(old_json_type) || old_json_type != new_json_type)
 		{
 			// oldֵǻ oldnewֵͲһ
 			// should return undefined for two identical values
 			// should return { __old: <old value>, __new : <new value> } object for two different numbers
-			if (is_scalar_json_value_type(old_json_type) && old_json_type == new_json_type) {
-				if (JVT_STRING == old_json_type) {
-					const auto& old_str = old_json.as_string();
-					const auto& new_str = new_json.as_string();
-					if (old_str.size() != new_str.size() || old_str != new_str) {
-						fc::mutable_variant_object result_json;
-						result_json[JSONDIFF_KEY_OLD_VALUE] = old_json;
-						result_json[JSONDIFF_KEY_NEW_VALUE] = new_json;
-						return std::make_shared<DiffResult>(result_json);
-					}
-					else {
-						// identical scalar values
-						return DiffResult::make_undefined_diff_result();
-					}
-				}
-				else if (json_dumps(old_json) != json_dumps(new_json)) {
-					fc::mutable_variant_object result_json;
-					result_json[JSONDIFF_KEY_OLD_VALUE] = old_json;
-					result_json[JSONDIFF_KEY_NEW_VALUE] = new_json;
-					return std::make_shared<DiffResult>(result_json);
-				}
-				else {
-					// identical scalar values
-					return DiffResult::make_undefined_diff_result();
-				}
-			}
-			else if (old_json_type != new_json_type)
+			// typed comparison, unchanged leaves are compared without allocating
+			bool changed = !is_scalar_json_value_type(old_json_type) || !is_scalar_json_value_type(new_json_type)
+				|| !Traits::scalar_equal(old_json, new_json);
+			if (!changed)
 			{
-				fc::mutable_variant_object result_json;
-				result_json[JSONDIFF_KEY_OLD_VALUE] = old_json;
-				result_json[JSONDIFF_KEY_NEW_VALUE] = new_json;
-				return std::make_shared<DiffResult>(result_json);
+				// identical scalar values
+				return false;
 			}
-			else
+			ctx.count_change();
+			if (old_json_type == JVT_STRING && new_json_type == JVT_STRING)
 			{
-				// identical scalar values
-				return DiffResult::make_undefined_diff_result();
+				// long strings that only differ in places keep the changed parts
+				const auto& old_str = old_json.get_string();
+				const auto& new_str = new_json.get_string();
+				if (std::max(old_str.size(), new_str.size()) >= _options.string_delta_min_size
+					&& make_string_delta(old_str.data(), old_str.size(), new_str.data(), new_str.size(), diff_json))
+					return true;
 			}
+			fc::mutable_variant_object result_json;
+			result_json[JSONDIFF_KEY_OLD_VALUE] = Traits::to_json(old_json);
+			result_json[JSONDIFF_KEY_NEW_VALUE] = Traits::to_json(new_json);
+			diff_json = std::move(result_json);
+			return true;
 		}
 		else if (old_json_type == JsonValueType::JVT_OBJECT)
 		{
@@ -83,41 +973,128 @@ namespace jsondiff
 			// should return { <key>__added: <new value> } when the first object is missing a key
 			// should return { <key>: { __old: <old value>, __new : <new value> } } for two objects with diffent scalar values for a key
 			// should return { <key>: <diff> } with a recursive diff for two objects with diffent values for a key
-			auto a_obj = old_json.as<fc::mutable_variant_object>();
-			auto b_obj = new_json.as<fc::mutable_variant_object>();
-			bool same = false;
-			fc::mutable_variant_object diff_json;
+			// both sides are walked through const references, only values that end up in the diff are copied
+			const auto& a_obj = Traits::get_object(old_json);
+			const auto& b_obj = Traits::get_object(new_json);
+			if (ctx.stats)
+				ctx.stats->object_fanout[DiffStats::fanout_bucket(std::max(a_obj.size(), b_obj.size()))]++;
+			utils::ObjectKeyIndex<const typename Traits::object_type> b_index(b_obj);
+			// the members of a wide object are diffed by tasks first, the loop below takes their results in order,
+			// so the diff is the same as the serial one. the fingerprint caches were filled for both subtrees above
+			// and are only read by the tasks
+			IndexedDiffs member_diffs;
+			size_t next_member_diff = 0;
+			// the tasks also tell which keys are in new, so they are only looked up once
+			std::vector<char> member_matched;
+			bool parallel = _options.thread_pool && a_obj.size() >= _options.parallel_min_size;
+			if (parallel)
+			{
+				member_matched.assign(a_obj.size(), 0);
+				std::vector<IndexedDiffs> chunk_diffs(parallel_chunk_count(*_options.thread_pool, a_obj.size()));
+				run_chunks(*_options.thread_pool, ctx, a_obj.size(), [&](DiffContext& task_ctx, size_t chunk, size_t begin, size_t end) {
+					for (size_t k = begin; k < end; k++)
+					{
+						auto i = a_obj.begin() + k;
+						auto b_i = b_index.find(i->key());
+						if (b_i == b_index.end())
+							continue;
+						member_matched[k] = 1;
+						JsonValue sub_diff_json;
+						if (task_ctx.track_path)
+							task_ctx.path.push_back(Traits::key_string(i->key()));
+						bool changed = diff_value(task_ctx, i->value(), b_i->value(), sub_diff_json);
+						if (task_ctx.track_path)
+							task_ctx.path.pop_back();
+						if (changed)
+							chunk_diffs[chunk].push_back(std::make_pair(k, std::move(sub_diff_json)));
+					}
+				});
+				member_diffs = join_chunk_diffs(chunk_diffs);
+			}
+			// the entries are collected first and appended to the diff object at the end, without looking each key up
+			std::vector<fc::mutable_variant_object::entry> diff_entries;
+			// a changed member named like a deleted or added one, e.g. "a__added" next to an added "a", must replace
+			// that entry as set did, which needs the lookups
+			bool postfixed_keys = false;
+			size_t matched_count = 0;
 			for (auto i = a_obj.begin(); i != a_obj.end(); i++)
 			{
-				auto a_i_value = i->value();
-				auto a_i_key = i->key();
-				if (b_obj.find(a_i_key) == b_obj.end())
+				const auto& a_i_key = i->key();
+				bool matched;
+				auto b_i = b_index.end();
+				if (parallel)
+					matched = member_matched[i - a_obj.begin()] != 0;
+				else
+				{
+					b_i = b_index.find(a_i_key);
+					matched = b_i != b_index.end();
+				}
+				if (!matched)
 				{
 					// oldnew
-					diff_json[a_i_key + JSONDIFF_KEY_DELETED_POSTFIX] = a_i_value;
+					if (ctx.track_path && !child_in_scope(ctx, Traits::key_string(a_i_key)))
+						continue;
+					ctx.count_change();
+					diff_entries.emplace_back(Traits::key_string(a_i_key) + JSONDIFF_KEY_DELETED_POSTFIX, Traits::to_json(i->value()));
 				}
 				else
 				{
 					// oldnewжkey
-					auto sub_diff_value = diff(a_i_value, b_obj[a_i_key]);
-					if (sub_diff_value->is_undefined()) // һԪ
+					matched_count++;
+					JsonValue sub_diff_json;
+					bool changed;
+					if (parallel)
+					{
+						size_t k = i - a_obj.begin();
+						changed = next_member_diff < member_diffs.size() && member_diffs[next_member_diff].first == k;
+						if (changed)
+							sub_diff_json = std::move(member_diffs[next_member_diff++].second);
+					}
+					else
+					{
+						if (ctx.track_path)
+							ctx.path.push_back(Traits::key_string(a_i_key));
+						changed = diff_value(ctx, i->value(), b_i->value(), sub_diff_json);
+						if (ctx.track_path)
+							ctx.path.pop_back();
+					}
+					if (!changed) // һԪ
 						continue;
 					// ޸
-					diff_json[a_i_key] = sub_diff_value->value();
+					diff_entries.emplace_back(Traits::key_string(a_i_key), std::move(sub_diff_json));
+					const auto& diff_key = diff_entries.back().key();
+					postfixed_keys = postfixed_keys || utils::string_ends_with(diff_key, JSONDIFF_KEY_DELETED_POSTFIX)
+						|| utils::string_ends_with(diff_key, JSONDIFF_KEY_ADDED_POSTFIX);
 				}
 			}
-			for (auto j = b_obj.begin(); j != b_obj.end(); j++)
+			if (matched_count < b_obj.size())
 			{
-				auto key = j->key();
-				if (a_obj.find(key) == a_obj.end())
+				// only look for added keys when some keys of new were not matched
+				utils::ObjectKeyIndex<const typename Traits::object_type> a_index(a_obj);
+				for (auto j = b_obj.begin(); j != b_obj.end(); j++)
 				{
+					const auto& key = j->key();
+					if (a_index.contains(key))
+						continue;
 					// oldǴnew
-					diff_json[key + JSONDIFF_KEY_ADDED_POSTFIX] = j->value();
+					if (ctx.track_path && !child_in_scope(ctx, Traits::key_string(key)))
+						continue;
+					ctx.count_change();
+					diff_entries.emplace_back(Traits::key_string(key) + JSONDIFF_KEY_ADDED_POSTFIX, Traits::to_json(j->value()));
 				}
 			}
-			if (diff_json.size() < 1)
-				return DiffResult::make_undefined_diff_result();
-			return std::make_shared<DiffResult>(diff_json);
+			if (diff_entries.empty())
+				return false;
+			fc::mutable_variant_object diff_json_obj;
+			if (postfixed_keys)
+			{
+				for (auto& entry : diff_entries)
+					diff_json_obj.set(entry.key(), std::move(entry.value()));
+			}
+			else
+				utils::append_object_entries(diff_json_obj, diff_entries);
+			diff_json = std::move(diff_json_obj);
+			return true;
 		}
 		else if (old_json_type == JsonValueType::JVT_ARRAY)
 		{
@@ -133,57 +1110,272 @@ namespace jsondiff
 			//   should return[..., ['+', insert_position_index, <added item>], ...] for two arrays when the second array has an extra value
 			//   should return[..., ['~', position_index, <diff>], ...] for two arrays when an item has been modified(note: involves a crazy heuristic)
 
-			auto a_array = old_json.as<fc::variants>();
-			auto b_array = new_json.as<fc::variants>();
+			const auto& a_array = Traits::get_array(old_json);
+			const auto& b_array = Traits::get_array(new_json);
+			if (ctx.stats)
+				ctx.stats->array_fanout[DiffStats::fanout_bucket(std::max(a_array.size(), b_array.size()))]++;
 
-			// TODO: arrayĴ󲿷Ԫͬʱǿǰ벿ԪأʱӦþdiffС
+			fc::variants diff_json_array;
+			const ArrayKeyPattern* key_pattern = find_array_key_pattern(ctx.path);
+			if (key_pattern && diff_keyed_array(ctx, *key_pattern, old_json, new_json, diff_json_array))
+			{
+				if (diff_json_array.size() < 1)
+					return false;
+				diff_json = std::move(diff_json_array);
+				return true;
+			}
 
-			// һarrayж仯ʱ diffԭʼindex
+			// equal elements are interned to the same symbol and the arrays are matched by the longest common subsequence
+			// of their symbols, so an insert near the front doesn't turn every later element into a change.
+			// the unmatched elements between two matches are paired up in order as modified ones ('~'),
+			// the rest are removed ('-', index in old) or added ('+', index in new)
+			auto& scratch = ctx.array_scratch;
+			ArraySymbolTable<Value> symbols(a_array.size() + b_array.size(), scratch.symbol_slots, scratch.symbol_values);
+			auto& a_symbols = scratch.a_symbols;
+			auto& b_symbols = scratch.b_symbols;
+			a_symbols.resize(a_array.size());
+			b_symbols.resize(b_array.size());
+			bool parallel = _options.thread_pool && a_array.size() + b_array.size() >= _options.parallel_min_size;
+			if (parallel)
+			{
+				// the elements are hashed by tasks, the symbols are still given out in order
+				auto& fingerprints = scratch.fingerprints;
+				fingerprints.resize(a_array.size() + b_array.size());
+				run_chunks(*_options.thread_pool, ctx, fingerprints.size(), [&](DiffContext& task_ctx, size_t, size_t begin, size_t end) {
+					for (size_t k = begin; k < end; k++)
+					{
+						fingerprints[k] = k < a_array.size() ? task_ctx.old_fingerprint(a_array[k])
+							: task_ctx.new_fingerprint(b_array[k - a_array.size()]);
+					}
+				});
+				for (size_t i = 0; i < a_array.size(); i++)
+					a_symbols[i] = symbols.intern(a_array[i], fingerprints[i]);
+				for (size_t i = 0; i < b_array.size(); i++)
+					b_symbols[i] = symbols.intern(b_array[i], fingerprints[a_array.size() + i]);
+			}
+			else
+			{
+				for (size_t i = 0; i < a_array.size(); i++)
+					a_symbols[i] = symbols.intern(a_array[i], ctx.old_fingerprint(a_array[i]));
+				for (size_t i = 0; i < b_array.size(); i++)
+					b_symbols[i] = symbols.intern(b_array[i], ctx.new_fingerprint(b_array[i]));
+			}
+			if (scratch.matches.size() <= scratch.depth)
+				scratch.matches.push_back(std::unique_ptr<std::vector<SequenceMatch>>(new std::vector<SequenceMatch>()));
+			auto& matches = *scratch.matches[scratch.depth];
+			sequence_lcs(a_symbols, b_symbols, _options.array_diff_max_cost, scratch.lcs, matches);
+			if (ctx.stats)
+				ctx.stats->skipped_equal += matches.size();
+			matches.push_back(SequenceMatch(a_array.size(), b_array.size()));
+			// the elements diffed below use the next level's matches
+			struct DepthGuard
+			{
+				size_t& depth;
+				explicit DepthGuard(size_t& depth_) : depth(depth_) { depth++; }
+				~DepthGuard() { depth--; }
+			} depth_guard(scratch.depth);
 
-			fc::variants diff_json;
-			for (size_t i = 0; i < a_array.size(); i++)
+			// with enough paired elements they are diffed by tasks first, the loop below takes their results in order
+			std::vector<std::pair<size_t, size_t>> pairs;
+			IndexedDiffs pair_diffs;
+			size_t next_pair_diff = 0;
+			if (parallel)
 			{
-				if (i >= b_array.size())
+				size_t a_next = 0;
+				size_t b_next = 0;
+				for (const auto& match : matches)
 				{
-					// ɾԪ
-					fc::variants item_diff;
-					item_diff.push_back("-");
-					item_diff.push_back(i);
-					item_diff.push_back(a_array[i]);
-					diff_json.push_back(item_diff);
+					size_t paired_count = std::min(match.first - a_next, match.second - b_next);
+					for (size_t k = 0; k < paired_count; k++)
+						pairs.push_back(std::make_pair(a_next + k, b_next + k));
+					a_next = match.first + 1;
+					b_next = match.second + 1;
 				}
-				else
+				parallel = pairs.size() >= _options.parallel_min_size;
+			}
+			if (parallel)
+			{
+				std::vector<IndexedDiffs> chunk_diffs(parallel_chunk_count(*_options.thread_pool, pairs.size()));
+				run_chunks(*_options.thread_pool, ctx, pairs.size(), [&](DiffContext& task_ctx, size_t chunk, size_t begin, size_t end) {
+					for (size_t k = begin; k < end; k++)
+					{
+						JsonValue item_value_diff;
+						if (task_ctx.track_path)
+							task_ctx.path.push_back(std::to_string(pairs[k].first));
+						bool changed = diff_value(task_ctx, a_array[pairs[k].first], b_array[pairs[k].second], item_value_diff);
+						if (task_ctx.track_path)
+							task_ctx.path.pop_back();
+						if (changed)
+							chunk_diffs[chunk].push_back(std::make_pair(k, std::move(item_value_diff)));
+					}
+				});
+				pair_diffs = join_chunk_diffs(chunk_diffs);
+			}
+
+			size_t a_pos = 0;
+			size_t b_pos = 0;
+			size_t pair_pos = 0;
+			for (const auto& match : matches)
+			{
+				size_t paired_count = std::min(match.first - a_pos, match.second - b_pos);
+				for (size_t k = 0; k < paired_count; k++)
 				{
-					auto item_value_diff = diff(a_array[i], b_array[i]);
-					if (item_value_diff->is_undefined()) // ûзı
+					JsonValue item_value_diff;
+					bool changed;
+					if (parallel)
+					{
+						changed = next_pair_diff < pair_diffs.size() && pair_diffs[next_pair_diff].first == pair_pos;
+						if (changed)
+							item_value_diff = std::move(pair_diffs[next_pair_diff++].second);
+						pair_pos++;
+					}
+					else
+					{
+						if (ctx.track_path)
+							ctx.path.push_back(std::to_string(a_pos + k));
+						changed = diff_value(ctx, a_array[a_pos + k], b_array[b_pos + k], item_value_diff);
+						if (ctx.track_path)
+							ctx.path.pop_back();
+					}
+					if (!changed)
 						continue;
 					// ޸Ԫ
-					fc::variants item_diff;
-					item_diff.push_back("~");
-					item_diff.push_back(i);
-					item_diff.push_back(item_value_diff->value());
-					diff_json.push_back(item_diff);
+					diff_json_array.push_back(make_array_diff_item("~", a_pos + k, std::move(item_value_diff)));
+				}
+				for (size_t i = a_pos + paired_count; i < match.first; i++)
+				{
+					// ɾԪ
+					ctx.count_change();
+					diff_json_array.push_back(make_array_diff_item("-", i, Traits::to_json(a_array[i])));
+				}
+				for (size_t j = b_pos + paired_count; j < match.second; j++)
+				{
+					// oldǴnew
+					ctx.count_change();
+					diff_json_array.push_back(make_array_diff_item("+", j, Traits::to_json(b_array[j])));
 				}
+				a_pos = match.first + 1;
+				b_pos = match.second + 1;
 			}
-			for (size_t i = a_array.size(); i < b_array.size(); i++)
+			if (diff_json_array.size() < 1)
+				return false;
+			diff_json = std::move(diff_json_array);
+			return true;
+		}
+		else
+		{
+			throw JsonDiffException(std::string("not supported json value type to diff ") + json_dumps(Traits::to_json(old_json)));
+		}
+	}
+
+	const JsonDiff::ArrayKeyPattern* JsonDiff::find_array_key_pattern(const std::vector<std::string>& path) const
+	{
+		for (const auto& pattern : _array_key_patterns)
+		{
+			if (pattern.path.size() != path.size())
+				continue;
+			bool matched = true;
+			for (size_t i = 0; i < pattern.path.size() && matched; i++)
+				matched = pattern.path[i] == "*" || pattern.path[i] == path[i];
+			if (matched)
+				return &pattern;
+		}
+		return nullptr;
+	}
+
+	template <typename Value>
+	bool JsonDiff::diff_keyed_array(DiffContext& ctx, const ArrayKeyPattern& pattern, const Value& old_json, const Value& new_json, fc::variants& diff_json_array)
+	{
+		typedef JsonValueTraits<Value> Traits;
+		const auto& a_array = Traits::get_array(old_json);
+		const auto& b_array = Traits::get_array(new_json);
+		// key values are interned to symbols, every symbol may appear once per side
+		ArraySymbolTable<Value> keys(a_array.size() + b_array.size());
+		const size_t no_index = SIZE_MAX;
+		std::vector<size_t> old_index_of_key;
+		std::vector<size_t> new_to_old(b_array.size(), no_index);
+		std::vector<bool> new_key_seen;
+		for (size_t i = 0; i < a_array.size(); i++)
+		{
+			if (!a_array[i].is_object())
+				return false;
+			const Value* key = Traits::pointer_find(a_array[i], pattern.key);
+			if (!key)
+				return false;
+			auto symbol = keys.intern(*key, Traits::fingerprint(*key));
+			if (symbol < old_index_of_key.size())
+				return false; // duplicate key
+			old_index_of_key.push_back(i);
+		}
+		new_key_seen.resize(a_array.size() + b_array.size());
+		for (size_t j = 0; j < b_array.size(); j++)
+		{
+			if (!b_array[j].is_object())
+				return false;
+			const Value* key = Traits::pointer_find(b_array[j], pattern.key);
+			if (!key)
+				return false;
+			auto symbol = keys.intern(*key, Traits::fingerprint(*key));
+			if (new_key_seen[symbol])
+				return false;
+			new_key_seen[symbol] = true;
+			if (symbol < old_index_of_key.size())
+				new_to_old[j] = old_index_of_key[symbol];
+		}
+
+		// matched elements stay in place if they are on a longest run in increasing old order, the others are moved
+		std::vector<size_t> matched_old_indexes;
+		std::vector<size_t> matched_new_indexes;
+		for (size_t j = 0; j < b_array.size(); j++)
+		{
+			if (new_to_old[j] == no_index)
+				continue;
+			matched_old_indexes.push_back(new_to_old[j]);
+			matched_new_indexes.push_back(j);
+		}
+		std::vector<size_t> old_to_new(a_array.size(), no_index);
+		std::vector<bool> old_kept(a_array.size());
+		for (size_t k = 0; k < matched_old_indexes.size(); k++)
+			old_to_new[matched_old_indexes[k]] = matched_new_indexes[k];
+		for (auto k : longest_increasing_subsequence(matched_old_indexes))
+			old_kept[matched_old_indexes[k]] = true;
+
+		for (size_t i = 0; i < a_array.size(); i++)
+		{
+			size_t j = old_to_new[i];
+			if (j == no_index)
+			{
+				// ɾԪ
+				ctx.count_change();
+				diff_json_array.push_back(make_array_diff_item("-", i, Traits::to_json(a_array[i])));
+				continue;
+			}
+			if (!old_kept[i])
 			{
-				// oldǴnew
-				fc::variants item_diff;
-				item_diff.push_back("+");
-				item_diff.push_back(i);
-				item_diff.push_back(b_array[i]);
-				diff_json.push_back(item_diff);
+				ctx.count_change();
+				diff_json_array.push_back(make_array_diff_item(">", i, (uint64_t)j));
 			}
-			if (diff_json.size() < 1)
+			JsonValue item_value_diff;
+			if (ctx.track_path)
+				ctx.path.push_back(std::to_string(i));
+			bool changed = diff_value(ctx, a_array[i], b_array[j], item_value_diff);
+			if (ctx.track_path)
+				ctx.path.pop_back();
+			if (changed)
 			{
-				return DiffResult::make_undefined_diff_result();
+				// ޸Ԫ
+				diff_json_array.push_back(make_array_diff_item("~", i, std::move(item_value_diff)));
 			}
-			return std::make_shared<DiffResult>(diff_json);
 		}
-		else
+		for (size_t j = 0; j < b_array.size(); j++)
 		{
-			throw JsonDiffException(std::string("not supported json value type to diff ") + json_dumps(old_json));
+			if (new_to_old[j] == no_index)
+			{
+				ctx.count_change();
+				diff_json_array.push_back(make_array_diff_item("+", j, Traits::to_json(b_array[j])));
+			}
 		}
+		return true;
 	}
 
 	JsonValue JsonDiff::patch_by_string(const std::string& old_json_value, DiffResultP diff_info)
@@ -193,100 +1385,179 @@ namespace jsondiff
 
 	JsonValue JsonDiff::patch(const JsonValue& old_json, const DiffResultP& diff_info)
 	{
-		auto old_json_type = guess_json_value_type(old_json);
-		auto diff_json = diff_info->value();
-		auto result = json_deep_clone(old_json);
-		if (diff_info->is_undefined() || diff_json.is_null())
-			return result;
-		
-		auto old_json_str = json_dumps(old_json);
-		auto diff_json_str = json_dumps(diff_json);
-		
-		if (is_scalar_json_value_type(old_json_type) || is_scalar_value_diff_format(diff_json))
-		{ // TODO: жҪ޸ĵü׼ȷһ㣬޸diffjsonʽ{__old: ..., __new: ...}ͨobject diff
-			if (!diff_json.is_object())
+		// objects are shared by the copy, only the parts on the path of a change are rebuilt
+		JsonValue result(old_json);
+		patch_inplace(result, *diff_info);
+		return result;
+	}
+
+	JsonValue JsonDiff::patch(JsonValue&& old_json, const DiffResultP& diff_info)
+	{
+		patch_inplace(old_json, *diff_info);
+		return std::move(old_json);
+	}
+
+	void JsonDiff::patch_inplace(JsonValue& json, const DiffResult& diff_info)
+	{
+		if (diff_info.is_undefined() || diff_info.value().is_null())
+			return;
+		patch_inplace(json, *diff_info.compiled());
+	}
+
+	void JsonDiff::patch_inplace(JsonValue& json, const CompiledDiff& diff)
+	{
+		if (diff.is_undefined())
+			return;
+		JsonValueTraits<JsonValue>::allocator_type allocator;
+		if (!_options.stats)
+		{
+			patch_root(json, diff, allocator);
+			return;
+		}
+		auto start = std::chrono::steady_clock::now();
+		patch_root(json, diff, allocator);
+		record_apply_stats(DSO_PATCH, diff, elapsed_ns(start));
+	}
+
+	void JsonDiff::patch_inplace(NativeJsonDocument& doc, const DiffResult& diff_info)
+	{
+		if (diff_info.is_undefined() || diff_info.value().is_null())
+			return;
+		patch_inplace(doc, *diff_info.compiled());
+	}
+
+	void JsonDiff::patch_inplace(NativeJsonDocument& doc, const CompiledDiff& diff)
+	{
+		if (diff.is_undefined())
+			return;
+		if (!_options.stats)
+		{
+			patch_root(doc.root(), diff, doc.arena());
+			return;
+		}
+		auto start = std::chrono::steady_clock::now();
+		patch_root(doc.root(), diff, doc.arena());
+		record_apply_stats(DSO_PATCH, diff, elapsed_ns(start));
+	}
+
+	void JsonDiff::record_apply_stats(DiffStatsOperation operation, const CompiledDiff& diff, uint64_t apply_ns) const
+	{
+		DiffStats stats(operation);
+		stats.calls = 1;
+		stats.diff_ns = apply_ns;
+		count_diff_node(diff.root(), operation, 0, stats);
+		stats.diff_values = count_json_values(diff.json());
+		_options.stats->record(stats);
+	}
+
+	template <typename Value, typename Allocator>
+	void JsonDiff::patch_root(Value& json, const CompiledDiff& diff, Allocator& allocator)
+	{
+		if (!has_diff_fingerprints(diff.root()))
+		{
+			patch_node(json, diff.root(), allocator);
+			return;
+		}
+		// the base is checked before anything is changed
+		verify_diff_fingerprints(json, diff.root(), DS_OLD, "base document");
+		patch_node(json, diff.root(), allocator);
+		verify_diff_fingerprints(json, diff.root(), DS_NEW, "patched document");
+	}
+
+	template <typename Value, typename Allocator>
+	void JsonDiff::patch_node(Value& json, const CompiledDiffNode& node, Allocator& allocator)
+	{
+		typedef JsonValueTraits<Value> Traits;
+		auto old_json_type = Traits::type(json);
+		if (node.type == DNT_STRING_DELTA)
+		{
+			if (old_json_type != JVT_STRING)
+				throw JsonDiffException("wrong format of diffjson, string delta of a value that isn't a string");
+			const auto& str = json.get_string();
+			Traits::assign(json, JsonValue(apply_string_delta(str.data(), str.size(), node.hunks->get_array(), false)), allocator);
+		}
+		else if (is_scalar_json_value_type(old_json_type) || node.type == DNT_REPLACE)
+		{
+			if (node.type != DNT_REPLACE)
 				throw JsonDiffException("wrong format of diffjson of scalar json value");
-			result = diff_json[JSONDIFF_KEY_NEW_VALUE];
+			Traits::assign(json, *node.new_value, allocator);
 		}
 		else if (old_json_type == JsonValueType::JVT_OBJECT)
 		{
-			auto old_json_obj = old_json.as<fc::mutable_variant_object>();
-			auto diff_json_obj = diff_json.as<fc::mutable_variant_object>();
-			auto result_obj = result.as<fc::mutable_variant_object>();
-			for (auto i = diff_json_obj.begin(); i != diff_json_obj.end(); i++)
+			if (node.type != DNT_OBJECT)
+				throw JsonDiffException("wrong format of diffjson of this old version json");
+			// fc objects are immutable, so the object is rebuilt from its entries and the changed members are patched in place
+			typename Traits::ObjectEdit edit(json, allocator);
+			auto& result_obj = edit.object();
+			// keys are matched through a hash index, removed and added keys are applied in one pass at the end
+			utils::ObjectKeyIndex<typename Traits::ObjectEdit::object_type> result_index(result_obj);
+			std::vector<bool> removed;
+			std::vector<JsonMemberRef> appended;
+			for (const auto& op : node.ops)
 			{
-				auto key = i->key();
-				auto diff_item = i->value();
-				// key <key>__deleted  <key>__addedɾӣ޸keyֵ
-				if (utils::string_ends_with(key, JSONDIFF_KEY_DELETED_POSTFIX) && key.size() > strlen(JSONDIFF_KEY_DELETED_POSTFIX))
+				if (op.type == DOT_MEMBER_DELETED)
 				{
-					auto old_key = utils::string_without_ext(key, JSONDIFF_KEY_DELETED_POSTFIX);
-					if (old_json_obj.find(old_key) != old_json_obj.end())
+					auto found = result_index.find(op.key);
+					if (found != result_index.end())
 					{
 						// ɾԲ
-						result_obj.erase(old_key);
+						removed.resize(result_obj.size());
+						removed[found - result_obj.begin()] = true;
 						continue;
 					}
 				}
-				else if (utils::string_ends_with(key, JSONDIFF_KEY_ADDED_POSTFIX) && key.size() > strlen(JSONDIFF_KEY_ADDED_POSTFIX))
+				else if (op.type == DOT_MEMBER_ADDED)
 				{
-					auto old_key = utils::string_without_ext(key, JSONDIFF_KEY_ADDED_POSTFIX);
 					// Բ
-					result_obj[old_key] = diff_item;
+					auto found = result_index.find(op.key);
+					if (found != result_index.end())
+						edit.set(found, *op.value);
+					else
+						appended.push_back(JsonMemberRef(&op.key, op.value));
 					continue;
 				}
 				// ޸keyֵ
-				if (old_json_obj.find(key) == old_json_obj.end())
+				auto found = result_index.find(*op.json_key);
+				if (found == result_index.end())
 					throw JsonDiffException("wrong format of diffjson of this old version json");
-				auto sub_item_new = patch(old_json_obj[key], std::make_shared<DiffResult>(diff_item));
-				result_obj[key] = sub_item_new;
+				if (op.diff)
+					patch_node(found->value(), *op.diff, allocator);
+				else
+				{
+					// a <key>__deleted member whose key is missing, read as a change of the member named <key>__deleted
+					CompiledDiffNode member_node;
+					CompiledDiff::compile_node(*op.value, member_node);
+					patch_node(found->value(), member_node, allocator);
+				}
 			}
-			return result_obj;
+			edit.commit(removed, appended);
 		}
 		else if (old_json_type == JsonValueType::JVT_ARRAY)
 		{
-			auto old_json_array = old_json.as<fc::variants>();
-			auto diff_json_array = diff_json.as<fc::variants>();
-			auto result_array = result.as<fc::variants>();
-			for (size_t i = 0; i < diff_json_array.size(); i++)
-			{
-				if (!diff_json_array[i].is_array())
-					throw JsonDiffException("diffjson format error for array diff");
-				auto diff_item = diff_json_array[i].as<fc::variants>();
-				if (diff_item.size() != 3)
-					throw JsonDiffException("diffjson format error for array diff");
-				auto op_item = diff_item[0].as_string();
-				auto pos = diff_item[1].as_uint64();
-				auto inner_diff_json = diff_item[2];
-				// FIXME һarrayж仯ʱ diffԭʼindexӦҳ pos => old_jsonֵͬpos
-				if (op_item == std::string("+"))
-				{
-					// Ԫ
-					result_array.insert(result_array.begin() + pos, inner_diff_json);
-				}
-				else if (op_item == std::string("-"))
-				{
-					// ɾԪ
-					result_array.erase(result_array.begin() + pos);
-				}
-				else if (op_item == std::string("~"))
-				{
-					// ޸Ԫ
-					auto sub_item_new = patch(old_json_array[i], std::make_shared<DiffResult>(inner_diff_json));
-					result_array[pos] = sub_item_new;
-				}
-				else
-				{
-					throw JsonDiffException(std::string("not supported diff array op now: ") + op_item);
-				}
+			// '-', '~' and '>' are positions in json, '+' and the targets of '>' are positions in the result.
+			// the work follows the number of ops, apart from moving the elements behind the first '-' or '+'
+			ArrayDiffOps ops;
+			group_array_diff_ops(node, ops);
+			typename Traits::ArrayEdit edit(json, allocator);
+			size_t size = edit.items().size();
+			sort_positions(ops.removed, size);
+			sort_positions(ops.modified, size);
+			check_modified_kept(ops.modified, ops.removed);
+			// ޸Ԫ, where they are before the splice
+			for (const auto& item : ops.modified)
+				patch_node(edit.items()[item.first], *item.second, allocator);
+			if (ops.moved.empty())
+			{
+				sort_positions(ops.added, size - ops.removed.size() + ops.added.size());
+				splice_array(edit, ops.removed, ops.added);
 			}
-			return result_array;
+			else
+				rebuild_array(edit, ops.removed, ops.added, ops.moved);
 		}
 		else
 		{
-			throw JsonDiffException(std::string("not supported json value type to merge patch ") + json_dumps(old_json));
+			throw JsonDiffException(std::string("not supported json value type to merge patch ") + json_dumps(Traits::to_json(json)));
 		}
-		return result;
 	}
 
 	JsonValue JsonDiff::rollback_by_string(const std::string& new_json_value, DiffResultP diff_info)
@@ -296,99 +1567,179 @@ namespace jsondiff
 
 	JsonValue JsonDiff::rollback(const JsonValue& new_json, DiffResultP diff_info)
 	{
-		auto new_json_type = guess_json_value_type(new_json);
-		auto diff_json = diff_info->value();
-		auto result = json_deep_clone(new_json);
-		if (diff_info->is_undefined() || diff_json.is_null())
-			return result;
+		// objects are shared by the copy, only the parts on the path of a change are rebuilt
+		JsonValue result(new_json);
+		rollback_inplace(result, *diff_info);
+		return result;
+	}
 
-		auto new_json_str = json_dumps(new_json);
-		auto diff_json_str = json_dumps(diff_json);
+	JsonValue JsonDiff::rollback(JsonValue&& new_json, DiffResultP diff_info)
+	{
+		rollback_inplace(new_json, *diff_info);
+		return std::move(new_json);
+	}
+
+	void JsonDiff::rollback_inplace(JsonValue& json, const DiffResult& diff_info)
+	{
+		if (diff_info.is_undefined() || diff_info.value().is_null())
+			return;
+		rollback_inplace(json, *diff_info.compiled());
+	}
+
+	void JsonDiff::rollback_inplace(JsonValue& json, const CompiledDiff& diff)
+	{
+		if (diff.is_undefined())
+			return;
+		JsonValueTraits<JsonValue>::allocator_type allocator;
+		if (!_options.stats)
+		{
+			rollback_root(json, diff, allocator);
+			return;
+		}
+		auto start = std::chrono::steady_clock::now();
+		rollback_root(json, diff, allocator);
+		record_apply_stats(DSO_ROLLBACK, diff, elapsed_ns(start));
+	}
+
+	void JsonDiff::rollback_inplace(NativeJsonDocument& doc, const DiffResult& diff_info)
+	{
+		if (diff_info.is_undefined() || diff_info.value().is_null())
+			return;
+		rollback_inplace(doc, *diff_info.compiled());
+	}
+
+	void JsonDiff::rollback_inplace(NativeJsonDocument& doc, const CompiledDiff& diff)
+	{
+		if (diff.is_undefined())
+			return;
+		if (!_options.stats)
+		{
+			rollback_root(doc.root(), diff, doc.arena());
+			return;
+		}
+		auto start = std::chrono::steady_clock::now();
+		rollback_root(doc.root(), diff, doc.arena());
+		record_apply_stats(DSO_ROLLBACK, diff, elapsed_ns(start));
+	}
 
-		if (is_scalar_json_value_type(new_json_type) || is_scalar_value_diff_format(diff_json))
-		{ // TODO: жҪ޸ĵü׼ȷһ㣬޸diffjsonʽ{__old: ..., __new: ...}ͨobject diff
-			if (!diff_json.is_object())
+	template <typename Value, typename Allocator>
+	void JsonDiff::rollback_root(Value& json, const CompiledDiff& diff, Allocator& allocator)
+	{
+		if (!has_diff_fingerprints(diff.root()))
+		{
+			rollback_node(json, diff.root(), allocator);
+			return;
+		}
+		verify_diff_fingerprints(json, diff.root(), DS_NEW, "base document");
+		rollback_node(json, diff.root(), allocator);
+		verify_diff_fingerprints(json, diff.root(), DS_OLD, "rolled back document");
+	}
+
+	template <typename Value, typename Allocator>
+	void JsonDiff::rollback_node(Value& json, const CompiledDiffNode& node, Allocator& allocator)
+	{
+		typedef JsonValueTraits<Value> Traits;
+		auto new_json_type = Traits::type(json);
+		if (node.type == DNT_STRING_DELTA)
+		{
+			if (new_json_type != JVT_STRING)
+				throw JsonDiffException("wrong format of diffjson, string delta of a value that isn't a string");
+			const auto& str = json.get_string();
+			Traits::assign(json, JsonValue(apply_string_delta(str.data(), str.size(), node.hunks->get_array(), true)), allocator);
+		}
+		else if (is_scalar_json_value_type(new_json_type) || node.type == DNT_REPLACE)
+		{
+			if (node.type != DNT_REPLACE)
 				throw JsonDiffException("wrong format of diffjson of scalar json value");
-			result = diff_json[JSONDIFF_KEY_OLD_VALUE];
+			Traits::assign(json, *node.old_value, allocator);
 		}
 		else if (new_json_type == JsonValueType::JVT_OBJECT)
 		{
-			auto new_json_obj = new_json.as<fc::mutable_variant_object>();
-			auto diff_json_obj = diff_json.as<fc::mutable_variant_object>();
-			auto result_obj = result.as<fc::mutable_variant_object>();
-			for (auto i = diff_json_obj.begin(); i != diff_json_obj.end(); i++)
+			if (node.type != DNT_OBJECT)
+				throw JsonDiffException("wrong format of diffjson of this old version json");
+			// fc objects are immutable, so the object is rebuilt from its entries and the changed members are rolled back in place
+			typename Traits::ObjectEdit edit(json, allocator);
+			auto& result_obj = edit.object();
+			// keys are matched through a hash index, removed and added keys are applied in one pass at the end
+			utils::ObjectKeyIndex<typename Traits::ObjectEdit::object_type> result_index(result_obj);
+			std::vector<bool> removed;
+			std::vector<JsonMemberRef> appended;
+			for (const auto& op : node.ops)
 			{
-				auto key = i->key();
-				auto diff_item = i->value();
-				// key <key>__deleted  <key>__addedɾӣ޸keyֵ
-				if (utils::string_ends_with(key, JSONDIFF_KEY_ADDED_POSTFIX) && key.size() > strlen(JSONDIFF_KEY_ADDED_POSTFIX))
+				if (op.type == DOT_MEMBER_ADDED)
 				{
-					auto origin_key = utils::string_without_ext(key, JSONDIFF_KEY_ADDED_POSTFIX);
-					if (new_json_obj.find(origin_key) != new_json_obj.end())
+					auto found = result_index.find(op.key);
+					if (found != result_index.end())
 					{
 						// ԲҪع
-						result_obj.erase(origin_key);
+						removed.resize(result_obj.size());
+						removed[found - result_obj.begin()] = true;
 						continue;
 					}
 				}
-				else if (utils::string_ends_with(key, JSONDIFF_KEY_DELETED_POSTFIX) && key.size() > strlen(JSONDIFF_KEY_DELETED_POSTFIX))
+				else if (op.type == DOT_MEMBER_DELETED)
 				{
-					auto origin_key = utils::string_without_ext(key, JSONDIFF_KEY_DELETED_POSTFIX);
 					// ɾԲҪع
-					result_obj[origin_key] = diff_item;
+					auto found = result_index.find(op.key);
+					if (found != result_index.end())
+						edit.set(found, *op.value);
+					else
+						appended.push_back(JsonMemberRef(&op.key, op.value));
 					continue;
 				}
 				// ޸keyֵ
-				if (new_json_obj.find(key) == new_json_obj.end())
+				auto found = result_index.find(*op.json_key);
+				if (found == result_index.end())
 					throw JsonDiffException("wrong format of diffjson of this old version json");
-				auto sub_item_new = rollback(new_json_obj[key], std::make_shared<DiffResult>(diff_item));
-				result_obj[key] = sub_item_new;
+				if (op.diff)
+					rollback_node(found->value(), *op.diff, allocator);
+				else
+				{
+					// a <key>__added member whose key is missing, read as a change of the member named <key>__added
+					CompiledDiffNode member_node;
+					CompiledDiff::compile_node(*op.value, member_node);
+					rollback_node(found->value(), member_node, allocator);
+				}
 			}
-			return result_obj;
+			edit.commit(removed, appended);
 		}
 		else if (new_json_type == JsonValueType::JVT_ARRAY)
 		{
-			auto new_json_array = new_json.as<fc::variants>();
-			auto diff_json_array = diff_json.as<fc::variants>();
-			auto result_array = result.as<fc::variants>();
-			for (size_t i = 0; i < diff_json_array.size(); i++)
-			{
-				if (!diff_json_array[i].is_array())
-					throw JsonDiffException("diffjson format error for array diff");
-				auto diff_item = diff_json_array[i].as<fc::variants>();
-				if (diff_item.size() != 3)
-					throw JsonDiffException("diffjson format error for array diff");
-				auto op_item = diff_item[0].as_string();
-				auto pos = diff_item[1].as_uint64(); // posoldpos FIXME ¾ɶposһһ
-				auto inner_diff_json = diff_item[2];
-				// FIXME һarrayж仯ʱ diffԭʼindexӦҳ pos => old_jsonֵͬpos
-				if (op_item == std::string("-"))
-				{
-					// ɾԪأҪع
-					result_array.insert(result_array.begin() + pos, inner_diff_json);
-				}
-				else if (op_item == std::string("+"))
-				{
-					// ԪأҪع
-					result_array.erase(result_array.begin() + pos);
-				}
-				else if (op_item == std::string("~"))
-				{
-					// ޸Ԫ
-					auto sub_item_new = rollback(new_json_array[i], std::make_shared<DiffResult>(inner_diff_json));
-					result_array[pos] = sub_item_new;
-				}
-				else
-				{
-					throw JsonDiffException(std::string("not supported diff array op now: ") + op_item);
-				}
+			// '+' and the targets of '>' are positions in json, '-', '~' and '>' are positions in the result
+			ArrayDiffOps ops;
+			group_array_diff_ops(node, ops);
+			typename Traits::ArrayEdit edit(json, allocator);
+			size_t size = edit.items().size();
+			if (ops.added.size() > size)
+				throw JsonDiffException("diffjson format error for array diff");
+			size_t result_size = size - ops.added.size() + ops.removed.size();
+			sort_positions(ops.removed, result_size);
+			sort_positions(ops.modified, result_size);
+			check_modified_kept(ops.modified, ops.removed);
+			if (ops.moved.empty())
+			{
+				sort_positions(ops.added, size);
+				splice_array(edit, ops.added, ops.removed);
 			}
-			return result_array;
+			else
+			{
+				std::vector<std::pair<size_t, size_t>> moved_back;
+				moved_back.reserve(ops.moved.size());
+				for (const auto& item : ops.moved)
+					moved_back.push_back(std::make_pair(item.second, item.first));
+				rebuild_array(edit, ops.added, ops.removed, moved_back);
+			}
+			// ޸Ԫ, where they are after the splice
+			for (const auto& item : ops.modified)
+				rollback_node(edit.items()[item.first], *item.second, allocator);
 		}
 		else
 		{
-			throw JsonDiffException(std::string("not supported json value type to rollback diff from ") + json_dumps(new_json));
+			throw JsonDiffException(std::string("not supported json value type to rollback diff from ") + json_dumps(Traits::to_json(json)));
 		}
-		return result;
 	}
+
+	// used by the composition of diffs, see compose.cpp
+	template void JsonDiff::patch_node(JsonValue& json, const CompiledDiffNode& node, JsonValueTraits<JsonValue>::allocator_type& allocator);
+	template void JsonDiff::rollback_node(JsonValue& json, const CompiledDiffNode& node, JsonValueTraits<JsonValue>::allocator_type& allocator);
 }
@@ -0,0 +1,125 @@
+#include <jsondiff/mapped_file.h>
+#include <jsondiff/exceptions.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace jsondiff
+{
+#ifdef _WIN32
+	MappedFile::MappedFile(const std::string& path)
+		: _data(nullptr), _size(0), _released(nullptr), _file(INVALID_HANDLE_VALUE), _mapping(nullptr)
+	{
+		_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (_file == INVALID_HANDLE_VALUE)
+			throw JsonDiffException(std::string("can't open file ") + path);
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(_file, &size))
+		{
+			CloseHandle(_file);
+			throw JsonDiffException(std::string("can't get the size of file ") + path);
+		}
+		_size = (size_t)size.QuadPart;
+		if (_size == 0)
+			return;
+		_mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (_mapping)
+			_data = (const char*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!_data)
+		{
+			if (_mapping)
+				CloseHandle(_mapping);
+			CloseHandle(_file);
+			throw JsonDiffException(std::string("can't map file ") + path);
+		}
+		_released = _data;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (_data)
+			UnmapViewOfFile(_data);
+		if (_mapping)
+			CloseHandle(_mapping);
+		if (_file != INVALID_HANDLE_VALUE)
+			CloseHandle(_file);
+	}
+
+	void MappedFile::release_before(const char* position)
+	{
+	}
+
+	void MappedFile::rescan_from(const char* position)
+	{
+	}
+#else
+	MappedFile::MappedFile(const std::string& path)
+		: _data(nullptr), _size(0), _released(nullptr)
+	{
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			throw JsonDiffException(std::string("can't open file ") + path);
+		struct stat st;
+		if (fstat(fd, &st) != 0)
+		{
+			close(fd);
+			throw JsonDiffException(std::string("can't get the size of file ") + path);
+		}
+		_size = (size_t)st.st_size;
+		if (_size > 0)
+		{
+			void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data == MAP_FAILED)
+			{
+				close(fd);
+				throw JsonDiffException(std::string("can't map file ") + path);
+			}
+			// the diff reads the files front to back
+			madvise(data, _size, MADV_SEQUENTIAL);
+			_data = (const char*)data;
+			_released = _data;
+		}
+		close(fd);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (_data)
+			munmap((void*)_data, _size);
+	}
+
+	void MappedFile::release_before(const char* position)
+	{
+		if (!_data || position < _released || (size_t)(position - _released) < JSONDIFF_MAPPED_FILE_RELEASE_STEP)
+			return;
+		size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+		const char* release_end = _data + (position - _data) / page_size * page_size;
+		madvise((void*)_released, release_end - _released, MADV_DONTNEED);
+		_released = release_end;
+	}
+
+	void MappedFile::rescan_from(const char* position)
+	{
+		if (!_data || position >= _released)
+			return;
+		size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+		_released = _data + (position - _data) / page_size * page_size;
+	}
+#endif
+
+	const char* MappedFile::data() const
+	{
+		return _data;
+	}
+
+	size_t MappedFile::size() const
+	{
+		return _size;
+	}
+}
@@ -0,0 +1,422 @@
+#include <jsondiff/native_json.h>
+#include <jsondiff/exceptions.h>
+#include <jsondiff/helper.h>
+#include <jsondiff/json_tokenizer.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <new>
+
+namespace jsondiff
+{
+	JsonArena::JsonArena(size_t first_block_size)
+		: _pos(nullptr), _end(nullptr), _next_block_size(first_block_size > 0 ? first_block_size : JSONDIFF_ARENA_BLOCK_SIZE), _capacity(0)
+	{
+	}
+
+	JsonArena::~JsonArena()
+	{
+		for (auto block : _blocks)
+			std::free(block);
+	}
+
+	void* JsonArena::allocate_slow(size_t size, size_t align)
+	{
+		size_t block_size = std::max(_next_block_size, size + align);
+		char* block = (char*)std::malloc(block_size);
+		if (!block)
+			throw std::bad_alloc();
+		_blocks.push_back(block);
+		_capacity += block_size;
+		_next_block_size = std::min(_next_block_size * 2, (size_t)JSONDIFF_ARENA_MAX_BLOCK_SIZE);
+		_pos = block;
+		_end = block + block_size;
+		return allocate(size, align);
+	}
+
+	void JsonArena::reset()
+	{
+		if (_blocks.size() > 1)
+		{
+			for (auto block : _blocks)
+				std::free(block);
+			_blocks.clear();
+			char* block = (char*)std::malloc(_capacity);
+			if (!block)
+			{
+				_capacity = 0;
+				_pos = _end = nullptr;
+				throw std::bad_alloc();
+			}
+			_blocks.push_back(block);
+		}
+		if (_blocks.empty())
+			return;
+		_pos = _blocks[0];
+		_end = _blocks[0] + _capacity;
+	}
+
+	size_t JsonArena::capacity() const
+	{
+		return _capacity;
+	}
+
+	void NativeJsonString::assign(JsonArena& arena, const char* data, size_t size)
+	{
+		if (size > UINT32_MAX)
+			throw JsonDiffException("string too long for a native json document");
+		_size = (uint32_t)size;
+		if (size <= small_size)
+		{
+			memcpy(_bytes, data, size);
+			return;
+		}
+		char* p = (char*)arena.allocate(size, 1);
+		memcpy(p, data, size);
+		memcpy(_bytes, &p, sizeof(p));
+	}
+
+	// builds the document from the tokens of JsonTokenizer, the children of every container are gathered on the
+	// document's stacks and copied into the arena at once when it closes, so they end up contiguous
+	class NativeJsonDocument::Parser
+	{
+	private:
+		NativeJsonDocument& _doc;
+		JsonTokenizer _tokenizer;
+		// strings with escapes are decoded here before they are copied into the arena
+		std::string _decoded;
+
+		// the unescaped bytes of a string or key token
+		// @throws JsonDiffException
+		std::pair<const char*, size_t> string_bytes(const JsonToken& token)
+		{
+			const char* begin = token.begin + 1;
+			size_t size = token.end - token.begin - 2;
+			if (!memchr(begin, '\\', size))
+				return std::make_pair(begin, size);
+			_decoded = token.decode_string();
+			return std::make_pair(_decoded.data(), _decoded.size());
+		}
+
+		// the rules of json_loads: a number with '.', 'e' or 'E' is a double, a negative one an int64,
+		// the others an int64 if they fit and a uint64 otherwise
+		static void set_number(NativeJsonValue& value, const JsonToken& token)
+		{
+			char buffer[64];
+			std::string long_number;
+			size_t size = token.end - token.begin;
+			const char* text = buffer;
+			if (size < sizeof(buffer))
+			{
+				memcpy(buffer, token.begin, size);
+				buffer[size] = '\0';
+			}
+			else
+			{
+				long_number.assign(token.begin, size);
+				text = long_number.c_str();
+			}
+			bool is_float = false;
+			for (size_t i = 0; i < size && !is_float; i++)
+				is_float = text[i] == '.' || text[i] == 'e' || text[i] == 'E';
+			if (is_float)
+				value.set_double(std::strtod(text, nullptr));
+			else if (text[0] == '-')
+				value.set_int64((int64_t)std::strtoll(text, nullptr, 10));
+			else
+			{
+				uint64_t u = std::strtoull(text, nullptr, 10);
+				if (u > (uint64_t)std::numeric_limits<int64_t>::max())
+					value.set_uint64(u);
+				else
+					value.set_int64((int64_t)u);
+			}
+		}
+
+		// drop the members with a key seen before in [start, end of the member stack), their value replacing the earlier one,
+		// as fc objects keep a duplicate key at its first position with its last value
+		// @returns the number of members left
+		size_t drop_duplicate_keys(size_t start)
+		{
+			auto& members = _doc._member_stack;
+			size_t count = members.size() - start;
+			size_t kept = 0;
+			if (count < JSONDIFF_OBJECT_KEY_INDEX_MIN_SIZE)
+			{
+				for (size_t j = 0; j < count; j++)
+				{
+					auto& member = members[start + j];
+					size_t i = 0;
+					while (i < kept && members[start + i].key() != member.key())
+						i++;
+					if (i < kept)
+						members[start + i].value() = member.value();
+					else
+						members[start + kept++] = member;
+				}
+				return kept;
+			}
+			size_t capacity = 16;
+			while (capacity < count * 2)
+				capacity <<= 1;
+			size_t mask = capacity - 1;
+			_doc._key_slots.assign(capacity, 0);
+			for (size_t j = 0; j < count; j++)
+			{
+				auto& member = members[start + j];
+				size_t slot = utils::key_hash(member.key()) & mask;
+				for (; _doc._key_slots[slot] != 0; slot = (slot + 1) & mask)
+				{
+					if (members[start + _doc._key_slots[slot] - 1].key() == member.key())
+						break;
+				}
+				if (_doc._key_slots[slot] != 0)
+				{
+					members[start + _doc._key_slots[slot] - 1].value() = member.value();
+					continue;
+				}
+				members[start + kept] = member;
+				_doc._key_slots[slot] = ++kept;
+			}
+			return kept;
+		}
+
+		// @throws JsonDiffException
+		void parse_value(const JsonToken& token, NativeJsonValue& value)
+		{
+			switch (token.type)
+			{
+			case JTT_NULL:
+				value.set_null();
+				break;
+			case JTT_TRUE:
+			case JTT_FALSE:
+				value.set_bool(token.type == JTT_TRUE);
+				break;
+			case JTT_NUMBER:
+				set_number(value, token);
+				break;
+			case JTT_STRING:
+			{
+				auto bytes = string_bytes(token);
+				value.set_string(_doc._arena, bytes.first, bytes.second);
+				break;
+			}
+			case JTT_BEGIN_ARRAY:
+			{
+				auto& stack = _doc._item_stack;
+				size_t start = stack.size();
+				for (auto item = _tokenizer.next(); item.type != JTT_END_ARRAY; item = _tokenizer.next())
+				{
+					// parsed aside, a nested container grows the stack
+					NativeJsonValue item_value;
+					parse_value(item, item_value);
+					stack.push_back(item_value);
+				}
+				size_t count = stack.size() - start;
+				auto items = _doc._arena.allocate_array<NativeJsonValue>(count);
+				std::uninitialized_copy(stack.begin() + start, stack.end(), items);
+				stack.resize(start);
+				value.set_array(NativeJsonArray::make(items, count));
+				break;
+			}
+			case JTT_BEGIN_OBJECT:
+			{
+				auto& stack = _doc._member_stack;
+				size_t start = stack.size();
+				for (auto key = _tokenizer.next(); key.type != JTT_END_OBJECT; key = _tokenizer.next())
+				{
+					NativeJsonMember member;
+					auto bytes = string_bytes(key);
+					member.key().assign(_doc._arena, bytes.first, bytes.second);
+					parse_value(_tokenizer.next(), member.value());
+					stack.push_back(member);
+				}
+				size_t count = drop_duplicate_keys(start);
+				auto members = _doc._arena.allocate_array<NativeJsonMember>(count);
+				std::uninitialized_copy(stack.begin() + start, stack.begin() + start + count, members);
+				stack.resize(start);
+				value.set_object(NativeJsonObject::make(members, count));
+				break;
+			}
+			default:
+				// the tokenizer only returns a value where one is expected
+				throw JsonDiffException("json syntax error: expected a value");
+			}
+		}
+	public:
+		Parser(NativeJsonDocument& doc, const char* json, size_t size)
+			: _doc(doc), _tokenizer(json, json + size)
+		{
+		}
+
+		// @throws JsonDiffException
+		void parse(NativeJsonValue& root)
+		{
+			parse_value(_tokenizer.next(), root);
+			// throws on data after the value
+			_tokenizer.next();
+		}
+	};
+
+	NativeJsonDocument::NativeJsonDocument()
+	{
+	}
+
+	NativeJsonDocument::NativeJsonDocument(size_t arena_block_size)
+		: _arena(arena_block_size)
+	{
+	}
+
+	NativeJsonDocument::~NativeJsonDocument()
+	{
+	}
+
+	void NativeJsonDocument::parse(const char* json, size_t size)
+	{
+		clear();
+		try
+		{
+			Parser parser(*this, json, size);
+			parser.parse(_root);
+		}
+		catch (...)
+		{
+			_item_stack.clear();
+			_member_stack.clear();
+			clear();
+			throw;
+		}
+	}
+
+	void NativeJsonDocument::parse(const std::string& json)
+	{
+		parse(json.data(), json.size());
+	}
+
+	void NativeJsonDocument::assign(const JsonValue& json)
+	{
+		clear();
+		_root = json_to_native(_arena, json);
+	}
+
+	void NativeJsonDocument::clear()
+	{
+		_root.set_null();
+		_arena.reset();
+	}
+
+	NativeJsonValue& NativeJsonDocument::root()
+	{
+		return _root;
+	}
+
+	const NativeJsonValue& NativeJsonDocument::root() const
+	{
+		return _root;
+	}
+
+	JsonArena& NativeJsonDocument::arena()
+	{
+		return _arena;
+	}
+
+	JsonValue NativeJsonDocument::to_json() const
+	{
+		return native_to_json(_root);
+	}
+
+	NativeJsonValue json_to_native(JsonArena& arena, const JsonValue& json_value)
+	{
+		NativeJsonValue result;
+		switch (json_value.get_type())
+		{
+		case fc::variant::null_type:
+			break;
+		case fc::variant::bool_type:
+			result.set_bool(json_value.as_bool());
+			break;
+		case fc::variant::int64_type:
+			result.set_int64(json_value.as_int64());
+			break;
+		case fc::variant::uint64_type:
+			result.set_uint64(json_value.as_uint64());
+			break;
+		case fc::variant::double_type:
+			result.set_double(json_value.as_double());
+			break;
+		case fc::variant::string_type:
+		{
+			const auto& str = json_value.get_string();
+			result.set_string(arena, str.data(), str.size());
+			break;
+		}
+		case fc::variant::array_type:
+		{
+			const auto& items = json_value.get_array();
+			auto native_items = arena.allocate_array<NativeJsonValue>(items.size());
+			for (size_t i = 0; i < items.size(); i++)
+				new (&native_items[i]) NativeJsonValue(json_to_native(arena, items[i]));
+			result.set_array(NativeJsonArray::make(native_items, items.size()));
+			break;
+		}
+		case fc::variant::object_type:
+		{
+			const auto& obj = json_value.get_object();
+			auto members = arena.allocate_array<NativeJsonMember>(obj.size());
+			size_t count = 0;
+			for (auto i = obj.begin(); i != obj.end(); i++, count++)
+			{
+				auto& member = *new (&members[count]) NativeJsonMember();
+				member.key().assign(arena, i->key().data(), i->key().size());
+				member.value() = json_to_native(arena, i->value());
+			}
+			result.set_object(NativeJsonObject::make(members, count));
+			break;
+		}
+		default:
+			throw JsonDiffException(std::string("not supported json value type for a native json document ") + json_dumps(json_value));
+		}
+		return result;
+	}
+
+	JsonValue native_to_json(const NativeJsonValue& json_value)
+	{
+		switch (json_value.get_type())
+		{
+		case NJT_BOOL:
+			return JsonValue(json_value.as_bool());
+		case NJT_INT64:
+			return JsonValue(json_value.as_int64());
+		case NJT_UINT64:
+			return JsonValue(json_value.as_uint64());
+		case NJT_DOUBLE:
+			return JsonValue(json_value.as_double());
+		case NJT_STRING:
+			return JsonValue(json_value.get_string().str());
+		case NJT_ARRAY:
+		{
+			const auto& items = json_value.get_array();
+			fc::variants result;
+			result.reserve(items.size());
+			for (const auto& item : items)
+				result.push_back(native_to_json(item));
+			return result;
+		}
+		case NJT_OBJECT:
+		{
+			// fc objects search for the key on every set(), so this is quadratic in the size of a wide object, as json_loads is
+			const auto& obj = json_value.get_object();
+			fc::mutable_variant_object result;
+			result.reserve(obj.size());
+			for (const auto& member : obj)
+				result.set(member.key().str(), native_to_json(member.value()));
+			return result;
+		}
+		default:
+			return JsonValue();
+		}
+	}
+}
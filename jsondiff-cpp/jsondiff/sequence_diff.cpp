@@ -0,0 +1,202 @@
+#include <jsondiff/sequence_diff.h>
+
+#include <algorithm>
+
+namespace jsondiff
+{
+	// divide and conquer over index ranges of both sequences, on a stack of tasks instead of recursion:
+	// the splits of searches cut short by the cost bound can be as many as the elements.
+	// the middle snake scratch vectors are shared by all tasks since a bisection finishes before the next one
+	class SequenceLcs
+	{
+	private:
+		const std::vector<uint32_t>& _a;
+		const std::vector<uint32_t>& _b;
+		size_t _max_cost;
+		std::vector<int64_t>& _forward;
+		std::vector<int64_t>& _backward;
+		std::vector<SequenceLcsTask>& _tasks;
+		std::vector<SequenceMatch>& _matches;
+	public:
+		SequenceLcs(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b, size_t max_cost,
+			SequenceLcsScratch& scratch, std::vector<SequenceMatch>& matches)
+			: _a(a), _b(b), _max_cost(max_cost < 1 ? 1 : max_cost), _forward(scratch.forward), _backward(scratch.backward),
+			_tasks(scratch.tasks), _matches(matches)
+		{
+		}
+
+		void solve(size_t a_lo, size_t a_hi, size_t b_lo, size_t b_hi)
+		{
+			// the tasks are pushed last first, so the matches are written in order
+			_tasks.clear();
+			_tasks.push_back(SequenceLcsTask{ a_lo, a_hi, b_lo, b_hi, false });
+			while (!_tasks.empty())
+			{
+				auto task = _tasks.back();
+				_tasks.pop_back();
+				if (task.matched)
+				{
+					for (size_t i = 0; i < task.a_hi - task.a_lo; i++)
+						_matches.push_back(SequenceMatch(task.a_lo + i, task.b_lo + i));
+					continue;
+				}
+				solve_task(task.a_lo, task.a_hi, task.b_lo, task.b_hi);
+			}
+		}
+
+	private:
+		void solve_task(size_t a_lo, size_t a_hi, size_t b_lo, size_t b_hi)
+		{
+			// common prefix and suffix are matched directly
+			while (a_lo < a_hi && b_lo < b_hi && _a[a_lo] == _b[b_lo])
+			{
+				_matches.push_back(SequenceMatch(a_lo, b_lo));
+				a_lo++;
+				b_lo++;
+			}
+			size_t suffix = 0;
+			while (a_lo < a_hi - suffix && b_lo < b_hi - suffix && _a[a_hi - suffix - 1] == _b[b_hi - suffix - 1])
+				suffix++;
+			a_hi -= suffix;
+			b_hi -= suffix;
+			if (suffix > 0)
+				_tasks.push_back(SequenceLcsTask{ a_hi, a_hi + suffix, b_hi, b_hi + suffix, true });
+			size_t a_split, b_split;
+			if (a_lo < a_hi && b_lo < b_hi && bisect(a_lo, a_hi, b_lo, b_hi, a_split, b_split))
+			{
+				_tasks.push_back(SequenceLcsTask{ a_split, a_hi, b_split, b_hi, false });
+				_tasks.push_back(SequenceLcsTask{ a_lo, a_split, b_lo, b_split, false });
+			}
+		}
+
+		// find the middle snake of the ranges and return the point where the forward and backward paths meet.
+		// @returns false if the ranges have nothing in common or no useful split point was found within the cost bound
+		bool bisect(size_t a_lo, size_t a_hi, size_t b_lo, size_t b_hi, size_t& a_split, size_t& b_split)
+		{
+			const int64_t n = (int64_t)(a_hi - a_lo);
+			const int64_t m = (int64_t)(b_hi - b_lo);
+			const int64_t max_d = (n + m + 1) / 2;
+			const int64_t cap = std::min(max_d, (int64_t)_max_cost + 1);
+			const int64_t v_offset = cap;
+			const int64_t v_length = 2 * cap + 2;
+			if ((int64_t)_forward.size() < v_length)
+			{
+				_forward.resize(v_length);
+				_backward.resize(v_length);
+			}
+			std::fill(_forward.begin(), _forward.begin() + v_length, -1);
+			std::fill(_backward.begin(), _backward.begin() + v_length, -1);
+			_forward[v_offset + 1] = 0;
+			_backward[v_offset + 1] = 0;
+			const int64_t delta = n - m;
+			// if the total number of characters is odd, the front path collides with the reverse path
+			const bool front = (delta % 2 != 0);
+			int64_t k1_start = 0, k1_end = 0, k2_start = 0, k2_end = 0;
+			int64_t best_x = 0, best_y = 0;
+			for (int64_t d = 0; d < cap; d++)
+			{
+				for (int64_t k1 = -d + k1_start; k1 <= d - k1_end; k1 += 2)
+				{
+					const int64_t k1_offset = v_offset + k1;
+					int64_t x1;
+					if (k1 == -d || (k1 != d && _forward[k1_offset - 1] < _forward[k1_offset + 1]))
+						x1 = _forward[k1_offset + 1];
+					else
+						x1 = _forward[k1_offset - 1] + 1;
+					int64_t y1 = x1 - k1;
+					while (x1 < n && y1 < m && _a[a_lo + x1] == _b[b_lo + y1])
+					{
+						x1++;
+						y1++;
+					}
+					_forward[k1_offset] = x1;
+					if (x1 > n)
+						k1_end += 2;
+					else if (y1 > m)
+						k1_start += 2;
+					else
+					{
+						if (x1 + y1 > best_x + best_y)
+						{
+							best_x = x1;
+							best_y = y1;
+						}
+						if (front)
+						{
+							const int64_t k2_offset = v_offset + delta - k1;
+							if (k2_offset >= 0 && k2_offset < v_length && _backward[k2_offset] != -1)
+							{
+								if (x1 >= n - _backward[k2_offset])
+								{
+									a_split = a_lo + (size_t)x1;
+									b_split = b_lo + (size_t)y1;
+									return true;
+								}
+							}
+						}
+					}
+				}
+				for (int64_t k2 = -d + k2_start; k2 <= d - k2_end; k2 += 2)
+				{
+					const int64_t k2_offset = v_offset + k2;
+					int64_t x2;
+					if (k2 == -d || (k2 != d && _backward[k2_offset - 1] < _backward[k2_offset + 1]))
+						x2 = _backward[k2_offset + 1];
+					else
+						x2 = _backward[k2_offset - 1] + 1;
+					int64_t y2 = x2 - k2;
+					while (x2 < n && y2 < m && _a[a_lo + (n - x2 - 1)] == _b[b_lo + (m - y2 - 1)])
+					{
+						x2++;
+						y2++;
+					}
+					_backward[k2_offset] = x2;
+					if (x2 > n)
+						k2_end += 2;
+					else if (y2 > m)
+						k2_start += 2;
+					else if (!front)
+					{
+						const int64_t k1_offset = v_offset + delta - k2;
+						if (k1_offset >= 0 && k1_offset < v_length && _forward[k1_offset] != -1)
+						{
+							const int64_t x1 = _forward[k1_offset];
+							const int64_t y1 = v_offset + x1 - k1_offset;
+							if (x1 >= n - x2)
+							{
+								a_split = a_lo + (size_t)x1;
+								b_split = b_lo + (size_t)y1;
+								return true;
+							}
+						}
+					}
+				}
+			}
+			if (cap >= max_d)
+				return false; // nothing in common
+			// too expensive: split where the forward search got furthest, both halves get a fresh cost bound
+			if ((best_x == 0 && best_y == 0) || (best_x == n && best_y == m))
+				return false;
+			a_split = a_lo + (size_t)best_x;
+			b_split = b_lo + (size_t)best_y;
+			return true;
+		}
+	};
+
+	std::vector<SequenceMatch> sequence_lcs(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b, size_t max_cost)
+	{
+		SequenceLcsScratch scratch;
+		std::vector<SequenceMatch> matches;
+		sequence_lcs(a, b, max_cost, scratch, matches);
+		return matches;
+	}
+
+	void sequence_lcs(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b, size_t max_cost,
+		SequenceLcsScratch& scratch, std::vector<SequenceMatch>& matches)
+	{
+		matches.clear();
+		matches.reserve(std::min(a.size(), b.size()) + 1);
+		SequenceLcs lcs(a, b, max_cost, scratch, matches);
+		lcs.solve(0, a.size(), 0, b.size());
+	}
+}
@@ -0,0 +1,931 @@
+#include <jsondiff/jsondiff.h>
+#include <jsondiff/exceptions.h>
+#include <jsondiff/fingerprint.h>
+#include <jsondiff/json_tokenizer.h>
+#include <jsondiff/mapped_file.h>
+#include <jsondiff/sequence_diff.h>
+#include <jsondiff/string_delta.h>
+
+#include <algorithm>
+#include <deque>
+#include <unordered_map>
+
+namespace jsondiff
+{
+	// writes the diff json of a stream diff. objects are opened lazily, when their first member is written,
+	// so a subtree without changes leaves nothing in the output
+	class StreamDiffWriter
+	{
+	private:
+		struct Frame
+		{
+			JsonToken key;
+			bool has_key;
+			bool has_members;
+		};
+		// the text is collected here and handed to out in blocks, kept whole if there is no out or it is held
+		std::ostream* _out;
+		bool _held;
+		std::string _buffer;
+		std::vector<Frame> _frames;
+		// the frames before this index have been written
+		size_t _opened_count;
+		bool _root_written;
+		// bytes handed to out so far
+		size_t _flushed;
+
+		// keys the generator would write unchanged are copied from the input as they are
+		static bool is_plain_key(const JsonToken& key)
+		{
+			for (auto p = key.begin + 1; p < key.end - 1; p++)
+			{
+				if (*p < 0x20 || *p >= 0x7f || *p == '\\')
+					return false;
+			}
+			return true;
+		}
+
+		void write_key(const JsonToken& key, const char* suffix)
+		{
+			if (is_plain_key(key))
+			{
+				_buffer.append(key.begin, key.end - key.begin - 1);
+				_buffer.append(suffix);
+				_buffer.push_back('"');
+			}
+			else
+				_buffer.append(json_dumps(JsonValue(key.decode_string() + suffix)));
+			_buffer.push_back(':');
+		}
+
+		void open_pending()
+		{
+			for (; _opened_count < _frames.size(); _opened_count++)
+			{
+				auto& frame = _frames[_opened_count];
+				if (_opened_count > 0)
+				{
+					auto& parent = _frames[_opened_count - 1];
+					if (parent.has_members)
+						_buffer.push_back(',');
+					parent.has_members = true;
+				}
+				else
+					_root_written = true;
+				if (frame.has_key)
+					write_key(frame.key, "");
+				_buffer.push_back('{');
+			}
+		}
+	public:
+		// the state of the writer at some point, to drop what is written after it
+		struct Mark
+		{
+			size_t buffer_size;
+			size_t flushed;
+			size_t frame_count;
+			size_t opened_count;
+			bool parent_has_members;
+			bool root_written;
+		};
+
+		// held keeps all the text until finish, so that it can still be dropped
+		explicit StreamDiffWriter(std::ostream* out, bool held = false)
+			: _out(out), _held(held), _opened_count(0), _root_written(false), _flushed(0)
+		{
+		}
+
+		Mark mark() const
+		{
+			Mark mark;
+			mark.buffer_size = _buffer.size();
+			mark.flushed = _flushed;
+			mark.frame_count = _frames.size();
+			mark.opened_count = _opened_count;
+			mark.parent_has_members = _opened_count > 0 && _frames[_opened_count - 1].has_members;
+			mark.root_written = _root_written;
+			return mark;
+		}
+
+		// drop what was written since mark and the objects started since, only the frame written last before mark
+		// can have changed. false if some of it was already handed to out
+		bool rollback(const Mark& mark)
+		{
+			if (_flushed != mark.flushed)
+				return false;
+			_buffer.resize(mark.buffer_size);
+			_frames.resize(mark.frame_count);
+			for (size_t i = mark.opened_count; i < _frames.size(); i++)
+				_frames[i].has_members = false;
+			if (mark.opened_count > 0)
+				_frames[mark.opened_count - 1].has_members = mark.parent_has_members;
+			_opened_count = mark.opened_count;
+			_root_written = mark.root_written;
+			return true;
+		}
+
+		// start the diff object of key, nullptr for the root
+		void open_object(const JsonToken* key)
+		{
+			Frame frame;
+			frame.has_key = key != nullptr;
+			if (key)
+				frame.key = *key;
+			frame.has_members = false;
+			_frames.push_back(frame);
+		}
+
+		void close_object()
+		{
+			if (_opened_count == _frames.size())
+			{
+				_buffer.push_back('}');
+				_opened_count--;
+			}
+			_frames.pop_back();
+			if (_out && !_held && _buffer.size() >= 65536)
+			{
+				_out->write(_buffer.data(), _buffer.size());
+				_flushed += _buffer.size();
+				_buffer.clear();
+			}
+		}
+
+		// write key + suffix with its diff json, or the diff json of the root if key is nullptr
+		void member(const JsonToken* key, const char* suffix, const std::string& value_text)
+		{
+			open_pending();
+			if (_frames.empty())
+			{
+				_buffer.append(value_text);
+				_root_written = true;
+				return;
+			}
+			auto& top = _frames.back();
+			if (top.has_members)
+				_buffer.push_back(',');
+			top.has_members = true;
+			if (key)
+				write_key(*key, suffix);
+			_buffer.append(value_text);
+		}
+
+		// drop everything written so far, nothing can have been handed to out
+		void clear()
+		{
+			_buffer.clear();
+			_frames.clear();
+			_opened_count = 0;
+			_root_written = false;
+		}
+
+		bool written() const
+		{
+			return _root_written;
+		}
+
+		// the text written so far, when there is no out
+		const std::string& text() const
+		{
+			return _buffer;
+		}
+
+		// an undefined diff is written as null, like DiffResult::str()
+		void finish()
+		{
+			if (!_root_written)
+				_buffer.append("null");
+			if (_out)
+				_out->write(_buffer.data(), _buffer.size());
+			_buffer.clear();
+		}
+	};
+
+	class JsonDiff::StreamDiffer
+	{
+	private:
+		JsonDiff& _json_diff;
+		// where the diff goes, a nested writer while a diff is kept for later
+		StreamDiffWriter* _writer;
+		// location of the values being diffed, only kept when some option depends on it
+		bool _track_path;
+		std::vector<std::string> _path;
+		// the inputs when they are mapped files, read pages are released as the diff moves on
+		MappedFile* _old_file;
+		MappedFile* _new_file;
+		// the budget of the options, counted where JsonDiff::diff counts it
+		size_t _compared_values;
+		size_t _changes;
+
+		// @throws JsonDiffBudgetException
+		void count_compare()
+		{
+			if (_compared_values++ >= _json_diff._options.max_compared_values)
+				throw JsonDiffBudgetException("the diff compared more values than its budget allows");
+		}
+
+		// @throws JsonDiffBudgetException
+		void count_change()
+		{
+			if (_changes++ >= _json_diff._options.max_changes)
+				throw JsonDiffBudgetException("the diff has more changes than its budget allows");
+		}
+
+		// diff two parsed subtrees at _path under the rest of the budget, the value pair was counted by diff_values
+		bool diff_subtrees(const JsonValue& old_json, const JsonValue& new_json, JsonValue& diff_json)
+		{
+			_compared_values--;
+			return _json_diff.diff_at(_path, old_json, new_json, diff_json, _compared_values, _changes);
+		}
+
+		void release_input(const JsonTokenizer& a, const JsonTokenizer& b)
+		{
+			if (_old_file)
+				_old_file->release_before(a.position());
+			if (_new_file)
+				_new_file->release_before(b.position());
+		}
+
+		// the inputs are read again from these points
+		void rescan_input(const char* a_position, const char* b_position)
+		{
+			if (_old_file)
+				_old_file->rescan_from(a_position);
+			if (_new_file)
+				_new_file->rescan_from(b_position);
+		}
+
+		static JsonValue parse_range(const char* begin, const char* end)
+		{
+			return json_loads(std::string(begin, end));
+		}
+
+		static JsonValue parse_value(JsonTokenizer& tokenizer)
+		{
+			const char* begin;
+			const char* end;
+			tokenizer.skip_value(begin, end);
+			return parse_range(begin, end);
+		}
+
+		// { __old, __new } of two values
+		static std::string replace_text(const JsonValue& old_json, const JsonValue& new_json)
+		{
+			return std::string("{\"" JSONDIFF_KEY_OLD_VALUE "\":") + json_dumps(old_json)
+				+ ",\"" JSONDIFF_KEY_NEW_VALUE "\":" + json_dumps(new_json) + "}";
+		}
+
+		void write_replace(const JsonToken* key, const JsonValue& old_json, const JsonValue& new_json)
+		{
+			count_change();
+			_writer->member(key, "", replace_text(old_json, new_json));
+		}
+
+		// a string delta for long strings, as diff_value writes it
+		void write_scalar_change(const JsonToken* key, const JsonValue& old_json, const JsonValue& new_json)
+		{
+			if (old_json.is_string() && new_json.is_string())
+			{
+				const auto& old_str = old_json.get_string();
+				const auto& new_str = new_json.get_string();
+				JsonValue delta_json;
+				if (std::max(old_str.size(), new_str.size()) >= _json_diff._options.string_delta_min_size
+					&& make_string_delta(old_str.data(), old_str.size(), new_str.data(), new_str.size(), delta_json))
+				{
+					count_change();
+					_writer->member(key, "", json_dumps(delta_json));
+					return;
+				}
+			}
+			write_replace(key, old_json, new_json);
+		}
+
+		// consume one value of each side, true if they are equal token by token.
+		// equal values written differently, e.g. with other key orders, are reported as different
+		static bool values_equal(JsonTokenizer& a, JsonTokenizer& b)
+		{
+			size_t a_depth = 0;
+			size_t b_depth = 0;
+			for (;;)
+			{
+				auto a_token = a.next();
+				auto b_token = b.next();
+				a_depth += a_token.type == JTT_BEGIN_OBJECT || a_token.type == JTT_BEGIN_ARRAY;
+				a_depth -= a_token.type == JTT_END_OBJECT || a_token.type == JTT_END_ARRAY;
+				b_depth += b_token.type == JTT_BEGIN_OBJECT || b_token.type == JTT_BEGIN_ARRAY;
+				b_depth -= b_token.type == JTT_END_OBJECT || b_token.type == JTT_END_ARRAY;
+				if (!json_token_equal(a_token, b_token))
+				{
+					for (; a_depth > 0; a_depth -= a_token.type == JTT_END_OBJECT || a_token.type == JTT_END_ARRAY)
+					{
+						a_token = a.next();
+						a_depth += a_token.type == JTT_BEGIN_OBJECT || a_token.type == JTT_BEGIN_ARRAY;
+					}
+					for (; b_depth > 0; b_depth -= b_token.type == JTT_END_OBJECT || b_token.type == JTT_END_ARRAY)
+					{
+						b_token = b.next();
+						b_depth += b_token.type == JTT_BEGIN_OBJECT || b_token.type == JTT_BEGIN_ARRAY;
+					}
+					return false;
+				}
+				if (a_depth == 0)
+					return true;
+			}
+		}
+
+		// true if the values at two text ranges are equal token by token, see values_equal
+		static bool ranges_equal(const char* a_begin, const char* a_end, const char* b_begin, const char* b_end)
+		{
+			if (a_end - a_begin == b_end - b_begin && std::equal(a_begin, a_end, b_begin))
+				return true;
+			JsonTokenizer a(a_begin, a_end);
+			JsonTokenizer b(b_begin, b_end);
+			return values_equal(a, b);
+		}
+
+		// same as ranges_equal, but objects with other key orders are equal too
+		static bool elements_equal(const char* a_begin, const char* a_end, const char* b_begin, const char* b_end)
+		{
+			if (ranges_equal(a_begin, a_end, b_begin, b_end))
+				return true;
+			if (std::find(a_begin, a_end, '{') == a_end || std::find(b_begin, b_end, '{') == b_end)
+				return false;
+			return json_equal(parse_range(a_begin, a_end), parse_range(b_begin, b_end));
+		}
+
+		// the hashes of the member names read from one object, to find duplicate keys. open addressing, 0 is a free slot.
+		// a hash collision looks like a duplicate, which only sends the object to the slower diff that handles those
+		class KeyHashSet
+		{
+		private:
+			std::vector<uint64_t> _slots;
+			size_t _count;
+		public:
+			KeyHashSet() : _count(0) {}
+
+			// false if the key was in the set
+			bool insert(const JsonToken& key)
+			{
+				uint64_t hash;
+				if (std::find(key.begin + 1, key.end - 1, '\\') == key.end - 1)
+					hash = fingerprint_bytes(key.begin + 1, key.end - key.begin - 2);
+				else
+				{
+					auto name = key.decode_string();
+					hash = fingerprint_bytes(name.data(), name.size());
+				}
+				hash += hash == 0;
+				if (2 * (_count + 1) > _slots.size())
+				{
+					std::vector<uint64_t> slots(std::max<size_t>(16, 2 * _slots.size()), 0);
+					for (auto old_hash : _slots)
+					{
+						if (old_hash == 0)
+							continue;
+						size_t i = old_hash & (slots.size() - 1);
+						while (slots[i] != 0)
+							i = (i + 1) & (slots.size() - 1);
+						slots[i] = old_hash;
+					}
+					_slots.swap(slots);
+				}
+				size_t i = hash & (_slots.size() - 1);
+				for (; _slots[i] != 0; i = (i + 1) & (_slots.size() - 1))
+				{
+					if (_slots[i] == hash)
+						return false;
+				}
+				_slots[i] = hash;
+				_count++;
+				return true;
+			}
+		};
+
+		// consume the rest of an object read up to a member, including its '}'
+		// @returns the end of the object
+		static const char* skip_members(JsonTokenizer& tokenizer)
+		{
+			const char* value_begin;
+			const char* value_end;
+			while (tokenizer.peek().type != JTT_END_OBJECT)
+			{
+				tokenizer.next();
+				tokenizer.skip_value(value_begin, value_end);
+			}
+			return tokenizer.next().end;
+		}
+
+		// an object member read out of lockstep, its value is left in the input and only its text range is kept
+		struct PendingMember
+		{
+			JsonToken key;
+			std::string name;
+			const char* begin;
+			const char* end;
+			// old members: found in the new object and diffed, diff_text is empty if the values are equal
+			bool resolved;
+			std::string diff_text;
+			// new members: position in the new object, added members are written in this order
+			size_t order;
+		};
+
+		// false if the path filters leave out the member name of the object being diffed
+		bool member_in_scope(const std::string& name)
+		{
+			if (!_track_path)
+				return true;
+			_path.push_back(name);
+			bool in_scope = _json_diff.path_in_scope(_path);
+			_path.pop_back();
+			return in_scope;
+		}
+
+		static void read_member(JsonTokenizer& tokenizer, PendingMember& member)
+		{
+			member.key = tokenizer.next();
+			member.name = member.key.decode_string();
+			tokenizer.skip_value(member.begin, member.end);
+			member.resolved = false;
+			member.order = 0;
+		}
+
+		// consume one value of each side and write their diff under key, or keep it in text when text is not nullptr
+		// @returns false if the values are equal
+		bool diff_into(JsonTokenizer& a, JsonTokenizer& b, const JsonToken* key, std::string* text)
+		{
+			if (!text)
+			{
+				diff_values(a, b, key);
+				return true;
+			}
+			StreamDiffWriter writer(nullptr);
+			auto parent_writer = _writer;
+			_writer = &writer;
+			diff_values(a, b, nullptr);
+			_writer = parent_writer;
+			if (!writer.written())
+				return false;
+			*text = writer.text();
+			return true;
+		}
+
+		bool diff_members(const PendingMember& a_member, const PendingMember& b_member, std::string* text)
+		{
+			JsonTokenizer a_value(a_member.begin, a_member.end);
+			JsonTokenizer b_value(b_member.begin, b_member.end);
+			if (_track_path)
+				_path.push_back(a_member.name);
+			bool changed = diff_into(a_value, b_value, &a_member.key, text);
+			if (_track_path)
+				_path.pop_back();
+			return changed;
+		}
+
+		// both '{' consumed. members are walked in lockstep while both sides have the same key at the same place.
+		// other members wait until their key shows up on the other side: old members in a queue, because their diffs
+		// are written in the old order, new members in a map, the ones left at the end are the added members.
+		// only members out of lockstep and the diffs queued behind them are kept, the same output as JsonDiff::diff.
+		// @returns false, with both objects read up to a member, when one of them has a key twice: json_loads keeps the
+		// last value at the place of the first, which only the parsed objects can show
+		bool diff_objects(JsonTokenizer& a, JsonTokenizer& b)
+		{
+			std::deque<PendingMember> a_queue;
+			std::unordered_map<std::string, PendingMember*> a_pending;
+			std::unordered_map<std::string, PendingMember> b_pending;
+			KeyHashSet a_keys;
+			KeyHashSet b_keys;
+			size_t b_order = 0;
+			for (;;)
+			{
+				release_input(a, b);
+				auto a_token = a.peek();
+				auto b_token = b.peek();
+				bool a_end = a_token.type == JTT_END_OBJECT;
+				bool b_end = b_token.type == JTT_END_OBJECT;
+				if (a_end && b_end)
+					break;
+				if (!a_end && !b_end && json_token_equal(a_token, b_token))
+				{
+					if (!a_keys.insert(a_token) || !b_keys.insert(b_token))
+						return false;
+					a.next();
+					b.next();
+					b_order++;
+					if (_track_path)
+						_path.push_back(a_token.decode_string());
+					if (a_queue.empty())
+						diff_into(a, b, &a_token, nullptr);
+					else
+					{
+						// behind a member still waiting for its key
+						PendingMember a_member;
+						a_member.key = a_token;
+						a_member.resolved = true;
+						if (diff_into(a, b, nullptr, &a_member.diff_text))
+							a_queue.push_back(std::move(a_member));
+					}
+					if (_track_path)
+						_path.pop_back();
+					continue;
+				}
+				if ((!a_end && !a_keys.insert(a_token)) || (!b_end && !b_keys.insert(b_token)))
+					return false;
+				if (!a_end)
+				{
+					PendingMember a_member;
+					read_member(a, a_member);
+					auto found = b_pending.find(a_member.name);
+					if (found != b_pending.end())
+					{
+						if (a_queue.empty())
+							diff_members(a_member, found->second, nullptr);
+						else if (diff_members(a_member, found->second, &a_member.diff_text))
+						{
+							a_member.resolved = true;
+							a_queue.push_back(std::move(a_member));
+						}
+						b_pending.erase(found);
+					}
+					else
+					{
+						a_queue.push_back(std::move(a_member));
+						a_pending.emplace(a_queue.back().name, &a_queue.back());
+					}
+				}
+				if (!b_end)
+				{
+					PendingMember b_member;
+					read_member(b, b_member);
+					b_member.order = b_order++;
+					auto found = a_pending.find(b_member.name);
+					if (found == a_pending.end())
+					{
+						b_pending.emplace(b_member.name, std::move(b_member));
+						continue;
+					}
+					auto a_member = found->second;
+					a_pending.erase(found);
+					if (a_member == &a_queue.front())
+					{
+						diff_members(*a_member, b_member, nullptr);
+						a_queue.pop_front();
+					}
+					else
+					{
+						diff_members(*a_member, b_member, &a_member->diff_text);
+						a_member->resolved = true;
+					}
+					while (!a_queue.empty() && a_queue.front().resolved)
+					{
+						if (!a_queue.front().diff_text.empty())
+							_writer->member(&a_queue.front().key, "", a_queue.front().diff_text);
+						a_queue.pop_front();
+					}
+				}
+			}
+			a.next();
+			b.next();
+			for (const auto& a_member : a_queue)
+			{
+				if (!a_member.resolved)
+				{
+					if (!member_in_scope(a_member.name))
+						continue;
+					count_change();
+					_writer->member(&a_member.key, JSONDIFF_KEY_DELETED_POSTFIX, json_dumps(parse_range(a_member.begin, a_member.end)));
+				}
+				else if (!a_member.diff_text.empty())
+					_writer->member(&a_member.key, "", a_member.diff_text);
+			}
+			if (b_pending.empty())
+				return true;
+			std::vector<const PendingMember*> added;
+			added.reserve(b_pending.size());
+			for (const auto& b_member : b_pending)
+			{
+				if (member_in_scope(b_member.second.name))
+					added.push_back(&b_member.second);
+			}
+			std::sort(added.begin(), added.end(), [](const PendingMember* x, const PendingMember* y) { return x->order < y->order; });
+			for (auto b_member : added)
+			{
+				count_change();
+				_writer->member(&b_member->key, JSONDIFF_KEY_ADDED_POSTFIX, json_dumps(parse_range(b_member->begin, b_member->end)));
+			}
+			return true;
+		}
+
+		// consume a whole array of each side, parse both and diff them with JsonDiff::diff_at
+		void diff_parsed_arrays(JsonTokenizer& a, JsonTokenizer& b, const JsonToken* key)
+		{
+			auto old_json = parse_value(a);
+			auto new_json = parse_value(b);
+			JsonValue diff_json;
+			if (diff_subtrees(old_json, new_json, diff_json))
+				_writer->member(key, "", json_dumps(diff_json));
+		}
+
+		// append ["op",index,value] to the items of an array diff, the first one opens the array
+		static void append_array_item(std::string& items, const char* op, size_t index, const std::string& value_text)
+		{
+			items.append(items.empty() ? "[[\"" : ",[\"");
+			items.append(op);
+			items.append("\",");
+			items.append(std::to_string(index));
+			items.push_back(',');
+			items.append(value_text);
+			items.push_back(']');
+		}
+
+		// both sides are read in lockstep while their elements are equal, the prefix. on the first difference the rest
+		// is counted, then walked again with the ends of both arrays lined up to find the suffix equal token by token.
+		// only the elements between the two, the middle, are kept as text ranges: they are matched by the longest
+		// common subsequence of their fingerprints like JsonDiff::diff does, which strips the same prefix and then the
+		// rest of the suffix itself, so the matches are the same. paired elements are diffed one at a time.
+		// arrays matched by key are parsed whole, their diff depends on every element
+		void diff_arrays(JsonTokenizer& a, JsonTokenizer& b, const JsonToken* key)
+		{
+			if (_track_path && _json_diff.find_array_key_pattern(_path))
+			{
+				diff_parsed_arrays(a, b, key);
+				return;
+			}
+			a.next();
+			b.next();
+			size_t prefix = 0;
+			JsonTokenizer a_middle = a;
+			JsonTokenizer b_middle = b;
+			const char* a_begin;
+			const char* a_end;
+			const char* b_begin;
+			const char* b_end;
+			for (;; prefix++)
+			{
+				release_input(a, b);
+				a_middle = a;
+				b_middle = b;
+				bool a_done = a.peek().type == JTT_END_ARRAY;
+				bool b_done = b.peek().type == JTT_END_ARRAY;
+				if (a_done && b_done)
+				{
+					a.next();
+					b.next();
+					return;
+				}
+				if (a_done || b_done)
+					break;
+				a.skip_value(a_begin, a_end);
+				b.skip_value(b_begin, b_end);
+				if (!elements_equal(a_begin, a_end, b_begin, b_end))
+					break;
+			}
+			// a_middle and b_middle are at the first differing elements, or at the end of the shorter array
+			size_t a_count = 0;
+			size_t b_count = 0;
+			{
+				JsonTokenizer a_rest = a_middle;
+				JsonTokenizer b_rest = b_middle;
+				while (a_rest.peek().type != JTT_END_ARRAY)
+				{
+					a_rest.skip_value(a_begin, a_end);
+					a_count++;
+					release_input(a_rest, b_rest);
+				}
+				while (b_rest.peek().type != JTT_END_ARRAY)
+				{
+					b_rest.skip_value(b_begin, b_end);
+					b_count++;
+					release_input(a_rest, b_rest);
+				}
+				a_rest.next();
+				b_rest.next();
+				a = a_rest;
+				b = b_rest;
+			}
+
+			// the ends lined up: the first elements of the longer side can't be in the suffix
+			auto a_middle_begin = a_middle.peek().begin;
+			auto b_middle_begin = b_middle.peek().begin;
+			rescan_input(a_middle_begin, b_middle_begin);
+			size_t suffix = 0;
+			{
+				JsonTokenizer a_rest = a_middle;
+				JsonTokenizer b_rest = b_middle;
+				for (size_t i = b_count; i < a_count; i++)
+					a_rest.skip_value(a_begin, a_end);
+				for (size_t i = a_count; i < b_count; i++)
+					b_rest.skip_value(b_begin, b_end);
+				while (a_rest.peek().type != JTT_END_ARRAY)
+				{
+					a_rest.skip_value(a_begin, a_end);
+					b_rest.skip_value(b_begin, b_end);
+					suffix = ranges_equal(a_begin, a_end, b_begin, b_end) ? suffix + 1 : 0;
+					release_input(a_rest, b_rest);
+				}
+			}
+			rescan_input(a_middle_begin, b_middle_begin);
+
+			std::vector<std::pair<const char*, const char*>> a_ranges(a_count - suffix);
+			std::vector<std::pair<const char*, const char*>> b_ranges(b_count - suffix);
+			for (auto& range : a_ranges)
+				a_middle.skip_value(range.first, range.second);
+			for (auto& range : b_ranges)
+				b_middle.skip_value(range.first, range.second);
+
+			// equal elements get the same symbol, by fingerprint and then by value
+			std::vector<SequenceMatch> matches;
+			if (!a_ranges.empty() && !b_ranges.empty() && (a_ranges.size() > 1 || b_ranges.size() > 1))
+			{
+				std::unordered_map<JsonFingerprint, std::vector<uint32_t>> symbols_by_fingerprint;
+				std::vector<const std::pair<const char*, const char*>*> symbol_ranges;
+				auto intern = [&](const std::pair<const char*, const char*>& range) {
+					auto json = parse_range(range.first, range.second);
+					auto& symbols = symbols_by_fingerprint[json_fingerprint(json)];
+					for (auto symbol : symbols)
+					{
+						const auto& other = *symbol_ranges[symbol];
+						if (ranges_equal(range.first, range.second, other.first, other.second)
+							|| json_equal(json, parse_range(other.first, other.second)))
+							return symbol;
+					}
+					auto symbol = (uint32_t)symbol_ranges.size();
+					symbol_ranges.push_back(&range);
+					symbols.push_back(symbol);
+					return symbol;
+				};
+				std::vector<uint32_t> a_symbols;
+				std::vector<uint32_t> b_symbols;
+				a_symbols.reserve(a_ranges.size());
+				b_symbols.reserve(b_ranges.size());
+				for (const auto& range : a_ranges)
+					a_symbols.push_back(intern(range));
+				for (const auto& range : b_ranges)
+					b_symbols.push_back(intern(range));
+				matches = sequence_lcs(a_symbols, b_symbols, _json_diff._options.array_diff_max_cost);
+			}
+			matches.push_back(SequenceMatch(a_ranges.size(), b_ranges.size()));
+
+			// the same walk as JsonDiff::diff, positions shifted by the prefix
+			std::string items;
+			size_t a_pos = 0;
+			size_t b_pos = 0;
+			for (const auto& match : matches)
+			{
+				size_t paired_count = std::min(match.first - a_pos, match.second - b_pos);
+				for (size_t k = 0; k < paired_count; k++)
+				{
+					const auto& a_range = a_ranges[a_pos + k];
+					const auto& b_range = b_ranges[b_pos + k];
+					JsonTokenizer a_value(a_range.first, a_range.second);
+					JsonTokenizer b_value(b_range.first, b_range.second);
+					std::string item_text;
+					if (_track_path)
+						_path.push_back(std::to_string(prefix + a_pos + k));
+					bool changed = diff_into(a_value, b_value, nullptr, &item_text);
+					if (_track_path)
+						_path.pop_back();
+					if (changed)
+						append_array_item(items, "~", prefix + a_pos + k, item_text);
+				}
+				for (size_t i = a_pos + paired_count; i < match.first; i++)
+				{
+					count_change();
+					append_array_item(items, "-", prefix + i, json_dumps(parse_range(a_ranges[i].first, a_ranges[i].second)));
+				}
+				for (size_t j = b_pos + paired_count; j < match.second; j++)
+				{
+					count_change();
+					append_array_item(items, "+", prefix + j, json_dumps(parse_range(b_ranges[j].first, b_ranges[j].second)));
+				}
+				a_pos = match.first + 1;
+				b_pos = match.second + 1;
+			}
+			if (!items.empty())
+				_writer->member(key, "", items + "]");
+		}
+	public:
+		StreamDiffer(JsonDiff& json_diff, StreamDiffWriter& writer, MappedFile* old_file, MappedFile* new_file)
+			: _json_diff(json_diff), _writer(&writer), _track_path(json_diff._track_path),
+			_old_file(old_file), _new_file(new_file), _compared_values(0), _changes(0)
+		{
+		}
+
+		// true if the options have a budget, the writer must then hold the diff until it is done
+		static bool has_budget(const DiffOptions& options)
+		{
+			return options.max_compared_values != SIZE_MAX || options.max_changes != SIZE_MAX;
+		}
+
+		// @throws JsonDiffException, JsonDiffBudgetException with DBA_THROW
+		void run(const char* old_json, size_t old_size, const char* new_json, size_t new_size)
+		{
+			auto writer = _writer;
+			try
+			{
+				JsonTokenizer a(old_json, old_json + old_size);
+				JsonTokenizer b(new_json, new_json + new_size);
+				diff_values(a, b, nullptr);
+				// throws on data after the values
+				a.next();
+				b.next();
+			}
+			catch (const JsonDiffBudgetException&)
+			{
+				if (_json_diff._options.budget_action == DBA_THROW)
+					throw;
+				// the work done so far is dropped, the documents replace each other whole
+				_writer = writer;
+				_writer->clear();
+				_path.clear();
+				_writer->member(nullptr, "", replace_text(parse_range(old_json, old_json + old_size), parse_range(new_json, new_json + new_size)));
+			}
+			_writer->finish();
+		}
+
+		// consume one value of each side and write their diff under key
+		void diff_values(JsonTokenizer& a, JsonTokenizer& b, const JsonToken* key)
+		{
+			const char* value_begin;
+			const char* value_end;
+			if (_track_path && !_json_diff.path_in_scope(_path))
+			{
+				a.skip_value(value_begin, value_end);
+				b.skip_value(value_begin, value_end);
+				return;
+			}
+			count_compare();
+			auto a_token = a.peek();
+			auto b_token = b.peek();
+			bool containers = (a_token.type == JTT_BEGIN_OBJECT || a_token.type == JTT_BEGIN_ARRAY) && a_token.type == b_token.type;
+			if (containers && _track_path && _path.size() >= _json_diff._options.max_depth)
+			{
+				// below the depth limit a changed subtree is replaced whole
+				auto old_json = parse_value(a);
+				auto new_json = parse_value(b);
+				if (!json_equal(old_json, new_json))
+					write_replace(key, old_json, new_json);
+				return;
+			}
+			if (a_token.type == JTT_BEGIN_OBJECT && b_token.type == JTT_BEGIN_OBJECT)
+			{
+				auto mark = _writer->mark();
+				size_t compared_values = _compared_values;
+				size_t changes = _changes;
+				auto a_begin = a.next().begin;
+				auto b_begin = b.next().begin;
+				_writer->open_object(key);
+				if (diff_objects(a, b))
+				{
+					_writer->close_object();
+					return;
+				}
+				// a key written twice, the objects are diffed as json_loads reads them
+				if (!_writer->rollback(mark))
+					throw JsonDiffException("duplicate object key found after the diff of its object was written");
+				auto a_end = skip_members(a);
+				auto b_end = skip_members(b);
+				auto old_json = parse_range(a_begin, a_end);
+				auto new_json = parse_range(b_begin, b_end);
+				_compared_values = compared_values;
+				_changes = changes;
+				JsonValue diff_json;
+				if (diff_subtrees(old_json, new_json, diff_json))
+					_writer->member(key, "", json_dumps(diff_json));
+				return;
+			}
+			if (a_token.type == JTT_BEGIN_ARRAY && b_token.type == JTT_BEGIN_ARRAY)
+			{
+				diff_arrays(a, b, key);
+				return;
+			}
+			if (a_token.is_scalar() && b_token.is_scalar())
+			{
+				a.next();
+				b.next();
+				if (!json_token_equal(a_token, b_token))
+					write_scalar_change(key, a_token.decode_scalar(), b_token.decode_scalar());
+				return;
+			}
+			// different types, at least one of them a container
+			auto old_json = parse_value(a);
+			auto new_json = parse_value(b);
+			write_replace(key, old_json, new_json);
+		}
+	};
+
+	void JsonDiff::diff_stream(const char* old_json, size_t old_size, const char* new_json, size_t new_size, std::ostream& out)
+	{
+		StreamDiffWriter writer(&out, StreamDiffer::has_budget(_options));
+		StreamDiffer differ(*this, writer, nullptr, nullptr);
+		differ.run(old_json, old_size, new_json, new_size);
+	}
+
+	void JsonDiff::diff_files(const std::string& old_path, const std::string& new_path, std::ostream& out)
+	{
+		MappedFile old_file(old_path);
+		MappedFile new_file(new_path);
+		StreamDiffWriter writer(&out, StreamDiffer::has_budget(_options));
+		StreamDiffer differ(*this, writer, &old_file, &new_file);
+		differ.run(old_file.data(), old_file.size(), new_file.data(), new_file.size());
+	}
+}
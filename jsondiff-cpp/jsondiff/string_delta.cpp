@@ -0,0 +1,303 @@
+#include <jsondiff/string_delta.h>
+#include <jsondiff/exceptions.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <tuple>
+#include <vector>
+
+namespace jsondiff
+{
+	// bytes a hunk adds to the diff text besides its two texts, about [<pos>,"",""],
+	static const size_t hunk_overhead = 16;
+
+	// true if offset is the end of data or the first byte of an utf-8 sequence
+	static bool is_utf8_boundary(const char* data, size_t size, size_t offset)
+	{
+		return offset >= size || ((unsigned char)data[offset] & 0xC0) != 0x80;
+	}
+
+	// the first offset in [from, to) where a and b differ, to if none. compares a word at a time
+	static size_t first_difference(const char* a, const char* b, size_t from, size_t to)
+	{
+		while (to - from >= sizeof(uint64_t))
+		{
+			uint64_t a_word;
+			uint64_t b_word;
+			memcpy(&a_word, a + from, sizeof(a_word));
+			memcpy(&b_word, b + from, sizeof(b_word));
+			if (a_word != b_word)
+				break;
+			from += sizeof(uint64_t);
+		}
+		while (from < to && a[from] == b[from])
+			from++;
+		return from;
+	}
+
+	// the size of the longest common suffix of a and b, at most limit
+	static size_t common_suffix(const char* a_end, const char* b_end, size_t limit)
+	{
+		size_t size = 0;
+		while (limit - size >= sizeof(uint64_t))
+		{
+			uint64_t a_word;
+			uint64_t b_word;
+			memcpy(&a_word, a_end - size - sizeof(uint64_t), sizeof(a_word));
+			memcpy(&b_word, b_end - size - sizeof(uint64_t), sizeof(b_word));
+			if (a_word != b_word)
+				break;
+			size += sizeof(uint64_t);
+		}
+		while (size < limit && a_end[-(ptrdiff_t)size - 1] == b_end[-(ptrdiff_t)size - 1])
+			size++;
+		return size;
+	}
+
+	// the common prefix and suffix of a and b, ending and starting on utf-8 boundaries
+	static void common_affixes(const char* a, size_t a_size, const char* b, size_t b_size, size_t& prefix, size_t& suffix)
+	{
+		size_t limit = std::min(a_size, b_size);
+		prefix = first_difference(a, b, 0, limit);
+		while (prefix > 0 && !(is_utf8_boundary(a, a_size, prefix) && is_utf8_boundary(b, b_size, prefix)))
+			prefix--;
+		suffix = common_suffix(a + a_size, b + b_size, limit - prefix);
+		// the suffix has the same bytes on both sides, so one test covers both
+		while (suffix > 0 && !is_utf8_boundary(a, a_size, a_size - suffix))
+			suffix--;
+	}
+
+	static JsonValue make_hunk(size_t pos, std::string old_text, std::string new_text)
+	{
+		fc::variants hunk(3);
+		hunk[0] = JsonValue((uint64_t)pos);
+		hunk[1] = JsonValue(std::move(old_text));
+		hunk[2] = JsonValue(std::move(new_text));
+		return JsonValue(std::move(hunk));
+	}
+
+	static void make_delta_json(fc::variants&& hunks, JsonValue& diff_json)
+	{
+		fc::mutable_variant_object result_json;
+		result_json[JSONDIFF_KEY_STRING_DELTA] = JsonValue(std::move(hunks));
+		diff_json = std::move(result_json);
+	}
+
+	bool make_string_delta(const char* old_data, size_t old_size, const char* new_data, size_t new_size, JsonValue& diff_json)
+	{
+		size_t prefix;
+		size_t suffix;
+		common_affixes(old_data, old_size, new_data, new_size, prefix, suffix);
+		size_t old_end = old_size - suffix;
+		size_t new_end = new_size - suffix;
+		// (start, old end, new end) of the hunks
+		std::vector<std::tuple<size_t, size_t, size_t>> runs;
+		if (old_end - prefix == new_end - prefix)
+		{
+			// bytes changed in place: one hunk per run of changed bytes, runs closer than the overhead of a hunk are joined
+			size_t i = prefix;
+			for (;;)
+			{
+				i = first_difference(old_data, new_data, i, old_end);
+				if (i == old_end)
+					break;
+				size_t start = i;
+				while (i < old_end && old_data[i] != new_data[i])
+					i++;
+				size_t stop = i;
+				// prefix and old_end are boundaries on both sides, so these stop there at the latest
+				while (!(is_utf8_boundary(old_data, old_size, start) && is_utf8_boundary(new_data, new_size, start)))
+					start--;
+				while (!(is_utf8_boundary(old_data, old_size, stop) && is_utf8_boundary(new_data, new_size, stop)))
+					stop++;
+				if (!runs.empty() && start <= std::get<1>(runs.back()) + hunk_overhead / 2)
+					std::get<1>(runs.back()) = std::get<2>(runs.back()) = stop;
+				else
+					runs.push_back(std::make_tuple(start, stop, stop));
+				i = std::max(i, stop);
+			}
+		}
+		else
+			runs.push_back(std::make_tuple(prefix, old_end, new_end));
+		if (runs.empty())
+			return false;
+		size_t delta_size = hunk_overhead;
+		for (const auto& run : runs)
+			delta_size += (std::get<1>(run) - std::get<0>(run)) + (std::get<2>(run) - std::get<0>(run)) + hunk_overhead;
+		if (delta_size >= old_size + new_size)
+			return false;
+		fc::variants hunks;
+		hunks.reserve(runs.size());
+		for (const auto& run : runs)
+		{
+			size_t start = std::get<0>(run);
+			hunks.push_back(make_hunk(start, std::string(old_data + start, std::get<1>(run) - start),
+				std::string(new_data + start, std::get<2>(run) - start)));
+		}
+		make_delta_json(std::move(hunks), diff_json);
+		return true;
+	}
+
+	bool is_string_delta_hunks(const JsonValue& hunks_json)
+	{
+		if (!hunks_json.is_array())
+			return false;
+		for (const auto& hunk_json : hunks_json.get_array())
+		{
+			if (!hunk_json.is_array())
+				return false;
+			const auto& hunk = hunk_json.get_array();
+			if (hunk.size() != 3 || !hunk[1].is_string() || !hunk[2].is_string())
+				return false;
+			if (hunk[0].get_type() != fc::variant::uint64_type && (hunk[0].get_type() != fc::variant::int64_type || hunk[0].as_int64() < 0))
+				return false;
+		}
+		return true;
+	}
+
+	// a hunk with its position in the string the delta applies to and in the one it produces
+	struct StringHunkRef
+	{
+		size_t old_pos;
+		size_t new_pos;
+		const std::string* old_text;
+		const std::string* new_text;
+	};
+
+	// @throws JsonDiffException if hunks overlap or aren't in order
+	static std::vector<StringHunkRef> read_hunks(const JsonArray& hunks)
+	{
+		std::vector<StringHunkRef> result;
+		result.reserve(hunks.size());
+		size_t old_end = 0;
+		size_t new_end = 0;
+		for (const auto& hunk_json : hunks)
+		{
+			const auto& hunk = hunk_json.get_array();
+			StringHunkRef ref;
+			ref.old_pos = (size_t)hunk[0].as_uint64();
+			if (ref.old_pos < old_end)
+				throw JsonDiffException("wrong format of string delta, hunks overlap");
+			// the unchanged bytes between two hunks are the same on both sides
+			ref.new_pos = new_end + (ref.old_pos - old_end);
+			ref.old_text = &hunk[1].get_string();
+			ref.new_text = &hunk[2].get_string();
+			old_end = ref.old_pos + ref.old_text->size();
+			new_end = ref.new_pos + ref.new_text->size();
+			result.push_back(ref);
+		}
+		return result;
+	}
+
+	std::string apply_string_delta(const char* data, size_t size, const JsonArray& hunks, bool rollback)
+	{
+		std::string result;
+		result.reserve(size);
+		size_t cursor = 0;
+		for (const auto& hunk : read_hunks(hunks))
+		{
+			size_t pos = rollback ? hunk.new_pos : hunk.old_pos;
+			const auto& from = rollback ? *hunk.new_text : *hunk.old_text;
+			const auto& to = rollback ? *hunk.old_text : *hunk.new_text;
+			if (pos > size || from.size() > size - pos || memcmp(data + pos, from.data(), from.size()) != 0)
+				throw JsonDiffException("string delta doesn't match the string");
+			result.append(data + cursor, pos - cursor);
+			result.append(to);
+			cursor = pos + from.size();
+		}
+		result.append(data + cursor, size - cursor);
+		return result;
+	}
+
+	bool compose_string_delta(const JsonArray& first, const JsonArray& second, JsonValue& diff_json)
+	{
+		// both deltas are laid over the middle string: the first one produced [new_pos, +new size) of it,
+		// the second one replaces [old_pos, +old size). overlapping or touching ranges form clusters whose middle
+		// text is known from the hunks alone, each cluster becomes one hunk from the first string to the last one
+		auto first_hunks = read_hunks(first);
+		auto second_hunks = read_hunks(second);
+		fc::variants hunks;
+		size_t i = 0;
+		size_t j = 0;
+		while (i < first_hunks.size() || j < second_hunks.size())
+		{
+			bool take_first = j == second_hunks.size() || (i < first_hunks.size() && first_hunks[i].new_pos <= second_hunks[j].old_pos);
+			size_t start = take_first ? first_hunks[i].new_pos : second_hunks[j].old_pos;
+			size_t end = start;
+			size_t first_begin = i;
+			size_t second_begin = j;
+			for (;;)
+			{
+				if (i < first_hunks.size() && first_hunks[i].new_pos <= end)
+				{
+					end = std::max(end, first_hunks[i].new_pos + first_hunks[i].new_text->size());
+					i++;
+				}
+				else if (j < second_hunks.size() && second_hunks[j].old_pos <= end)
+				{
+					end = std::max(end, second_hunks[j].old_pos + second_hunks[j].old_text->size());
+					j++;
+				}
+				else
+					break;
+			}
+			// the middle text of the cluster, the two deltas have to agree where they both know it
+			std::string middle(end - start, '\0');
+			std::vector<bool> known(end - start, false);
+			for (size_t k = first_begin; k < i; k++)
+			{
+				const auto& hunk = first_hunks[k];
+				memcpy(&middle[hunk.new_pos - start], hunk.new_text->data(), hunk.new_text->size());
+				std::fill(known.begin() + (hunk.new_pos - start), known.begin() + (hunk.new_pos - start + hunk.new_text->size()), true);
+			}
+			for (size_t k = second_begin; k < j; k++)
+			{
+				const auto& hunk = second_hunks[k];
+				for (size_t n = 0; n < hunk.old_text->size(); n++)
+				{
+					size_t at = hunk.old_pos - start + n;
+					if (known[at] && middle[at] != (*hunk.old_text)[n])
+						throw JsonDiffException("string delta doesn't follow the first delta, can't compose");
+					middle[at] = (*hunk.old_text)[n];
+				}
+			}
+			std::string old_text;
+			size_t cursor = start;
+			for (size_t k = first_begin; k < i; k++)
+			{
+				old_text.append(middle, cursor - start, first_hunks[k].new_pos - cursor);
+				old_text.append(*first_hunks[k].old_text);
+				cursor = first_hunks[k].new_pos + first_hunks[k].new_text->size();
+			}
+			old_text.append(middle, cursor - start, end - cursor);
+			std::string new_text;
+			cursor = start;
+			for (size_t k = second_begin; k < j; k++)
+			{
+				new_text.append(middle, cursor - start, second_hunks[k].old_pos - cursor);
+				new_text.append(*second_hunks[k].new_text);
+				cursor = second_hunks[k].old_pos + second_hunks[k].old_text->size();
+			}
+			new_text.append(middle, cursor - start, end - cursor);
+			// the cluster starts in the first string where the unchanged bytes before it do
+			size_t old_pos = start;
+			if (first_begin > 0)
+			{
+				const auto& before = first_hunks[first_begin - 1];
+				old_pos = before.old_pos + before.old_text->size() + (start - before.new_pos - before.new_text->size());
+			}
+			if (old_text == new_text)
+				continue;
+			size_t prefix;
+			size_t suffix;
+			common_affixes(old_text.data(), old_text.size(), new_text.data(), new_text.size(), prefix, suffix);
+			hunks.push_back(make_hunk(old_pos + prefix, old_text.substr(prefix, old_text.size() - prefix - suffix),
+				new_text.substr(prefix, new_text.size() - prefix - suffix)));
+		}
+		if (hunks.empty())
+			return false;
+		make_delta_json(std::move(hunks), diff_json);
+		return true;
+	}
+}
@@ -0,0 +1,190 @@
+#include <jsondiff/thread_pool.h>
+
+namespace jsondiff
+{
+	// the pool and queue of the worker running on this thread
+	static thread_local const ThreadPool* current_pool = nullptr;
+	static thread_local size_t current_pool_queue = SIZE_MAX;
+
+	ThreadPool::ThreadPool(size_t thread_count)
+		: _queued(0), _next_queue(0), _stopping(false)
+	{
+		if (thread_count == 0)
+			thread_count = std::thread::hardware_concurrency();
+		if (thread_count == 0)
+			thread_count = 1;
+		for (size_t i = 0; i < thread_count; i++)
+			_queues.push_back(std::unique_ptr<Queue>(new Queue()));
+		for (size_t i = 0; i < thread_count; i++)
+			_threads.push_back(std::thread(&ThreadPool::worker_loop, this, i));
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_wake_mutex);
+			_stopping = true;
+		}
+		_wake.notify_all();
+		for (auto& thread : _threads)
+			thread.join();
+	}
+
+	size_t ThreadPool::thread_count() const
+	{
+		return _threads.size();
+	}
+
+	size_t ThreadPool::current_queue() const
+	{
+		return current_pool == this ? current_pool_queue : SIZE_MAX;
+	}
+
+	void ThreadPool::push(Task&& task)
+	{
+		size_t index = current_queue();
+		if (index == SIZE_MAX)
+			index = _next_queue++ % _queues.size();
+		{
+			std::lock_guard<std::mutex> lock(_queues[index]->mutex);
+			_queues[index]->tasks.push_back(std::move(task));
+		}
+		_queued++;
+		{
+			// taken so that a thread checking _queued before sleeping can't miss the notify
+			std::lock_guard<std::mutex> lock(_wake_mutex);
+		}
+		_wake.notify_one();
+	}
+
+	bool ThreadPool::try_pop(Task& task)
+	{
+		if (_queued == 0)
+			return false;
+		size_t own = current_queue();
+		if (own != SIZE_MAX)
+		{
+			auto& queue = *_queues[own];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.tasks.empty())
+			{
+				task = std::move(queue.tasks.back());
+				queue.tasks.pop_back();
+				_queued--;
+				return true;
+			}
+		}
+		size_t start = own != SIZE_MAX ? own : _next_queue.load();
+		for (size_t k = 1; k <= _queues.size(); k++)
+		{
+			auto& queue = *_queues[(start + k) % _queues.size()];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (queue.tasks.empty())
+				continue;
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+			_queued--;
+			return true;
+		}
+		return false;
+	}
+
+	void ThreadPool::run_task(Task& task)
+	{
+		std::exception_ptr error;
+		try
+		{
+			task.run();
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+		task.run = nullptr;
+		task.group->finish(error);
+	}
+
+	void ThreadPool::worker_loop(size_t index)
+	{
+		current_pool = this;
+		current_pool_queue = index;
+		for (;;)
+		{
+			Task task;
+			if (try_pop(task))
+			{
+				run_task(task);
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(_wake_mutex);
+			_wake.wait(lock, [this]() { return _stopping || _queued > 0; });
+			if (_stopping)
+				return;
+		}
+	}
+
+	TaskGroup::TaskGroup(ThreadPool& pool)
+		: _pool(pool), _pending(0)
+	{
+	}
+
+	TaskGroup::~TaskGroup()
+	{
+		try
+		{
+			wait();
+		}
+		catch (...)
+		{
+		}
+	}
+
+	void TaskGroup::run(std::function<void()> task)
+	{
+		_pending++;
+		ThreadPool::Task pool_task;
+		pool_task.run = std::move(task);
+		pool_task.group = this;
+		_pool.push(std::move(pool_task));
+	}
+
+	void TaskGroup::finish(std::exception_ptr error)
+	{
+		if (error)
+		{
+			std::lock_guard<std::mutex> lock(_error_mutex);
+			if (!_error)
+				_error = error;
+		}
+		// the group may be gone as soon as _pending is 0, only the pool is used after this
+		auto& pool = _pool;
+		if (--_pending > 0)
+			return;
+		{
+			std::lock_guard<std::mutex> lock(pool._wake_mutex);
+		}
+		pool._wake.notify_all();
+	}
+
+	void TaskGroup::wait()
+	{
+		while (_pending > 0)
+		{
+			ThreadPool::Task task;
+			if (_pool.try_pop(task))
+			{
+				_pool.run_task(task);
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(_pool._wake_mutex);
+			_pool._wake.wait(lock, [this]() { return _pending == 0 || _pool._queued > 0; });
+		}
+		std::exception_ptr error;
+		{
+			std::lock_guard<std::mutex> lock(_error_mutex);
+			std::swap(error, _error);
+		}
+		if (error)
+			std::rethrow_exception(error);
+	}
+}
@@ -0,0 +1,310 @@
+#include <jsondiff/tracked_document.h>
+#include <jsondiff/exceptions.h>
+#include <jsondiff/helper.h>
+#include <jsondiff/json_pointer.h>
+
+#include <unordered_map>
+
+namespace jsondiff
+{
+	// a value of a tracked document. an object or array a change is made in is expanded into nodes of its members or
+	// elements, which the later changes in it add, replace and remove without copying the others
+	struct TrackedNode
+	{
+		// the whole value while the node isn't expanded
+		JsonValue value;
+		bool expanded;
+		bool object;
+		// the members of an expanded object in order, an erased one is null until they are compacted
+		std::vector<std::pair<std::string, std::unique_ptr<TrackedNode>>> members;
+		std::unordered_map<std::string, size_t> member_positions;
+		size_t erased_members;
+		// the elements of an expanded array
+		std::vector<std::unique_ptr<TrackedNode>> items;
+
+		explicit TrackedNode(JsonValue value_)
+			: value(std::move(value_)), expanded(false), object(false), erased_members(0)
+		{
+		}
+	};
+
+	// a scalar isn't expanded
+	static void expand(TrackedNode& node)
+	{
+		if (node.expanded)
+			return;
+		if (node.value.is_object())
+		{
+			const auto& obj = node.value.get_object();
+			node.members.reserve(obj.size());
+			for (auto i = obj.begin(); i != obj.end(); i++)
+			{
+				// a repeated key is found at its first member, as patch finds it
+				node.member_positions.insert(std::make_pair(i->key(), node.members.size()));
+				node.members.push_back(std::make_pair(i->key(), std::unique_ptr<TrackedNode>(new TrackedNode(i->value()))));
+			}
+			node.object = true;
+		}
+		else if (node.value.is_array())
+		{
+			auto& items = node.value.get_array();
+			node.items.reserve(items.size());
+			for (auto& item : items)
+				node.items.push_back(std::unique_ptr<TrackedNode>(new TrackedNode(std::move(item))));
+		}
+		else
+			return;
+		node.value = JsonValue();
+		node.expanded = true;
+	}
+
+	// put node.value back together from the nodes of its members or elements
+	static void collapse(TrackedNode& node)
+	{
+		if (!node.expanded)
+			return;
+		if (node.object)
+		{
+			std::vector<fc::mutable_variant_object::entry> entries;
+			entries.reserve(node.members.size() - node.erased_members);
+			for (auto& member : node.members)
+			{
+				if (!member.second)
+					continue;
+				collapse(*member.second);
+				entries.push_back(fc::mutable_variant_object::entry(member.first, std::move(member.second->value)));
+			}
+			fc::mutable_variant_object obj;
+			utils::append_object_entries(obj, entries);
+			node.value = JsonValue(std::move(obj));
+			node.members.clear();
+			node.member_positions.clear();
+			node.erased_members = 0;
+		}
+		else
+		{
+			fc::variants items;
+			items.reserve(node.items.size());
+			for (auto& item : node.items)
+			{
+				collapse(*item);
+				items.push_back(std::move(item->value));
+			}
+			node.value = JsonValue(std::move(items));
+			node.items.clear();
+		}
+		node.expanded = false;
+		node.object = false;
+	}
+
+	// the member node of an expanded object, nullptr if it has no such member
+	static TrackedNode* find_member(TrackedNode& node, const std::string& key)
+	{
+		auto found = node.member_positions.find(key);
+		return found == node.member_positions.end() ? nullptr : node.members[found->second].second.get();
+	}
+
+	static void erase_member(TrackedNode& node, const std::string& key)
+	{
+		auto found = node.member_positions.find(key);
+		node.members[found->second].second.reset();
+		node.member_positions.erase(found);
+		node.erased_members++;
+		if (node.erased_members * 2 <= node.members.size())
+			return;
+		// compacted when most members are erased, so the erases stay O(1) on average
+		size_t kept = 0;
+		node.member_positions.clear();
+		for (size_t i = 0; i < node.members.size(); i++)
+		{
+			if (!node.members[i].second)
+				continue;
+			node.member_positions.insert(std::make_pair(node.members[i].first, kept));
+			node.members[kept++] = std::move(node.members[i]);
+		}
+		node.members.resize(kept);
+		node.erased_members = 0;
+	}
+
+	// the diff of a change covers all of it, path filters and budgets would leave the change out of its own diff
+	static DiffOptions change_options(DiffOptions options)
+	{
+		options.include_paths.clear();
+		options.exclude_paths.clear();
+		options.max_compared_values = SIZE_MAX;
+		options.max_changes = SIZE_MAX;
+		return options;
+	}
+
+	TrackedDocument::TrackedDocument(const JsonValue& json)
+		: _root(new TrackedNode(json)), _change_count(0)
+	{
+	}
+
+	TrackedDocument::TrackedDocument(const JsonValue& json, const DiffOptions& options)
+		: _json_diff(change_options(options)), _root(new TrackedNode(json)), _change_count(0)
+	{
+	}
+
+	TrackedDocument::~TrackedDocument()
+	{
+	}
+
+	const JsonValue& TrackedDocument::json() const
+	{
+		collapse(*_root);
+		return _root->value;
+	}
+
+	void TrackedDocument::change(ChangeType type, const std::string& pointer, const JsonValue* value)
+	{
+		auto tokens = json_pointer_parse(pointer);
+		JsonValue diff_json;
+		if (tokens.empty())
+		{
+			if (type == CT_ERASE)
+				throw JsonDiffException("can't erase the whole document");
+			if (!_json_diff.diff_at(tokens, json(), *value, diff_json))
+				return;
+			_root.reset(new TrackedNode(*value));
+		}
+		else
+		{
+			// the containers along the pointer, containers[i] holds the child tokens[i] names
+			std::vector<const TrackedNode*> containers;
+			std::vector<size_t> indexes(tokens.size());
+			TrackedNode* current = _root.get();
+			for (size_t i = 0; i + 1 < tokens.size(); i++)
+			{
+				expand(*current);
+				containers.push_back(current);
+				TrackedNode* child = nullptr;
+				if (current->expanded && current->object)
+					child = find_member(*current, tokens[i]);
+				else if (current->expanded)
+				{
+					if (json_pointer_parse_index(tokens[i], indexes[i]) && indexes[i] < current->items.size())
+						child = current->items[indexes[i]].get();
+				}
+				if (!child)
+					throw JsonDiffException("json pointer " + pointer + " has no parent in the document");
+				current = child;
+			}
+			// the diff of the container the change is made in, then the change
+			expand(*current);
+			const auto& key = tokens.back();
+			if (current->expanded && current->object)
+			{
+				auto found = find_member(*current, key);
+				if (type == CT_ERASE)
+				{
+					if (!found)
+						throw JsonDiffException("json pointer " + pointer + " not found in the document");
+					collapse(*found);
+					diff_json = fc::mutable_variant_object(key + JSONDIFF_KEY_DELETED_POSTFIX, std::move(found->value));
+					erase_member(*current, key);
+				}
+				else if (found)
+				{
+					collapse(*found);
+					JsonValue member_diff;
+					if (!_json_diff.diff_at(tokens, found->value, *value, member_diff))
+						return;
+					diff_json = fc::mutable_variant_object(key, std::move(member_diff));
+					found->value = *value;
+				}
+				else
+				{
+					diff_json = fc::mutable_variant_object(key + JSONDIFF_KEY_ADDED_POSTFIX, *value);
+					current->member_positions.insert(std::make_pair(key, current->members.size()));
+					current->members.push_back(std::make_pair(key, std::unique_ptr<TrackedNode>(new TrackedNode(*value))));
+				}
+			}
+			else if (current->expanded)
+			{
+				auto& items = current->items;
+				size_t index = items.size();
+				if (key != "-" && !json_pointer_parse_index(key, index))
+					throw JsonDiffException("json pointer " + pointer + " doesn't end with an array index");
+				fc::variants diff_json_array;
+				if (type == CT_SET && index < items.size())
+				{
+					collapse(*items[index]);
+					JsonValue item_diff;
+					if (!_json_diff.diff_at(tokens, items[index]->value, *value, item_diff))
+						return;
+					diff_json_array.push_back(make_array_diff_item("~", index, std::move(item_diff)));
+					items[index]->value = *value;
+				}
+				else if (type == CT_ERASE && index < items.size())
+				{
+					collapse(*items[index]);
+					diff_json_array.push_back(make_array_diff_item("-", index, std::move(items[index]->value)));
+					items.erase(items.begin() + index);
+				}
+				else if ((type != CT_ERASE && index == items.size()) || (type == CT_INSERT && index < items.size()))
+				{
+					diff_json_array.push_back(make_array_diff_item("+", index, *value));
+					items.insert(items.begin() + index, std::unique_ptr<TrackedNode>(new TrackedNode(*value)));
+				}
+				else
+					throw JsonDiffException("json pointer " + pointer + " is out of the array");
+				diff_json = std::move(diff_json_array);
+			}
+			else
+				throw JsonDiffException("json pointer " + pointer + " has no parent in the document");
+			// wrapped in the diffs of the containers above it
+			for (size_t i = containers.size(); i > 0; i--)
+			{
+				if (containers[i - 1]->object)
+					diff_json = fc::mutable_variant_object(tokens[i - 1], std::move(diff_json));
+				else
+				{
+					fc::variants diff_json_array;
+					diff_json_array.push_back(make_array_diff_item("~", indexes[i - 1], std::move(diff_json)));
+					diff_json = std::move(diff_json_array);
+				}
+			}
+		}
+		_changes.push_back(std::make_shared<DiffResult>(std::move(diff_json)));
+		_change_count++;
+	}
+
+	void TrackedDocument::set(const std::string& pointer, const JsonValue& value)
+	{
+		change(CT_SET, pointer, &value);
+	}
+
+	void TrackedDocument::erase(const std::string& pointer)
+	{
+		change(CT_ERASE, pointer, nullptr);
+	}
+
+	void TrackedDocument::insert(const std::string& pointer, const JsonValue& value)
+	{
+		change(CT_INSERT, pointer, &value);
+	}
+
+	DiffResultP TrackedDocument::diff()
+	{
+		if (_changes.empty())
+			return DiffResult::make_undefined_diff_result();
+		auto result = _json_diff.compose(_changes);
+		// kept folded, so the next call only composes the changes made after this one
+		_changes.clear();
+		if (!result->is_undefined())
+			_changes.push_back(result);
+		return result;
+	}
+
+	void TrackedDocument::reset()
+	{
+		_changes.clear();
+		_change_count = 0;
+	}
+
+	size_t TrackedDocument::change_count() const
+	{
+		return _change_count;
+	}
+}
@@ -0,0 +1,261 @@
+#include <jsondiff/version_store.h>
+#include <jsondiff/exceptions.h>
+#include <jsondiff/fingerprint.h>
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace jsondiff
+{
+	static const char version_log_magic[] = { 'J', 'D', 'V', 'S', 1 };
+	static const size_t version_log_header_size = sizeof(version_log_magic);
+	// type byte, payload size, payload checksum
+	static const size_t version_record_header_size = 1 + 8 + 8;
+	static const char version_record_diff = 'D';
+	static const char version_record_snapshot = 'S';
+
+	static void put_u64(char* out, uint64_t value)
+	{
+		for (int i = 0; i < 8; i++)
+			out[i] = (char)(value >> (8 * i));
+	}
+
+	static uint64_t get_u64(const char* data)
+	{
+		uint64_t value = 0;
+		for (int i = 0; i < 8; i++)
+			value |= (uint64_t)(unsigned char)data[i] << (8 * i);
+		return value;
+	}
+
+	// cut the file at path down to size bytes
+	// @throws JsonDiffException
+	static void truncate_file(const std::string& path, uint64_t size)
+	{
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, 0, nullptr);
+		LARGE_INTEGER position;
+		position.QuadPart = (LONGLONG)size;
+		bool done = file != INVALID_HANDLE_VALUE && SetFilePointerEx(file, position, nullptr, FILE_BEGIN) && SetEndOfFile(file);
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+#else
+		bool done = truncate(path.c_str(), (off_t)size) == 0;
+#endif
+		if (!done)
+			throw JsonDiffException(std::string("can't truncate file ") + path);
+	}
+
+	VersionStore::VersionStore(const std::string& path, const VersionStoreOptions& options)
+		: _path(path), _options(options), _json_diff(options.diff_options), _log_size(0)
+	{
+		if (_options.keyframe_interval < 1)
+			_options.keyframe_interval = 1;
+		open_log();
+	}
+
+	VersionStore::~VersionStore()
+	{
+		_writer.flush();
+	}
+
+	void VersionStore::open_log()
+	{
+		if (!std::ifstream(_path, std::ios::binary).good())
+		{
+			std::ofstream created(_path, std::ios::binary | std::ios::trunc);
+			created.write(version_log_magic, version_log_header_size);
+			if (!created.good())
+				throw JsonDiffException(std::string("can't create version log ") + _path);
+		}
+		_log.reset(new MappedFile(_path));
+		const char* data = _log->data();
+		uint64_t size = _log->size();
+		if (size < version_log_header_size || memcmp(data, version_log_magic, version_log_header_size) != 0)
+			throw JsonDiffException(std::string("not a version log ") + _path);
+		// index the records, the payloads are only read to check them.
+		// a keyframe's snapshot comes before its diff record, the version exists once the diff record is complete
+		uint64_t pos = version_log_header_size;
+		uint64_t valid_end = pos;
+		VersionEntry pending = { 0, 0, 0, 0 };
+		while (size - pos >= version_record_header_size)
+		{
+			char type = data[pos];
+			uint64_t payload_size = get_u64(data + pos + 1);
+			uint64_t checksum = get_u64(data + pos + 9);
+			uint64_t payload_offset = pos + version_record_header_size;
+			if (payload_size > size - payload_offset)
+				break; // cut short by a crash, dropped below
+			if (fingerprint_bytes(data + payload_offset, (size_t)payload_size) != checksum)
+			{
+				// the last record may be half written, one with records after it was damaged later
+				if (payload_size == size - payload_offset)
+					break;
+				throw JsonDiffException(std::string("corrupt version log ") + _path);
+			}
+			if (type == version_record_snapshot && pending.snapshot_offset == 0)
+			{
+				pending.snapshot_offset = payload_offset;
+				pending.snapshot_size = payload_size;
+			}
+			else if (type == version_record_diff && (pending.snapshot_offset != 0 || !_versions.empty()))
+			{
+				pending.diff_offset = payload_offset;
+				pending.diff_size = payload_size;
+				if (pending.snapshot_offset != 0)
+					_keyframes.push_back(_versions.size());
+				_versions.push_back(pending);
+				pending = VersionEntry{ 0, 0, 0, 0 };
+				valid_end = payload_offset + payload_size;
+			}
+			else
+				throw JsonDiffException(std::string("corrupt version log ") + _path);
+			pos = payload_offset + payload_size;
+		}
+		pos = valid_end;
+		if (pos < size)
+		{
+			_log.reset();
+			truncate_file(_path, pos);
+		}
+		_log_size = pos;
+		_writer.open(_path, std::ios::binary | std::ios::app);
+		if (!_writer.good())
+			throw JsonDiffException(std::string("can't open version log ") + _path);
+		if (!_versions.empty())
+		{
+			uint64_t last = _versions.size() - 1;
+			_head = read_snapshot(_keyframes.back());
+			for (uint64_t version = _keyframes.back() + 1; version <= last; version++)
+				_json_diff.patch_inplace(_head, *read_diff(version));
+		}
+	}
+
+	uint64_t VersionStore::append_record(char type, const std::string& payload)
+	{
+		char header[version_record_header_size];
+		header[0] = type;
+		put_u64(header + 1, payload.size());
+		put_u64(header + 9, fingerprint_bytes(payload.data(), payload.size()));
+		_writer.write(header, version_record_header_size);
+		_writer.write(payload.data(), payload.size());
+		if (!_writer.good())
+			throw JsonDiffException(std::string("can't write version log ") + _path);
+		uint64_t payload_offset = _log_size + version_record_header_size;
+		_log_size = payload_offset + payload.size();
+		return payload_offset;
+	}
+
+	const char* VersionStore::read_payload(uint64_t offset, uint64_t size)
+	{
+		if (!_log || offset + size > _log->size())
+		{
+			// written after the last mapping
+			flush();
+			_log.reset();
+			_log.reset(new MappedFile(_path));
+		}
+		return _log->data() + offset;
+	}
+
+	DiffResultP VersionStore::read_diff(uint64_t version)
+	{
+		const auto& entry = _versions[version];
+		return DiffResult::from_binary(read_payload(entry.diff_offset, entry.diff_size), (size_t)entry.diff_size);
+	}
+
+	JsonValue VersionStore::read_snapshot(uint64_t version)
+	{
+		const auto& entry = _versions[version];
+		const char* text = read_payload(entry.snapshot_offset, entry.snapshot_size);
+		return json_loads(std::string(text, (size_t)entry.snapshot_size));
+	}
+
+	uint64_t VersionStore::commit(const JsonValue& json)
+	{
+		uint64_t version = _versions.size();
+		VersionEntry entry = { 0, 0, 0, 0 };
+		auto diff_payload = _json_diff.diff(_head, json)->binary();
+		bool keyframe = version % _options.keyframe_interval == 0;
+		if (keyframe)
+		{
+			auto snapshot_payload = json_dumps(json);
+			entry.snapshot_offset = append_record(version_record_snapshot, snapshot_payload);
+			entry.snapshot_size = snapshot_payload.size();
+		}
+		entry.diff_offset = append_record(version_record_diff, diff_payload);
+		entry.diff_size = diff_payload.size();
+		_versions.push_back(entry);
+		if (keyframe)
+			_keyframes.push_back(version);
+		_head = json;
+		return version;
+	}
+
+	uint64_t VersionStore::version_count() const
+	{
+		return _versions.size();
+	}
+
+	const JsonValue& VersionStore::head() const
+	{
+		return _head;
+	}
+
+	JsonValue VersionStore::get(uint64_t version)
+	{
+		if (version >= _versions.size())
+			throw JsonDiffException("version " + std::to_string(version) + " not in the version log");
+		uint64_t last = _versions.size() - 1;
+		if (version == last)
+			return _head;
+		// the nearest keyframe at or before version, and the one after it or the head
+		auto next = std::upper_bound(_keyframes.begin(), _keyframes.end(), version);
+		uint64_t before = *(next - 1);
+		uint64_t after = next != _keyframes.end() ? *next : last;
+		JsonValue json;
+		if (version - before <= after - version)
+		{
+			json = read_snapshot(before);
+			for (uint64_t v = before + 1; v <= version; v++)
+				_json_diff.patch_inplace(json, *read_diff(v));
+		}
+		else
+		{
+			json = after == last ? _head : read_snapshot(after);
+			for (uint64_t v = after; v > version; v--)
+				_json_diff.rollback_inplace(json, *read_diff(v));
+		}
+		return json;
+	}
+
+	DiffResultP VersionStore::version_diff(uint64_t version)
+	{
+		if (version >= _versions.size())
+			throw JsonDiffException("version " + std::to_string(version) + " not in the version log");
+		return read_diff(version);
+	}
+
+	DiffResultP VersionStore::changes(uint64_t from, uint64_t to)
+	{
+		if (from > to || to >= _versions.size())
+			throw JsonDiffException("version range not in the version log");
+		std::vector<DiffResultP> diffs;
+		for (uint64_t version = from + 1; version <= to; version++)
+			diffs.push_back(read_diff(version));
+		return _json_diff.compose(diffs);
+	}
+
+	void VersionStore::flush()
+	{
+		_writer.flush();
+		if (!_writer.good())
+			throw JsonDiffException(std::string("can't write version log ") + _path);
+	}
+}